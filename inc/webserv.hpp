@@ -15,9 +15,62 @@
 #define TIME_OUT_POLL		100
 #define TIME_OUT_REQUEST	5000
 #define TIME_OUT_RESPONSE	10000
+#define TIME_OUT_CGI		5000
 #define MAX_BUFFER_SIZE		10000000
 #define MAX_BODY_SIZE		10000000
+#define MAX_UPLOAD_BODY_SIZE	68719476736ULL	// client_max_body_size limit, bodies past MAX_BUFFER_SIZE only fit streamed uploads
 #define MAX_HEADER_SIZE		8192
+#define MAX_STREAM_BACKLOG	262144	// streamed bytes queued for a client before the source is paused
+#define PIPELINE_DEPTH		16		// pipelined requests in flight per connection without pipeline_depth
+#define MAX_PIPELINE_DEPTH	128
+#define MAX_CGI_POOL_WORKERS	64
+#define MAX_CGI_POOL_REQUESTS	1000000	// largest cgi_pool_max_requests
+#define MAX_CGI_POOL_QUEUE	4096	// largest cgi_pool_queue
+#define MAX_CGI_CACHE_TIME	31536000	// seconds, largest cgi_cache and cgi_cache_stale
+#define FILE_IO_THREADS		4		// threads running blocking file handlers (GET, DELETE)
+#define FILE_IO_QUEUE		1024	// file jobs waiting for a thread before new ones get 503
+#define AUTOINDEX_CACHE_ENTRIES	256		// rendered directory listings kept
+#define AUTOINDEX_CACHE_TTL	1000	// ms a listing is served without re-reading the directory
+#define AUTOINDEX_PAGE_SIZE	1000	// entries per page of a paged listing (?page=, ?cursor=) without ?limit=
+#define AUTOINDEX_PAGE_MAX	10000	// largest ?limit= accepted
+#define AUTOINDEX_STREAM_BATCH	256		// entries rendered per file I/O job while a page streams
+#define RESPONSE_HEADERS_RESERVED	8	// header slots a response starts with
+#define HPACK_TABLE_SIZE	4096	// HPACK dynamic table of each direction, the protocol default
+#define H2_WINDOW_SIZE		1048576	// HTTP/2 receive window of the connection and of each stream, topped up once half is used
+#define H2_MAX_FRAME_SIZE	16384	// largest HTTP/2 frame accepted, the protocol default
+#define PROXY_CONNECT_TIMEOUT	5000	// ms to connect to an upstream without proxy_connect_timeout
+#define PROXY_SEND_TIMEOUT	60000	// ms an upstream may take to accept the next request bytes
+#define PROXY_READ_TIMEOUT	60000	// ms an upstream may take between two reads of its response
+#define PROXY_KEEPALIVE		16		// idle upstream connections kept per address without proxy_keepalive
+#define PROXY_KEEPALIVE_TIMEOUT	60000	// ms an idle upstream connection is kept
+#define MAX_PROXY_TIMEOUT	3600000
+#define UPSTREAM_MAX_FAILS	1		// failed attempts within fail_timeout that take a backend out without max_fails
+#define UPSTREAM_FAIL_TIMEOUT	10		// seconds failures are counted over and a failed backend stays out
+#define UPSTREAM_MAX_BACKOFF	5		// times the time out doubles for a backend failing again on return
+#define UPSTREAM_HASH_POINTS	160		// points per unit of weight on the consistent hash ring
+#define MAX_UPSTREAM_WEIGHT	100
+#define HEALTH_CHECK_INTERVAL	5000	// ms between two probes of a backend without interval=
+#define HEALTH_CHECK_TIMEOUT	2000	// ms a probe may take without timeout=
+#define HEALTH_CHECK_RISE	2		// passed probes in a row that bring a backend back
+#define HEALTH_CHECK_FALL	3		// failed probes in a row that take a backend out
+#define DISK_CACHE_MAX_SIZE	256		// MB of responses kept in a proxy_cache_path without max_size=
+#define DISK_CACHE_INACTIVE	600		// seconds an unused response is kept without inactive=
+#define DISK_CACHE_SWEEP_INTERVAL	1000	// ms between two sweeps of a disk cache
+#define DISK_CACHE_SWEEP_BATCH	64		// files a sweep removes at most, the rest waits for the next one
+#define DISK_CACHE_READ_SIZE	65536	// bytes of a cached body read per event while it is sent
+#define METRICS_RATE_WINDOW	10		// seconds the requests per second of stub_status are averaged over
+#define ACCESS_LOG_BUFFER	64		// KB of log lines an access_log holds before lines are dropped, without buffer=
+#define ACCESS_LOG_FLUSH	1000	// ms between two writes of an access_log that is less than half full, without flush=
+#define MAX_ACCESS_LOG_BUFFER	65536	// KB, largest buffer= of an access_log
+#define MAX_ACCESS_LOG_FLUSH	3600000	// ms, largest flush= of an access_log
+#define LOG_LEVEL_ERROR		0
+#define LOG_LEVEL_WARN		1
+#define LOG_LEVEL_INFO		2
+#define LOG_LEVEL_DEBUG		3
+#define LOG_LEVEL_TRACE		4
+#ifndef LOG_MAX_LEVEL
+# define LOG_MAX_LEVEL	LOG_LEVEL_INFO	// most verbose level compiled in, `make debug` keeps debug and trace sites
+#endif
 #ifndef MAX_RESPONSE_SIZE
 # define MAX_RESPONSE_SIZE	100000 // Default value for non-test builds
 #endif
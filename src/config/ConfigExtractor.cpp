@@ -8,10 +8,21 @@ void	ConfigExtractor::extractFields(std::vector<Server>& servs, std::ifstream& c
 		size_t first_non_space = line.find_first_not_of(" \t");
 		if (first_non_space == std::string::npos || line[first_non_space] == '#')
 			continue ;
+		if (extractLogFormat(serv, line))
+			continue ;	// a pattern may hold braces, it is not a block
 		if (line.find("server {") != std::string::npos) {
 			serv = Server();
 			continue ;
 		}
+		if (std::regex_match(line, std::regex("^\\s*types\\s*\\{$"))) {
+			extractTypes(serv, cfg);
+			continue ;
+		}
+		std::smatch upstream;
+		if (std::regex_match(line, upstream, std::regex("^\\s*upstream\\s+(\\S+)\\s+\\{$"))) {
+			extractUpstream(serv, upstream[1], cfg);
+			continue ;
+		}
 		if (line.find("}") != std::string::npos) {
 			servs.push_back(serv);
 			continue ;
@@ -19,10 +30,14 @@ void	ConfigExtractor::extractFields(std::vector<Server>& servs, std::ifstream& c
 		extractPort(serv, line);
 		extractAddress(serv, line);
 		extractMaxBodySize(serv, line);
+		extractPipelineDepth(serv, line);
 		extractName(serv, line);
 		extractRoot(serv, line);
 		extractIndex(serv, line);
 		extractErrorPage(serv, line);
+		extractCachePath(serv, line);
+		extractAccessLog(serv, line);
+		extractLogLevel(serv, line);
 		if (line.find("location ") != std::string::npos) {
 			Location loc;
 			extractLocation(loc, line);
@@ -46,9 +61,107 @@ void	ConfigExtractor::extractLocationFields(Server& serv, Location& loc, std::if
 		extractCgiExt(loc, line);
 		extractUploadPath(loc, line);
 		extractReturn(loc, line);
+		extractCgiPool(loc, line);
+		extractCgiPoolMaxRequests(loc, line);
+		extractCgiPoolQueue(loc, line);
+		extractCgiCache(loc, line);
+		extractCgiCacheStale(loc, line);
+		extractCgiCacheKeyHeaders(loc, line);
+		extractProxyPass(loc, line);
+		extractProxyTimeouts(loc, line);
+		extractProxyKeepalive(loc, line);
+		extractProxyCache(loc, line);
+		extractStubStatus(loc, line);
+	}
+}
+
+// MIME type first, then the extensions it is served for, with or without the dot
+void	ConfigExtractor::extractTypes(Server& serv, std::ifstream& cfg) {
+	std::string line;
+
+	while (std::getline(cfg, line)) {
+		size_t first_non_space = line.find_first_not_of(" \t");
+		if (first_non_space == std::string::npos || line[first_non_space] == '#')
+			continue ;
+		if (line.find("}") != std::string::npos)
+			break ;
+		std::istringstream iss(line);
+		std::string type;
+		std::string extension;
+		iss >> type;
+		while (iss >> extension) {
+			if (extension[0] == '.')
+				extension.erase(0, 1);
+			std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+			serv.setType(extension, type);
+		}
 	}
 }
 
+// balance <policy> [uri|ip], health_check <path> [status=N] [interval=N] [timeout=N] [rise=N] [fall=N],
+// then one server host[:port] [weight=N] [max_fails=N] [fail_timeout=N] per backend
+void	ConfigExtractor::extractUpstream(Server& serv, const std::string& name, std::ifstream& cfg) {
+	std::string	line;
+	Upstream	upstream;
+	upstream.name = name;
+
+	while (std::getline(cfg, line)) {
+		size_t first_non_space = line.find_first_not_of(" \t");
+		if (first_non_space == std::string::npos || line[first_non_space] == '#')
+			continue ;
+		if (line.find("}") != std::string::npos)
+			break ;
+		std::istringstream iss(line);
+		std::string keyword;
+		iss >> keyword;
+		if (keyword == "balance") {
+			iss >> upstream.balance >> upstream.hash_key;
+			continue ;
+		}
+		if (keyword == "health_check") {
+			iss >> upstream.health_path;
+			std::string param;
+			while (iss >> param) {
+				size_t eq = param.find('=');
+				std::string key = param.substr(0, eq);
+				size_t value = std::stoul(param.substr(eq + 1));
+				if (key == "status")
+					upstream.health_status = static_cast<int>(value);
+				else if (key == "interval")
+					upstream.health_interval = value;
+				else if (key == "timeout")
+					upstream.health_timeout = value;
+				else if (key == "rise")
+					upstream.health_rise = value;
+				else if (key == "fall")
+					upstream.health_fall = value;
+			}
+			continue ;
+		}
+		UpstreamServer backend;
+		std::string address;
+		iss >> address;
+		size_t colon = address.find(':');
+		backend.host = address.substr(0, colon);
+		if (colon != std::string::npos)
+			backend.port = std::stoi(address.substr(colon + 1));
+		std::string param;
+		while (iss >> param) {
+			size_t eq = param.find('=');
+			std::string key = param.substr(0, eq);
+			size_t value = std::stoul(param.substr(eq + 1));
+			if (key == "weight")
+				backend.weight = value;
+			else if (key == "max_fails")
+				backend.max_fails = value;
+			else if (key == "fail_timeout")
+				backend.fail_timeout = value;
+		}
+		upstream.servers.push_back(backend);
+	}
+	serv.setUpstream(upstream);
+}
+
 void	ConfigExtractor::extractPort(Server& serv, const std::string& line) {
 	std::regex	re("^\\s*listen\\s+(\\d+)$");
 	std::smatch	match;
@@ -73,7 +186,14 @@ void	ConfigExtractor::extractMaxBodySize(Server& serv, const std::string& line)
 	std::regex	re("^\\s*client_max_body_size\\s+(\\d+)$");
 	std::smatch	match;
 	if (std::regex_search(line, match, re))
-		serv.setMaxBodySize(std::stoi(match[1]));
+		serv.setMaxBodySize(std::stoull(match[1]));
+}
+
+void	ConfigExtractor::extractPipelineDepth(Server& serv, const std::string& line) {
+	std::regex	re("^\\s*pipeline_depth\\s+(\\d+)$");
+	std::smatch	match;
+	if (std::regex_search(line, match, re))
+		serv.setPipelineDepth(std::stoull(match[1]));
 }
 
 void	ConfigExtractor::extractName(Server& serv, const std::string& line) {
@@ -107,6 +227,74 @@ void	ConfigExtractor::extractErrorPage(Server& serv, const std::string& line) {
 	}
 }
 
+// proxy_cache_path <dir> [max_size=MB] [inactive=seconds]
+void	ConfigExtractor::extractCachePath(Server& serv, const std::string& line) {
+	std::regex	re("^\\s*proxy_cache_path\\s+(\\S+)(.*)$");
+	std::smatch	match;
+	if (!std::regex_search(line, match, re))
+		return ;
+	CachePath cache_path;
+	cache_path.path = match[1];
+	std::istringstream iss(match[2]);
+	std::string param;
+	while (iss >> param) {
+		size_t eq = param.find('=');
+		std::string key = param.substr(0, eq);
+		size_t value = std::stoul(param.substr(eq + 1));
+		if (key == "max_size")
+			cache_path.max_size = value;
+		else if (key == "inactive")
+			cache_path.inactive = value;
+	}
+	serv.setCachePath(cache_path);
+}
+
+// log_format <name> [escape=json] <pattern>, the pattern running to the end of the line
+bool	ConfigExtractor::extractLogFormat(Server& serv, const std::string& line) {
+	std::regex	re("^\\s*log_format\\s+(\\w+)(\\s+escape=(default|json))?\\s+(\\S.*)$");
+	std::smatch	match;
+	if (!std::regex_match(line, match, re))
+		return false;
+	LogFormat format;
+	format.pattern = match[4];
+	format.json = match[3] == "json";
+	serv.setLogFormat(match[1], format);
+	return true;
+}
+
+// access_log <path> [format] [buffer=KB] [flush=ms]
+void	ConfigExtractor::extractAccessLog(Server& serv, const std::string& line) {
+	std::regex	re("^\\s*access_log\\s+(\\S+)(.*)$");
+	std::smatch	match;
+	if (!std::regex_search(line, match, re))
+		return ;
+	AccessLogConfig access_log;
+	access_log.path = match[1];
+	std::istringstream iss(match[2]);
+	std::string param;
+	while (iss >> param) {
+		size_t eq = param.find('=');
+		if (eq == std::string::npos) {
+			access_log.format = param;
+			continue ;
+		}
+		std::string key = param.substr(0, eq);
+		size_t value = std::stoul(param.substr(eq + 1));
+		if (key == "buffer")
+			access_log.buffer = value;
+		else if (key == "flush")
+			access_log.flush = value;
+	}
+	serv.setAccessLog(access_log);
+}
+
+void	ConfigExtractor::extractLogLevel(Server& serv, const std::string& line) {
+	std::regex	re("^\\s*log_level\\s+(\\S+)$");
+	std::smatch	match;
+	if (std::regex_search(line, match, re))
+		serv.setLogLevel(match[1]);
+}
+
 void	ConfigExtractor::extractLocation(Location& loc, const std::string& line) {
 	std::regex	re("^\\s*location\\s+(\\S+)\\s*\\{$");
 	std::smatch	match;
@@ -181,3 +369,95 @@ void	ConfigExtractor::extractReturn(Location& loc, const std::string& line) {
 	if (std::regex_search(line, match, re))
 		loc.return_url = match[1];
 }
+
+void	ConfigExtractor::extractCgiPool(Location& loc, const std::string& line) {
+	std::regex	re("^\\s*cgi_pool\\s+(\\d+)$");
+	std::smatch	match;
+	if (std::regex_search(line, match, re))
+		loc.cgi_pool_workers = std::stoul(match[1]);
+}
+
+void	ConfigExtractor::extractCgiPoolMaxRequests(Location& loc, const std::string& line) {
+	std::regex	re("^\\s*cgi_pool_max_requests\\s+(\\d+)$");
+	std::smatch	match;
+	if (std::regex_search(line, match, re))
+		loc.cgi_pool_max_requests = std::stoul(match[1]);
+}
+
+void	ConfigExtractor::extractCgiPoolQueue(Location& loc, const std::string& line) {
+	std::regex	re("^\\s*cgi_pool_queue\\s+(\\d+)$");
+	std::smatch	match;
+	if (std::regex_search(line, match, re))
+		loc.cgi_pool_queue = std::stoul(match[1]);
+}
+
+void	ConfigExtractor::extractCgiCache(Location& loc, const std::string& line) {
+	std::regex	re("^\\s*cgi_cache\\s+(\\d+)$");
+	std::smatch	match;
+	if (std::regex_search(line, match, re))
+		loc.cgi_cache_ttl = std::stoul(match[1]);
+}
+
+void	ConfigExtractor::extractCgiCacheStale(Location& loc, const std::string& line) {
+	std::regex	re("^\\s*cgi_cache_stale\\s+(\\d+)$");
+	std::smatch	match;
+	if (std::regex_search(line, match, re))
+		loc.cgi_cache_stale = std::stoul(match[1]);
+}
+
+void	ConfigExtractor::extractCgiCacheKeyHeaders(Location& loc, const std::string& line) {
+	std::regex	re("^\\s*cgi_cache_key_headers\\s+(.+)$");
+	std::smatch	match;
+	if (std::regex_search(line, match, re))
+	{
+		std::istringstream iss(match[1]);
+		std::string token;
+		std::vector<std::string> headers;
+		while (iss >> token)
+			headers.push_back(token);
+		loc.cgi_cache_key_headers = headers;
+	}
+}
+
+void	ConfigExtractor::extractProxyPass(Location& loc, const std::string& line) {
+	std::regex	re("^\\s*proxy_pass\\s+(\\S+)$");
+	std::smatch	match;
+	if (std::regex_search(line, match, re))
+		loc.proxy_pass = match[1];
+}
+
+void	ConfigExtractor::extractProxyTimeouts(Location& loc, const std::string& line) {
+	std::regex	re("^\\s*proxy_(connect|send|read)_timeout\\s+(\\d+)$");
+	std::smatch	match;
+	if (std::regex_search(line, match, re))
+	{
+		size_t timeout = std::stoul(match[2]);
+		if (match[1] == "connect")
+			loc.proxy_connect_timeout = timeout;
+		else if (match[1] == "send")
+			loc.proxy_send_timeout = timeout;
+		else
+			loc.proxy_read_timeout = timeout;
+	}
+}
+
+void	ConfigExtractor::extractProxyKeepalive(Location& loc, const std::string& line) {
+	std::regex	re("^\\s*proxy_keepalive\\s+(\\d+)$");
+	std::smatch	match;
+	if (std::regex_search(line, match, re))
+		loc.proxy_keepalive = std::stoul(match[1]);
+}
+
+void	ConfigExtractor::extractProxyCache(Location& loc, const std::string& line) {
+	std::regex	re("^\\s*proxy_cache\\s+(\\d+)$");
+	std::smatch	match;
+	if (std::regex_search(line, match, re))
+		loc.proxy_cache = std::stoul(match[1]);
+}
+
+void	ConfigExtractor::extractStubStatus(Location& loc, const std::string& line) {
+	std::regex	re("^\\s*stub_status\\s+(\\S+)$");
+	std::smatch	match;
+	if (std::regex_search(line, match, re))
+		loc.stub_status = match[1] == "on";
+}
@@ -5,6 +5,8 @@
 #include <regex>
 #include <fstream>
 #include <string>
+#include <sstream>
+#include <algorithm>
 
 #include "../server/Server.hpp"
 
@@ -14,10 +16,15 @@ class ConfigExtractor {
 		void		extractPort(Server& serv, const std::string& line);
 		void		extractAddress(Server& serv, const std::string& line);
 		void		extractMaxBodySize(Server& serv, const std::string& line);
+		static void	extractPipelineDepth(Server& serv, const std::string& line);
 		static void	extractName(Server& serv, const std::string& line);
 		static void	extractRoot(Server& serv, const std::string& line);
 		static void	extractIndex(Server& serv, const std::string& line);
 		static void	extractErrorPage(Server& serv, const std::string& line);
+		static void	extractCachePath(Server& serv, const std::string& line);
+		static bool	extractLogFormat(Server& serv, const std::string& line);
+		static void	extractAccessLog(Server& serv, const std::string& line);
+		static void	extractLogLevel(Server& serv, const std::string& line);
 
 		static void	extractLocation(Location& loc, const std::string& line);
 		static void	extractAllowedMethods(Location& loc, const std::string& line);
@@ -27,8 +34,21 @@ class ConfigExtractor {
 		static void	extractCgiExt(Location& loc, const std::string& line);
 		static void	extractUploadPath(Location& loc, const std::string& line);
 		static void	extractReturn(Location& loc, const std::string& line);
+		static void	extractCgiPool(Location& loc, const std::string& line);
+		static void	extractCgiPoolMaxRequests(Location& loc, const std::string& line);
+		static void	extractCgiPoolQueue(Location& loc, const std::string& line);
+		static void	extractCgiCache(Location& loc, const std::string& line);
+		static void	extractCgiCacheStale(Location& loc, const std::string& line);
+		static void	extractCgiCacheKeyHeaders(Location& loc, const std::string& line);
+		static void	extractProxyPass(Location& loc, const std::string& line);
+		static void	extractProxyTimeouts(Location& loc, const std::string& line);
+		static void	extractProxyKeepalive(Location& loc, const std::string& line);
+		static void	extractProxyCache(Location& loc, const std::string& line);
+		static void	extractStubStatus(Location& loc, const std::string& line);
 
 	public:
 		void		extractFields(std::vector<Server>& servs, std::ifstream& cfg);
 		void		extractLocationFields(Server& serv, Location& loc, std::ifstream& cfg);
+		void		extractTypes(Server& serv, std::ifstream& cfg);
+		void		extractUpstream(Server& serv, const std::string& name, std::ifstream& cfg);
 };
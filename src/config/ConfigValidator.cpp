@@ -1,4 +1,6 @@
 #include "ConfigValidator.hpp"
+#include "../server/AccessLog.hpp"
+#include "../server/Log.hpp"
 
 void	ConfigValidator::validateFields(std::ifstream& cfg) {
 	std::stack<std::string>	blockstack;
@@ -37,6 +39,8 @@ void	ConfigValidator::handleOpenBlock(std::stack<std::string>& blockstack, const
 				LocationType& current_type, bool& location_present, std::set<std::string>& locations) {
 	std::regex	server("^\\s*server\\s*\\{$");
 	std::regex	location("^\\s*location\\s+(\\S+)\\s+\\{$");
+	std::regex	types("^\\s*types\\s*\\{$");
+	std::regex	upstream("^\\s*upstream\\s+([A-Za-z0-9._-]+)\\s+\\{$");
 
 	std::smatch				match;
 
@@ -45,11 +49,19 @@ void	ConfigValidator::handleOpenBlock(std::stack<std::string>& blockstack, const
 	if (std::regex_match(line, match, server)) {
 		blocktype = "server";
 		locations.clear();
+		_upstreams.clear();
+		_proxy_cache = false;
+		_log_formats.clear();
+		_access_log_format.clear();
 		resetDirectivesFlags(blocktype);
 	}
 	else if (std::regex_match(line, match, location)) {
 		if (blockstack.top() == "location")
 			throw std::runtime_error("Error: Config: Nested 'location' block is not allowed: " + line);
+		if (blockstack.top() == "types")
+			throw std::runtime_error("Error: Config: 'location' block inside 'types' is not allowed: " + line);
+		if (blockstack.top() == "upstream")
+			throw std::runtime_error("Error: Config: 'location' block inside 'upstream' is not allowed: " + line);
 		blocktype = "location";
 		if (!locations.insert(match[1]).second)
 			throw std::runtime_error("Error: Config: Duplicate location: " + line);
@@ -57,6 +69,19 @@ void	ConfigValidator::handleOpenBlock(std::stack<std::string>& blockstack, const
 			throw std::runtime_error("Error: Config: Invalid value for directive: location");
 		resetDirectivesFlags(blocktype);
 	}
+	else if (std::regex_match(line, match, types)) {
+		if (blockstack.empty() || blockstack.top() != "server")
+			throw std::runtime_error("Error: Config: 'types' block must be inside a 'server' block: " + line);
+		blocktype = "types";
+	}
+	else if (std::regex_match(line, match, upstream)) {
+		if (blockstack.empty() || blockstack.top() != "server")
+			throw std::runtime_error("Error: Config: 'upstream' block must be inside a 'server' block: " + line);
+		if (!_upstreams.insert(match[1]).second)
+			throw std::runtime_error("Error: Config: Duplicate upstream: " + line);
+		blocktype = "upstream";
+		_upstream_servers = 0;
+	}
 	else
 		throw std::runtime_error("Error: Config: Invalid block type: " + line);
 
@@ -69,6 +94,16 @@ void	ConfigValidator::handleOpenBlock(std::stack<std::string>& blockstack, const
 void	ConfigValidator::handleCloseBlock(std::stack<std::string>& blockstack, const std::string& line, LocationType current_type, bool location_present) {
 	if (blockstack.empty())
 		throw std::runtime_error("Error: Config: Unbalanced }: " + line);
+	if (blockstack.top() == "types") {
+		blockstack.pop();
+		return ;
+	}
+	if (blockstack.top() == "upstream") {
+		if (_upstream_servers == 0)
+			throw std::runtime_error("Error: Config: Missing server in upstream block");
+		blockstack.pop();
+		return ;
+	}
 	verifyMandatoryDirectives(blockstack.top(), current_type);
 	if (blockstack.top() == "server" && !location_present)
 		throw std::runtime_error("Error: Config: Missing directory type of location");
@@ -79,10 +114,28 @@ void	ConfigValidator::handleKeyword(std::stack<std::string>&	blockstack, const s
 	if (blockstack.empty())
 		throw std::runtime_error("Error: Config: Keyword outside of any block: " + line);
 	std::string currentBlock = blockstack.top();
-	if (currentBlock == "server")
+	if (currentBlock == "server") {
 		validateKeyword(line, "server");
-	if (currentBlock == "location")
+		std::smatch match;
+		if (std::regex_match(line, match, std::regex("^\\s*log_format\\s+(\\w+)\\s.*"))
+			&& !_log_formats.insert(match[1]).second)
+			throw std::runtime_error("Error: Config: Duplicate log_format: " + line);
+		if (std::regex_match(line, match, std::regex("^\\s*access_log\\s+\\S+(\\s+(\\w+))?(\\s.*)?$")))
+			_access_log_format = match[2].matched ? match[2].str() : "main";
+	}
+	if (currentBlock == "location") {
 		validateKeyword(line, "location");
+		if (std::regex_match(line, std::regex("^\\s*proxy_cache\\s.*")))
+			_proxy_cache = true;
+	}
+	if (currentBlock == "types" && !validateType(line))
+		throw std::runtime_error("Error: Config: Malformed directive: " + line);
+	if (currentBlock == "upstream") {
+		if (!validateUpstreamLine(line))
+			throw std::runtime_error("Error: Config: Malformed directive: " + line);
+		if (std::regex_search(line, std::regex("^\\s*server\\s")))
+			++_upstream_servers;
+	}
 }
 
 ConfigValidator::ConfigValidator() {
@@ -103,6 +156,16 @@ ConfigValidator::ConfigValidator() {
 		"cgi_ext"
 	};
 
+	_mandatory_location_directives_proxy = {
+		"allow_methods",
+		"proxy_pass"
+	};
+
+	_mandatory_location_directives_status = {
+		"allow_methods",
+		"stub_status"
+	};
+
 	_server_directives = {
 		{"listen", std::regex("^\\s*listen\\s+\\d+$"), validatePort},
 		{"server_name", std::regex("^\\s*server_name\\s+\\S+$"), nullptr},
@@ -110,7 +173,12 @@ ConfigValidator::ConfigValidator() {
 		{"root", std::regex("^\\s*root\\s+\\S+$"), nullptr},
 		{"index", std::regex("^\\s*index\\s+\\S+$"), validateIndex},
 		{"client_max_body_size", std::regex("^\\s*client_max_body_size\\s+\\d+$"), validateMaxBodySize},
-		{"error_page", std::regex("^\\s*error_page\\s+\\d+\\s+\\S+$"), validateErrorPage}
+		{"pipeline_depth", std::regex("^\\s*pipeline_depth\\s+\\d+$"), validatePipelineDepth},
+		{"error_page", std::regex("^\\s*error_page\\s+\\d+\\s+\\S+$"), validateErrorPage},
+		{"proxy_cache_path", std::regex("^\\s*proxy_cache_path\\s+\\S+(\\s+(max_size|inactive)=\\d{1,9})*$"), validateCachePath},
+		{"log_format", std::regex("^\\s*log_format\\s+\\w+(\\s+escape=(default|json))?\\s+\\S.*$"), validateLogFormat},
+		{"access_log", std::regex("^\\s*access_log\\s+\\S+(\\s+\\w+)?(\\s+(buffer|flush)=\\d{1,9})*$"), validateAccessLog},
+		{"log_level", std::regex("^\\s*log_level\\s+\\S+$"), validateLogLevel}
 	};
 
 	_location_directives = {
@@ -121,7 +189,20 @@ ConfigValidator::ConfigValidator() {
 		{"cgi_path", std::regex("^\\s*cgi_path\\s+\\S+$"), nullptr},
 		{"cgi_ext", std::regex("^\\s*cgi_ext(\\s+\\S+)+$"), validateExt},
 		{"upload_to", std::regex("^\\s*upload_to\\s+\\S+$"), nullptr},
-		{"return", std::regex("^\\s*return\\s+\\S+$"), nullptr}
+		{"return", std::regex("^\\s*return\\s+\\S+$"), nullptr},
+		{"cgi_pool", std::regex("^\\s*cgi_pool\\s+\\d+$"), validateCgiPool},
+		{"cgi_pool_max_requests", std::regex("^\\s*cgi_pool_max_requests\\s+\\d+$"), validateCgiPoolMaxRequests},
+		{"cgi_pool_queue", std::regex("^\\s*cgi_pool_queue\\s+\\d+$"), validateCgiPoolQueue},
+		{"cgi_cache", std::regex("^\\s*cgi_cache\\s+\\d+$"), validateCgiCacheTime},
+		{"cgi_cache_stale", std::regex("^\\s*cgi_cache_stale\\s+\\d+$"), validateCgiCacheTime},
+		{"cgi_cache_key_headers", std::regex("^\\s*cgi_cache_key_headers(\\s+\\S+)+$"), nullptr},
+		{"proxy_pass", std::regex("^\\s*proxy_pass\\s+\\S+$"), validateProxyPass},
+		{"proxy_connect_timeout", std::regex("^\\s*proxy_connect_timeout\\s+\\d+$"), validateProxyTimeout},
+		{"proxy_send_timeout", std::regex("^\\s*proxy_send_timeout\\s+\\d+$"), validateProxyTimeout},
+		{"proxy_read_timeout", std::regex("^\\s*proxy_read_timeout\\s+\\d+$"), validateProxyTimeout},
+		{"proxy_keepalive", std::regex("^\\s*proxy_keepalive\\s+\\d+$"), nullptr},
+		{"proxy_cache", std::regex("^\\s*proxy_cache\\s+\\d+$"), nullptr},
+		{"stub_status", std::regex("^\\s*stub_status\\s+\\S+$"), validateStubStatus}
 	};
 }
 
@@ -184,10 +265,25 @@ bool	ConfigValidator::validateMaxBodySize(const std::string& line) {
 	if (pos == std::string::npos)
 		return false;
 
-	int body_size = std::stoi(line.substr(pos + 1));
-	if (body_size >= 0 && body_size <= MAX_BODY_SIZE)
-		return true;
-	return false;
+	try {
+		unsigned long long body_size = std::stoull(line.substr(pos + 1));
+		return body_size <= MAX_UPLOAD_BODY_SIZE;
+	} catch (const std::out_of_range&) {
+		return false;
+	}
+}
+
+bool	ConfigValidator::validatePipelineDepth(const std::string& line) {
+	size_t pos = line.find_last_of(' ');
+	if (pos == std::string::npos)
+		return false;
+
+	try {
+		unsigned long long depth = std::stoull(line.substr(pos + 1));
+		return depth >= 1 && depth <= MAX_PIPELINE_DEPTH;
+	} catch (const std::out_of_range&) {
+		return false;
+	}
 }
 
 bool	ConfigValidator::validateErrorPage(const std::string& line) {
@@ -209,6 +305,46 @@ bool	ConfigValidator::validateErrorPage(const std::string& line) {
 	return true;
 }
 
+// One line of a types {} block: a MIME type and the extensions it is served for
+bool	ConfigValidator::validateType(const std::string& line) {
+	std::regex	re("^\\s*[A-Za-z0-9][A-Za-z0-9!#$&^_.+-]*/[A-Za-z0-9][A-Za-z0-9!#$&^_.+-]*"
+					"(\\s+\\.?[A-Za-z0-9_+-][A-Za-z0-9._+-]{0,30})+$");
+	return std::regex_match(line, re);
+}
+
+// One line of an upstream {} block: its balancing policy, its health check or one of its servers
+bool	ConfigValidator::validateUpstreamLine(const std::string& line) {
+	std::regex	balance("^\\s*balance\\s+(round_robin|least_conn|hash\\s+(uri|ip))$");
+	std::regex	health("^\\s*health_check\\s+/\\S*((\\s+(status|interval|timeout|rise|fall)=\\d{1,7}))*$");
+	std::regex	server("^\\s*server\\s+[A-Za-z0-9.-]+(:(\\d{1,5}))?((\\s+(weight|max_fails|fail_timeout)=\\d{1,9}))*$");
+	std::smatch	match;
+	if (std::regex_match(line, balance))
+		return true;
+	if (std::regex_match(line, health)) {
+		std::regex	param("(status|interval|timeout|rise|fall)=(\\d+)");
+		for (std::sregex_iterator it(line.begin(), line.end(), param), end; it != end; ++it) {
+			size_t value = std::stoul((*it)[2]);
+			if (value == 0 || ((*it)[1] == "status" && (value < 100 || value > 599)))
+				return false;
+		}
+		return true;
+	}
+	if (!std::regex_match(line, match, server))
+		return false;
+	if (match[2].matched) {
+		int port = std::stoi(match[2]);
+		if (port < 1 || port > 65535)
+			return false;
+	}
+	std::regex	weight("weight=(\\d+)");
+	if (std::regex_search(line, match, weight)) {
+		size_t value = std::stoul(match[1]);
+		if (value < 1 || value > MAX_UPSTREAM_WEIGHT)
+			return false;
+	}
+	return true;
+}
+
 bool	ConfigValidator::validateLocation(const std::string& line, LocationType& type, bool& location_present) {
 	std::regex	re("^\\s*location\\s+(\\S+)\\s+\\{$");
 	std::smatch	match;
@@ -267,6 +403,65 @@ bool	ConfigValidator::validateExt(const std::string& line) {
 	return false;
 }
 
+// Last word of the line is a number from min to max; too many digits is out of range too
+bool	ConfigValidator::validateNumber(const std::string& line, unsigned long long min, unsigned long long max) {
+	size_t pos = line.find_last_of(" \t");
+	if (pos == std::string::npos)
+		return false;
+
+	try {
+		unsigned long long value = std::stoull(line.substr(pos + 1));
+		return value >= min && value <= max;
+	} catch (const std::exception&) {
+		return false;
+	}
+}
+
+bool	ConfigValidator::validateCgiPool(const std::string& line) {
+	return validateNumber(line, 0, MAX_CGI_POOL_WORKERS);
+}
+
+bool	ConfigValidator::validateCgiPoolMaxRequests(const std::string& line) {
+	return validateNumber(line, 0, MAX_CGI_POOL_REQUESTS);
+}
+
+bool	ConfigValidator::validateCgiPoolQueue(const std::string& line) {
+	return validateNumber(line, 0, MAX_CGI_POOL_QUEUE);
+}
+
+bool	ConfigValidator::validateCgiCacheTime(const std::string& line) {
+	return validateNumber(line, 0, MAX_CGI_CACHE_TIME);
+}
+
+// http://host[:port][/uri], the host a name or an IPv4 address
+bool	ConfigValidator::validateProxyPass(const std::string& line) {
+	std::regex	re("^\\s*proxy_pass\\s+http://([A-Za-z0-9.-]+)(:(\\d{1,5}))?(/\\S*)?$");
+	std::smatch	match;
+	if (!std::regex_match(line, match, re))
+		return false;
+	if (match[3].matched) {
+		int port = std::stoi(match[3]);
+		if (port < 1 || port > 65535)
+			return false;
+	}
+	return true;
+}
+
+bool	ConfigValidator::validateProxyTimeout(const std::string& line) {
+	return validateNumber(line, 1, MAX_PROXY_TIMEOUT);
+}
+
+// Sizes and times of a disk cache are never 0
+bool	ConfigValidator::validateCachePath(const std::string& line) {
+	std::regex	param("(max_size|inactive)=(\\d+)");
+	for (std::sregex_iterator it(line.begin(), line.end(), param), end; it != end; ++it) {
+		unsigned long value = std::stoul((*it)[2]);
+		if (value == 0 || value > ((*it)[1] == "buffer" ? MAX_ACCESS_LOG_BUFFER : MAX_ACCESS_LOG_FLUSH))
+			return false;
+	}
+	return true;
+}
+
 bool	ConfigValidator::validateAutoindex(const std::string& line) {
 	std::regex	re("^\\s*autoindex\\s+(\\S+)$");
 	std::smatch	match;
@@ -278,6 +473,39 @@ bool	ConfigValidator::validateAutoindex(const std::string& line) {
 	return false;
 }
 
+bool	ConfigValidator::validateStubStatus(const std::string& line) {
+	std::regex	re("^\\s*stub_status\\s+(\\S+)$");
+	std::smatch	match;
+	if (std::regex_search(line, match, re))
+		return match[1] == "on" || match[1] == "off";
+	return false;
+}
+
+// Every $variable of the pattern must be one the access log knows
+bool	ConfigValidator::validateLogFormat(const std::string& line) {
+	std::regex	re("^\\s*log_format\\s+\\w+(\\s+escape=(default|json))?\\s+(\\S.*)$");
+	std::smatch	match;
+	if (!std::regex_match(line, match, re))
+		return false;
+	AccessLogFormat format;
+	return AccessLogFormat::compile({match[3], match[2] == "json"}, format);
+}
+
+bool	ConfigValidator::validateAccessLog(const std::string& line) {
+	std::regex	param("(buffer|flush)=(\\d+)");
+	for (std::sregex_iterator it(line.begin(), line.end(), param), end; it != end; ++it) {
+		unsigned long value = std::stoul((*it)[2]);
+		if (value == 0 || value > ((*it)[1] == "buffer" ? MAX_ACCESS_LOG_BUFFER : MAX_ACCESS_LOG_FLUSH))
+			return false;
+	}
+	return true;
+}
+
+bool	ConfigValidator::validateLogLevel(const std::string& line) {
+	Log::Level level;
+	return Log::parse(line.substr(line.find_last_of(" \t") + 1), level);
+}
+
 void	ConfigValidator::validateKeyword(const std::string& line, const std::string& context) {
 	bool match = false;
 	std::vector<Directive>& directives =
@@ -285,7 +513,7 @@ void	ConfigValidator::validateKeyword(const std::string& line, const std::string
 	for (auto &d : directives) {
 		if (std::regex_match(line, d.pattern)) {
 			match = true;
-			if (d.isSet && d.name != "error_page")
+			if (d.isSet && d.name != "error_page" && d.name != "log_format")
 				throw std::runtime_error("Error: Config: Repeated directive: " + line);
 			if (d.valueChecker && !d.valueChecker(line))
 				throw std::runtime_error("Error: Config: Invalid value for directive: " + d.name);
@@ -312,12 +540,24 @@ void	ConfigValidator::verifyMandatoryDirectives(const std::string& blocktype, Lo
 		for (auto& d : _server_directives) {
 			if (_mandatory_server_directives.count(d.name) && !d.isSet)
 				throw std::runtime_error("Error: Config: Missing mandatory server directory: " + d.name);
+			if (d.name == "proxy_cache_path" && _proxy_cache && !d.isSet)
+				throw std::runtime_error("Error: Config: proxy_cache without proxy_cache_path");
 		}
+		LogFormat builtin;
+		if (!_access_log_format.empty() && !_log_formats.count(_access_log_format)
+			&& !AccessLogFormat::builtin(_access_log_format, builtin))
+			throw std::runtime_error("Error: Config: Unknown log_format: " + _access_log_format);
 	}
 	else if (blocktype == "location") {
+		bool proxied = std::any_of(_location_directives.begin(), _location_directives.end(),
+			[](const Directive& d) { return d.name == "proxy_pass" && d.isSet; });
+		bool status = std::any_of(_location_directives.begin(), _location_directives.end(),
+			[](const Directive& d) { return d.name == "stub_status" && d.isSet; });
 		const auto& mandatory_list =
-		(loctype == DIRECTORY) ? _mandatory_location_directives_directory
-								: _mandatory_location_directives_cgi;
+		proxied ? _mandatory_location_directives_proxy
+				: status ? _mandatory_location_directives_status
+				: (loctype == DIRECTORY) ? _mandatory_location_directives_directory
+										: _mandatory_location_directives_cgi;
 		for (auto& d : _location_directives) {
 			if (mandatory_list.count(d.name) && !d.isSet)
 				throw std::runtime_error("Error: Config: Missing mandatory location directory: " + d.name);
@@ -30,10 +30,17 @@ class ConfigValidator {
 		std::unordered_set<std::string>		_mandatory_server_directives;
 		std::unordered_set<std::string>		_mandatory_location_directives_directory;
 		std::unordered_set<std::string>		_mandatory_location_directives_cgi;
+		std::unordered_set<std::string>		_mandatory_location_directives_proxy;
+		std::unordered_set<std::string>		_mandatory_location_directives_status;
 		std::vector<Directive>				_server_directives;
 		std::vector<Directive>				_location_directives;
 		static std::vector<std::string>		_methods;
 		static std::vector<std::string>		_cgi_extensions;
+		std::set<std::string>				_upstreams;			// upstream {} names of the current server
+		size_t								_upstream_servers = 0;	// server lines of the current upstream {} block
+		bool								_proxy_cache = false;	// a location of the current server sets proxy_cache
+		std::set<std::string>				_log_formats;		// log_format names of the current server
+		std::string							_access_log_format;	// format the access_log of the current server names
 
 		void		validateKeyword(const std::string& line, const std::string& context);
 		void		handleOpenBlock(std::stack<std::string>& blockstack, const std::string& line, LocationType& current_type, bool& location_present, std::set<std::string>& locations);
@@ -44,11 +51,26 @@ class ConfigValidator {
 		static bool	validateIP(const std::string& line);
 		static bool	validateIndex(const std::string& line);
 		static bool	validateMaxBodySize(const std::string& line);
+		static bool	validatePipelineDepth(const std::string& line);
 		static bool	validateErrorPage(const std::string& line);
+		static bool	validateType(const std::string& line);
+		static bool	validateUpstreamLine(const std::string& line);
 		bool		validateLocation(const std::string& line, LocationType& type, bool& location_present);
 		static bool	validateMethods(const std::string& line);
 		static bool	validateExt(const std::string& line);
 		static bool	validateAutoindex(const std::string& line);
+		static bool	validateStubStatus(const std::string& line);
+		static bool	validateNumber(const std::string& line, unsigned long long min, unsigned long long max);
+		static bool	validateCgiPool(const std::string& line);
+		static bool	validateCgiPoolMaxRequests(const std::string& line);
+		static bool	validateCgiPoolQueue(const std::string& line);
+		static bool	validateCgiCacheTime(const std::string& line);
+		static bool	validateProxyPass(const std::string& line);
+		static bool	validateProxyTimeout(const std::string& line);
+		static bool	validateCachePath(const std::string& line);
+		static bool	validateLogFormat(const std::string& line);
+		static bool	validateAccessLog(const std::string& line);
+		static bool	validateLogLevel(const std::string& line);
 
 		void		resetDirectivesFlags(const std::string& blocktype);
 		void		verifyMandatoryDirectives(const std::string& blocktype, LocationType current);
@@ -0,0 +1,426 @@
+/**
+ * @file Hpack.cpp
+ * @brief HPACK header compression implementation
+ */
+
+#include "Hpack.hpp"
+#include "../../inc/webserv.hpp"
+
+#include <algorithm> // for std::min
+
+namespace http2 {
+
+namespace {
+
+struct HuffmanCode {
+  uint32_t code;
+  uint8_t bits;
+};
+
+/** RFC 7541 Appendix B, symbol 256 is EOS */
+constexpr HuffmanCode HUFFMAN_CODES[257] = {
+  {0x1ff8, 13}, {0x7fffd8, 23}, {0xfffffe2, 28}, {0xfffffe3, 28}, {0xfffffe4, 28}, {0xfffffe5, 28},
+  {0xfffffe6, 28}, {0xfffffe7, 28}, {0xfffffe8, 28}, {0xffffea, 24}, {0x3ffffffc, 30}, {0xfffffe9, 28},
+  {0xfffffea, 28}, {0x3ffffffd, 30}, {0xfffffeb, 28}, {0xfffffec, 28}, {0xfffffed, 28}, {0xfffffee, 28},
+  {0xfffffef, 28}, {0xffffff0, 28}, {0xffffff1, 28}, {0xffffff2, 28}, {0x3ffffffe, 30}, {0xffffff3, 28},
+  {0xffffff4, 28}, {0xffffff5, 28}, {0xffffff6, 28}, {0xffffff7, 28}, {0xffffff8, 28}, {0xffffff9, 28},
+  {0xffffffa, 28}, {0xffffffb, 28}, {0x14, 6}, {0x3f8, 10}, {0x3f9, 10}, {0xffa, 12},
+  {0x1ff9, 13}, {0x15, 6}, {0xf8, 8}, {0x7fa, 11}, {0x3fa, 10}, {0x3fb, 10},
+  {0xf9, 8}, {0x7fb, 11}, {0xfa, 8}, {0x16, 6}, {0x17, 6}, {0x18, 6},
+  {0x0, 5}, {0x1, 5}, {0x2, 5}, {0x19, 6}, {0x1a, 6}, {0x1b, 6},
+  {0x1c, 6}, {0x1d, 6}, {0x1e, 6}, {0x1f, 6}, {0x5c, 7}, {0xfb, 8},
+  {0x7ffc, 15}, {0x20, 6}, {0xffb, 12}, {0x3fc, 10}, {0x1ffa, 13}, {0x21, 6},
+  {0x5d, 7}, {0x5e, 7}, {0x5f, 7}, {0x60, 7}, {0x61, 7}, {0x62, 7},
+  {0x63, 7}, {0x64, 7}, {0x65, 7}, {0x66, 7}, {0x67, 7}, {0x68, 7},
+  {0x69, 7}, {0x6a, 7}, {0x6b, 7}, {0x6c, 7}, {0x6d, 7}, {0x6e, 7},
+  {0x6f, 7}, {0x70, 7}, {0x71, 7}, {0x72, 7}, {0xfc, 8}, {0x73, 7},
+  {0xfd, 8}, {0x1ffb, 13}, {0x7fff0, 19}, {0x1ffc, 13}, {0x3ffc, 14}, {0x22, 6},
+  {0x7ffd, 15}, {0x3, 5}, {0x23, 6}, {0x4, 5}, {0x24, 6}, {0x5, 5},
+  {0x25, 6}, {0x26, 6}, {0x27, 6}, {0x6, 5}, {0x74, 7}, {0x75, 7},
+  {0x28, 6}, {0x29, 6}, {0x2a, 6}, {0x7, 5}, {0x2b, 6}, {0x76, 7},
+  {0x2c, 6}, {0x8, 5}, {0x9, 5}, {0x2d, 6}, {0x77, 7}, {0x78, 7},
+  {0x79, 7}, {0x7a, 7}, {0x7b, 7}, {0x7ffe, 15}, {0x7fc, 11}, {0x3ffd, 14},
+  {0x1ffd, 13}, {0xffffffc, 28}, {0xfffe6, 20}, {0x3fffd2, 22}, {0xfffe7, 20}, {0xfffe8, 20},
+  {0x3fffd3, 22}, {0x3fffd4, 22}, {0x3fffd5, 22}, {0x7fffd9, 23}, {0x3fffd6, 22}, {0x7fffda, 23},
+  {0x7fffdb, 23}, {0x7fffdc, 23}, {0x7fffdd, 23}, {0x7fffde, 23}, {0xffffeb, 24}, {0x7fffdf, 23},
+  {0xffffec, 24}, {0xffffed, 24}, {0x3fffd7, 22}, {0x7fffe0, 23}, {0xffffee, 24}, {0x7fffe1, 23},
+  {0x7fffe2, 23}, {0x7fffe3, 23}, {0x7fffe4, 23}, {0x1fffdc, 21}, {0x3fffd8, 22}, {0x7fffe5, 23},
+  {0x3fffd9, 22}, {0x7fffe6, 23}, {0x7fffe7, 23}, {0xffffef, 24}, {0x3fffda, 22}, {0x1fffdd, 21},
+  {0xfffe9, 20}, {0x3fffdb, 22}, {0x3fffdc, 22}, {0x7fffe8, 23}, {0x7fffe9, 23}, {0x1fffde, 21},
+  {0x7fffea, 23}, {0x3fffdd, 22}, {0x3fffde, 22}, {0xfffff0, 24}, {0x1fffdf, 21}, {0x3fffdf, 22},
+  {0x7fffeb, 23}, {0x7fffec, 23}, {0x1fffe0, 21}, {0x1fffe1, 21}, {0x3fffe0, 22}, {0x1fffe2, 21},
+  {0x7fffed, 23}, {0x3fffe1, 22}, {0x7fffee, 23}, {0x7fffef, 23}, {0xfffea, 20}, {0x3fffe2, 22},
+  {0x3fffe3, 22}, {0x3fffe4, 22}, {0x7ffff0, 23}, {0x3fffe5, 22}, {0x3fffe6, 22}, {0x7ffff1, 23},
+  {0x3ffffe0, 26}, {0x3ffffe1, 26}, {0xfffeb, 20}, {0x7fff1, 19}, {0x3fffe7, 22}, {0x7ffff2, 23},
+  {0x3fffe8, 22}, {0x1ffffec, 25}, {0x3ffffe2, 26}, {0x3ffffe3, 26}, {0x3ffffe4, 26}, {0x7ffffde, 27},
+  {0x7ffffdf, 27}, {0x3ffffe5, 26}, {0xfffff1, 24}, {0x1ffffed, 25}, {0x7fff2, 19}, {0x1fffe3, 21},
+  {0x3ffffe6, 26}, {0x7ffffe0, 27}, {0x7ffffe1, 27}, {0x3ffffe7, 26}, {0x7ffffe2, 27}, {0xfffff2, 24},
+  {0x1fffe4, 21}, {0x1fffe5, 21}, {0x3ffffe8, 26}, {0x3ffffe9, 26}, {0xffffffd, 28}, {0x7ffffe3, 27},
+  {0x7ffffe4, 27}, {0x7ffffe5, 27}, {0xfffec, 20}, {0xfffff3, 24}, {0xfffed, 20}, {0x1fffe6, 21},
+  {0x3fffe9, 22}, {0x1fffe7, 21}, {0x1fffe8, 21}, {0x7ffff3, 23}, {0x3fffea, 22}, {0x3fffeb, 22},
+  {0x1ffffee, 25}, {0x1ffffef, 25}, {0xfffff4, 24}, {0xfffff5, 24}, {0x3ffffea, 26}, {0x7ffff4, 23},
+  {0x3ffffeb, 26}, {0x7ffffe6, 27}, {0x3ffffec, 26}, {0x3ffffed, 26}, {0x7ffffe7, 27}, {0x7ffffe8, 27},
+  {0x7ffffe9, 27}, {0x7ffffea, 27}, {0x7ffffeb, 27}, {0xffffffe, 28}, {0x7ffffec, 27}, {0x7ffffed, 27},
+  {0x7ffffee, 27}, {0x7ffffef, 27}, {0x7fffff0, 27}, {0x3ffffee, 26}, {0x3fffffff, 30}
+};
+
+struct StaticEntry {
+  std::string_view name;
+  std::string_view value;
+};
+
+/** RFC 7541 Appendix A */
+constexpr StaticEntry STATIC_TABLE[] = {
+  {":authority", ""}, {":method", "GET"}, {":method", "POST"}, {":path", "/"},
+  {":path", "/index.html"}, {":scheme", "http"}, {":scheme", "https"}, {":status", "200"},
+  {":status", "204"}, {":status", "206"}, {":status", "304"}, {":status", "400"},
+  {":status", "404"}, {":status", "500"}, {"accept-charset", ""}, {"accept-encoding", "gzip, deflate"},
+  {"accept-language", ""}, {"accept-ranges", ""}, {"accept", ""}, {"access-control-allow-origin", ""},
+  {"age", ""}, {"allow", ""}, {"authorization", ""}, {"cache-control", ""},
+  {"content-disposition", ""}, {"content-encoding", ""}, {"content-language", ""}, {"content-length", ""},
+  {"content-location", ""}, {"content-range", ""}, {"content-type", ""}, {"cookie", ""},
+  {"date", ""}, {"etag", ""}, {"expect", ""}, {"expires", ""},
+  {"from", ""}, {"host", ""}, {"if-match", ""}, {"if-modified-since", ""},
+  {"if-none-match", ""}, {"if-range", ""}, {"if-unmodified-since", ""}, {"last-modified", ""},
+  {"link", ""}, {"location", ""}, {"max-forwards", ""}, {"proxy-authenticate", ""},
+  {"proxy-authorization", ""}, {"range", ""}, {"referer", ""}, {"refresh", ""},
+  {"retry-after", ""}, {"server", ""}, {"set-cookie", ""}, {"strict-transport-security", ""},
+  {"transfer-encoding", ""}, {"user-agent", ""}, {"vary", ""}, {"via", ""},
+  {"www-authenticate", ""},
+};
+constexpr size_t STATIC_ENTRIES = std::size(STATIC_TABLE);
+constexpr size_t ENTRY_OVERHEAD = 32;
+
+/** Binary tree of the Huffman code, leaves hold a symbol */
+struct HuffmanTree {
+  struct Node {
+    int16_t child[2] = {-1, -1};
+    int16_t symbol = -1;
+  };
+  std::vector<Node> nodes;
+
+  HuffmanTree() : nodes(1) {
+    for (int symbol = 0; symbol < 257; ++symbol) {
+      size_t node = 0;
+      for (int bit = HUFFMAN_CODES[symbol].bits - 1; bit >= 0; --bit) {
+        int branch = (HUFFMAN_CODES[symbol].code >> bit) & 1;
+        if (nodes[node].child[branch] < 0) {
+          nodes[node].child[branch] = static_cast<int16_t>(nodes.size());
+          nodes.emplace_back();
+        }
+        node = nodes[node].child[branch];
+      }
+      nodes[node].symbol = static_cast<int16_t>(symbol);
+    }
+  }
+};
+
+const HuffmanTree& huffmanTree() {
+  static const HuffmanTree tree;
+  return tree;
+}
+
+/** Append an integer with an N-bit prefix, first carrying the pattern bits */
+void encodeInteger(std::string& out, uint8_t pattern, int prefixBits, size_t value) {
+  size_t max = (1u << prefixBits) - 1;
+  if (value < max) {
+    out.push_back(static_cast<char>(pattern | value));
+    return;
+  }
+  out.push_back(static_cast<char>(pattern | max));
+  value -= max;
+  while (value >= 128) {
+    out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+/** Read an integer with an N-bit prefix; false when truncated or too large */
+bool decodeInteger(const uint8_t* data, size_t size, size_t& pos, int prefixBits, size_t& value) {
+  if (pos >= size) {
+    return false;
+  }
+  size_t max = (1u << prefixBits) - 1;
+  value = data[pos++] & max;
+  if (value < max) {
+    return true;
+  }
+  for (int shift = 0; shift < 28; shift += 7) {
+    if (pos >= size) {
+      return false;
+    }
+    uint8_t byte = data[pos++];
+    value += static_cast<size_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void encodeString(std::string& out, std::string_view str) {
+  size_t coded = huffmanEncodedSize(str);
+  if (coded < str.size()) {
+    encodeInteger(out, 0x80, 7, coded);
+    huffmanEncode(out, str);
+  } else {
+    encodeInteger(out, 0x00, 7, str.size());
+    out.append(str);
+  }
+}
+
+bool decodeString(const uint8_t* data, size_t size, size_t& pos, std::string& out) {
+  if (pos >= size) {
+    return false;
+  }
+  bool huffman = data[pos] & 0x80;
+  size_t length;
+  if (!decodeInteger(data, size, pos, 7, length) || length > size - pos) {
+    return false;
+  }
+  out.clear();
+  if (huffman) {
+    if (!huffmanDecode(data + pos, length, out)) {
+      return false;
+    }
+  } else {
+    out.assign(reinterpret_cast<const char*>(data + pos), length);
+  }
+  pos += length;
+  return true;
+}
+
+/** Fields whose value changes with every response, not worth a table entry */
+bool volatileField(std::string_view name) {
+  return name == "content-length" || name == "date" || name == "etag" || name == "last-modified"
+      || name == "location" || name == "content-range";
+}
+
+} // namespace
+
+void huffmanEncode(std::string& out, std::string_view str) {
+  uint64_t bits = 0;
+  int pending = 0;
+  for (unsigned char c : str) {
+    bits = (bits << HUFFMAN_CODES[c].bits) | HUFFMAN_CODES[c].code;
+    pending += HUFFMAN_CODES[c].bits;
+    while (pending >= 8) {
+      pending -= 8;
+      out.push_back(static_cast<char>(bits >> pending));
+    }
+  }
+  if (pending > 0) {
+    // Padded with the most significant bits of EOS, all ones
+    out.push_back(static_cast<char>((bits << (8 - pending)) | (0xff >> pending)));
+  }
+}
+
+size_t huffmanEncodedSize(std::string_view str) {
+  size_t bits = 0;
+  for (unsigned char c : str) {
+    bits += HUFFMAN_CODES[c].bits;
+  }
+  return (bits + 7) / 8;
+}
+
+bool huffmanDecode(const uint8_t* data, size_t size, std::string& out) {
+  const HuffmanTree& tree = huffmanTree();
+  size_t node = 0;
+  int depth = 0;          // bits read since the last symbol
+  bool ones = true;       // and they were all ones, as padding has to be
+  for (size_t i = 0; i < size; ++i) {
+    for (int bit = 7; bit >= 0; --bit) {
+      int branch = (data[i] >> bit) & 1;
+      int16_t next = tree.nodes[node].child[branch];
+      if (next < 0) {
+        return false;
+      }
+      node = next;
+      ++depth;
+      ones = ones && branch;
+      int16_t symbol = tree.nodes[node].symbol;
+      if (symbol == 256) {
+        return false;   // EOS inside a string
+      }
+      if (symbol >= 0) {
+        out.push_back(static_cast<char>(symbol));
+        node = 0;
+        depth = 0;
+        ones = true;
+      }
+    }
+  }
+  return depth < 8 && ones;
+}
+
+HpackTable::HpackTable(size_t maxSize) : _maxSize(maxSize) {}
+
+const HeaderField* HpackTable::at(size_t index) const {
+  thread_local HeaderField staticField;
+  if (index == 0) {
+    return nullptr;
+  }
+  if (index <= STATIC_ENTRIES) {
+    staticField.name = STATIC_TABLE[index - 1].name;
+    staticField.value = STATIC_TABLE[index - 1].value;
+    return &staticField;
+  }
+  index -= STATIC_ENTRIES + 1;
+  return index < _entries.size() ? &_entries[index] : nullptr;
+}
+
+size_t HpackTable::find(std::string_view name, std::string_view value, bool& exact) const {
+  size_t nameIndex = 0;
+  exact = false;
+  for (size_t i = 0; i < STATIC_ENTRIES; ++i) {
+    if (STATIC_TABLE[i].name != name) {
+      continue;
+    }
+    if (STATIC_TABLE[i].value == value) {
+      exact = true;
+      return i + 1;
+    }
+    if (nameIndex == 0) {
+      nameIndex = i + 1;
+    }
+  }
+  for (size_t i = 0; i < _entries.size(); ++i) {
+    if (_entries[i].name != name) {
+      continue;
+    }
+    if (_entries[i].value == value) {
+      exact = true;
+      return STATIC_ENTRIES + 1 + i;
+    }
+    if (nameIndex == 0) {
+      nameIndex = STATIC_ENTRIES + 1 + i;
+    }
+  }
+  return nameIndex;
+}
+
+void HpackTable::add(std::string_view name, std::string_view value) {
+  size_t entrySize = name.size() + value.size() + ENTRY_OVERHEAD;
+  if (entrySize > _maxSize) {
+    // Larger than the whole table: it empties the table and is not kept
+    _entries.clear();
+    _size = 0;
+    return;
+  }
+  _entries.push_front(HeaderField{std::string(name), std::string(value)});
+  _size += entrySize;
+  evict();
+}
+
+void HpackTable::setMaxSize(size_t maxSize) {
+  _maxSize = maxSize;
+  evict();
+}
+
+size_t HpackTable::maxSize() const {
+  return _maxSize;
+}
+
+void HpackTable::evict() {
+  while (_size > _maxSize) {
+    const HeaderField& oldest = _entries.back();
+    _size -= oldest.name.size() + oldest.value.size() + ENTRY_OVERHEAD;
+    _entries.pop_back();
+  }
+}
+
+HpackDecoder::HpackDecoder(size_t maxTableSize) : _table(maxTableSize), _maxTableSize(maxTableSize) {}
+
+bool HpackDecoder::decode(const uint8_t* data, size_t size, HeaderFields& out) {
+  size_t pos = 0;
+  bool fieldSeen = false;
+  while (pos < size) {
+    uint8_t first = data[pos];
+    size_t index;
+
+    if (first & 0x80) {
+      // Indexed field
+      if (!decodeInteger(data, size, pos, 7, index)) {
+        return false;
+      }
+      const HeaderField* field = _table.at(index);
+      if (!field) {
+        return false;
+      }
+      out.push_back(*field);
+      fieldSeen = true;
+      continue;
+    }
+
+    if ((first & 0xe0) == 0x20) {
+      // Dynamic table size update, only before the first field
+      if (fieldSeen || !decodeInteger(data, size, pos, 5, index) || index > _maxTableSize) {
+        return false;
+      }
+      _table.setMaxSize(index);
+      continue;
+    }
+
+    // Literal: with incremental indexing (01), without indexing (0000) or never indexed (0001)
+    bool indexing = (first & 0xc0) == 0x40;
+    if (!decodeInteger(data, size, pos, indexing ? 6 : 4, index)) {
+      return false;
+    }
+    HeaderField field;
+    if (index) {
+      const HeaderField* named = _table.at(index);
+      if (!named) {
+        return false;
+      }
+      field.name = named->name;
+    } else if (!decodeString(data, size, pos, field.name)) {
+      return false;
+    }
+    if (!decodeString(data, size, pos, field.value)) {
+      return false;
+    }
+    if (indexing) {
+      _table.add(field.name, field.value);
+    }
+    out.push_back(std::move(field));
+    fieldSeen = true;
+  }
+  return true;
+}
+
+HpackEncoder::HpackEncoder() : _table(HPACK_TABLE_SIZE) {}
+
+void HpackEncoder::setMaxTableSize(size_t size) {
+  size = std::min<size_t>(size, HPACK_TABLE_SIZE);
+  if (size != _table.maxSize()) {
+    _table.setMaxSize(size);
+    _sizeUpdate = true;
+  }
+}
+
+void HpackEncoder::encode(std::string& out, std::string_view name, std::string_view value) {
+  if (_sizeUpdate) {
+    encodeInteger(out, 0x20, 5, _table.maxSize());
+    _sizeUpdate = false;
+  }
+
+  bool exact;
+  size_t index = _table.find(name, value, exact);
+  if (exact) {
+    encodeInteger(out, 0x80, 7, index);
+    return;
+  }
+  if (volatileField(name)) {
+    encodeInteger(out, 0x00, 4, index);
+  } else {
+    encodeInteger(out, 0x40, 6, index);
+    _table.add(name, value);
+  }
+  if (index == 0) {
+    encodeString(out, name);
+  }
+  encodeString(out, value);
+}
+
+} // namespace http2
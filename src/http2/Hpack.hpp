@@ -0,0 +1,113 @@
+/**
+ * @file Hpack.hpp
+ * @brief HPACK header compression for HTTP/2 (RFC 7541)
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace http2 {
+
+/** One field of a header block, names are lowercase */
+struct HeaderField {
+  std::string name;
+  std::string value;
+};
+typedef std::vector<HeaderField> HeaderFields;
+
+/** Huffman-code str onto out */
+void huffmanEncode(std::string& out, std::string_view str);
+
+/** Size of str once Huffman-coded */
+size_t huffmanEncodedSize(std::string_view str);
+
+/** Decode a Huffman-coded string; false on a bad code or padding */
+bool huffmanDecode(const uint8_t* data, size_t size, std::string& out);
+
+/**
+ * @class HpackTable
+ * @brief Static table followed by a dynamic table, addressed by one index
+ *
+ * Index 1 to 61 is the static table, the dynamic table follows with the
+ * newest entry first. Entries are evicted from the oldest once the table
+ * size (name + value + 32 per entry) passes its maximum.
+ */
+class HpackTable {
+  public:
+    explicit HpackTable(size_t maxSize);
+
+    /** Entry at an index, nullptr when there is none */
+    const HeaderField* at(size_t index) const;
+
+    /**
+     * @brief Find a field
+     * @return Index of an entry with name and value, else of one with the name (exact false), 0 for none
+     */
+    size_t find(std::string_view name, std::string_view value, bool& exact) const;
+
+    /** Add an entry as the newest */
+    void add(std::string_view name, std::string_view value);
+
+    /** Change the maximum size, evicting what no longer fits */
+    void setMaxSize(size_t maxSize);
+
+    size_t maxSize() const;
+
+  private:
+    void evict();
+
+    std::deque<HeaderField> _entries;   // newest first
+    size_t _size = 0;
+    size_t _maxSize;
+};
+
+/**
+ * @class HpackDecoder
+ * @brief Decodes the header blocks of one connection, in order
+ */
+class HpackDecoder {
+  public:
+    /** @param maxTableSize Dynamic table size the peer may use, as announced in SETTINGS */
+    explicit HpackDecoder(size_t maxTableSize);
+
+    /**
+     * @brief Decode a complete header block
+     * @return false on a compression error, the connection cannot go on
+     */
+    bool decode(const uint8_t* data, size_t size, HeaderFields& out);
+
+  private:
+    HpackTable _table;
+    size_t _maxTableSize;
+};
+
+/**
+ * @class HpackEncoder
+ * @brief Encodes the header blocks of one connection, in order
+ *
+ * Fields repeated across responses (server, content-type, cache-control...)
+ * go to the dynamic table and cost one byte the next time. Values that change
+ * with every response are sent as literals so they do not evict those.
+ */
+class HpackEncoder {
+  public:
+    HpackEncoder();
+
+    /** Apply the peer's SETTINGS_HEADER_TABLE_SIZE, announced at the start of the next block */
+    void setMaxTableSize(size_t size);
+
+    /** Append one field to the header block in out */
+    void encode(std::string& out, std::string_view name, std::string_view value);
+
+  private:
+    HpackTable _table;
+    bool _sizeUpdate = false;   // table size changed since the last block
+};
+
+} // namespace http2
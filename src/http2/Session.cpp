@@ -0,0 +1,848 @@
+/**
+ * @file Session.cpp
+ * @brief HTTP/2 connection implementation
+ */
+
+#include "Session.hpp"
+#include "../parser/Parser.hpp"
+#include "../router/HttpConstants.hpp"
+#include "../server/HelperFunctions.hpp"
+
+#include <algorithm> // for std::min
+#include <limits> // for std::numeric_limits
+#include <strings.h> // for strcasecmp
+
+namespace http2 {
+
+namespace {
+
+enum FrameType : uint8_t {
+  DATA = 0x0,
+  HEADERS = 0x1,
+  PRIORITY = 0x2,
+  RST_STREAM = 0x3,
+  SETTINGS = 0x4,
+  PUSH_PROMISE = 0x5,
+  PING = 0x6,
+  GOAWAY = 0x7,
+  WINDOW_UPDATE = 0x8,
+  CONTINUATION = 0x9,
+};
+
+enum FrameFlag : uint8_t {
+  FLAG_ACK = 0x1,
+  FLAG_END_STREAM = 0x1,
+  FLAG_END_HEADERS = 0x4,
+  FLAG_PADDED = 0x8,
+  FLAG_PRIORITY = 0x20,
+};
+
+enum Setting : uint16_t {
+  SETTINGS_HEADER_TABLE_SIZE = 0x1,
+  SETTINGS_ENABLE_PUSH = 0x2,
+  SETTINGS_MAX_CONCURRENT_STREAMS = 0x3,
+  SETTINGS_INITIAL_WINDOW_SIZE = 0x4,
+  SETTINGS_MAX_FRAME_SIZE = 0x5,
+  SETTINGS_MAX_HEADER_LIST_SIZE = 0x6,
+};
+
+constexpr size_t FRAME_HEADER_SIZE = 9;
+constexpr int64_t MAX_WINDOW = 0x7fffffff;
+constexpr size_t MAX_HEADER_BLOCK = MAX_HEADER_SIZE * 4;   // compressed, before the list itself is checked
+
+uint32_t read32(const uint8_t* p) {
+  return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16)
+       | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+void append32(std::string& out, uint32_t value) {
+  out.push_back(static_cast<char>(value >> 24));
+  out.push_back(static_cast<char>(value >> 16));
+  out.push_back(static_cast<char>(value >> 8));
+  out.push_back(static_cast<char>(value));
+}
+
+void appendSetting(std::string& out, uint16_t id, uint32_t value) {
+  out.push_back(static_cast<char>(id >> 8));
+  out.push_back(static_cast<char>(id));
+  append32(out, value);
+}
+
+/** Strip the padding of a DATA or HEADERS payload; false when it is longer than the payload */
+bool unpad(uint8_t flags, const uint8_t*& payload, size_t& size) {
+  if (!(flags & FLAG_PADDED)) {
+    return true;
+  }
+  if (size < 1 || payload[0] >= size) {
+    return false;
+  }
+  size -= 1 + payload[0];
+  payload += 1;
+  return true;
+}
+
+/** HTTP2-Settings is the SETTINGS payload in base64url without padding */
+bool decodeBase64Url(std::string_view in, std::string& out) {
+  uint32_t bits = 0;
+  int count = 0;
+  for (char c : in) {
+    int value;
+    if (c >= 'A' && c <= 'Z') {
+      value = c - 'A';
+    } else if (c >= 'a' && c <= 'z') {
+      value = c - 'a' + 26;
+    } else if (c >= '0' && c <= '9') {
+      value = c - '0' + 52;
+    } else if (c == '-' || c == '+') {
+      value = 62;
+    } else if (c == '_' || c == '/') {
+      value = 63;
+    } else if (c == '=') {
+      break;
+    } else {
+      return false;
+    }
+    bits = (bits << 6) | value;
+    count += 6;
+    if (count >= 8) {
+      count -= 8;
+      out.push_back(static_cast<char>(bits >> count));
+    }
+  }
+  return true;
+}
+
+/** Header fields that only mean something to one HTTP/1.1 connection */
+bool connectionSpecific(std::string_view name) {
+  return name == "connection" || name == "keep-alive" || name == "proxy-connection"
+      || name == "transfer-encoding" || name == "upgrade";
+}
+
+/** Lowercase token characters, which is all an HTTP/2 field name may hold */
+bool validName(std::string_view name) {
+  if (name.empty()) {
+    return false;
+  }
+  for (char c : name) {
+    bool lower = c >= 'a' && c <= 'z';
+    bool digit = c >= '0' && c <= '9';
+    if (!lower && !digit && std::string_view("!#$%&'*+-.^_`|~").find(c) == std::string_view::npos) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool validValue(std::string_view value) {
+  return value.find_first_of(std::string_view("\r\n\0", 3)) == std::string_view::npos;
+}
+
+/** Three digit status code of a status line, "500" when there is none */
+std::string_view statusCode(std::string_view status) {
+  size_t digits = status.find_first_of("0123456789");
+  if (digits == std::string_view::npos || status.size() - digits < 3) {
+    return "500";
+  }
+  return status.substr(digits, 3);
+}
+
+} // namespace
+
+Session::Session(size_t maxStreams) : _decoder(HPACK_TABLE_SIZE), _maxStreams(maxStreams) {
+  // Server connection preface, it does not wait for the client's
+  std::string settings;
+  appendSetting(settings, SETTINGS_MAX_CONCURRENT_STREAMS, static_cast<uint32_t>(maxStreams));
+  appendSetting(settings, SETTINGS_INITIAL_WINDOW_SIZE, H2_WINDOW_SIZE);
+  appendSetting(settings, SETTINGS_MAX_HEADER_LIST_SIZE, MAX_HEADER_SIZE);
+  writeFrame(SETTINGS, 0, 0, settings.data(), settings.size());
+  if (H2_WINDOW_SIZE > 65535) {
+    writeWindowUpdate(0, H2_WINDOW_SIZE - 65535);
+  }
+}
+
+bool Session::upgrade(std::string_view settings, const Request& req) {
+  std::string payload;
+  if (!decodeBase64Url(settings, payload) || payload.size() % 6 != 0
+      || applySettings(reinterpret_cast<const uint8_t*>(payload.data()), payload.size()) != NO_ERROR) {
+    return false;
+  }
+  Stream& stream = _streams[1];
+  stream.remoteClosed = true;
+  stream.head = req.getMethod() == "HEAD";
+  stream.sendWindow = _initialWindow;
+  _lastStream = 1;
+  return true;
+}
+
+void Session::feed(std::string& in) {
+  size_t pos = 0;
+  if (!_prefaceSeen) {
+    size_t size = std::min(in.size(), PREFACE.size());
+    if (std::string_view(in).substr(0, size) != PREFACE.substr(0, size)) {
+      connectionError(PROTOCOL_ERROR);
+    } else if (size < PREFACE.size()) {
+      return;
+    } else {
+      _prefaceSeen = true;
+      pos = PREFACE.size();
+    }
+  }
+
+  while (!_goawaySent && in.size() - pos >= FRAME_HEADER_SIZE) {
+    const uint8_t* header = reinterpret_cast<const uint8_t*>(in.data() + pos);
+    size_t size = (static_cast<size_t>(header[0]) << 16) | (header[1] << 8) | header[2];
+    if (size > H2_MAX_FRAME_SIZE) {
+      connectionError(FRAME_SIZE_ERROR);
+      break;
+    }
+    if (in.size() - pos < FRAME_HEADER_SIZE + size) {
+      break;
+    }
+    uint32_t stream = read32(header + 5) & 0x7fffffff;
+    handleFrame(header[3], header[4], stream, header + FRAME_HEADER_SIZE, size);
+    pos += FRAME_HEADER_SIZE + size;
+  }
+
+  if (_goawaySent) {
+    in.clear();   // nothing more is read from a failed connection
+  } else {
+    in.erase(0, pos);
+  }
+}
+
+bool Session::nextEvent(StreamEvent& event) {
+  if (_events.empty()) {
+    return false;
+  }
+  event = std::move(_events.front());
+  _events.pop_front();
+  return true;
+}
+
+void Session::respond(uint32_t id, const Response& res, bool more) {
+  auto it = _streams.find(id);
+  if (it == _streams.end() || it->second.responded) {
+    return;   // reset by the client
+  }
+  Stream& stream = it->second;
+  stream.responded = true;
+
+  // Fields and body come from the serialized tail when a cached page supplied one
+  HeaderFields fields;
+  std::string_view body = res.getBody();
+  if (res.getSerialized()) {
+    std::string_view tail = *res.getSerialized();
+    size_t end = tail.find("\r\n\r\n");
+    body = end == std::string_view::npos ? std::string_view() : tail.substr(end + 4);
+    for (size_t pos = 0; pos < end;) {
+      size_t eol = std::min(tail.find("\r\n", pos), end);
+      std::string_view line = tail.substr(pos, eol - pos);
+      size_t colon = line.find(':');
+      if (colon != std::string_view::npos) {
+        fields.push_back({std::string(line.substr(0, colon)), trim(line.substr(colon + 1))});
+      }
+      pos = eol + 2;
+    }
+  } else {
+    for (const Response::Header& header : res.getHeaderList()) {
+      fields.push_back({header.name, header.value});
+    }
+  }
+
+  std::string block;
+  bool chunked = false;
+  bool hasDate = false;
+  bool hasServer = false;
+  _encoder.encode(block, ":status", statusCode(res.getStatus()));
+  for (HeaderField& field : fields) {
+    for (char& c : field.name) {
+      c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    if (field.name == "transfer-encoding") {
+      chunked = chunked || strcasecmp(field.value.c_str(), "chunked") == 0;
+    }
+    if (connectionSpecific(field.name) || !validName(field.name) || !validValue(field.value)) {
+      continue;
+    }
+    hasDate = hasDate || field.name == "date";
+    hasServer = hasServer || field.name == "server";
+    _encoder.encode(block, field.name, field.value);
+  }
+  if (!hasDate) {
+    const std::string& dateLine = dateHeaderLine();   // "Date: <value>\r\n"
+    _encoder.encode(block, "date", std::string_view(dateLine).substr(6, dateLine.size() - 8));
+  }
+  if (!hasServer) {
+    _encoder.encode(block, "server", network::SERVER_SOFTWARE);
+  }
+
+  bool end = !more && (stream.head || body.empty());
+  writeHeaders(id, block, end);
+  if (end) {
+    stream.localClosed = true;
+    retire(it);
+    return;
+  }
+  if (!stream.head) {
+    stream.pending.append(body);
+  }
+  if (more && chunked) {
+    stream.dechunk = std::make_unique<ChunkedDecoder>(std::numeric_limits<size_t>::max());
+  }
+  stream.endPending = !more;
+  sendPending(id, stream);
+  retire(it);
+}
+
+void Session::sendData(uint32_t id, std::string_view data, bool end) {
+  auto it = _streams.find(id);
+  if (it == _streams.end() || !it->second.responded || it->second.endPending) {
+    return;
+  }
+  Stream& stream = it->second;
+  if (stream.dechunk) {
+    stream.dechunk->decode(data.data(), data.size(), [&stream](const char* piece, size_t size) {
+      if (!stream.head) {
+        stream.pending.append(piece, size);
+      }
+    });
+    if (stream.dechunk->failed()) {
+      reset(id, INTERNAL_ERROR);
+      return;
+    }
+    end = end || stream.dechunk->done();
+  } else if (!stream.head) {
+    stream.pending.append(data);
+  }
+  stream.endPending = end;
+  sendPending(id, stream);
+  retire(it);
+}
+
+void Session::reset(uint32_t id, ErrorCode error) {
+  auto it = _streams.find(id);
+  if (it == _streams.end()) {
+    return;
+  }
+  writeRstStream(id, error);
+  _streams.erase(it);
+}
+
+std::string& Session::output() {
+  return _out;
+}
+
+size_t Session::backlog(uint32_t id) const {
+  auto it = _streams.find(id);
+  return it == _streams.end() ? 0 : it->second.pending.size() - it->second.sent;
+}
+
+bool Session::closing() const {
+  return _goawaySent || (_goawayReceived && _streams.empty());
+}
+
+// ========================= FRAMES IN =========================
+
+void Session::handleFrame(uint8_t type, uint8_t flags, uint32_t stream, const uint8_t* payload, size_t size) {
+  if (!_settingsSeen && type != SETTINGS) {
+    connectionError(PROTOCOL_ERROR);
+    return;
+  }
+  // A header block is not interleaved with any other frame
+  if (_headerStream && (type != CONTINUATION || stream != _headerStream)) {
+    connectionError(PROTOCOL_ERROR);
+    return;
+  }
+
+  switch (type) {
+    case DATA:
+      handleData(flags, stream, payload, size);
+      break;
+    case HEADERS:
+      handleHeaders(flags, stream, payload, size);
+      break;
+    case PRIORITY:
+      if (stream == 0) {
+        connectionError(PROTOCOL_ERROR);
+      } else if (size != 5) {
+        streamError(stream, FRAME_SIZE_ERROR);
+      }
+      break;
+    case RST_STREAM:
+      handleRstStream(stream, payload, size);
+      break;
+    case SETTINGS:
+      handleSettings(flags, stream, payload, size);
+      break;
+    case PING:
+      if (stream != 0) {
+        connectionError(PROTOCOL_ERROR);
+      } else if (size != 8) {
+        connectionError(FRAME_SIZE_ERROR);
+      } else if (!(flags & FLAG_ACK)) {
+        writeFrame(PING, FLAG_ACK, 0, payload, size);
+      }
+      break;
+    case GOAWAY:
+      if (stream != 0) {
+        connectionError(PROTOCOL_ERROR);
+      } else {
+        _goawayReceived = true;
+      }
+      break;
+    case WINDOW_UPDATE:
+      handleWindowUpdate(stream, payload, size);
+      break;
+    case CONTINUATION:
+      if (!_headerStream) {
+        connectionError(PROTOCOL_ERROR);
+        break;
+      }
+      _headerBlock.append(reinterpret_cast<const char*>(payload), size);
+      if (_headerBlock.size() > MAX_HEADER_BLOCK) {
+        connectionError(ENHANCE_YOUR_CALM);
+      } else if (flags & FLAG_END_HEADERS) {
+        uint32_t blockStream = _headerStream;
+        _headerStream = 0;
+        handleHeaderBlock(blockStream, _headerEnd);
+      }
+      break;
+    case PUSH_PROMISE:
+      connectionError(PROTOCOL_ERROR);   // clients do not push
+      break;
+    default:
+      break;   // unknown frame types are ignored
+  }
+}
+
+void Session::handleData(uint8_t flags, uint32_t id, const uint8_t* payload, size_t size) {
+  if (id == 0 || id > _lastStream) {
+    connectionError(PROTOCOL_ERROR);
+    return;
+  }
+  // Padding counts against flow control too
+  _recvWindow -= size;
+  if (_recvWindow < 0) {
+    connectionError(FLOW_CONTROL_ERROR);
+    return;
+  }
+  if (_recvWindow < H2_WINDOW_SIZE / 2) {
+    writeWindowUpdate(0, static_cast<uint32_t>(H2_WINDOW_SIZE - _recvWindow));
+    _recvWindow = H2_WINDOW_SIZE;
+  }
+
+  auto it = _streams.find(id);
+  if (it == _streams.end()) {
+    return;   // answered or reset already, frames in flight are dropped
+  }
+  Stream& stream = it->second;
+  if (stream.remoteClosed) {
+    streamError(id, STREAM_CLOSED);
+    return;
+  }
+  stream.recvWindow -= size;
+  if (stream.recvWindow < 0) {
+    streamError(id, FLOW_CONTROL_ERROR);
+    return;
+  }
+  if (!unpad(flags, payload, size)) {
+    connectionError(PROTOCOL_ERROR);
+    return;
+  }
+  if (size > 0) {
+    StreamEvent event;
+    event.type = StreamEvent::DATA;
+    event.stream = id;
+    event.data.assign(reinterpret_cast<const char*>(payload), size);
+    _events.push_back(std::move(event));
+  }
+  if (flags & FLAG_END_STREAM) {
+    stream.remoteClosed = true;
+    StreamEvent event;
+    event.type = StreamEvent::END;
+    event.stream = id;
+    _events.push_back(std::move(event));
+    retire(it);
+  } else if (stream.recvWindow < H2_WINDOW_SIZE / 2) {
+    writeWindowUpdate(id, static_cast<uint32_t>(H2_WINDOW_SIZE - stream.recvWindow));
+    stream.recvWindow = H2_WINDOW_SIZE;
+  }
+}
+
+void Session::handleHeaders(uint8_t flags, uint32_t stream, const uint8_t* payload, size_t size) {
+  if (stream == 0 || !unpad(flags, payload, size)) {
+    connectionError(PROTOCOL_ERROR);
+    return;
+  }
+  if (flags & FLAG_PRIORITY) {
+    if (size < 5) {
+      connectionError(FRAME_SIZE_ERROR);
+      return;
+    }
+    payload += 5;
+    size -= 5;
+  }
+  _headerBlock.assign(reinterpret_cast<const char*>(payload), size);
+  _headerEnd = flags & FLAG_END_STREAM;
+  if (flags & FLAG_END_HEADERS) {
+    handleHeaderBlock(stream, _headerEnd);
+  } else {
+    _headerStream = stream;
+  }
+}
+
+void Session::handleHeaderBlock(uint32_t id, bool endStream) {
+  // Decoded whatever becomes of the stream, the table state is shared by all of them
+  HeaderFields fields;
+  if (!_decoder.decode(reinterpret_cast<const uint8_t*>(_headerBlock.data()), _headerBlock.size(), fields)) {
+    connectionError(COMPRESSION_ERROR);
+    return;
+  }
+  _headerBlock.clear();
+
+  auto it = _streams.find(id);
+  if (it != _streams.end() || id <= _lastStream) {
+    // Trailers end the request; their fields are not passed on
+    if (it == _streams.end() || it->second.remoteClosed || !endStream) {
+      connectionError(it == _streams.end() ? STREAM_CLOSED : PROTOCOL_ERROR);
+      return;
+    }
+    it->second.remoteClosed = true;
+    StreamEvent event;
+    event.type = StreamEvent::END;
+    event.stream = id;
+    _events.push_back(std::move(event));
+    retire(it);
+    return;
+  }
+
+  if (id % 2 == 0) {
+    connectionError(PROTOCOL_ERROR);
+    return;
+  }
+  _lastStream = id;
+  if (_goawayReceived) {
+    return;
+  }
+  if (_streams.size() >= _maxStreams) {
+    writeRstStream(id, REFUSED_STREAM);
+    return;
+  }
+
+  StreamEvent event;
+  event.type = StreamEvent::REQUEST;
+  event.stream = id;
+  event.end = endStream;
+  bool head = false;
+  if (!buildRequest(fields, event.request, head)) {
+    writeRstStream(id, PROTOCOL_ERROR);
+    return;
+  }
+  Stream& stream = _streams[id];
+  stream.sendWindow = _initialWindow;
+  stream.remoteClosed = endStream;
+  stream.head = head;
+  _events.push_back(std::move(event));
+}
+
+/** Turn the fields of a request into an HTTP/1.1 head and parse that; false when they are malformed */
+bool Session::buildRequest(const HeaderFields& fields, Request& req, bool& head) {
+  std::string method, path, scheme, authority, cookie;
+  std::string lines;
+  bool regular = false;
+  bool hasHost = false;
+  for (const HeaderField& field : fields) {
+    if (!validValue(field.value)) {
+      return false;
+    }
+    if (!field.name.empty() && field.name[0] == ':') {
+      std::string* pseudo = field.name == ":method" ? &method
+                          : field.name == ":path" ? &path
+                          : field.name == ":scheme" ? &scheme
+                          : field.name == ":authority" ? &authority : nullptr;
+      // Pseudo-headers come first, each once
+      if (!pseudo || regular || !pseudo->empty() || field.value.empty()) {
+        return false;
+      }
+      *pseudo = field.value;
+      continue;
+    }
+    regular = true;
+    if (!validName(field.name) || connectionSpecific(field.name)
+        || (field.name == "te" && field.value != "trailers")) {
+      return false;
+    }
+    if (field.name == "cookie") {
+      // Split into crumbs for compression, one header again for the handlers
+      cookie += (cookie.empty() ? "" : "; ") + field.value;
+      continue;
+    }
+    if (field.name == "host") {
+      if (!authority.empty()) {
+        continue;
+      }
+      hasHost = true;
+    }
+    lines += field.name + ": " + field.value + "\r\n";
+  }
+  if (method.empty() || path.empty() || scheme.empty() || method == "CONNECT") {
+    return false;
+  }
+
+  std::string request = method + " " + path + " HTTP/1.1\r\n";
+  if (!authority.empty() && !hasHost) {
+    request += "host: " + authority + "\r\n";
+  }
+  request += lines;
+  if (!cookie.empty()) {
+    request += "cookie: " + cookie + "\r\n";
+  }
+  request += "\r\n";
+
+  bool close = false;
+  if (request.size() > MAX_HEADER_SIZE) {
+    req = Parser::parseRequest(http::STATUS_BAD_REQUEST_400, close, true);
+  } else {
+    req = Parser::parseRequest(request, close, false);
+  }
+  head = method == "HEAD";
+  return true;
+}
+
+void Session::handleSettings(uint8_t flags, uint32_t stream, const uint8_t* payload, size_t size) {
+  if (stream != 0) {
+    connectionError(PROTOCOL_ERROR);
+    return;
+  }
+  if (flags & FLAG_ACK) {
+    if (size != 0) {
+      connectionError(FRAME_SIZE_ERROR);
+    }
+    return;
+  }
+  if (size % 6 != 0) {
+    connectionError(FRAME_SIZE_ERROR);
+    return;
+  }
+  ErrorCode error = applySettings(payload, size);
+  if (error != NO_ERROR) {
+    connectionError(error);
+    return;
+  }
+  _settingsSeen = true;
+  writeFrame(SETTINGS, FLAG_ACK, 0, nullptr, 0);
+  flush();   // a larger window lets held back data go
+}
+
+ErrorCode Session::applySettings(const uint8_t* payload, size_t size) {
+  for (size_t pos = 0; pos + 6 <= size; pos += 6) {
+    uint16_t id = static_cast<uint16_t>((payload[pos] << 8) | payload[pos + 1]);
+    uint32_t value = read32(payload + pos + 2);
+    switch (id) {
+      case SETTINGS_HEADER_TABLE_SIZE:
+        _encoder.setMaxTableSize(value);
+        break;
+      case SETTINGS_ENABLE_PUSH:
+        if (value > 1) {
+          return PROTOCOL_ERROR;
+        }
+        break;
+      case SETTINGS_INITIAL_WINDOW_SIZE: {
+        if (value > MAX_WINDOW) {
+          return FLOW_CONTROL_ERROR;
+        }
+        // Applies to every open stream, by the difference
+        int64_t delta = static_cast<int64_t>(value) - _initialWindow;
+        for (auto& [id, stream] : _streams) {
+          stream.sendWindow += delta;
+          if (stream.sendWindow > MAX_WINDOW) {
+            return FLOW_CONTROL_ERROR;
+          }
+        }
+        _initialWindow = value;
+        break;
+      }
+      case SETTINGS_MAX_FRAME_SIZE:
+        if (value < 16384 || value > 16777215) {
+          return PROTOCOL_ERROR;
+        }
+        _peerMaxFrame = value;
+        break;
+      default:
+        break;   // concurrency and header list limits of the client do not bind a server that never pushes
+    }
+  }
+  return NO_ERROR;
+}
+
+void Session::handleWindowUpdate(uint32_t id, const uint8_t* payload, size_t size) {
+  if (size != 4) {
+    connectionError(FRAME_SIZE_ERROR);
+    return;
+  }
+  uint32_t increment = read32(payload) & 0x7fffffff;
+  if (id == 0) {
+    if (increment == 0 || _sendWindow + increment > MAX_WINDOW) {
+      connectionError(increment == 0 ? PROTOCOL_ERROR : FLOW_CONTROL_ERROR);
+      return;
+    }
+    _sendWindow += increment;
+    flush();
+    return;
+  }
+  if (id > _lastStream) {
+    connectionError(PROTOCOL_ERROR);
+    return;
+  }
+  auto it = _streams.find(id);
+  if (it == _streams.end()) {
+    return;
+  }
+  if (increment == 0 || it->second.sendWindow + increment > MAX_WINDOW) {
+    streamError(id, increment == 0 ? PROTOCOL_ERROR : FLOW_CONTROL_ERROR);
+    return;
+  }
+  it->second.sendWindow += increment;
+  sendPending(id, it->second);
+  retire(it);
+}
+
+void Session::handleRstStream(uint32_t id, const uint8_t* payload, size_t size) {
+  (void)payload;
+  if (id == 0 || id > _lastStream) {
+    connectionError(PROTOCOL_ERROR);
+    return;
+  }
+  if (size != 4) {
+    connectionError(FRAME_SIZE_ERROR);
+    return;
+  }
+  auto it = _streams.find(id);
+  if (it == _streams.end()) {
+    return;
+  }
+  _streams.erase(it);
+  StreamEvent event;
+  event.type = StreamEvent::CANCELLED;
+  event.stream = id;
+  _events.push_back(std::move(event));
+}
+
+// ========================= FRAMES OUT =========================
+
+void Session::writeFrame(uint8_t type, uint8_t flags, uint32_t stream, const void* payload, size_t size) {
+  _out.push_back(static_cast<char>(size >> 16));
+  _out.push_back(static_cast<char>(size >> 8));
+  _out.push_back(static_cast<char>(size));
+  _out.push_back(static_cast<char>(type));
+  _out.push_back(static_cast<char>(flags));
+  append32(_out, stream);
+  if (size > 0) {
+    _out.append(static_cast<const char*>(payload), size);
+  }
+}
+
+/** HEADERS frame, followed by CONTINUATION frames when the block is larger than a frame */
+void Session::writeHeaders(uint32_t stream, const std::string& block, bool endStream) {
+  size_t first = std::min(block.size(), _peerMaxFrame);
+  uint8_t flags = (endStream ? FLAG_END_STREAM : 0) | (first == block.size() ? FLAG_END_HEADERS : 0);
+  writeFrame(HEADERS, flags, stream, block.data(), first);
+  for (size_t pos = first; pos < block.size();) {
+    size_t size = std::min(block.size() - pos, _peerMaxFrame);
+    writeFrame(CONTINUATION, pos + size == block.size() ? FLAG_END_HEADERS : 0, stream, block.data() + pos, size);
+    pos += size;
+  }
+}
+
+void Session::writeRstStream(uint32_t stream, ErrorCode error) {
+  std::string payload;
+  append32(payload, error);
+  writeFrame(RST_STREAM, 0, stream, payload.data(), payload.size());
+}
+
+void Session::writeWindowUpdate(uint32_t stream, uint32_t increment) {
+  std::string payload;
+  append32(payload, increment);
+  writeFrame(WINDOW_UPDATE, 0, stream, payload.data(), payload.size());
+}
+
+/** The connection cannot go on: GOAWAY, and everything after it is ignored */
+void Session::connectionError(ErrorCode error) {
+  if (_goawaySent) {
+    return;
+  }
+  std::string payload;
+  append32(payload, _lastStream);
+  append32(payload, error);
+  writeFrame(GOAWAY, 0, 0, payload.data(), payload.size());
+  _goawaySent = true;
+}
+
+/** Only this stream fails: RST_STREAM, and its work is stopped */
+void Session::streamError(uint32_t id, ErrorCode error) {
+  writeRstStream(id, error);
+  if (_streams.erase(id)) {
+    StreamEvent event;
+    event.type = StreamEvent::CANCELLED;
+    event.stream = id;
+    _events.push_back(std::move(event));
+  }
+}
+
+void Session::flush() {
+  for (auto it = _streams.begin(); it != _streams.end() && _sendWindow > 0;) {
+    auto next = std::next(it);
+    sendPending(it->first, it->second);
+    retire(it);
+    it = next;
+  }
+}
+
+/** DATA frames for what the windows allow of a stream's pending body */
+void Session::sendPending(uint32_t id, Stream& stream) {
+  while (!stream.localClosed && stream.responded) {
+    size_t left = stream.pending.size() - stream.sent;
+    if (left == 0) {
+      if (stream.endPending) {
+        writeFrame(DATA, FLAG_END_STREAM, id, nullptr, 0);
+        stream.localClosed = true;
+      }
+      break;
+    }
+    int64_t allowed = std::min<int64_t>({_sendWindow, stream.sendWindow, static_cast<int64_t>(_peerMaxFrame),
+                                        static_cast<int64_t>(left)});
+    if (allowed <= 0) {
+      break;
+    }
+    size_t size = static_cast<size_t>(allowed);
+    bool end = stream.endPending && size == left;
+    writeFrame(DATA, end ? FLAG_END_STREAM : 0, id, stream.pending.data() + stream.sent, size);
+    stream.sent += size;
+    _sendWindow -= allowed;
+    stream.sendWindow -= allowed;
+    stream.localClosed = end;
+  }
+  if (stream.sent == stream.pending.size()) {
+    stream.pending.clear();
+    stream.sent = 0;
+  } else if (stream.sent >= MAX_HEADER_SIZE && stream.sent * 2 >= stream.pending.size()) {
+    stream.pending.erase(0, stream.sent);
+    stream.sent = 0;
+  }
+}
+
+/** Forget a stream once both sides are done with it */
+void Session::retire(std::map<uint32_t, Stream>::iterator it) {
+  Stream& stream = it->second;
+  if (!stream.localClosed) {
+    return;
+  }
+  if (!stream.remoteClosed) {
+    // Answered before the whole body arrived (413...): the client can stop sending it
+    writeRstStream(it->first, NO_ERROR);
+    stream.remoteClosed = true;
+  }
+  _streams.erase(it);
+}
+
+} // namespace http2
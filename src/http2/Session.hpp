@@ -0,0 +1,157 @@
+/**
+ * @file Session.hpp
+ * @brief Server side of an HTTP/2 connection over cleartext (h2c)
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "Hpack.hpp"
+#include "../../inc/webserv.hpp"
+#include "../request/Request.hpp"
+#include "../request/ChunkedDecoder.hpp"
+#include "../response/Response.hpp"
+
+namespace http2 {
+
+/** Client connection preface, sent before its first frame */
+constexpr std::string_view PREFACE = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+/** Error codes of RST_STREAM and GOAWAY (RFC 9113 section 7) */
+enum ErrorCode : uint32_t {
+  NO_ERROR = 0x0,
+  PROTOCOL_ERROR = 0x1,
+  INTERNAL_ERROR = 0x2,
+  FLOW_CONTROL_ERROR = 0x3,
+  STREAM_CLOSED = 0x5,
+  FRAME_SIZE_ERROR = 0x6,
+  REFUSED_STREAM = 0x7,
+  CANCEL = 0x8,
+  COMPRESSION_ERROR = 0x9,
+  ENHANCE_YOUR_CALM = 0xb,
+};
+
+/** Something a client did on a stream, for the event loop to act on */
+struct StreamEvent {
+  enum Type {
+    REQUEST,    // request head arrived; the body follows as DATA unless end is set
+    DATA,       // piece of the request body
+    END,        // request body complete
+    CANCELLED,  // client reset the stream, its work can stop
+  };
+  Type type = REQUEST;
+  uint32_t stream = 0;
+  Request request;
+  std::string data;
+  bool end = false;
+};
+
+/**
+ * @class Session
+ * @brief Frames, streams, HPACK and flow control of one HTTP/2 connection
+ *
+ * Bytes read from the socket are fed in and turn into StreamEvents; each
+ * request head goes through Parser as an HTTP/1.1 head, so Router handles it
+ * like any other request. Responses come back per stream in any order and
+ * leave as HEADERS and DATA frames within the client's flow control windows;
+ * what does not fit waits in the stream until WINDOW_UPDATE. Frames to send
+ * collect in output().
+ */
+class Session {
+  public:
+    /** @param maxStreams Streams open at once, more are refused */
+    explicit Session(size_t maxStreams);
+
+    /**
+     * @brief Take over a connection upgraded from HTTP/1.1, the request becomes stream 1
+     * @param settings HTTP2-Settings header of the request
+     * @return false when the header is malformed and the upgrade has to be ignored
+     */
+    bool upgrade(std::string_view settings, const Request& req);
+
+    /** Handle the complete frames at the front of in and erase them */
+    void feed(std::string& in);
+
+    /** Next thing a client did, false when there is none */
+    bool nextEvent(StreamEvent& event);
+
+    /** Send a response; with more set its body follows through sendData() */
+    void respond(uint32_t stream, const Response& res, bool more);
+
+    /** Send body bytes of a response, without the chunked coding its head may announce */
+    void sendData(uint32_t stream, std::string_view data, bool end);
+
+    /** Abandon a stream whose response cannot be completed */
+    void reset(uint32_t stream, ErrorCode error);
+
+    /** Frames ready to go out, the caller empties it */
+    std::string& output();
+
+    /** Response bytes of a stream held back by flow control */
+    size_t backlog(uint32_t stream) const;
+
+    /** True once the connection closes after output() is sent */
+    bool closing() const;
+
+  private:
+    struct Stream {
+      bool remoteClosed = false;    // request complete
+      bool localClosed = false;     // END_STREAM sent
+      bool responded = false;
+      bool head = false;            // HEAD request, no body goes out
+      int64_t sendWindow = 0;
+      int64_t recvWindow = H2_WINDOW_SIZE;
+      std::string pending;          // response body not sent yet
+      size_t sent = 0;              // of pending
+      bool endPending = false;      // pending is the end of the body
+      std::unique_ptr<ChunkedDecoder> dechunk;
+    };
+
+    void handleFrame(uint8_t type, uint8_t flags, uint32_t stream, const uint8_t* payload, size_t size);
+    void handleData(uint8_t flags, uint32_t stream, const uint8_t* payload, size_t size);
+    void handleHeaders(uint8_t flags, uint32_t stream, const uint8_t* payload, size_t size);
+    void handleHeaderBlock(uint32_t stream, bool endStream);
+    void handleSettings(uint8_t flags, uint32_t stream, const uint8_t* payload, size_t size);
+    void handleWindowUpdate(uint32_t stream, const uint8_t* payload, size_t size);
+    void handleRstStream(uint32_t stream, const uint8_t* payload, size_t size);
+    ErrorCode applySettings(const uint8_t* payload, size_t size);
+    bool buildRequest(const HeaderFields& fields, Request& req, bool& head);
+
+    void writeFrame(uint8_t type, uint8_t flags, uint32_t stream, const void* payload, size_t size);
+    void writeHeaders(uint32_t stream, const std::string& block, bool endStream);
+    void writeRstStream(uint32_t stream, ErrorCode error);
+    void writeWindowUpdate(uint32_t stream, uint32_t increment);
+    void connectionError(ErrorCode error);
+    void streamError(uint32_t stream, ErrorCode error);
+    void flush();
+    void sendPending(uint32_t id, Stream& stream);
+    void retire(std::map<uint32_t, Stream>::iterator it);
+
+    std::map<uint32_t, Stream> _streams;
+    std::deque<StreamEvent> _events;
+    std::string _out;
+    HpackDecoder _decoder;
+    HpackEncoder _encoder;
+    size_t _maxStreams;
+    bool _prefaceSeen = false;
+    bool _settingsSeen = false;       // client's first frame has to be SETTINGS
+    uint32_t _lastStream = 0;         // highest stream the client opened
+    uint32_t _headerStream = 0;       // stream whose header block continues in CONTINUATION frames
+    bool _headerEnd = false;          // END_STREAM of that HEADERS frame
+    std::string _headerBlock;
+    int64_t _sendWindow = 65535;
+    int64_t _recvWindow = H2_WINDOW_SIZE;
+    int64_t _initialWindow = 65535;   // client's SETTINGS_INITIAL_WINDOW_SIZE
+    size_t _peerMaxFrame = 16384;     // client's SETTINGS_MAX_FRAME_SIZE
+    bool _goawaySent = false;
+    bool _goawayReceived = false;
+};
+
+} // namespace http2
@@ -1,4 +1,5 @@
 #include "Parser.hpp"
+#include "../server/Log.hpp"
 
 bool isValidMethod(std::string_view method) {
     static const std::unordered_set<std::string_view> validMethods = {
@@ -187,7 +188,7 @@ void findKeepAlive(const std::vector<std::string>& headers, bool& kick_me) {
     else if (value == "close")
         kick_me = true;
     else
-        std::cout << "Error: Unreachable: findKeepAlive()\n";
+        LOG_DEBUG("Connection: " << value << " leaves the connection as it is");
 }
 
 
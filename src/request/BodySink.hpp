@@ -0,0 +1,40 @@
+/**
+ * @file BodySink.hpp
+ * @brief Consumer of a request body as it arrives
+ */
+
+#pragma once
+
+#include <cstddef>
+
+class Response;
+
+/**
+ * @class BodySink
+ * @brief Takes a request body piece by piece instead of after it is complete
+ *
+ * The router opens one once the head of a request is parsed; Cluster feeds it
+ * the body bytes of each socket read and calls finish() after the last one, so
+ * the body is never held in memory as a whole. A sink that writes on another
+ * thread exposes fd() meanwhile; once it is full() the connection is not read
+ * until that descriptor is ready and onEvent() took the result.
+ */
+class BodySink {
+  public:
+    virtual ~BodySink() = default;
+
+    /** Consume the next body bytes */
+    virtual void write(const char* data, size_t size) = 0;
+
+    /** Body complete, fill the response */
+    virtual void finish(Response& res) = 0;
+
+    /** Descriptor to poll for POLLIN while written bytes are in progress, -1 when idle */
+    virtual int fd() const { return -1; }
+
+    /** Take up the progress fd() signalled */
+    virtual void onEvent() {}
+
+    /** True while the sink holds as many bytes as it takes before fd() is ready */
+    virtual bool full() const { return false; }
+};
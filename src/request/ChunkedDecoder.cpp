@@ -0,0 +1,118 @@
+#include "ChunkedDecoder.hpp"
+#include "../../inc/webserv.hpp"
+
+#include <algorithm> // for std::min
+
+ChunkedDecoder::ChunkedDecoder(size_t maxBodySize) : _maxBodySize(maxBodySize) {}
+
+size_t ChunkedDecoder::decode(const char* data, size_t size, const Output& out) {
+  size_t pos = 0;
+  while (pos < size && _state != DONE && _state != FAILED) {
+    if (_state == DATA) {
+      size_t length = static_cast<size_t>(std::min<uint64_t>(_chunkSize, size - pos));
+      out(data + pos, length);
+      pos += length;
+      _chunkSize -= length;
+      if (_chunkSize == 0)
+        _state = DATA_CR;
+      continue;
+    }
+    step(data[pos++]);
+  }
+  return pos;
+}
+
+bool ChunkedDecoder::done() const {
+  return _state == DONE;
+}
+
+bool ChunkedDecoder::failed() const {
+  return _state == FAILED;
+}
+
+size_t ChunkedDecoder::bodySize() const {
+  return _bodySize;
+}
+
+/** Handle one byte outside chunk data */
+void ChunkedDecoder::step(char c) {
+  // Size lines and trailers are bounded like a request head
+  if (++_lineSize > MAX_HEADER_SIZE) {
+    _state = FAILED;
+    return;
+  }
+
+  switch (_state) {
+    case SIZE: {
+      int digit = -1;
+      if (c >= '0' && c <= '9')
+        digit = c - '0';
+      else if (c >= 'a' && c <= 'f')
+        digit = c - 'a' + 10;
+      else if (c >= 'A' && c <= 'F')
+        digit = c - 'A' + 10;
+
+      if (digit >= 0 && _digits < 16) {
+        _chunkSize = (_chunkSize << 4) | digit;
+        ++_digits;
+      } else if (digit >= 0 || _digits == 0) {
+        _state = FAILED;
+      } else if (c == ';' || c == ' ' || c == '\t') {
+        _state = EXTENSION;
+      } else if (c == '\r') {
+        _state = SIZE_LF;
+      } else {
+        _state = FAILED;
+      }
+      break;
+    }
+    case EXTENSION:
+      if (c == '\r')
+        _state = SIZE_LF;
+      else if (c == '\n')
+        _state = FAILED;
+      break;
+    case SIZE_LF:
+      if (c != '\n' || _chunkSize > _maxBodySize - _bodySize) {
+        _state = FAILED;
+        break;
+      }
+      _lineSize = 0;
+      if (_chunkSize == 0) {
+        _state = TRAILER;
+        break;
+      }
+      _bodySize += _chunkSize;
+      _state = DATA;
+      break;
+    case DATA_CR:
+      _state = c == '\r' ? DATA_LF : FAILED;
+      break;
+    case DATA_LF:
+      if (c != '\n') {
+        _state = FAILED;
+        break;
+      }
+      _chunkSize = 0;
+      _digits = 0;
+      _lineSize = 0;
+      _state = SIZE;
+      break;
+    case TRAILER:
+      // An empty line ends the body; trailer fields are not used
+      _state = c == '\r' ? END_LF : TRAILER_LINE;
+      break;
+    case TRAILER_LINE:
+      if (c == '\r')
+        _state = TRAILER_LF;
+      break;
+    case TRAILER_LF:
+      _state = c == '\n' ? TRAILER : FAILED;
+      break;
+    case END_LF:
+      _state = c == '\n' ? DONE : FAILED;
+      break;
+    default:
+      break;
+  }
+}
@@ -0,0 +1,55 @@
+/**
+ * @file ChunkedDecoder.hpp
+ * @brief Incremental decoder for the chunked transfer coding
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+/**
+ * @class ChunkedDecoder
+ * @brief Removes the chunked transfer coding from a request body as it arrives
+ *
+ * Keeps its position across reads, so every byte is looked at once however the
+ * body is split. Chunk data goes straight to the output callback; chunk
+ * extensions and trailer fields are skipped.
+ */
+class ChunkedDecoder {
+  public:
+    /** Receives the decoded body, in pieces */
+    using Output = std::function<void(const char* data, size_t size)>;
+
+    /** @param maxBodySize Decoded size past which the body is rejected */
+    explicit ChunkedDecoder(size_t maxBodySize);
+
+    /**
+     * @brief Decode the next bytes of the coded body
+     * @return Bytes consumed; anything after the last chunk's trailer is left for the next request
+     */
+    size_t decode(const char* data, size_t size, const Output& out);
+
+    /** True once the last chunk and its trailer were read */
+    bool done() const;
+
+    /** True once the body is malformed or too large */
+    bool failed() const;
+
+    /** Decoded bytes so far */
+    size_t bodySize() const;
+
+  private:
+    enum State { SIZE, EXTENSION, SIZE_LF, DATA, DATA_CR, DATA_LF, TRAILER, TRAILER_LINE, TRAILER_LF, END_LF, DONE, FAILED };
+
+    /** Handle one byte outside chunk data */
+    void step(char c);
+
+    State _state = SIZE;
+    uint64_t _chunkSize = 0;    // size of the current chunk, then what is left of it
+    size_t _digits = 0;         // hex digits of the current size line
+    size_t _lineSize = 0;       // bytes of the current size line, or of the whole trailer
+    size_t _bodySize = 0;
+    size_t _maxBodySize;
+};
@@ -20,6 +20,14 @@ std::string_view Request::getStatus() const {
   return _status;
 }
 
+const std::string& Request::getRemoteAddr() const {
+  return _remoteAddr;
+}
+
+void Request::setRemoteAddr(const std::string& addr) {
+  _remoteAddr = addr;
+}
+
 std::string Request::getMessageType() const {
     return "Request";
 }
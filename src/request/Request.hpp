@@ -6,6 +6,7 @@ class Request : public AMessage {
   private:
     bool _isError;
     std::string _status;
+    std::string _remoteAddr;  // client address, empty outside a connection
 
   public:
     Request(void);
@@ -17,6 +18,9 @@ class Request : public AMessage {
     std::string_view getStatus() const;
     void setStatus(const std::string& status);
 
+    const std::string& getRemoteAddr() const;
+    void setRemoteAddr(const std::string& addr);
+
 
     virtual std::string getMessageType() const override;
     void print() const;
@@ -0,0 +1,52 @@
+/**
+ * @file PendingResponse.hpp
+ * @brief Response that is completed later by the event loop
+ */
+
+#pragma once
+
+#include <string>
+
+#include "../../inc/webserv.hpp"
+
+class Response;
+
+/**
+ * @class PendingResponse
+ * @brief Work a handler started but could not finish synchronously
+ *
+ * The handler attaches it to the Response; Cluster polls fd() and calls
+ * onEvent() until done(), then finish() fills the real response. A streaming
+ * job hands its head over early and its body piece by piece through takeBody().
+ */
+class PendingResponse {
+  public:
+    virtual ~PendingResponse() = default;
+
+    /** Descriptor to poll, -1 while the work is queued */
+    virtual int fd() const = 0;
+
+    /** poll() events to wait for on fd() */
+    virtual short events() const = 0;
+
+    /** Advance on poll() readiness of fd() */
+    virtual void onEvent(short revents) = 0;
+
+    /** True once finish() can build the response */
+    virtual bool done() const = 0;
+
+    /** Fill the final response */
+    virtual void finish(Response& res) = 0;
+
+    /** Stop the work; a timed out job finishes with 504, a dropped one is discarded */
+    virtual void abort(bool timedOut) = 0;
+
+    /** True once the head can go out before the body is complete; finish() then fills status and headers only */
+    virtual bool streaming() const { return false; }
+
+    /** Move body bytes produced so far, already framed, into out; false when the connection must close after them */
+    virtual bool takeBody(std::string& out) { (void)out; return true; }
+
+    /** True once the job waited too long, elapsedMs counting from its start or its last streamed bytes */
+    virtual bool expired(long long elapsedMs) const { return elapsedMs > TIME_OUT_CGI; }
+};
@@ -4,10 +4,12 @@
  */
 
 #include "Response.hpp"
+#include "../../inc/webserv.hpp"
 
 /** Default constructor */
 Response::Response() {
   _status = "";
+  _headerList.reserve(RESPONSE_HEADERS_RESERVED);
 }
 
 /** Destructor */
@@ -21,6 +23,7 @@ std::string Response::getMessageType() const {
 /** Set HTTP status line */
 void Response::setStatus(const std::string& status) {
   _status = status;
+  _serialized.reset();
 }
 
 /** Get HTTP status line */
@@ -30,7 +33,60 @@ std::string_view Response::getStatus() const {
 
 /** Set HTTP header */
 void Response::setHeaders(const std::string& key, const std::string& value) {
-    AMessage::setHeaders(key, value);
+    _headerList.push_back({key, value});
+    _serialized.reset();
+}
+
+/** Get values of a header, in the order they were set */
+std::vector<std::string> Response::getHeaders(const std::string& key) const {
+  std::vector<std::string> values;
+  for (const Header& header : _headerList) {
+    if (header.name == key) {
+      values.push_back(header.value);
+    }
+  }
+  return values;
+}
+
+/** Get all headers in the order they were set */
+const Response::HeaderList& Response::getHeaderList() const {
+  return _headerList;
+}
+
+/** Set response body */
+void Response::setBody(const std::string& body) {
+  AMessage::setBody(body);
+  _serialized.reset();
+}
+
+/** Attach headers and body already serialized, dropped again by any later change */
+void Response::setSerialized(std::shared_ptr<const std::string> serialized) {
+  _serialized = std::move(serialized);
+}
+
+/** Get the serialized headers and body, nullptr when they have to be built from the fields */
+const std::shared_ptr<const std::string>& Response::getSerialized() const {
+  return _serialized;
+}
+
+/** Attach work the event loop has to finish before the response is sent */
+void Response::setPending(std::shared_ptr<PendingResponse> pending) {
+  _pending = std::move(pending);
+}
+
+/** Get pending work, nullptr for complete responses */
+const std::shared_ptr<PendingResponse>& Response::getPending() const {
+  return _pending;
+}
+
+/** Attach work the event loop runs after the response is sent, nobody waits for its result */
+void Response::setBackground(std::shared_ptr<PendingResponse> background) {
+  _background = std::move(background);
+}
+
+/** Get background work, nullptr when there is none */
+const std::shared_ptr<PendingResponse>& Response::getBackground() const {
+  return _background;
 }
 
 /** Print response to console for debugging */
@@ -39,13 +95,8 @@ void Response::print() const {
     std::cout << "Status     : " << _status << "\n";
 
     std::cout << "Headers    :\n";
-    const auto& headers = getAllHeaders();
-    for (const auto& pair : headers) {
-        const std::string& key = pair.first;
-        const std::vector<std::string>& values = pair.second;
-        for (const auto& value : values) {
-            std::cout << key << ": " << value << "\n";
-        }
+    for (const Header& header : _headerList) {
+        std::cout << header.name << ": " << header.value << "\n";
     }
 
     // std::cout << "Body: Uncommented for debugging in Response.cpp\n" << std::endl;
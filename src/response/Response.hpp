@@ -8,7 +8,10 @@
 #include <string>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <vector>
 #include "../message/AMessage.hpp"
+#include "PendingResponse.hpp"
 
 /**
  * @class Response
@@ -16,6 +19,13 @@
  */
 class Response: public AMessage {
   public:
+    /** One header line, kept in the order it was set */
+    struct Header {
+      std::string name;
+      std::string value;
+    };
+    typedef std::vector<Header> HeaderList;
+
     Response();
     ~Response();
 
@@ -31,9 +41,43 @@ class Response: public AMessage {
     /** Set HTTP header */
     virtual void setHeaders(const std::string& key, const std::string& value) override;
 
+    /** Get values of a header, in the order they were set */
+    std::vector<std::string> getHeaders(const std::string& key) const;
+
+    /** Get all headers in the order they were set */
+    const HeaderList& getHeaderList() const;
+
+    /** Headers are kept in getHeaderList(), not in the request's map */
+    const std::unordered_map<std::string, std::vector<std::string>>& getAllHeaders() const = delete;
+
+    /** Set response body */
+    virtual void setBody(const std::string& body) override;
+
+    /** Attach headers and body already serialized, dropped again by any later change */
+    void setSerialized(std::shared_ptr<const std::string> serialized);
+
+    /** Get the serialized headers and body, nullptr when they have to be built from the fields */
+    const std::shared_ptr<const std::string>& getSerialized() const;
+
+    /** Attach work the event loop has to finish before the response is sent */
+    void setPending(std::shared_ptr<PendingResponse> pending);
+
+    /** Get pending work, nullptr for complete responses */
+    const std::shared_ptr<PendingResponse>& getPending() const;
+
+    /** Attach work the event loop runs after the response is sent, nobody waits for its result */
+    void setBackground(std::shared_ptr<PendingResponse> background);
+
+    /** Get background work, nullptr when there is none */
+    const std::shared_ptr<PendingResponse>& getBackground() const;
+
     /** Print response to console for debugging */
     void print() const;
 
   private:
     std::string _status;
+    HeaderList _headerList;
+    std::shared_ptr<const std::string> _serialized;
+    std::shared_ptr<PendingResponse> _pending;
+    std::shared_ptr<PendingResponse> _background;
 };
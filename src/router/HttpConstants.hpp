@@ -23,6 +23,8 @@ namespace http {
   const std::string STATUS_BAD_REQUEST_400 = "400 Bad Request";
   const std::string STATUS_PAYLOAD_TOO_LARGE_413 = "413 Payload Too Large";
   const std::string STATUS_INTERNAL_SERVER_ERROR_500 = "500 Internal Server Error";
+  const std::string STATUS_BAD_GATEWAY_502 = "502 Bad Gateway";
+  const std::string STATUS_SERVICE_UNAVAILABLE_503 = "503 Service Unavailable";
   const std::string STATUS_GATEWAY_TIMEOUT_504 = "504 Gateway Timeout";
   const std::string STATUS_REQUEST_TIMEOUT_408 = "408 Request Timeout";
 
@@ -36,6 +38,8 @@ namespace http {
   const int BAD_REQUEST_400 = 400;
   const int PAYLOAD_TOO_LARGE_413 = 413;
   const int INTERNAL_SERVER_ERROR_500 = 500;
+  const int BAD_GATEWAY_502 = 502;
+  const int SERVICE_UNAVAILABLE_503 = 503;
   const int GATEWAY_TIMEOUT_504 = 504;
   const int REQUEST_TIMEOUT_408 = 408;
 
@@ -49,19 +53,26 @@ namespace http {
   const std::string CONTENT_TYPE = "Content-Type";
   const std::string CONTENT_LENGTH = "Content-Length";
   const std::string CONNECTION = "Connection";
+  const std::string TRANSFER_ENCODING = "Transfer-Encoding";
   const std::string LOCATION = "Location";
   const std::string USER_AGENT = "User-Agent";
   const std::string ACCEPT = "Accept";
   const std::string HOST = "Host";
   const std::string ALLOW = "Allow";
+  const std::string DATE = "Date";
+  const std::string SERVER = "Server";
 
   // Connection Values
   const std::string CONNECTION_CLOSE = "close";
   const std::string CONNECTION_KEEP_ALIVE = "keep-alive";
 
+  // Transfer Encodings
+  const std::string TRANSFER_ENCODING_CHUNKED = "chunked";
+
   // Content Types
   const std::string CONTENT_TYPE_HTML = "text/html";
   const std::string CONTENT_TYPE_TEXT = "text/plain";
+  const std::string CONTENT_TYPE_JSON = "application/json";
 }
 
 /**
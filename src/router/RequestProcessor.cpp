@@ -66,6 +66,26 @@ void RequestProcessor::processRequest(const Request& req, const Handler* handler
   router::utils::HttpResponseBuilder::setErrorResponse(res, http::NOT_FOUND_404, req, server);
 }
 
+/** Status processRequest would refuse the request with before running a handler, 0 when it gets that far */
+int RequestProcessor::checkHead(const Request& req, const Handler* handler, const Server& server) const {
+  std::string method(req.getMethod());
+
+  // Same order of checks as processRequest
+  if (method != http::GET && method != http::POST && method != http::DELETE) {
+    return http::METHOD_NOT_ALLOWED_405;
+  }
+  if (handler) {
+    return 0;
+  }
+  if (isPathExistsButMethodNotAllowed(req, server)) {
+    return http::METHOD_NOT_ALLOWED_405;
+  }
+  if (!isPathConfigured(req, server) || method != http::GET) {
+    return http::NOT_FOUND_404;
+  }
+  return 0;
+}
+
 /** Execute handler */
 bool RequestProcessor::executeHandler(const Handler* handler,
                                       const Request& req, Response& res,
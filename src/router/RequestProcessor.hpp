@@ -28,6 +28,8 @@ class RequestProcessor {
     void processRequest(const Request& req, const Handler* handler,
                         Response& res, const Server& server) const;
 
+    /** Status processRequest would refuse the request with before running a handler, 0 when it gets that far */
+    int checkHead(const Request& req, const Handler* handler, const Server& server) const;
 
   private:
     /** Execute handler with error handling */
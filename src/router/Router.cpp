@@ -10,9 +10,13 @@
 #include "HttpConstants.hpp"
 #include "handlers/Handlers.hpp"
 
+#include <chrono> // for std::chrono::steady_clock
+#include <cstdlib> // for std::strtoull
+#include <netdb.h> // for getaddrinfo, freeaddrinfo
+
 using namespace router::utils;
 
-Router::Router() {}
+Router::Router() : _fileIo(std::make_unique<router::handlers::FileIoPool>(FILE_IO_THREADS, FILE_IO_QUEUE)) {}
 
 Router::~Router() {}
 
@@ -21,57 +25,258 @@ Router::~Router() {}
 /** Initialize router with server configs */
 void Router::setupRouter(const std::vector<Server>& configs) {
   _routes.clear();
+  _uploadRoutes.clear();
+  _cgi.plans.clear();
+  _cgi.pools.clear();
+  _cgi.caches.clear();
+  _proxy.targets.clear();
+  _proxy.groups.clear();
+  _proxy.pools.clear();
+  _cgi.diskCaches.clear();
+  _diskCaches.clear();
+
+  const CgiSetup* cgiSetup = &_cgi;
+  router::handlers::FileIoPool* fileIo = _fileIo.get();
 
   for (size_t i = 0; i < configs.size(); ++i) {
     const Server& server = configs[i];
     std::string server_root = server.getRoot();
+    const CachePath& cachePath = server.getCachePath();
+    if (!cachePath.path.empty()) {
+      _diskCaches[server.getId()] = std::make_unique<router::handlers::DiskCache>(
+        cachePath.path, static_cast<uint64_t>(cachePath.max_size) * 1024 * 1024, cachePath.inactive, server, fileIo);
+    }
 
     for (const auto& location : server.getLocations()) {
       std::string location_path = location.location;
 
+      if (!location.cgi_path.empty()) {
+        setupCgi(server, location);
+      }
+      const router::handlers::ProxyTarget* proxyTarget = nullptr;
+      if (!location.proxy_pass.empty()) {
+        proxyTarget = setupProxy(server, location);
+      }
+
       for (const auto& method : location.allowed_methods) {
         Handler handler;
+        const char* kind = "static";
 
-        if (!location.return_url.empty()) {
+        if (proxyTarget) {
+          kind = "proxy";
+          handler = [proxyTarget](const Request& req, Response& res, const Server& srv) {
+            proxy(req, res, srv, *proxyTarget);
+          };
+        } else if (location.stub_status) {
+          kind = "status";
+          handler = [this](const Request& req, Response& res, const Server& srv) {
+            stubStatus(req, res, srv, statusReport());
+          };
+        } else if (!location.return_url.empty()) {
+          kind = "redirect";
           handler = [](const Request& req, Response& res, const Server& srv) {
             redirect(req, res, srv);
           };
         } else if (!location.cgi_path.empty() && !location.cgi_ext.empty()) {
-          handler = [](const Request& req, Response& res, const Server& srv) {
-            cgi(req, res, srv);
+          kind = "cgi";
+          handler = [cgiSetup, fileIo](const Request& req, Response& res, const Server& srv) {
+            cgi(req, res, srv, cgiSetup, fileIo);
           };
         } else if (method == http::POST && !location.upload_path.empty()) {
-          handler = [](const Request& req, Response& res, const Server& srv) {
-            post(req, res, srv);
+          kind = "upload";
+          handler = [fileIo](const Request& req, Response& res, const Server& srv) {
+            post(req, res, srv, fileIo);
           };
+          _uploadRoutes.insert({server.getId(), location_path});
         } else if (method == http::DELETE && !location.upload_path.empty()) {
-          handler = [](const Request& req, Response& res, const Server& srv) {
-            del(req, res, srv);
+          kind = "delete";
+          handler = [fileIo](const Request& req, Response& res, const Server& srv) {
+            res.setPending(fileIo->submit(del, req, srv));
           };
         } else {
-          handler = [](const Request& req, Response& res, const Server& srv) {
-            get(req, res, srv);
+          handler = [fileIo](const Request& req, Response& res, const Server& srv) {
+            res.setPending(fileIo->submit([fileIo](const Request& req, Response& res, const Server& srv) {
+              get(req, res, srv, fileIo);
+            }, req, srv));
           };
         }
 
-        addRoute(server.getId(), method, location_path, handler);
+        addRoute(server.getId(), method, location_path, handler, kind);
       }
     }
   }
 //   listRoutes(); // test
 }
 
+/** Resolve launch plans for a CGI location, start its workers when cgi_pool is set and its cache when cgi_cache is */
+void Router::setupCgi(const Server& server, const Location& location) {
+  std::string workDir = router::utils::StringUtils::resolvePath(location.cgi_path, server.getRoot());
+  if (workDir.size() > 1 && workDir.back() == '/') {
+    workDir.pop_back();
+  }
+
+  router::handlers::CacheTarget cache = cacheTarget(server, location);
+  if (cache.cache) {
+    _cgi.diskCaches[{server.getId(), location.location}] = cache;
+  }
+
+  if (location.cgi_cache_ttl > 0) {
+    _cgi.caches[{server.getId(), location.location}] = std::make_unique<router::handlers::CgiCache>(
+      location.cgi_cache_ttl, location.cgi_cache_stale, location.cgi_cache_key_headers);
+  }
+
+  for (const auto& ext : location.cgi_ext) {
+    _cgi.plans[{server.getId(), location.location, ext}] = makeCgiExecPlan(ext, workDir);
+
+    if (location.cgi_pool_workers == 0) {
+      continue;
+    }
+    const router::handlers::CgiRunner* runner = router::handlers::CgiWorkerPool::findRunner(ext);
+    if (!runner) {
+      // No persistent runner for this interpreter, keep fork per request
+      continue;
+    }
+    _cgi.pools[{server.getId(), location.location, ext}] = std::make_unique<router::handlers::CgiWorkerPool>(
+      *runner, location.cgi_pool_workers, location.cgi_pool_max_requests, location.cgi_pool_queue, workDir);
+  }
+}
+
+/** Resolve the upstream of a proxy_pass location, an upstream {} block when its host names one */
+const router::handlers::ProxyTarget* Router::setupProxy(const Server& server, const Location& location) {
+  std::string host;
+  int port = 0;
+  router::handlers::ProxyTarget target;
+  if (!router::handlers::parseProxyUrl(location.proxy_pass, host, port, target.uri)) {
+    throw std::runtime_error("Error: Invalid proxy_pass: " + location.proxy_pass);
+  }
+  target.host = port == 80 ? host : host + ":" + std::to_string(port);
+  target.location = location.location;
+  target.connectTimeout = location.proxy_connect_timeout;
+  target.sendTimeout = location.proxy_send_timeout;
+  target.readTimeout = location.proxy_read_timeout;
+  target.cache = cacheTarget(server, location);
+
+  using router::handlers::UpstreamGroup;
+  auto upstream = server.getUpstreams().find(host);
+  bool named = upstream != server.getUpstreams().end();
+  std::string key = named ? std::to_string(server.getId()) + "/" + host : host + ":" + std::to_string(port);
+  std::unique_ptr<UpstreamGroup>& group = _proxy.groups[key];
+  if (!group) {
+    if (!named) {
+      group = std::make_unique<UpstreamGroup>(UpstreamGroup::ROUND_ROBIN);
+      group->addBackend(key, upstreamPool(host, port, location.proxy_keepalive), 1, 0, 0);
+    } else {
+      const Upstream& config = upstream->second;
+      UpstreamGroup::Balance balance = config.balance == "least_conn" ? UpstreamGroup::LEAST_CONN
+                                     : config.balance != "hash" ? UpstreamGroup::ROUND_ROBIN
+                                     : config.hash_key == "ip" ? UpstreamGroup::HASH_IP
+                                     : UpstreamGroup::HASH_URI;
+      group = std::make_unique<UpstreamGroup>(balance);
+      for (const UpstreamServer& backend : config.servers) {
+        group->addBackend(backend.host + ":" + std::to_string(backend.port),
+                          upstreamPool(backend.host, backend.port, location.proxy_keepalive),
+                          static_cast<int>(backend.weight), backend.max_fails, backend.fail_timeout);
+      }
+      UpstreamGroup::HealthCheck check;
+      check.path = config.health_path;
+      check.status = config.health_status;
+      check.interval = std::chrono::milliseconds(config.health_interval);
+      check.timeout = std::chrono::milliseconds(config.health_timeout);
+      check.rise = static_cast<unsigned>(config.health_rise);
+      check.fall = static_cast<unsigned>(config.health_fall);
+      group->setHealthCheck(check);
+    }
+  }
+  target.group = group.get();
+
+  router::handlers::ProxyTarget& stored = _proxy.targets[{server.getId(), location.location}];
+  stored = target;
+  return &stored;
+}
+
+/** Health probes of upstream backends due now, to run as background jobs */
+std::vector<std::shared_ptr<PendingResponse>> Router::dueHealthProbes() {
+  std::vector<std::shared_ptr<PendingResponse>> probes;
+  auto now = std::chrono::steady_clock::now();
+  for (auto& [key, group] : _proxy.groups) {
+    router::handlers::startDueProbes(*group, now, probes);
+  }
+  return probes;
+}
+
+/** Disk cache of a proxy_cache location, none when the location does not cache */
+router::handlers::CacheTarget Router::cacheTarget(const Server& server, const Location& location) const {
+  router::handlers::CacheTarget target;
+  auto it = _diskCaches.find(server.getId());
+  if (location.proxy_cache > 0 && it != _diskCaches.end()) {
+    target.cache = it->second.get();
+    target.ttl = location.proxy_cache;
+  }
+  return target;
+}
+
+/** Drop what the disk caches no longer keep, and take the file jobs they started */
+std::vector<std::shared_ptr<PendingResponse>> Router::sweepCaches() {
+  std::vector<std::shared_ptr<PendingResponse>> jobs;
+  auto now = std::chrono::steady_clock::now();
+  for (auto& [serverId, cache] : _diskCaches) {
+    cache->sweep(now);
+    for (auto& job : cache->takeJobs()) {
+      jobs.push_back(std::move(job));
+    }
+  }
+  return jobs;
+}
+
+/** Counters of the disk caches, summed over the servers */
+router::handlers::DiskCacheStats Router::cacheStats() const {
+  router::handlers::DiskCacheStats total;
+  for (const auto& [serverId, cache] : _diskCaches) {
+    router::handlers::DiskCacheStats stats = cache->stats();
+    total.hits += stats.hits;
+    total.misses += stats.misses;
+    total.bypasses += stats.bypasses;
+    total.stores += stats.stores;
+    total.evictions += stats.evictions;
+    total.entries += stats.entries;
+    total.size += stats.size;
+  }
+  return total;
+}
+
+/** Pool of an upstream address, resolved when first used so that the event loop never waits on a name lookup */
+router::handlers::UpstreamPool* Router::upstreamPool(const std::string& host, int port, size_t keepalive) {
+  std::string address = host + ":" + std::to_string(port);
+  std::unique_ptr<router::handlers::UpstreamPool>& pool = _proxy.pools[address];
+  if (!pool) {
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0 || !result) {
+      _proxy.pools.erase(address);
+      throw std::runtime_error("Error: proxy_pass: cannot resolve " + host);
+    }
+    sockaddr_in resolved = *reinterpret_cast<sockaddr_in*>(result->ai_addr);
+    freeaddrinfo(result);
+    pool = std::make_unique<router::handlers::UpstreamPool>(resolved, keepalive);
+  }
+  return pool.get();
+}
+
 // ========================= ROUTES REGISTRATION =========================
 
 /** Register route */
-void Router::addRoute(int server_id, std::string_view method, std::string_view path, Handler handler) {
-  _routes[server_id][std::string(path)][std::string(method)] = std::move(handler);
+void Router::addRoute(int server_id, std::string_view method, std::string_view path, Handler handler,
+                      const char* kind) {
+  _routes[server_id][std::string(path)][std::string(method)] = {std::move(handler), kind};
 }
 
 // =========================  REQUEST  HANDLING  =========================
 
-/** Find handler */
-const Router::Handler* Router::findHandler(int server_id, const std::string& method, const std::string& path) const {
+/** Find handler, and the route it is registered under and its kind when route_path and kind are given */
+const Router::Handler* Router::findHandler(int server_id, const std::string& method, const std::string& path,
+                                           const std::string** route_path, const char** kind) const {
   auto server_it = _routes.find(server_id);
   if (server_it == _routes.end()) {
     return nullptr;
@@ -84,12 +289,20 @@ const Router::Handler* Router::findHandler(int server_id, const std::string& met
   if (path_it != server_routes.end()) {
     auto method_it = path_it->second.find(method);
     if (method_it != path_it->second.end()) {
-      return &method_it->second;
+      if (route_path) {
+        *route_path = &path_it->first;
+      }
+      if (kind) {
+        *kind = method_it->second.kind;
+      }
+      return &method_it->second.handler;
     }
   }
 
   // Find best advanced match
   const Handler* best_handler = nullptr;
+  const std::string* best_route = nullptr;
+  const char* best_kind = nullptr;
   size_t best_match_length = 0;
   bool is_extension_match = false;
 
@@ -107,7 +320,9 @@ const Router::Handler* Router::findHandler(int server_id, const std::string& met
     if (!route_path.empty() && route_path[0] == '.' && path.length() > route_path.length()) {
       if (path.substr(path.length() - route_path.length()) == route_path) {
         if (!is_extension_match || route_path.length() > best_match_length) {
-          best_handler = &method_it->second;
+          best_handler = &method_it->second.handler;
+          best_route = &route_pair.first;
+          best_kind = method_it->second.kind;
           best_match_length = route_path.length();
           is_extension_match = true;
         }
@@ -132,13 +347,21 @@ const Router::Handler* Router::findHandler(int server_id, const std::string& met
 
       if (is_valid_prefix_match) {
         if (!is_extension_match && route_path.length() > best_match_length) {
-          best_handler = &method_it->second;
+          best_handler = &method_it->second.handler;
+          best_route = &route_pair.first;
+          best_kind = method_it->second.kind;
           best_match_length = route_path.length();
         }
       }
     }
   }
 
+  if (route_path && best_handler) {
+    *route_path = best_route;
+  }
+  if (kind && best_handler) {
+    *kind = best_kind;
+  }
   return best_handler;
 }
 
@@ -173,8 +396,8 @@ const Location* Router::findLocation(const Server& server, const std::string& pa
 }
 
 
-/** Process HTTP request */
-void Router::handleRequest(const Server& server, const Request& req, Response& res) const {
+/** Process HTTP request; trace gets the location that handled it and the kind of its handler */
+void Router::handleRequest(const Server& server, const Request& req, Response& res, RequestTrace* trace) const {
   if (req.getError()) {
     int statusCode = router::utils::HttpResponseBuilder::parseStatusCodeFromString(std::string(req.getStatus()));
     router::utils::HttpResponseBuilder::setErrorResponse(res, statusCode, req, server);
@@ -188,10 +411,105 @@ void Router::handleRequest(const Server& server, const Request& req, Response& r
   path = router::utils::StringUtils::normalizePath(path);
 
   // find handler, if not found, return 404
-  const Handler* handler = findHandler(server.getId(), method, path);
+  const Handler* handler = findHandler(server.getId(), method, path, trace ? &trace->route : nullptr,
+                                      trace ? &trace->handler : nullptr);
   _requestProcessor.processRequest(req, handler, res, server);
 }
 
+/** Open a sink for a request whose handler takes the body as it arrives, nullptr when it is buffered */
+std::unique_ptr<BodySink> Router::openBodySink(const Server& server, const Request& req, RequestTrace* trace) const {
+  if (req.getError()) {
+    return nullptr;
+  }
+
+  std::string method(req.getMethod());
+  std::string path = router::utils::StringUtils::normalizePath(std::string(req.getPath()));
+
+  // Same route handleRequest would pick
+  const std::string* route_path = nullptr;
+  const char* kind = nullptr;
+  if (!findHandler(server.getId(), method, path, &route_path, &kind)) {
+    return nullptr;
+  }
+  if (trace) {
+    trace->route = route_path;
+    trace->handler = kind;
+  }
+  auto proxied = _proxy.targets.find({server.getId(), *route_path});
+  if (proxied != _proxy.targets.end()) {
+    return openProxySink(req, server, proxied->second);
+  }
+  if (method != http::POST || !_uploadRoutes.count({server.getId(), *route_path})) {
+    return nullptr;
+  }
+  return openUploadSink(req, server, _fileIo.get());
+}
+
+/** Answer a request that is refused on its head alone (413, 404, 405) */
+bool Router::refuseHead(const Server& server, const Request& req, Response& res) const {
+  if (req.getError()) {
+    return false;
+  }
+
+  int status = 0;
+  const std::vector<std::string>& length = req.getHeaders("content-length");
+  if (length.size() == 1 && !length[0].empty() && length[0].find_first_not_of("0123456789") == std::string::npos
+      && (length[0].size() > 20 || std::strtoull(length[0].c_str(), nullptr, 10) > server.getMaxBodySize())) {
+    status = http::PAYLOAD_TOO_LARGE_413;
+  } else {
+    std::string method(req.getMethod());
+    std::string path = router::utils::StringUtils::normalizePath(std::string(req.getPath()));
+    status = _requestProcessor.checkHead(req, findHandler(server.getId(), method, path), server);
+  }
+  if (status == 0) {
+    return false;
+  }
+
+  // The body is never read, so the connection cannot be reused
+  Request closing;
+  closing.setHeaders("connection", http::CONNECTION_CLOSE);
+  router::utils::HttpResponseBuilder::setErrorResponse(res, status, closing, server);
+  return true;
+}
+
+/** Queue depth and latency of the file I/O threads */
+router::handlers::FileIoStats Router::fileIoStats() const {
+  return _fileIo->stats();
+}
+
+/** Counters of the event loop that stub_status locations report, set by the Cluster owning them */
+void Router::setMetrics(const Metrics* metrics) {
+  _metrics = metrics;
+}
+
+/** Everything a stub_status location reports, read now */
+router::handlers::StatusReport Router::statusReport() const {
+  router::handlers::StatusReport report;
+  if (_metrics) {
+    report.metrics = _metrics->snapshot();
+  }
+  report.fileIo = fileIoStats();
+  report.cache = cacheStats();
+
+  auto now = std::chrono::steady_clock::now();
+  for (const auto& [key, group] : _proxy.groups) {
+    for (const auto& backend : group->backends()) {
+      router::handlers::BackendStatus status;
+      status.upstream = key;
+      status.backend = backend.name;
+      status.up = backend.healthy && now >= backend.downUntil;
+      status.checked = !group->healthCheck().path.empty();
+      status.latency = backend.latency.count();
+      status.probes = backend.probes;
+      status.probeFailures = backend.probeFailures;
+      status.fails = backend.fails;
+      status.active = backend.active;
+      report.upstreams.push_back(status);
+    }
+  }
+  return report;
+}
+
 // ========================= HELPERS =========================
 
 /** List all registered routes */
@@ -6,6 +6,8 @@
 #pragma once
 
 #include <map>
+#include <set>
+#include <memory>
 #include <string>
 #include <string_view>
 #include <functional>
@@ -15,6 +17,9 @@
 #include "../server/Server.hpp"
 #include "HttpConstants.hpp"
 #include "RequestProcessor.hpp"
+#include "handlers/Handlers.hpp"
+#include "handlers/FileIoPool.hpp"
+#include "../server/Metrics.hpp"
 
 /**
  * @class Router
@@ -31,25 +36,92 @@ public:
   /** Initialize router with server configs */
   void setupRouter(const std::vector<Server>& configs);
 
-  /** Process HTTP request */
-  void handleRequest(const Server& server, const Request& req, Response& res) const;
+  /** Process HTTP request; trace gets the location that handled it and the kind of its handler */
+  void handleRequest(const Server& server, const Request& req, Response& res, RequestTrace* trace = nullptr) const;
+
+  /** Open a sink for a request whose handler takes the body as it arrives, nullptr when it is buffered */
+  std::unique_ptr<BodySink> openBodySink(const Server& server, const Request& req, RequestTrace* trace = nullptr) const;
+
+  /**
+   * @brief Answer a request that is refused on its head alone (413, 404, 405)
+   * @return false when the body is wanted; res is left untouched then
+   */
+  bool refuseHead(const Server& server, const Request& req, Response& res) const;
+
+  /** Queue depth and latency of the file I/O threads */
+  router::handlers::FileIoStats fileIoStats() const;
+
+  /** Health probes of upstream backends due now, to run as background jobs */
+  std::vector<std::shared_ptr<PendingResponse>> dueHealthProbes();
+
+  /**
+   * @brief Drop what the disk caches no longer keep; each cache sweeps once per DISK_CACHE_SWEEP_INTERVAL
+   * @return File jobs the caches started since the last call, to run as background jobs
+   */
+  std::vector<std::shared_ptr<PendingResponse>> sweepCaches();
+
+  /** Counters of the disk caches, summed over the servers */
+  router::handlers::DiskCacheStats cacheStats() const;
+
+  /** Counters of the event loop that stub_status locations report, set by the Cluster owning them */
+  void setMetrics(const Metrics* metrics);
+
+  /** Everything a stub_status location reports, read now */
+  router::handlers::StatusReport statusReport() const;
 
   /** List all registered routes */
   void listRoutes() const;
 
 private:
+  /** Handler of a route and the kind of handler it is (static, cgi, upload...), which latencies are kept by */
+  struct Route {
+    Handler handler;
+    const char* kind = nullptr;
+  };
+
   /** Register route */
-  void addRoute(int server_id, std::string_view method, std::string_view path, Handler handler);
+  void addRoute(int server_id, std::string_view method, std::string_view path, Handler handler, const char* kind);
 
-  /** Find handler */
-  const Handler* findHandler(int server_id, const std::string& method, const std::string& path) const;
+  /** Find handler, and the route it is registered under and its kind when route_path and kind are given */
+  const Handler* findHandler(int server_id, const std::string& method, const std::string& path,
+                             const std::string** route_path = nullptr, const char** kind = nullptr) const;
 
   /** Find matching location */
   const Location* findLocation(const Server& server, const std::string& path) const;
 
+  /** Resolve launch plans for a CGI location, start its workers when cgi_pool is set and its cache when cgi_cache is */
+  void setupCgi(const Server& server, const Location& location);
+
+  /** Resolve the upstream of a proxy_pass location, an upstream {} block when its host names one */
+  const router::handlers::ProxyTarget* setupProxy(const Server& server, const Location& location);
+
+  /** Disk cache of a proxy_cache location, none when the location does not cache */
+  router::handlers::CacheTarget cacheTarget(const Server& server, const Location& location) const;
+
+  /** Pool of an upstream address, shared by every group reaching it */
+  router::handlers::UpstreamPool* upstreamPool(const std::string& host, int port, size_t keepalive);
+
   /** Route storage: server_id → path → method → handler */
-  std::map<int, std::map<std::string, std::map<std::string, Handler>>> _routes;
+  std::map<int, std::map<std::string, std::map<std::string, Route>>> _routes;
+
+  /** Upload routes, whose POST bodies go to an UploadSink: (server_id, path) */
+  std::set<std::pair<int, std::string>> _uploadRoutes;
 
   /** Request processor */
   RequestProcessor _requestProcessor;
+
+  /** CGI plans and persistent workers: (server_id, location, extension) → plan / pool */
+  CgiSetup _cgi;
+
+  /** Upstream pools by address, groups by upstream block or address, proxy targets by (server_id, location) */
+  ProxySetup _proxy;
+
+  /** proxy_cache_path directories by server_id */
+  router::handlers::DiskCacheMap _diskCaches;
+
+  /** Threads running the GET and DELETE handlers, which block on the file system */
+  std::unique_ptr<router::handlers::FileIoPool> _fileIo;
+
+  /** Event loop counters, nullptr until a Cluster sets them */
+  const Metrics* _metrics = nullptr;
 };
@@ -0,0 +1,109 @@
+/**
+ * @file CacheControl.cpp
+ * @brief What a response allows the shared caches to do with it implementation
+ */
+
+#include "CacheControl.hpp"
+#include "../HttpConstants.hpp"
+
+#include <algorithm> // for std::transform, std::min, std::max
+#include <cctype> // for ::tolower
+#include <cstdlib> // for std::strtol
+#include <ctime> // for std::time, strptime, timegm
+#include <sstream> // for std::istringstream
+
+namespace router::handlers {
+
+namespace {
+
+/** Largest delta-seconds kept, as RFC 9111 suggests for values that do not fit */
+const long MAX_DELTA_SECONDS = 2147483648L;
+
+std::string toLower(std::string value) {
+  std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+  return value;
+}
+
+/** Delta-seconds of a directive, 0 (stale) when it is not a run of digits */
+long parseDeltaSeconds(const std::string& value) {
+  if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos) {
+    return 0;
+  }
+  if (value.size() > 10) {
+    return MAX_DELTA_SECONDS;
+  }
+  return std::min(std::strtol(value.c_str(), nullptr, 10), MAX_DELTA_SECONDS);
+}
+
+/** RFC 7231 IMF-fixdate, -1 when malformed */
+time_t parseHttpDate(const std::string& value) {
+  struct tm parsed = {};
+  const char* end = strptime(value.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &parsed);
+  if (!end || *end != '\0') {
+    return -1;
+  }
+  return timegm(&parsed);
+}
+
+} // namespace
+
+/** Read status, Cache-Control, Expires, Set-Cookie and Vary of a response */
+CacheControl parseCacheControl(const Response& res) {
+  CacheControl control;
+  if (std::strtol(std::string(res.getStatus()).c_str(), nullptr, 10) != http::OK_200) {
+    control.storable = false;
+    return control;
+  }
+
+  bool sharedMaxAge = false;
+  std::string expires;
+  for (const Response::Header& header : res.getHeaderList()) {
+    const std::string name = toLower(header.name);
+    // A cookie belongs to one client; Vary asks for a key the caches do not build
+    if (name == "set-cookie" || name == "vary") {
+      control.storable = false;
+      return control;
+    }
+    if (name == "expires") {
+      expires = header.value;
+    }
+    if (name != "cache-control") {
+      continue;
+    }
+    std::istringstream directives(header.value);
+    std::string directive;
+    while (std::getline(directives, directive, ',')) {
+      directive.erase(0, directive.find_first_not_of(" \t"));
+      directive.erase(directive.find_last_not_of(" \t") + 1);
+      directive = toLower(directive);
+
+      if (directive == "no-store" || directive == "no-cache" || directive == "private") {
+        control.storable = false;
+        return control;
+      }
+      size_t eq = directive.find('=');
+      if (eq == std::string::npos) {
+        continue;
+      }
+      std::string directiveName = directive.substr(0, eq);
+      std::string value = directive.substr(eq + 1);
+      if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+        value = value.substr(1, value.size() - 2);
+      }
+      if (directiveName == "s-maxage" || (directiveName == "max-age" && !sharedMaxAge)) {
+        control.freshFor = parseDeltaSeconds(value);
+        sharedMaxAge = sharedMaxAge || directiveName == "s-maxage";
+      } else if (directiveName == "stale-while-revalidate") {
+        control.staleFor = parseDeltaSeconds(value);
+      }
+    }
+  }
+  // max-age wins over Expires; a malformed Expires means already expired
+  if (control.freshFor < 0 && !expires.empty()) {
+    time_t when = parseHttpDate(expires);
+    control.freshFor = when < 0 ? 0 : std::max(0L, static_cast<long>(when - std::time(nullptr)));
+  }
+  return control;
+}
+
+} // namespace router::handlers
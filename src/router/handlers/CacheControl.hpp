@@ -0,0 +1,28 @@
+/**
+ * @file CacheControl.hpp
+ * @brief What a response allows the shared caches to do with it
+ */
+
+#pragma once
+
+#include "../../response/Response.hpp"
+
+namespace router::handlers {
+
+/**
+ * @brief Freshness a response asks for, read once for the CGI and disk caches
+ *
+ * Only a 200 without Set-Cookie, Vary, no-store, no-cache or private may be
+ * stored. s-maxage wins over max-age, which wins over Expires. A negative or
+ * malformed delta-seconds, like a malformed Expires, means already stale.
+ */
+struct CacheControl {
+  bool storable = true;   // false when the response must not be shared
+  long freshFor = -1;     // seconds the response stays fresh, -1 when it does not say
+  long staleFor = -1;     // stale-while-revalidate seconds, -1 when it does not say
+};
+
+/** Read status, Cache-Control, Expires, Set-Cookie and Vary of a response */
+CacheControl parseCacheControl(const Response& res);
+
+} // namespace router::handlers
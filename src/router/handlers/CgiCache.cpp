@@ -0,0 +1,272 @@
+/**
+ * @file CgiCache.cpp
+ * @brief Short-lived per-location cache of CGI responses implementation
+ */
+
+#include "CgiCache.hpp"
+#include "CacheControl.hpp"
+#include "HandlerUtils.hpp"
+#include "../utils/HttpResponseBuilder.hpp"
+#include "../HttpConstants.hpp"
+#include "../../server/Server.hpp"
+
+#include <algorithm> // for std::transform
+#include <cctype> // for std::tolower
+
+namespace router::handlers {
+
+namespace {
+
+/** Entries kept per location before stale ones are dropped */
+const size_t MAX_CACHE_ENTRIES = 1024;
+
+std::string toLower(std::string value) {
+  std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+  return value;
+}
+
+/** Copy a response without its Connection header, which belongs to the original request */
+void copyResponse(const Response& from, Response& to) {
+  to.setStatus(std::string(from.getStatus()));
+  for (const auto& header : from.getHeaderList()) {
+    if (header.name == http::CONNECTION) {
+      continue;
+    }
+    to.setHeaders(header.name, header.value);
+  }
+  to.setBody(std::string(from.getBody()));
+}
+
+} // namespace
+
+// ========================= WAITER =========================
+
+CgiCacheWaiter::CgiCacheWaiter(const Request& req, const Server& server) : _req(req), _server(&server) {
+  _req.setBody("");
+}
+
+int CgiCacheWaiter::fd() const {
+  return -1;
+}
+
+short CgiCacheWaiter::events() const {
+  return 0;
+}
+
+void CgiCacheWaiter::onEvent(short revents) {
+  (void)revents;
+}
+
+bool CgiCacheWaiter::done() const {
+  return _done;
+}
+
+void CgiCacheWaiter::finish(Response& res) {
+  if (_errorStatus) {
+    router::utils::HttpResponseBuilder::setErrorResponse(res, _errorStatus, _req, *_server);
+    return;
+  }
+  copyResponse(_outcome, res);
+  HandlerUtils::setConnectionHeaders(res, _req);
+}
+
+void CgiCacheWaiter::abort(bool timedOut) {
+  if (_done) {
+    return;
+  }
+  _done = true;
+  _errorStatus = timedOut ? http::GATEWAY_TIMEOUT_504 : http::INTERNAL_SERVER_ERROR_500;
+}
+
+/** Take over the leader's response, nullptr when the leader failed */
+void CgiCacheWaiter::resolve(const Response* outcome) {
+  if (_done) {
+    return;
+  }
+  _done = true;
+  if (outcome) {
+    _outcome = *outcome;
+  } else {
+    _errorStatus = http::INTERNAL_SERVER_ERROR_500;
+  }
+}
+
+// ========================= FILL =========================
+
+CgiCacheFill::CgiCacheFill(CgiCache* cache, std::string key, std::shared_ptr<PendingResponse> job)
+  : _cache(cache), _key(std::move(key)), _job(std::move(job)) {}
+
+CgiCacheFill::~CgiCacheFill() {
+  // Dropped before finish(): the waiters must not hang on it
+  if (!_reported) {
+    _cache->complete(_key, nullptr);
+  }
+}
+
+int CgiCacheFill::fd() const {
+  return _job->fd();
+}
+
+short CgiCacheFill::events() const {
+  return _job->events();
+}
+
+void CgiCacheFill::onEvent(short revents) {
+  _job->onEvent(revents);
+}
+
+bool CgiCacheFill::done() const {
+  return _job->done();
+}
+
+void CgiCacheFill::finish(Response& res) {
+  _job->finish(res);
+  _reported = true;
+  _cache->complete(_key, &res);
+}
+
+void CgiCacheFill::abort(bool timedOut) {
+  _job->abort(timedOut);
+}
+
+// ========================= CACHE =========================
+
+CgiCache::CgiCache(size_t ttl, size_t stale, const std::vector<std::string>& keyHeaders)
+  : _ttl(std::chrono::seconds(ttl)), _stale(std::chrono::seconds(stale)) {
+  // Request header names are stored lowercase by the parser
+  for (const auto& header : keyHeaders) {
+    _keyHeaders.push_back(toLower(header));
+  }
+}
+
+/** Only plain GET requests without credentials are shared */
+bool CgiCache::cacheable(const Request& req) const {
+  return req.getMethod() == http::GET && req.getHeaders("authorization").empty() && req.getHeaders("cookie").empty();
+}
+
+/** Cache key of a request */
+std::string CgiCache::key(const Request& req) const {
+  std::string key(req.getMethod());
+  key += ' ';
+  key += req.getPath();
+  for (const auto& header : _keyHeaders) {
+    key += '\n';
+    key += header;
+    key += ':';
+    for (const auto& value : req.getHeaders(header)) {
+      key += value;
+      key += ',';
+    }
+  }
+  return key;
+}
+
+/** Answer from the cache when possible */
+CgiCache::Lookup CgiCache::lookup(const std::string& key, const Request& req, const Server& server, Response& res) {
+  auto it = _entries.find(key);
+  if (it == _entries.end()) {
+    return MISS;
+  }
+  Entry& entry = it->second;
+
+  if (entry.filled) {
+    Clock::duration age = Clock::now() - entry.stored;
+    if (age < entry.ttl + entry.stale) {
+      copyResponse(entry.response, res);
+      HandlerUtils::setConnectionHeaders(res, req);
+      res.setHeaders("Age", std::to_string(std::chrono::duration_cast<std::chrono::seconds>(age).count()));
+      if (age < entry.ttl || entry.inFlight) {
+        return HIT;
+      }
+      return STALE;
+    }
+  }
+
+  if (entry.inFlight) {
+    // Coalesce: only one script runs per key, the others get its response
+    auto waiter = std::make_shared<CgiCacheWaiter>(req, server);
+    entry.waiters.push_back(waiter);
+    res.setPending(waiter);
+    return WAIT;
+  }
+  return MISS;
+}
+
+/** Wrap the job that produces the response for key; later misses wait for it */
+std::shared_ptr<PendingResponse> CgiCache::fill(const std::string& key, std::shared_ptr<PendingResponse> job) {
+  if (_entries.size() >= MAX_CACHE_ENTRIES && !_entries.count(key)) {
+    evict();
+    if (_entries.size() >= MAX_CACHE_ENTRIES) {
+      return job;
+    }
+  }
+  _entries[key].inFlight = true;
+  return std::make_shared<CgiCacheFill>(this, key, std::move(job));
+}
+
+/** Job for key finished, res is nullptr when it failed or was dropped */
+void CgiCache::complete(const std::string& key, const Response* res) {
+  auto it = _entries.find(key);
+  if (it == _entries.end()) {
+    return;
+  }
+  Entry& entry = it->second;
+  entry.inFlight = false;
+
+  for (auto& weakWaiter : entry.waiters) {
+    if (auto waiter = weakWaiter.lock()) {
+      waiter->resolve(res);
+    }
+  }
+  entry.waiters.clear();
+
+  Clock::duration ttl;
+  Clock::duration stale;
+  if (res && freshness(*res, ttl, stale)) {
+    entry.filled = true;
+    entry.response = Response();
+    copyResponse(*res, entry.response);
+    entry.stored = Clock::now();
+    entry.ttl = ttl;
+    entry.stale = stale;
+  }
+  // A failed refresh keeps the old response until its stale window ends
+  if (!entry.filled) {
+    _entries.erase(it);
+  }
+}
+
+/** Apply Cache-Control of a response, false when it must not be stored */
+bool CgiCache::freshness(const Response& res, Clock::duration& ttl, Clock::duration& stale) const {
+  CacheControl control = parseCacheControl(res);
+  if (!control.storable) {
+    return false;
+  }
+  ttl = control.freshFor >= 0 ? Clock::duration(std::chrono::seconds(control.freshFor)) : _ttl;
+  stale = control.staleFor >= 0 ? Clock::duration(std::chrono::seconds(control.staleFor)) : _stale;
+  return ttl > Clock::duration::zero();
+}
+
+/** Drop entries past their stale window, to make room */
+void CgiCache::evict() {
+  Clock::time_point now = Clock::now();
+  for (auto it = _entries.begin(); it != _entries.end();) {
+    const Entry& entry = it->second;
+    if (!entry.inFlight && now - entry.stored >= entry.ttl + entry.stale) {
+      it = _entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+/** Find the cache of a location, nullptr when it has none */
+CgiCache* findCgiCache(const CgiCacheMap* caches, int serverId, const std::string& location) {
+  if (!caches) {
+    return nullptr;
+  }
+  auto it = caches->find({serverId, location});
+  return it != caches->end() ? it->second.get() : nullptr;
+}
+
+} // namespace router::handlers
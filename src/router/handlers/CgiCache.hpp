@@ -0,0 +1,146 @@
+/**
+ * @file CgiCache.hpp
+ * @brief Short-lived per-location cache of CGI responses
+ */
+
+#pragma once
+
+#include <string> // for std::string
+#include <vector> // for std::vector
+#include <map> // for std::map
+#include <unordered_map> // for std::unordered_map
+#include <memory> // for std::shared_ptr, std::weak_ptr, std::unique_ptr
+#include <chrono> // for std::chrono::steady_clock
+
+#include "../../request/Request.hpp"
+#include "../../response/Response.hpp"
+#include "../../response/PendingResponse.hpp"
+
+class Server;
+
+namespace router::handlers {
+
+class CgiCache;
+
+/**
+ * @brief Request waiting for the response another request is already producing
+ *
+ * Has no descriptor of its own; it is done once the leading job finishes.
+ */
+class CgiCacheWaiter : public PendingResponse {
+public:
+  CgiCacheWaiter(const Request& req, const Server& server);
+
+  int fd() const override;
+  short events() const override;
+  void onEvent(short revents) override;
+  bool done() const override;
+  void finish(Response& res) override;
+  void abort(bool timedOut) override;
+
+private:
+  friend class CgiCache;
+
+  /** Take over the leader's response, nullptr when the leader failed */
+  void resolve(const Response* outcome);
+
+  bool _done = false;
+  Response _outcome;
+  int _errorStatus = 0;   // non-zero when finish() must send an error page
+  Request _req;
+  const Server* _server;
+};
+
+/**
+ * @brief Job whose response is stored in the cache and handed to the waiters
+ */
+class CgiCacheFill : public PendingResponse {
+public:
+  CgiCacheFill(CgiCache* cache, std::string key, std::shared_ptr<PendingResponse> job);
+  ~CgiCacheFill() override;
+
+  CgiCacheFill(const CgiCacheFill&) = delete;
+  CgiCacheFill& operator=(const CgiCacheFill&) = delete;
+
+  int fd() const override;
+  short events() const override;
+  void onEvent(short revents) override;
+  bool done() const override;
+  void finish(Response& res) override;
+  void abort(bool timedOut) override;
+
+private:
+  CgiCache* _cache;
+  std::string _key;
+  std::shared_ptr<PendingResponse> _job;
+  bool _reported = false;
+};
+
+/**
+ * @brief Responses of one CGI location, reused for a few seconds
+ *
+ * Keyed by method, path with query string and the configured request headers.
+ * Cache-Control from the script (no-store, no-cache, private, max-age,
+ * s-maxage, stale-while-revalidate) overrides the location defaults; responses
+ * setting a cookie or carrying Vary are never stored.
+ */
+class CgiCache {
+public:
+  enum Lookup {
+    MISS,   // nothing usable: run the script and fill()
+    HIT,    // res holds the cached response
+    STALE,  // res holds an expired response: run the script in the background and fill()
+    WAIT    // res waits for the request already running the script
+  };
+
+  CgiCache(size_t ttl, size_t stale, const std::vector<std::string>& keyHeaders);
+
+  /** Only plain GET requests without credentials are shared */
+  bool cacheable(const Request& req) const;
+
+  /** Cache key of a request */
+  std::string key(const Request& req) const;
+
+  /** Answer from the cache when possible */
+  Lookup lookup(const std::string& key, const Request& req, const Server& server, Response& res);
+
+  /** Wrap the job that produces the response for key; later misses wait for it */
+  std::shared_ptr<PendingResponse> fill(const std::string& key, std::shared_ptr<PendingResponse> job);
+
+private:
+  friend class CgiCacheFill;
+
+  using Clock = std::chrono::steady_clock;
+
+  struct Entry {
+    bool filled = false;
+    bool inFlight = false;            // a job is producing a new response
+    Response response;                // without the Connection header
+    Clock::time_point stored;
+    Clock::duration ttl{};
+    Clock::duration stale{};
+    std::vector<std::weak_ptr<CgiCacheWaiter>> waiters;
+  };
+
+  /** Job for key finished, res is nullptr when it failed or was dropped */
+  void complete(const std::string& key, const Response* res);
+
+  /** Apply Cache-Control of a response, false when it must not be stored */
+  bool freshness(const Response& res, Clock::duration& ttl, Clock::duration& stale) const;
+
+  /** Drop entries past their stale window, to make room */
+  void evict();
+
+  Clock::duration _ttl;
+  Clock::duration _stale;
+  std::vector<std::string> _keyHeaders;
+  std::unordered_map<std::string, Entry> _entries;
+};
+
+/** Caches per (server id, location) */
+using CgiCacheMap = std::map<std::pair<int, std::string>, std::unique_ptr<CgiCache>>;
+
+/** Find the cache of a location, nullptr when it has none */
+CgiCache* findCgiCache(const CgiCacheMap* caches, int serverId, const std::string& location);
+
+} // namespace router::handlers
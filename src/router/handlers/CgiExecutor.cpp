@@ -1,221 +1,218 @@
 #include "CgiExecutor.hpp"
 #include "../HttpConstants.hpp"
+#include "../../server/Log.hpp"
 
-#include <filesystem> // for std::filesystem::path, std::filesystem::parent_path, std::filesystem::filename
-#include <unistd.h> // for pipe, fork, dup2, close, write, read, chdir, execve, STDIN_FILENO, STDOUT_FILENO
+#include <unistd.h> // for pipe2, close, write, read, STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO
+#include <fcntl.h> // for O_CLOEXEC
+#include <spawn.h> // for posix_spawn, posix_spawn_file_actions_*, posix_spawnattr_*
 #include <sys/wait.h> // for waitpid, WNOHANG, WIFEXITED, WEXITSTATUS
-#include <signal.h> // for kill, SIGKILL
+#include <signal.h> // for kill, SIGKILL, SIGPIPE, sigemptyset, sigaddset
 #include <cstdlib> // for std::stoul
 #include <ostream> // for std::ostream
 #include <ctime> // for time, time_t
-#include <iostream> // for std::cout
 #include <sstream> // for std::istringstream
 #include <algorithm> // for std::find_if
 
-/** Execute CGI script and capture output */
-std::string executeCgiScript(const std::string& scriptPath, const std::vector<std::string>& env, const std::string& input) {
-  int pipe_in[2];  // For sending input to CGI
-  int pipe_out[2]; // For receiving output from CGI
+/** Interpreter and argv for an extension */
+CgiExecPlan makeCgiExecPlan(const std::string& extension, const std::string& workDir) {
+  CgiExecPlan plan;
+  plan.workDir = workDir;
 
-  if (pipe(pipe_in) == -1 || pipe(pipe_out) == -1) {
-    return "";
+  // Convert to lowercase for case-insensitive comparison
+  std::string ext = extension;
+  for (char& c : ext) {
+    c = std::tolower(c);
   }
 
-  pid_t pid = fork();
-  if (pid == -1) {
-    // Fork failed, close pipes
-    close(pipe_in[0]);
-    close(pipe_in[1]);
-    close(pipe_out[0]);
-    close(pipe_out[1]);
-    return "";
+  if (ext == ".py") {
+    // example: script.py -> python3 script.py
+    plan.program = "/usr/bin/python3";
+    plan.argv = {"python3"};
+  } else if (ext == ".js") {
+    // example: script.js -> node script.js
+    plan.program = "/usr/bin/node";
+    plan.argv = {"node"};
   }
+  // For unknown extensions the script is executed directly
+  return plan;
+}
 
-  // Child process
-  if (pid == 0) {
-    // Close unused pipe ends
-    close(pipe_in[1]);
-    close(pipe_out[0]);
-
-    // Redirect stdin to read from pipe_in
-    if (dup2(pipe_in[0], STDIN_FILENO) == -1) {
-      close(pipe_in[0]);
-      close(pipe_out[1]);
-      return "";
-    }
-
-    // Redirect stdout to write to pipe_out
-    if (dup2(pipe_out[1], STDOUT_FILENO) == -1) {
-      close(pipe_in[0]);
-      close(pipe_out[1]);
-      return "";
-    }
+/** Launch a CGI process; returns its pid, or -1 with no descriptors left open */
+pid_t spawnCgiProcess(const CgiExecPlan& plan, const std::string& scriptPath, const std::vector<std::string>& env, int& stdinFd, int& stdoutFd) {
+  int pipe_in[2];  // For sending input to CGI
+  int pipe_out[2]; // For receiving output from CGI
 
-    // Close original pipe descriptors
+  if (pipe2(pipe_in, O_CLOEXEC) == -1) {
+    return -1;
+  }
+  if (pipe2(pipe_out, O_CLOEXEC) == -1) {
     close(pipe_in[0]);
-    close(pipe_out[1]);
+    close(pipe_in[1]);
+    return -1;
+  }
 
-    // Fill up envp with environment variables
-    std::vector<std::string> envStrings(env.begin(), env.end());
-    std::vector<char*> envp;
+  // Run in the script directory for relative path access, with just the filename as argument
+  // example: /home/ilyam/42/webserver/www/cgi-bin/script.py -> /home/ilyam/42/webserver/www/cgi-bin, script.py
+  size_t slash = scriptPath.find_last_of('/');
+  std::string scriptDir = slash == std::string::npos ? plan.workDir : scriptPath.substr(0, slash);
+  std::string scriptName = slash == std::string::npos ? scriptPath : scriptPath.substr(slash + 1);
+  if (scriptDir.empty()) {
+    scriptDir = "/";
+  }
+  const std::string& program = plan.program.empty() ? scriptName : plan.program;
 
-    for (auto& var : envStrings) {
-      // Convert to char*
-      envp.push_back(const_cast<char*>(var.c_str()));
-    }
-    // Add nullptr to the end of the environment variables
-    envp.push_back(nullptr);
-
-    // Change to script directory for relative path access and get just the filename
-    // example: /home/ilyam/42/webserver/www/cgi-bin/script.py -> /home/ilyam/42/webserver/www/cgi-bin
-    std::filesystem::path scriptDir = std::filesystem::path(scriptPath).parent_path();
-    // example: /home/ilyam/42/webserver/www/cgi-bin/script.py -> script.py
-    std::string scriptName = std::filesystem::path(scriptPath).filename().string();
-
-    if (!scriptDir.empty()) {
-      // Change to script directory for relative path access
-      chdir(scriptDir.c_str());
-    }
+  std::vector<char*> argv;
+  for (const auto& arg : plan.argv) {
+    argv.push_back(const_cast<char*>(arg.c_str()));
+  }
+  argv.push_back(const_cast<char*>(scriptName.c_str()));
+  if (plan.program.empty()) {
+    // Direct execution: argv[0] is the script itself
+    argv.push_back(const_cast<char*>(scriptName.c_str()));
+  }
+  argv.push_back(nullptr);
 
-    // Execute CGI script based on file extension using execve()
-    size_t dotPos = scriptName.find_last_of('.');
-    if (dotPos != std::string::npos) {
-      std::string ext = scriptName.substr(dotPos + 1);
-      // Convert to lowercase for case-insensitive comparison
-      for (char& c : ext) {
-        c = std::tolower(c);
-      }
+  std::vector<char*> envp;
+  for (const auto& var : env) {
+    envp.push_back(const_cast<char*>(var.c_str()));
+  }
+  envp.push_back(nullptr);
+
+  // posix_spawn clones without copying the page tables (CLONE_VM | CLONE_VFORK in glibc),
+  // so the cost does not grow with the server heap; the child only runs these actions
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, pipe_in[0], STDIN_FILENO);
+  posix_spawn_file_actions_adddup2(&actions, pipe_out[1], STDOUT_FILENO);
+  posix_spawn_file_actions_addchdir_np(&actions, scriptDir.c_str());
+  // Client and listening sockets must not leak into the script
+  posix_spawn_file_actions_addclosefrom_np(&actions, STDERR_FILENO + 1);
+
+  // The server ignores SIGPIPE, scripts get the default back
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+  sigset_t defaults;
+  sigemptyset(&defaults);
+  sigaddset(&defaults, SIGPIPE);
+  posix_spawnattr_setsigdefault(&attr, &defaults);
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF);
+
+  pid_t pid = -1;
+  int err = posix_spawn(&pid, program.c_str(), &actions, &attr, argv.data(), envp.data());
+  posix_spawn_file_actions_destroy(&actions);
+  posix_spawnattr_destroy(&attr);
+
+  // Close the child's pipe ends
+  close(pipe_in[0]);
+  close(pipe_out[1]);
+
+  if (err != 0) {
+    close(pipe_in[1]);
+    close(pipe_out[0]);
+    return -1;
+  }
+  stdinFd = pipe_in[1];
+  stdoutFd = pipe_out[0];
+  return pid;
+}
 
-      if (ext == "py") {
-        // Execute Python script with execve()
-        // example: /home/ilyam/42/webserver/www/cgi-bin/script.py -> python3 script.py
-        char* args[] = {
-          const_cast<char*>("python3"),
-          const_cast<char*>(scriptName.c_str()),
-          nullptr
-        };
-        execve("/usr/bin/python3", args, envp.data());
-
-      } else if (ext == "js") {
-        // Execute JavaScript script with Node.js using execve()
-        // example: /home/ilyam/42/webserver/www/cgi-bin/script.js -> node script.js
-        char* args[] = {
-          const_cast<char*>("node"),
-          const_cast<char*>(scriptName.c_str()),
-          nullptr
-        };
-        execve("/usr/bin/node", args, envp.data());
+/** Execute CGI script and capture output */
+std::string executeCgiScript(const CgiExecPlan& plan, const std::string& scriptPath, const std::vector<std::string>& env, const std::string& input) {
+  int stdinFd;  // For sending input to CGI
+  int stdoutFd; // For receiving output from CGI
 
-      } else {
-        // For unknown extensions, try direct execution with execve()
-        char* args[] = {
-          const_cast<char*>(scriptName.c_str()),
-          const_cast<char*>(scriptName.c_str()),
-          nullptr
-        };
-        execve(scriptName.c_str(), args, envp.data());
-      }
+  pid_t pid = spawnCgiProcess(plan, scriptPath, env, stdinFd, stdoutFd);
+  if (pid == -1) {
+    return "";
+  }
 
-    } else {
-      // If no extension, try direct execution with execve()
-      char* args[] = {
-        const_cast<char*>(scriptName.c_str()),
-        const_cast<char*>(scriptName.c_str()),
-        nullptr
-      };
-      execve(scriptName.c_str(), args, envp.data());
+  // Send input to CGI (already processed for chunked requests)
+  if (!input.empty()) {
+    ssize_t bytesWritten = write(stdinFd, input.c_str(), input.length());
+    if (bytesWritten == -1) {
+      LOG_WARN("CGI: Failed to write input to " << scriptPath);
     }
-    // If execve fails, return empty string
-    return "";
-  } else { // Parent process
-    // Close unused pipe ends
-    close(pipe_in[0]);
-    close(pipe_out[1]);
+  }
+  close(stdinFd); // Send EOF
+
+  // Read output from CGI with timeout
+  std::string output;
+  char buffer[4096];
+  ssize_t bytesRead;
+  int timeout = 5; // 5 second timeout for infinite loop
+  time_t startTime = time(nullptr);
+
+  // Make pipe non-blocking
+  while (time(nullptr) - startTime < timeout) {
+    // Check if child has finished
+    int status;
+    pid_t result = waitpid(pid, &status, WNOHANG);
 
-    // Send input to CGI (already processed for chunked requests)
-    if (!input.empty()) {
-      ssize_t bytesWritten = write(pipe_in[1], input.c_str(), input.length());
-      if (bytesWritten == -1) {
-        std::cout << "CGI: Failed to write input to CGI" << std::endl;
+    if (result == pid) {
+      // Child finished, read remaining output
+      while ((bytesRead = read(stdoutFd, buffer, sizeof(buffer))) > 0) {
+        output.append(buffer, bytesRead);
       }
-    }
-    close(pipe_in[1]); // Send EOF
-
-    // Read output from CGI with timeout
-    std::string output;
-    char buffer[4096];
-    ssize_t bytesRead;
-    int timeout = 5; // 5 second timeout for infinite loop
-    time_t startTime = time(nullptr);
-
-    // Make pipe non-blocking
-    while (time(nullptr) - startTime < timeout) {
-      // Check if child has finished
-      int status;
-      pid_t result = waitpid(pid, &status, WNOHANG);
-
-      if (result == pid) {
-        // Child finished, read remaining output
-        while ((bytesRead = read(pipe_out[0], buffer, sizeof(buffer))) > 0) {
+      close(stdoutFd);
+      // If child finished and exited successfully, return output
+      return (WIFEXITED(status) && WEXITSTATUS(status) == 0) ? output : "";
+    } else if (result == 0) {
+      // Child still running, check if data available with select()
+      // Set up readfds for select()
+      fd_set readfds;
+      // Zero out readfds
+      FD_ZERO(&readfds);
+      // Set up readfds for select()
+      FD_SET(stdoutFd, &readfds);
+
+      struct timeval tv;
+      tv.tv_sec = 0;
+      tv.tv_usec = 500000; // 5sec timeout
+
+      // Check if data available with select()
+      // the highest-numbered file descriptor to monitor, plus one (f0, f1, f2, ...)
+      if (select(stdoutFd + 1, &readfds, nullptr, nullptr, &tv) > 0) {
+        // Data available, read it
+        bytesRead = read(stdoutFd, buffer, sizeof(buffer));
+        if (bytesRead > 0) {
           output.append(buffer, bytesRead);
         }
-        close(pipe_out[0]);
-        // If child finished and exited successfully, return output
-        return (WIFEXITED(status) && WEXITSTATUS(status) == 0) ? output : "";
-      } else if (result == 0) {
-        // Child still running, check if data available with select()
-        // Set up readfds for select()
-        fd_set readfds;
-        // Zero out readfds
-        FD_ZERO(&readfds);
-        // Set up readfds for select()
-        FD_SET(pipe_out[0], &readfds);
-
-        struct timeval tv;
-        tv.tv_sec = 0;
-        tv.tv_usec = 500000; // 5sec timeout
-
-        // Check if data available with select()
-        // the highest-numbered file descriptor to monitor, plus one (f0, f1, f2, ...)
-        if (select(pipe_out[0] + 1, &readfds, nullptr, nullptr, &tv) > 0) {
-          // Data available, read it
-          bytesRead = read(pipe_out[0], buffer, sizeof(buffer));
-          if (bytesRead > 0) {
-            output.append(buffer, bytesRead);
-          }
-        }
       }
     }
+  }
 
-    close(pipe_out[0]);
+  close(stdoutFd);
 
-    // Check if timeout occurred
-    if (time(nullptr) - startTime >= timeout) {
-      std::cout << "CGI: Script timeout after " << timeout << " seconds - killing process" << std::endl;
-      kill(pid, SIGKILL);
-      waitpid(pid, nullptr, 0); // Wait for cleanup
-      return "CGI_TIMEOUT_504";
-    }
+  // Check if timeout occurred
+  if (time(nullptr) - startTime >= timeout) {
+    LOG_WARN("CGI: " << scriptPath << " timed out after " << timeout << " seconds, killing it");
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0); // Wait for cleanup
+    return "CGI_TIMEOUT_504";
+  }
 
-    // Wait for child to finish and get exit status
-    int status;
-    waitpid(pid, &status, 0);
+  // Wait for child to finish and get exit status
+  int status;
+  waitpid(pid, &status, 0);
 
-    // If child finished and exited successfully, return output
-    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
-      return output;
-    } else {
-      return "";
-    }
+  // If child finished and exited successfully, return output
+  if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+    return output;
+  } else {
+    return "";
   }
 }
 
 /** Execute CGI script and parse output into structured result */
-CgiResult executeAndParseCgiScript(const std::string& scriptPath, const std::vector<std::string>& env, const std::string& input) {
+CgiResult executeAndParseCgiScript(const CgiExecPlan& plan, const std::string& scriptPath, const std::vector<std::string>& env, const std::string& input) {
+  // Execute CGI script to get raw output
+  return parseCgiOutput(executeCgiScript(plan, scriptPath, env, input));
+}
+
+/** Parse raw CGI output into structured result */
+CgiResult parseCgiOutput(const std::string& cgiOutput) {
   CgiResult result;
 
-  // Execute CGI script to get raw output
-  std::string cgiOutput = executeCgiScript(scriptPath, env, input);
   if (cgiOutput.empty()) {
     return result; // success = false by default
   }
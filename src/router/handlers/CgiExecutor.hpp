@@ -3,6 +3,8 @@
 #include <string> // for std::string
 #include <vector> // for std::vector
 #include <map> // for std::map
+#include <tuple> // for std::tuple
+#include <sys/types.h> // for pid_t
 
 struct CgiResult {
   std::map<std::string, std::string> headers;
@@ -13,5 +15,18 @@ struct CgiResult {
   CgiResult() : success(false) {}
 };
 
-std::string executeCgiScript(const std::string& scriptPath, const std::vector<std::string>& env, const std::string& input);
-CgiResult executeAndParseCgiScript(const std::string& scriptPath, const std::vector<std::string>& env, const std::string& input);
+/** How to launch scripts of one extension in one location, resolved once at startup */
+struct CgiExecPlan {
+  std::string program;            // interpreter given to posix_spawn, empty = run the script itself
+  std::vector<std::string> argv;  // argv before the script name
+  std::string workDir;            // resolved cgi_path of the location
+};
+
+/** Plans per (server id, location, extension) */
+using CgiExecPlanMap = std::map<std::tuple<int, std::string, std::string>, CgiExecPlan>;
+
+CgiExecPlan makeCgiExecPlan(const std::string& extension, const std::string& workDir);
+pid_t spawnCgiProcess(const CgiExecPlan& plan, const std::string& scriptPath, const std::vector<std::string>& env, int& stdinFd, int& stdoutFd);
+std::string executeCgiScript(const CgiExecPlan& plan, const std::string& scriptPath, const std::vector<std::string>& env, const std::string& input);
+CgiResult executeAndParseCgiScript(const CgiExecPlan& plan, const std::string& scriptPath, const std::vector<std::string>& env, const std::string& input);
+CgiResult parseCgiOutput(const std::string& cgiOutput);
@@ -0,0 +1,317 @@
+/**
+ * @file CgiStream.cpp
+ * @brief CGI process driven by the event loop implementation
+ */
+
+#include "CgiStream.hpp"
+#include "HandlerUtils.hpp"
+#include "../utils/HttpResponseBuilder.hpp"
+#include "../HttpConstants.hpp"
+#include "../../../inc/webserv.hpp"
+#include "../../server/Server.hpp"
+
+#include <unistd.h> // for read, write, close
+#include <fcntl.h> // for fcntl, O_NONBLOCK
+#include <poll.h> // for POLLIN, POLLOUT, POLLERR
+#include <signal.h> // for kill, SIGKILL
+#include <sys/wait.h> // for waitpid, WNOHANG, WIFEXITED, WEXITSTATUS
+#include <cerrno> // for errno, EAGAIN
+#include <cctype> // for std::tolower
+#include <algorithm> // for std::min
+#include <sstream> // for std::ostringstream
+
+namespace router::handlers {
+
+namespace {
+
+/** Case-insensitive header name lookup in a parsed CGI head */
+const std::string* findCgiHeader(const CgiResult& result, const std::string& name) {
+  for (const auto& [headerName, headerValue] : result.headers) {
+    if (headerName.size() != name.size()) {
+      continue;
+    }
+    size_t i = 0;
+    while (i < name.size() && std::tolower(headerName[i]) == std::tolower(name[i])) {
+      ++i;
+    }
+    if (i == name.size()) {
+      return &headerValue;
+    }
+  }
+  return nullptr;
+}
+
+/** Content-Length value a body can be framed by: one run of digits that fits in a size_t */
+bool parseContentLength(const std::string& value, size_t& length) {
+  if (value.empty() || value.size() > 19 || value.find_first_not_of("0123456789") != std::string::npos) {
+    return false;
+  }
+  length = std::stoull(value);
+  return true;
+}
+
+void setNonBlocking(int fd) {
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+} // namespace
+
+CgiStreamJob::CgiStreamJob(pid_t pid, int stdinFd, int stdoutFd, std::string input, const Request& req, const Server& server,
+                           bool stream)
+  : _pid(pid), _stdinFd(stdinFd), _stdoutFd(stdoutFd), _input(std::move(input)), _req(req), _server(&server) {
+  // The body already travels through stdin
+  _req.setBody("");
+
+  // Without chunked encoding the end of the body can only be told by its length
+  if (!stream || _req.getHttpVersion() != "HTTP/1.1") {
+    _mode = BUFFERED;
+  }
+
+  setNonBlocking(_stdinFd);
+  setNonBlocking(_stdoutFd);
+  if (_input.empty()) {
+    closeInput();
+  }
+}
+
+CgiStreamJob::~CgiStreamJob() {
+  stop();
+}
+
+int CgiStreamJob::fd() const {
+  if (_state == WRITING) {
+    return _stdinFd;
+  }
+  if (_state == READING) {
+    return _stdoutFd;
+  }
+  return -1;
+}
+
+short CgiStreamJob::events() const {
+  return _state == WRITING ? POLLOUT : POLLIN;
+}
+
+void CgiStreamJob::onEvent(short revents) {
+  if (_state == WRITING) {
+    if (revents & POLLERR) {
+      // The script closed its stdin without reading everything
+      closeInput();
+      return;
+    }
+    ssize_t written = write(_stdinFd, _input.data() + _written, _input.size() - _written);
+    if (written < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        closeInput();
+      }
+      return;
+    }
+    _written += written;
+    if (_written == _input.size()) {
+      closeInput();
+    }
+    return;
+  }
+
+  if (_state != READING) {
+    return;
+  }
+
+  // One read per event keeps the output held in memory bounded
+  char buffer[16384];
+  ssize_t bytesRead = read(_stdoutFd, buffer, sizeof(buffer));
+  if (bytesRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    return;
+  }
+  if (bytesRead <= 0) {
+    complete();
+    return;
+  }
+  consume(buffer, bytesRead);
+}
+
+bool CgiStreamJob::done() const {
+  return _state == DONE;
+}
+
+void CgiStreamJob::finish(Response& res) {
+  if (_errorStatus) {
+    router::utils::HttpResponseBuilder::setErrorResponse(res, _errorStatus, _req, *_server);
+    return;
+  }
+  if (!streaming()) {
+    HandlerUtils::setCgiResponse(res, _result, _req, *_server);
+    return;
+  }
+
+  // Head only, the body follows through takeBody()
+  HandlerUtils::setCgiHead(res, _result, _req);
+  if (_mode == RAW) {
+    // Validated when the head was parsed
+    res.setHeaders(http::CONTENT_LENGTH, *findCgiHeader(_result, http::CONTENT_LENGTH));
+  } else {
+    res.setHeaders(http::TRANSFER_ENCODING, http::TRANSFER_ENCODING_CHUNKED);
+  }
+}
+
+void CgiStreamJob::abort(bool timedOut) {
+  if (_state == DONE) {
+    return;
+  }
+  stop();
+  _state = DONE;
+  if (streaming()) {
+    _broken = true;
+  } else {
+    _errorStatus = timedOut ? http::GATEWAY_TIMEOUT_504 : http::INTERNAL_SERVER_ERROR_500;
+  }
+}
+
+bool CgiStreamJob::streaming() const {
+  return _mode == CHUNKED || _mode == RAW;
+}
+
+bool CgiStreamJob::takeBody(std::string& out) {
+  out.append(_out);
+  _out.clear();
+  return !_broken;
+}
+
+/** Stdin fully written or refused by the script */
+void CgiStreamJob::closeInput() {
+  close(_stdinFd);
+  _stdinFd = -1;
+  _input.clear();
+  _state = READING;
+}
+
+/** Split off the header block, then pass body bytes on in the chosen framing */
+void CgiStreamJob::consume(const char* data, size_t size) {
+  if (_mode != HEAD && _mode != BUFFERED) {
+    appendBody(data, size);
+    return;
+  }
+  _head.append(data, size);
+  if (_mode == BUFFERED) {
+    if (_head.size() > MAX_BUFFER_SIZE) {
+      // Output without a header block is held whole; past the cap the script is given up on
+      stop();
+      _state = DONE;
+      _errorStatus = http::BAD_GATEWAY_502;
+    }
+    return;
+  }
+
+  // Same separators as parseCgiOutput
+  size_t headerEnd = _head.find("\r\n\r\n");
+  size_t separator = 4;
+  if (headerEnd == std::string::npos) {
+    headerEnd = _head.find("\n\n");
+    separator = 2;
+  }
+  if (headerEnd == std::string::npos) {
+    if (_head.size() > MAX_HEADER_SIZE) {
+      // No header block: the whole output is the body, as in parseCgiOutput
+      _mode = BUFFERED;
+    }
+    return;
+  }
+
+  _result = parseCgiOutput(_head.substr(0, headerEnd + separator));
+  std::string body = _head.substr(headerEnd + separator);
+  _head.clear();
+  const std::string* length = findCgiHeader(_result, http::CONTENT_LENGTH);
+  if (!length) {
+    _mode = CHUNKED;
+  } else if (parseContentLength(*length, _remaining)) {
+    _mode = RAW;
+  } else {
+    // Nothing is out yet, so the client gets an error page instead of a body it cannot frame
+    stop();
+    _state = DONE;
+    _mode = BUFFERED;
+    _errorStatus = http::BAD_GATEWAY_502;
+    return;
+  }
+  appendBody(body.data(), body.size());
+}
+
+/** Add body bytes in the chosen framing */
+void CgiStreamJob::appendBody(const char* data, size_t size) {
+  if (size == 0) {
+    return;
+  }
+  if (_mode == CHUNKED) {
+    std::ostringstream chunkSize;
+    chunkSize << std::hex << size << "\r\n";
+    _out.append(chunkSize.str());
+    _out.append(data, size);
+    _out.append("\r\n");
+    return;
+  }
+  // Output past the announced length is dropped
+  size_t take = std::min(size, _remaining);
+  _out.append(data, take);
+  _remaining -= take;
+}
+
+/** Stdout closed: reap the script and terminate the body */
+void CgiStreamJob::complete() {
+  close(_stdoutFd);
+  _stdoutFd = -1;
+
+  // Stdout closes as the script exits; one still running after closing it is not waited for
+  int status = 0;
+  pid_t result = waitpid(_pid, &status, WNOHANG);
+  if (result == 0) {
+    kill(_pid, SIGKILL);
+    result = waitpid(_pid, &status, 0);
+  }
+  _pid = -1;
+  _state = DONE;
+  bool exitedCleanly = result > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+
+  if (!streaming()) {
+    // A failed script, like in the blocking path, gets a 500 page
+    if (exitedCleanly) {
+      _result = parseCgiOutput(_head);
+    }
+    _head.clear();
+    _mode = BUFFERED;
+    if (!_result.success) {
+      _errorStatus = http::INTERNAL_SERVER_ERROR_500;
+    }
+    return;
+  }
+
+  if (!exitedCleanly) {
+    // The status line is already out, so the client learns from the closed connection
+    _broken = true;
+    return;
+  }
+  if (_mode == CHUNKED) {
+    _out.append("0\r\n\r\n");
+  } else if (_remaining > 0) {
+    // Fewer bytes than announced: the client must not take the body as complete
+    _broken = true;
+  }
+}
+
+/** Kill and reap the script, close what is still open */
+void CgiStreamJob::stop() {
+  if (_stdinFd != -1) {
+    close(_stdinFd);
+    _stdinFd = -1;
+  }
+  if (_stdoutFd != -1) {
+    close(_stdoutFd);
+    _stdoutFd = -1;
+  }
+  if (_pid > 0) {
+    kill(_pid, SIGKILL);
+    waitpid(_pid, nullptr, 0);
+    _pid = -1;
+  }
+}
+
+} // namespace router::handlers
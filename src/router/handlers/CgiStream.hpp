@@ -0,0 +1,83 @@
+/**
+ * @file CgiStream.hpp
+ * @brief CGI process driven by the event loop, output streamed to the client
+ */
+
+#pragma once
+
+#include <string> // for std::string
+#include <sys/types.h> // for pid_t
+
+#include "CgiExecutor.hpp"
+#include "../../request/Request.hpp"
+#include "../../response/Response.hpp"
+#include "../../response/PendingResponse.hpp"
+
+class Server;
+
+namespace router::handlers {
+
+/**
+ * @brief One spawned CGI script, fed and read without blocking
+ *
+ * The head goes out as soon as the script's header block is parsed. The body
+ * follows as it is produced: as is, cut to the length, when the script set
+ * Content-Length, with chunked transfer encoding otherwise. HTTP/1.0 clients,
+ * and callers that need the whole response (stream = false), get a buffered
+ * response.
+ */
+class CgiStreamJob : public PendingResponse {
+public:
+  CgiStreamJob(pid_t pid, int stdinFd, int stdoutFd, std::string input, const Request& req, const Server& server,
+               bool stream = true);
+  ~CgiStreamJob() override;
+
+  CgiStreamJob(const CgiStreamJob&) = delete;
+  CgiStreamJob& operator=(const CgiStreamJob&) = delete;
+
+  int fd() const override;
+  short events() const override;
+  void onEvent(short revents) override;
+  bool done() const override;
+  void finish(Response& res) override;
+  void abort(bool timedOut) override;
+  bool streaming() const override;
+  bool takeBody(std::string& out) override;
+
+private:
+  enum State { WRITING, READING, DONE };
+  enum Mode { HEAD, CHUNKED, RAW, BUFFERED };
+
+  /** Stdin fully written or refused by the script */
+  void closeInput();
+
+  /** Split off the header block, then pass body bytes on in the chosen framing */
+  void consume(const char* data, size_t size);
+
+  /** Add body bytes in the chosen framing */
+  void appendBody(const char* data, size_t size);
+
+  /** Stdout closed: reap the script and terminate the body */
+  void complete();
+
+  /** Kill and reap the script, close what is still open */
+  void stop();
+
+  pid_t _pid;
+  int _stdinFd;
+  int _stdoutFd;
+  State _state = WRITING;
+  Mode _mode = HEAD;
+  std::string _input;
+  size_t _written = 0;
+  std::string _head;      // output until the header block is complete
+  CgiResult _result;      // parsed head, plus the body when buffered
+  std::string _out;       // framed body bytes not yet taken
+  size_t _remaining = 0;  // body bytes still expected in RAW mode
+  bool _broken = false;   // body cut short after the head went out
+  int _errorStatus = 0;   // non-zero when finish() must send an error page
+  Request _req;
+  const Server* _server;
+};
+
+} // namespace router::handlers
@@ -0,0 +1,437 @@
+/**
+ * @file CgiWorkerPool.cpp
+ * @brief Pre-forked persistent CGI interpreters implementation
+ */
+
+#include "CgiWorkerPool.hpp"
+#include "CgiExecutor.hpp"
+#include "HandlerUtils.hpp"
+#include "../utils/HttpResponseBuilder.hpp"
+#include "../HttpConstants.hpp"
+#include "../../server/Server.hpp"
+
+#include <unistd.h> // for close
+#include <fcntl.h> // for fcntl, O_NONBLOCK, O_RDONLY, O_WRONLY
+#include <spawn.h> // for posix_spawn, posix_spawn_file_actions_*, posix_spawnattr_*
+#include <poll.h> // for POLLIN, POLLOUT, POLLERR, POLLHUP
+#include <signal.h> // for kill, SIGKILL, SIGPIPE
+#include <sys/socket.h> // for socketpair, send, recv
+#include <sys/wait.h> // for waitpid, WNOHANG
+#include <arpa/inet.h> // for htonl, ntohl
+#include <cerrno> // for errno, EAGAIN
+#include <cstring> // for std::memcpy
+
+namespace router::handlers {
+
+namespace {
+
+/**
+ * Python worker loop. Reads request frames from fd 3, runs the script in-process
+ * with stdin/stdout swapped for buffers and answers with one reply frame.
+ * Compiled scripts stay cached, by file, until their mtime changes. The scripts
+ * of the directories given as arguments are compiled before the first request.
+ */
+const char* const PYTHON_RUNNER = R"PY(
+import io, os, struct, sys
+root = os.getcwd()
+cache = {}
+
+def read_exact(n):
+    data = bytearray()
+    while len(data) < n:
+        chunk = os.read(3, n - len(data))
+        if not chunk:
+            os._exit(0)
+        data += chunk
+    return bytes(data)
+
+def read_frame():
+    return read_exact(struct.unpack('!I', read_exact(4))[0])
+
+def load(path):
+    st = os.stat(path)
+    key = (st.st_dev, st.st_ino)
+    entry = cache.get(key)
+    if entry is None or entry[0] != st.st_mtime_ns:
+        with open(path, 'rb') as f:
+            entry = (st.st_mtime_ns, compile(f.read(), path, 'exec'))
+        cache[key] = entry
+    return entry[1]
+
+for top in sys.argv[1:]:
+    for dirpath, dirs, files in os.walk(top):
+        for name in files:
+            if name.endswith('.py') and len(cache) < 256:
+                try:
+                    load(os.path.join(dirpath, name))
+                except Exception:
+                    pass  # reported by the request that runs it
+
+while True:
+    script = os.path.join(root, read_frame().decode())
+    env = read_frame()
+    body = read_frame()
+    # Bytes as they came: a header value need not be UTF-8
+    os.environb.clear()
+    for item in env.split(b'\0'):
+        key, sep, value = item.partition(b'=')
+        if sep and key:
+            os.environb[key] = value
+    out = io.BytesIO()
+    sys.stdout = io.TextIOWrapper(out, encoding='utf-8', write_through=True)
+    sys.stdin = io.TextIOWrapper(io.BytesIO(body), encoding='utf-8')
+    sys.argv = [os.path.basename(script)]
+    status = 0
+    try:
+        os.chdir(os.path.dirname(script))
+        exec(load(script), {'__name__': '__main__', '__file__': script, '__builtins__': __builtins__})
+    except SystemExit as e:
+        status = e.code if isinstance(e.code, int) else (0 if e.code is None else 1)
+    except BaseException:
+        import traceback
+        traceback.print_exc()
+        status = 1
+    try:
+        sys.stdout.flush()
+    except Exception:
+        pass
+    data = out.getvalue()
+    reply = memoryview(struct.pack('!IB', len(data), status & 255) + data)
+    while reply:
+        reply = reply[os.write(3, reply):]
+)PY";
+
+const size_t REPLY_HEADER_SIZE = 5; // 4 bytes length + 1 byte exit status
+
+void appendFrame(std::string& out, const std::string& payload) {
+  uint32_t len = htonl(static_cast<uint32_t>(payload.size()));
+  out.append(reinterpret_cast<const char*>(&len), sizeof(len));
+  out.append(payload);
+}
+
+} // namespace
+
+// ========================= JOB =========================
+
+CgiPoolJob::CgiPoolJob(CgiWorkerPool* pool, std::string frames, const Request& req, const Server& server)
+  : _pool(pool), _frames(std::move(frames)), _req(req), _server(&server) {
+  // The body already travels in the frames
+  _req.setBody("");
+}
+
+CgiPoolJob::~CgiPoolJob() {
+  if (_state != DONE) {
+    abort(false);
+  }
+}
+
+int CgiPoolJob::fd() const {
+  if (_state == WRITING || _state == READING) {
+    return _worker->fd;
+  }
+  return -1;
+}
+
+short CgiPoolJob::events() const {
+  return _state == WRITING ? POLLOUT : POLLIN;
+}
+
+void CgiPoolJob::onEvent(short revents) {
+  if (_state == WRITING) {
+    if (revents & (POLLERR | POLLHUP)) {
+      fail();
+      return;
+    }
+    ssize_t sent = send(_worker->fd, _frames.data() + _written, _frames.size() - _written, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (sent < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        fail();
+      }
+      return;
+    }
+    _written += sent;
+    if (_written == _frames.size()) {
+      _frames.clear();
+      _state = READING;
+    }
+    return;
+  }
+
+  if (_state != READING) {
+    return;
+  }
+
+  char buffer[4096];
+  ssize_t bytesRead = recv(_worker->fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+  if (bytesRead < 0) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      fail();
+    }
+    return;
+  }
+  if (bytesRead == 0) {
+    // Worker exited mid-request
+    fail();
+    return;
+  }
+  _reply.append(buffer, bytesRead);
+
+  if (_reply.size() < REPLY_HEADER_SIZE) {
+    return;
+  }
+  uint32_t len;
+  std::memcpy(&len, _reply.data(), sizeof(len));
+  size_t expected = REPLY_HEADER_SIZE + ntohl(len);
+  if (_reply.size() > expected) {
+    fail();
+  } else if (_reply.size() == expected) {
+    _state = DONE;
+    CgiWorker* worker = _worker;
+    _worker = nullptr;
+    _pool->release(worker, true);
+  }
+}
+
+bool CgiPoolJob::done() const {
+  return _state == DONE;
+}
+
+void CgiPoolJob::finish(Response& res) {
+  if (_errorStatus) {
+    router::utils::HttpResponseBuilder::setErrorResponse(res, _errorStatus, _req, *_server);
+    return;
+  }
+
+  // A non-zero exit status is handled like a failed fork-mode script
+  CgiResult result;
+  if (_reply[4] == 0) {
+    result = parseCgiOutput(_reply.substr(REPLY_HEADER_SIZE));
+  }
+  HandlerUtils::setCgiResponse(res, result, _req, *_server);
+}
+
+void CgiPoolJob::abort(bool timedOut) {
+  if (_state == DONE) {
+    return;
+  }
+  if (_state == QUEUED) {
+    _pool->unqueue(this);
+  } else {
+    // The script cannot be interrupted, so the worker is replaced
+    CgiWorker* worker = _worker;
+    _worker = nullptr;
+    _state = DONE;
+    _pool->release(worker, false);
+  }
+  _state = DONE;
+  _errorStatus = timedOut ? http::GATEWAY_TIMEOUT_504 : http::INTERNAL_SERVER_ERROR_500;
+}
+
+void CgiPoolJob::fail() {
+  CgiWorker* worker = _worker;
+  _worker = nullptr;
+  _state = DONE;
+  _errorStatus = http::INTERNAL_SERVER_ERROR_500;
+  _pool->release(worker, false);
+}
+
+// ========================= POOL =========================
+
+CgiWorkerPool::CgiWorkerPool(const CgiRunner& runner, size_t workers, size_t maxRequests, size_t queueLimit,
+                             const std::string& scriptDir)
+  : _runner(runner), _maxRequests(maxRequests), _queueLimit(queueLimit), _workers(workers) {
+  if (!scriptDir.empty()) {
+    _runner.argv.push_back(scriptDir);
+  }
+  // Warm every worker up front, while the server heap is still small
+  for (auto& worker : _workers) {
+    spawn(worker);
+  }
+}
+
+CgiWorkerPool::~CgiWorkerPool() {
+  for (auto& worker : _workers) {
+    kill(worker);
+  }
+}
+
+/** Queue a script run; the job completes through the event loop */
+std::shared_ptr<PendingResponse> CgiWorkerPool::submit(const std::string& scriptPath, const std::vector<std::string>& env,
+                                                       const std::string& input, const Request& req, const Server& server) {
+  std::string envBlock;
+  for (const auto& var : env) {
+    envBlock.append(var);
+    envBlock.push_back('\0');
+  }
+
+  std::string frames;
+  appendFrame(frames, scriptPath);
+  appendFrame(frames, envBlock);
+  appendFrame(frames, input);
+
+  auto job = std::make_shared<CgiPoolJob>(this, std::move(frames), req, server);
+
+  // A worker that is down counts as idle only if it can be spawned again
+  bool idle = false;
+  for (auto& worker : _workers) {
+    if (!worker.busy && worker.pid == -1) {
+      spawn(worker);
+    }
+    idle = idle || (!worker.busy && worker.pid != -1);
+  }
+
+  // Backpressure: every worker busy and the wait queue full
+  if (!idle && _queue.size() >= _queueLimit) {
+    job->_state = CgiPoolJob::DONE;
+    job->_errorStatus = http::SERVICE_UNAVAILABLE_503;
+    return job;
+  }
+
+  _queue.push_back(job.get());
+  dispatch();
+  return job;
+}
+
+/** Hand queued jobs to idle workers */
+void CgiWorkerPool::dispatch() {
+  for (auto& worker : _workers) {
+    if (_queue.empty()) {
+      return;
+    }
+    if (worker.busy) {
+      continue;
+    }
+
+    // Replace workers that died while idle
+    if (worker.pid != -1 && waitpid(worker.pid, nullptr, WNOHANG) == worker.pid) {
+      worker.pid = -1;
+      kill(worker);
+    }
+    if (worker.pid == -1 && !spawn(worker)) {
+      continue;
+    }
+
+    CgiPoolJob* job = _queue.front();
+    _queue.pop_front();
+    worker.busy = true;
+    job->_worker = &worker;
+    job->_state = CgiPoolJob::WRITING;
+  }
+
+  // No worker is up and none could be spawned: the waiting jobs fail now, not at their time out
+  for (const auto& worker : _workers) {
+    if (worker.pid != -1) {
+      return;
+    }
+  }
+  for (CgiPoolJob* job : _queue) {
+    job->_state = CgiPoolJob::DONE;
+    job->_errorStatus = http::BAD_GATEWAY_502;
+  }
+  _queue.clear();
+}
+
+/** Return a worker after a job; unhealthy or worn out workers are replaced */
+void CgiWorkerPool::release(CgiWorker* worker, bool healthy) {
+  worker->busy = false;
+  worker->served++;
+  if (!healthy || (_maxRequests && worker->served >= _maxRequests)) {
+    kill(*worker);
+    spawn(*worker);
+  }
+  dispatch();
+}
+
+/** Drop a job that is still waiting for a worker */
+void CgiWorkerPool::unqueue(CgiPoolJob* job) {
+  for (auto it = _queue.begin(); it != _queue.end(); ++it) {
+    if (*it == job) {
+      _queue.erase(it);
+      return;
+    }
+  }
+}
+
+bool CgiWorkerPool::spawn(CgiWorker& worker) {
+  int sv[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) == -1) {
+    return false;
+  }
+
+  // Built before the child exists: it must not allocate, another thread may hold the malloc lock
+  std::vector<char*> argv;
+  for (const auto& arg : _runner.argv) {
+    argv.push_back(const_cast<char*>(arg.c_str()));
+  }
+  argv.push_back(nullptr);
+  std::string path = "PATH=" + network::SYSTEM_PATH;
+  char* envp[] = { const_cast<char*>(path.c_str()), nullptr };
+
+  // Child: fd 3 talks to the server, stdin/stdout go to /dev/null, nothing else is inherited
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, sv[1], 3);
+  posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+  posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+  posix_spawn_file_actions_addclosefrom_np(&actions, 4);
+
+  // The server ignores SIGPIPE, interpreters get the default back
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+  sigset_t defaults;
+  sigemptyset(&defaults);
+  sigaddset(&defaults, SIGPIPE);
+  posix_spawnattr_setsigdefault(&attr, &defaults);
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF);
+
+  pid_t pid = -1;
+  int err = posix_spawn(&pid, _runner.interpreter.c_str(), &actions, &attr, argv.data(), envp);
+  posix_spawn_file_actions_destroy(&actions);
+  posix_spawnattr_destroy(&attr);
+
+  close(sv[1]);
+  if (err != 0) {
+    close(sv[0]);
+    return false;
+  }
+  fcntl(sv[0], F_SETFL, fcntl(sv[0], F_GETFL, 0) | O_NONBLOCK);
+  worker.pid = pid;
+  worker.fd = sv[0];
+  worker.served = 0;
+  worker.busy = false;
+  return true;
+}
+
+void CgiWorkerPool::kill(CgiWorker& worker) {
+  if (worker.fd != -1) {
+    close(worker.fd);
+  }
+  if (worker.pid != -1) {
+    ::kill(worker.pid, SIGKILL);
+    waitpid(worker.pid, nullptr, 0);
+  }
+  worker.fd = -1;
+  worker.pid = -1;
+  worker.served = 0;
+  worker.busy = false;
+}
+
+/** Runner for an extension (".py"), nullptr when it has no persistent mode */
+const CgiRunner* CgiWorkerPool::findRunner(const std::string& extension) {
+  static const std::map<std::string, CgiRunner> runners = {
+    { ".py", { "/usr/bin/python3", { "python3", "-c", PYTHON_RUNNER } } }
+  };
+  auto it = runners.find(extension);
+  return it != runners.end() ? &it->second : nullptr;
+}
+
+/** Find the pool serving a script, nullptr when the location forks per request */
+CgiWorkerPool* findCgiPool(const CgiPoolMap* pools, int serverId, const std::string& location, const std::string& extension) {
+  if (!pools) {
+    return nullptr;
+  }
+  auto it = pools->find({serverId, location, extension});
+  return it != pools->end() ? it->second.get() : nullptr;
+}
+
+} // namespace router::handlers
@@ -0,0 +1,130 @@
+/**
+ * @file CgiWorkerPool.hpp
+ * @brief Pre-forked persistent CGI interpreters
+ */
+
+#pragma once
+
+#include <string> // for std::string
+#include <vector> // for std::vector
+#include <deque> // for std::deque
+#include <map> // for std::map
+#include <tuple> // for std::tuple
+#include <memory> // for std::shared_ptr, std::unique_ptr
+#include <sys/types.h> // for pid_t
+
+#include "../../request/Request.hpp"
+#include "../../response/Response.hpp"
+#include "../../response/PendingResponse.hpp"
+
+class Server;
+
+namespace router::handlers {
+
+class CgiWorkerPool;
+
+/**
+ * @brief Interpreter command that runs the worker loop for one extension
+ */
+struct CgiRunner {
+  std::string interpreter;        // absolute path given to execve()
+  std::vector<std::string> argv;  // full argv, including the runner program
+};
+
+/**
+ * @brief One interpreter process kept alive between requests
+ */
+struct CgiWorker {
+  pid_t pid = -1;
+  int fd = -1;          // parent end of the socketpair, fd 3 in the worker
+  size_t served = 0;    // requests handled since spawn
+  bool busy = false;
+};
+
+/**
+ * @brief One request handed to a pool, completed by the event loop
+ *
+ * Frame protocol (all lengths are 32-bit big endian):
+ *   request:  [len][script path] [len][env, NUL separated] [len][body]
+ *   response: [len][exit status, 1 byte][raw CGI output]
+ */
+class CgiPoolJob : public PendingResponse {
+public:
+  CgiPoolJob(CgiWorkerPool* pool, std::string frames, const Request& req, const Server& server);
+  ~CgiPoolJob() override;
+
+  int fd() const override;
+  short events() const override;
+  void onEvent(short revents) override;
+  bool done() const override;
+  void finish(Response& res) override;
+  void abort(bool timedOut) override;
+
+private:
+  friend class CgiWorkerPool;
+
+  enum State { QUEUED, WRITING, READING, DONE };
+
+  /** Worker stopped answering or sent a malformed frame */
+  void fail();
+
+  CgiWorkerPool* _pool;
+  CgiWorker* _worker = nullptr;
+  State _state = QUEUED;
+  std::string _frames;
+  size_t _written = 0;
+  std::string _reply;
+  int _errorStatus = 0;   // non-zero when finish() must send an error page
+  Request _req;
+  const Server* _server;
+};
+
+/**
+ * @brief Fixed set of workers for one (location, extension) pair
+ */
+class CgiWorkerPool {
+public:
+  /** Spawn the workers; each one compiles the scripts under scriptDir before its first request */
+  CgiWorkerPool(const CgiRunner& runner, size_t workers, size_t maxRequests, size_t queueLimit,
+                const std::string& scriptDir = "");
+  ~CgiWorkerPool();
+
+  CgiWorkerPool(const CgiWorkerPool&) = delete;
+  CgiWorkerPool& operator=(const CgiWorkerPool&) = delete;
+
+  /** Queue a script run; the job completes through the event loop */
+  std::shared_ptr<PendingResponse> submit(const std::string& scriptPath, const std::vector<std::string>& env,
+                                          const std::string& input, const Request& req, const Server& server);
+
+  /** Runner for an extension (".py"), nullptr when it has no persistent mode */
+  static const CgiRunner* findRunner(const std::string& extension);
+
+private:
+  friend class CgiPoolJob;
+
+  /** Hand queued jobs to idle workers */
+  void dispatch();
+
+  /** Return a worker after a job; unhealthy or worn out workers are replaced */
+  void release(CgiWorker* worker, bool healthy);
+
+  /** Drop a job that is still waiting for a worker */
+  void unqueue(CgiPoolJob* job);
+
+  bool spawn(CgiWorker& worker);
+  void kill(CgiWorker& worker);
+
+  CgiRunner _runner;
+  size_t _maxRequests;
+  size_t _queueLimit;
+  std::vector<CgiWorker> _workers;
+  std::deque<CgiPoolJob*> _queue;
+};
+
+/** Pools per (server id, location, extension) */
+using CgiPoolMap = std::map<std::tuple<int, std::string, std::string>, std::unique_ptr<CgiWorkerPool>>;
+
+/** Find the pool serving a script, nullptr when the location forks per request */
+CgiWorkerPool* findCgiPool(const CgiPoolMap* pools, int serverId, const std::string& location, const std::string& extension);
+
+} // namespace router::handlers
@@ -0,0 +1,155 @@
+/**
+ * @file DirectoryListingJob.cpp
+ * @brief Paged directory listing streamed from the file I/O threads implementation
+ */
+
+#include "DirectoryListingJob.hpp"
+#include "HandlerUtils.hpp"
+#include "../HttpConstants.hpp"
+#include "../utils/HttpResponseBuilder.hpp"
+#include "../../server/Server.hpp"
+
+#include <poll.h> // for POLLIN
+#include <sstream> // for std::ostringstream
+
+namespace router::handlers {
+
+DirectoryListingJob::DirectoryListingJob(const std::string& dirPath, const std::string& requestPath,
+                                         const utils::ListingQuery& query, utils::AutoindexCache::Template page,
+                                         const Request& req, const Server& server, FileIoPool* pool)
+  : _page(std::make_shared<utils::DirectoryPage>(dirPath, requestPath, query, std::move(page))),
+    _pool(pool), _json(query.json), _req(req), _server(&server) {
+  // Without chunked encoding the end of the body can only be told by its length
+  _stream = _pool && _req.getHttpVersion() == "HTTP/1.1";
+
+  if (!_stream) {
+    while (!_page->finished()) {
+      _page->renderNext(_out, AUTOINDEX_PAGE_MAX);
+    }
+    _done = true;
+    return;
+  }
+
+  std::string batch;
+  _page->renderNext(batch, AUTOINDEX_STREAM_BATCH);
+  append(batch);
+  next();
+}
+
+int DirectoryListingJob::fd() const {
+  return _batch ? _batch->fd() : -1;
+}
+
+short DirectoryListingJob::events() const {
+  return POLLIN;
+}
+
+void DirectoryListingJob::onEvent(short revents) {
+  if (!_batch) {
+    return;
+  }
+  _batch->onEvent(revents);
+  if (_batch->done()) {
+    collect();
+    next();
+  }
+}
+
+bool DirectoryListingJob::done() const {
+  return _done;
+}
+
+void DirectoryListingJob::finish(Response& res) {
+  if (_errorStatus) {
+    HandlerUtils::setErrorResponse(res, _errorStatus, _req, *_server);
+    return;
+  }
+  const std::string& contentType = _json ? http::CONTENT_TYPE_JSON : http::CONTENT_TYPE_HTML;
+  if (!_stream) {
+    utils::HttpResponseBuilder::setSuccessResponse(res, _out, contentType, _req);
+    _out.clear();
+    return;
+  }
+
+  // Head only, the body follows through takeBody()
+  res.setStatus(http::STATUS_OK_200);
+  res.setHeaders(http::CONTENT_TYPE, contentType);
+  res.setHeaders(http::TRANSFER_ENCODING, http::TRANSFER_ENCODING_CHUNKED);
+  HandlerUtils::setConnectionHeaders(res, _req);
+}
+
+void DirectoryListingJob::abort(bool timedOut) {
+  if (_done) {
+    return;
+  }
+  if (_batch) {
+    _batch->abort(false);
+    _batch.reset();
+  }
+  _done = true;
+  if (_stream) {
+    _broken = true;
+  } else {
+    _errorStatus = timedOut ? http::GATEWAY_TIMEOUT_504 : http::INTERNAL_SERVER_ERROR_500;
+  }
+}
+
+bool DirectoryListingJob::streaming() const {
+  return _stream;
+}
+
+bool DirectoryListingJob::takeBody(std::string& out) {
+  out.append(_out);
+  _out.clear();
+  return !_broken;
+}
+
+/** Queue batches until one is left running on a thread or the page is complete */
+void DirectoryListingJob::next() {
+  std::shared_ptr<utils::DirectoryPage> page = _page;
+  auto work = [page](const Request&, Response& res, const Server&) {
+    std::string batch;
+    page->renderNext(batch, AUTOINDEX_STREAM_BATCH);
+    res.setStatus(http::STATUS_OK_200);
+    res.setBody(batch);
+  };
+
+  while (!_done && !_page->finished()) {
+    _batch = _pool->submit(work, _req, *_server);
+    if (!_batch->done()) {
+      return;
+    }
+    collect();   // ran inline, or refused by a full queue
+  }
+  _done = true;
+}
+
+/** Take the output of the finished batch */
+void DirectoryListingJob::collect() {
+  Response batch;
+  _batch->finish(batch);
+  _batch.reset();
+  if (batch.getStatus() != http::STATUS_OK_200) {
+    // The status line is already out, so the client learns from the closed connection
+    _broken = true;
+    _done = true;
+    return;
+  }
+  append(std::string(batch.getBody()));
+}
+
+/** Add a rendered batch in the chosen framing, and the last chunk once the page is complete */
+void DirectoryListingJob::append(const std::string& data) {
+  if (!data.empty()) {
+    std::ostringstream chunkSize;
+    chunkSize << std::hex << data.size() << "\r\n";
+    _out.append(chunkSize.str());
+    _out.append(data);
+    _out.append("\r\n");
+  }
+  if (_page->finished()) {
+    _out.append("0\r\n\r\n");
+  }
+}
+
+} // namespace router::handlers
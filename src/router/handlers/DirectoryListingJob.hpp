@@ -0,0 +1,70 @@
+/**
+ * @file DirectoryListingJob.hpp
+ * @brief Paged directory listing streamed from the file I/O threads
+ */
+
+#pragma once
+
+#include <memory> // for std::shared_ptr
+#include <string> // for std::string
+
+#include "FileIoPool.hpp"
+#include "../utils/DirectoryPage.hpp"
+#include "../../request/Request.hpp"
+#include "../../response/Response.hpp"
+#include "../../response/PendingResponse.hpp"
+
+class Server;
+
+namespace router::handlers {
+
+/**
+ * @brief Page of a listing sent while it is being read
+ *
+ * The first batch is rendered by the constructor, the rest one batch per
+ * file I/O job, so the event loop only moves bytes. The head goes out with
+ * the first batch and the body is chunked; HTTP/1.0 clients, and callers
+ * without a pool, get the whole page buffered.
+ */
+class DirectoryListingJob : public PendingResponse {
+public:
+  /** Open the directory and render the first batch; throws std::runtime_error when it cannot be read */
+  DirectoryListingJob(const std::string& dirPath, const std::string& requestPath, const utils::ListingQuery& query,
+                      utils::AutoindexCache::Template page, const Request& req, const Server& server, FileIoPool* pool);
+
+  DirectoryListingJob(const DirectoryListingJob&) = delete;
+  DirectoryListingJob& operator=(const DirectoryListingJob&) = delete;
+
+  int fd() const override;
+  short events() const override;
+  void onEvent(short revents) override;
+  bool done() const override;
+  void finish(Response& res) override;
+  void abort(bool timedOut) override;
+  bool streaming() const override;
+  bool takeBody(std::string& out) override;
+
+private:
+  /** Queue batches until one is left running on a thread or the page is complete */
+  void next();
+
+  /** Take the output of the finished batch */
+  void collect();
+
+  /** Add a rendered batch in the chosen framing, and the last chunk once the page is complete */
+  void append(const std::string& data);
+
+  std::shared_ptr<utils::DirectoryPage> _page;
+  FileIoPool* _pool;
+  std::shared_ptr<PendingResponse> _batch;   // batch running on a thread
+  bool _stream;
+  bool _json;
+  std::string _out;       // framed body bytes not yet taken, the whole body when buffered
+  bool _done = false;
+  bool _broken = false;   // body cut short after the head went out
+  int _errorStatus = 0;   // non-zero when finish() must send an error page
+  Request _req;
+  const Server* _server;
+};
+
+} // namespace router::handlers
@@ -0,0 +1,710 @@
+/**
+ * @file DiskCache.cpp
+ * @brief Responses of proxy_cache locations kept on disk implementation
+ */
+
+#include "DiskCache.hpp"
+#include "CacheControl.hpp"
+#include "FileIoPool.hpp"
+#include "HandlerUtils.hpp"
+#include "../HttpConstants.hpp"
+#include "../../../inc/webserv.hpp"
+
+#include <unistd.h> // for close, pread, write, unlink
+#include <fcntl.h> // for open, O_RDONLY
+#include <poll.h> // for POLLIN
+#include <sys/stat.h> // for stat
+#include <cerrno> // for errno, EINTR
+#include <cstdio> // for std::rename, std::snprintf
+#include <cstdlib> // for std::strtoll
+#include <ctime> // for std::time
+#include <algorithm> // for std::transform, std::sort, std::min, std::max
+#include <filesystem> // for std::filesystem::create_directories, recursive_directory_iterator
+#include <fstream> // for std::ifstream
+#include <stdexcept> // for std::runtime_error
+
+namespace router::handlers {
+
+namespace {
+
+/** First line of a stored file, changed when its layout changes */
+const std::string FILE_MAGIC = "WEBSERV-CACHE 1";
+
+/** Heads of stored files longer than this are not read back */
+const size_t MAX_STORED_HEAD = 65536;
+
+std::string toLower(std::string value) {
+  std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+  return value;
+}
+
+/** 64-bit FNV-1a */
+uint64_t hashKey(const std::string& key) {
+  uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c : key) {
+    hash ^= c;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+std::string hexHash(uint64_t hash) {
+  char buffer[17];
+  std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+  return buffer;
+}
+
+/** Headers that belong to one exchange, set again when the response is sent */
+bool isHopHeader(const std::string& lowerName) {
+  return lowerName == "connection" || lowerName == "keep-alive" || lowerName == "content-length"
+         || lowerName == "transfer-encoding" || lowerName == "age" || lowerName == "x-cache";
+}
+
+/** Write head and body to tmp, then rename it to file, so that a reader never sees half a file */
+bool writeFile(const std::string& tmp, const std::string& file, const std::string& head, const std::string& body) {
+  int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd == -1) {
+    return false;
+  }
+  bool written = true;
+  for (std::string_view part : {std::string_view(head), std::string_view(body)}) {
+    while (written && !part.empty()) {
+      ssize_t n = write(fd, part.data(), part.size());
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      written = n > 0;
+      if (written) {
+        part.remove_prefix(n);
+      }
+    }
+  }
+  close(fd);
+  std::error_code error;
+  std::filesystem::create_directories(std::filesystem::path(file).parent_path(), error);
+  if (!written || error || std::rename(tmp.c_str(), file.c_str()) != 0) {
+    unlink(tmp.c_str());
+    return false;
+  }
+  return true;
+}
+
+/**
+ * File work of a DiskCache, driven by the event loop as a background job
+ *
+ * done gets the outcome on the event loop. The work cannot be called back
+ * once a thread runs it, so the job never expires: it is waited for.
+ */
+class CacheFileJob : public PendingResponse {
+public:
+  CacheFileJob(std::shared_ptr<PendingResponse> io, std::function<void(bool)> done)
+    : _io(std::move(io)), _done(std::move(done)) {
+    settle();
+  }
+
+  int fd() const override { return _io ? _io->fd() : -1; }
+  short events() const override { return POLLIN; }
+  bool done() const override { return !_io; }
+  void finish(Response& res) override { (void)res; }
+  void abort(bool timedOut) override { (void)timedOut; }
+  bool expired(long long elapsedMs) const override { (void)elapsedMs; return false; }
+
+  void onEvent(short revents) override {
+    if (_io) {
+      _io->onEvent(revents);
+      settle();
+    }
+  }
+
+  /** True when the work answered 200 */
+  bool succeeded() const { return _succeeded; }
+
+private:
+  void settle() {
+    if (!_io->done()) {
+      return;
+    }
+    Response res;
+    _io->finish(res);
+    _io.reset();
+    _succeeded = res.getStatus() == http::STATUS_OK_200;
+    _done(_succeeded);
+  }
+
+  std::shared_ptr<PendingResponse> _io;
+  std::function<void(bool)> _done;
+  bool _succeeded = false;
+};
+
+} // namespace
+
+// ========================= FILE =========================
+
+/**
+ * @brief File of a hit, opened by its first read on a file I/O thread
+ *
+ * Reads of a hit run one after the other, never two at once.
+ */
+class CachedFile {
+public:
+  explicit CachedFile(std::string path) : _path(std::move(path)) {}
+
+  ~CachedFile() {
+    if (_fd != -1) {
+      close(_fd);
+    }
+  }
+
+  CachedFile(const CachedFile&) = delete;
+  CachedFile& operator=(const CachedFile&) = delete;
+
+  /** Read up to size bytes at offset into out, false when the file is gone or cut short */
+  bool read(off_t offset, size_t size, std::string& out) {
+    if (_fd == -1) {
+      _fd = open(_path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (_fd == -1) {
+        _missing = true;
+        return false;
+      }
+    }
+    out.resize(size);
+    ssize_t bytesRead;
+    do {
+      bytesRead = pread(_fd, &out[0], size, offset);
+    } while (bytesRead < 0 && errno == EINTR);
+    if (bytesRead <= 0) {
+      out.clear();
+      return false;
+    }
+    out.resize(bytesRead);
+    return true;
+  }
+
+  /** True once it could not be opened: the file was removed behind the cache's back */
+  bool missing() const {
+    return _missing;
+  }
+
+private:
+  std::string _path;
+  int _fd = -1;
+  bool _missing = false;
+};
+
+// ========================= HIT =========================
+
+DiskCacheHit::DiskCacheHit(DiskCache* cache, uint64_t hash, const std::string& file, off_t offset, size_t size,
+                           const std::string& status, const Response::HeaderList& headers, long age,
+                           const Request& req)
+  : _cache(cache), _hash(hash), _pinned(size > 0), _file(std::make_shared<CachedFile>(file)), _offset(offset),
+    _remaining(size), _size(size), _status(status), _headers(headers), _age(age), _req(req) {
+  next();
+}
+
+DiskCacheHit::~DiskCacheHit() {
+  // A read already running finishes; the file is closed with its last reference
+  if (_read) {
+    _read->abort(false);
+  }
+  unpin();
+}
+
+int DiskCacheHit::fd() const {
+  return _read ? _read->fd() : -1;
+}
+
+short DiskCacheHit::events() const {
+  return POLLIN;
+}
+
+void DiskCacheHit::onEvent(short revents) {
+  if (!_read) {
+    return;
+  }
+  _read->onEvent(revents);
+  if (!_read->done()) {
+    return;
+  }
+  Response piece;
+  _read->finish(piece);
+  _read.reset();
+  settle(piece);
+}
+
+bool DiskCacheHit::done() const {
+  return (_remaining == 0 || _failed) && _out.empty() && !_read;
+}
+
+void DiskCacheHit::finish(Response& res) {
+  if (_failed && !_started) {
+    res = std::move(_error);
+    return;
+  }
+  res.setStatus(_status);
+  for (const Response::Header& header : _headers) {
+    res.setHeaders(header.name, header.value);
+  }
+  res.setHeaders(http::CONTENT_LENGTH, std::to_string(_size));
+  res.setHeaders("Age", std::to_string(_age));
+  res.setHeaders("X-Cache", "HIT");
+  HandlerUtils::setConnectionHeaders(res, _req);
+}
+
+void DiskCacheHit::abort(bool timedOut) {
+  if (_read) {
+    _read->abort(false);
+    _read.reset();
+  }
+  unpin();
+  _out.clear();
+  if (!_failed && !_started) {
+    HandlerUtils::setErrorResponse(_error, timedOut ? http::GATEWAY_TIMEOUT_504 : http::INTERNAL_SERVER_ERROR_500,
+                                   _req, *_cache->_server);
+  }
+  _failed = true;
+}
+
+bool DiskCacheHit::streaming() const {
+  return _started;
+}
+
+bool DiskCacheHit::takeBody(std::string& out) {
+  out.append(_out);
+  _out.clear();
+  next();
+  return !_failed;
+}
+
+/** Start reading the next piece, unless one is running or waits to be taken */
+void DiskCacheHit::next() {
+  if (_read || _failed || _remaining == 0 || !_out.empty()) {
+    return;
+  }
+  auto work = [file = _file, offset = _offset,
+               want = std::min(_remaining, static_cast<size_t>(DISK_CACHE_READ_SIZE))](
+                const Request& req, Response& res, const Server& server) {
+    std::string piece;
+    if (!file->read(offset, want, piece)) {
+      HandlerUtils::setErrorResponse(res, http::INTERNAL_SERVER_ERROR_500, req, server);
+      return;
+    }
+    res.setStatus(http::STATUS_OK_200);
+    res.setBody(piece);
+  };
+
+  if (!_cache->_pool) {
+    Response piece;
+    work(_req, piece, *_cache->_server);
+    settle(piece);
+    return;
+  }
+  _read = _cache->_pool->submit(std::move(work), _req, *_cache->_server);
+  if (_read->done()) {
+    Response piece;   // refused by a full queue
+    _read->finish(piece);
+    _read.reset();
+    settle(piece);
+  }
+}
+
+/** Take the outcome of a finished read */
+void DiskCacheHit::settle(Response& piece) {
+  if (piece.getStatus() != http::STATUS_OK_200) {
+    _failed = true;
+    _error = std::move(piece);
+    unpin();
+    return;
+  }
+  _out.assign(piece.getBody());
+  _offset += static_cast<off_t>(_out.size());
+  _remaining -= _out.size();
+  _started = true;
+  unpin();
+}
+
+/** Let the cache replace or remove the file again, once it is open or no longer needed */
+void DiskCacheHit::unpin() {
+  if (_pinned) {
+    _pinned = false;
+    _cache->release(_hash, _file->missing());
+  }
+}
+
+// ========================= FILL =========================
+
+DiskCacheFill::DiskCacheFill(DiskCache* cache, std::string key, size_t ttl, std::shared_ptr<PendingResponse> job)
+  : _cache(cache), _key(std::move(key)), _ttl(ttl), _job(std::move(job)) {}
+
+int DiskCacheFill::fd() const {
+  return _job->fd();
+}
+
+short DiskCacheFill::events() const {
+  return _job->events();
+}
+
+void DiskCacheFill::onEvent(short revents) {
+  _job->onEvent(revents);
+}
+
+bool DiskCacheFill::done() const {
+  return _job->done();
+}
+
+void DiskCacheFill::finish(Response& res) {
+  _job->finish(res);
+  if (!_job->streaming()) {
+    _cache->store(_key, _ttl, res);
+  }
+  res.setHeaders("X-Cache", "MISS");
+}
+
+void DiskCacheFill::abort(bool timedOut) {
+  _job->abort(timedOut);
+}
+
+bool DiskCacheFill::expired(long long elapsedMs) const {
+  return _job->expired(elapsedMs);
+}
+
+// ========================= CACHE =========================
+
+DiskCache::DiskCache(const std::string& path, uint64_t maxSize, size_t inactive, const Server& server,
+                     FileIoPool* pool)
+  : _path(path), _maxSize(maxSize), _inactive(static_cast<time_t>(inactive)), _server(&server), _pool(pool) {
+  while (_path.size() > 1 && _path.back() == '/') {
+    _path.pop_back();
+  }
+  std::error_code error;
+  std::filesystem::create_directories(_path + "/tmp", error);
+  if (error) {
+    throw std::runtime_error("Error: Cannot create proxy_cache_path " + _path + ": " + error.message());
+  }
+  // Files half written by a previous run
+  for (const auto& file : std::filesystem::directory_iterator(_path + "/tmp", error)) {
+    std::filesystem::remove(file.path(), error);
+  }
+  load();
+}
+
+/** Cache key of a request: method, host and path with query string */
+std::string DiskCache::key(const Request& req) {
+  std::string key(req.getMethod());
+  key += ' ';
+  const std::vector<std::string>& host = req.getHeaders("host");
+  key += host.empty() ? std::string() : toLower(host.front());
+  key += ' ';
+  key += req.getPath();
+  return key;
+}
+
+/** Answer from the cache when possible; counts the hit, miss or bypass */
+DiskCache::Lookup DiskCache::lookup(const Request& req, Response& res) {
+  // Only plain GET requests without credentials are shared; a client asking for a fresh answer gets one
+  bool noCache = false;
+  for (const std::string& value : req.getHeaders("cache-control")) {
+    noCache = noCache || toLower(value).find("no-cache") != std::string::npos;
+  }
+  for (const std::string& value : req.getHeaders("pragma")) {
+    noCache = noCache || toLower(value).find("no-cache") != std::string::npos;
+  }
+  if (req.getMethod() != http::GET || !req.getHeaders("authorization").empty() || !req.getHeaders("cookie").empty()
+      || noCache) {
+    ++_stats.bypasses;
+    return BYPASS;
+  }
+
+  const std::string cacheKey = key(req);
+  auto it = _entries.find(hashKey(cacheKey));
+  time_t now = std::time(nullptr);
+  if (it == _entries.end() || it->second.key != cacheKey || now >= it->second.expires) {
+    ++_stats.misses;
+    return MISS;
+  }
+  Entry& entry = it->second;
+  entry.used = now;
+  _lru.splice(_lru.begin(), _lru, entry.lru);
+  ++_stats.hits;
+  long age = std::max(0L, static_cast<long>(now - entry.stored));
+  if (entry.bodySize > 0) {
+    ++_busy[it->first];   // released by the hit once the file is open
+  }
+  res.setPending(std::make_shared<DiskCacheHit>(this, it->first, filePath(it->first), entry.bodyOffset,
+                                                entry.bodySize, entry.status, entry.headers, age, req));
+  return HIT;
+}
+
+/** Wrap the job that produces the response for key, which it must not stream */
+std::shared_ptr<PendingResponse> DiskCache::fill(const std::string& key, size_t ttl,
+                                                 std::shared_ptr<PendingResponse> job) {
+  return std::make_shared<DiskCacheFill>(this, key, ttl, std::move(job));
+}
+
+/** Store a complete response when it allows it */
+bool DiskCache::store(const std::string& key, size_t ttl, const Response& res) {
+  if (res.getPending()) {
+    return false;
+  }
+  long fresh = freshness(res, ttl);
+  if (fresh <= 0) {
+    return false;
+  }
+
+  Entry entry;
+  entry.key = key;
+  entry.status = std::string(res.getStatus());
+  time_t now = std::time(nullptr);
+  entry.expires = now + fresh;
+  entry.stored = now;
+  entry.used = now;
+  std::string head = FILE_MAGIC + "\nKEY " + key + "\nEXPIRES " + std::to_string(entry.expires) + "\nSTATUS "
+                     + entry.status + "\n";
+  for (const Response::Header& header : res.getHeaderList()) {
+    if (isHopHeader(toLower(header.name))) {
+      continue;
+    }
+    entry.headers.push_back(header);
+    head += header.name + ": " + header.value + "\n";
+  }
+  head += "\n";
+  std::string_view body = res.getBody();
+  entry.bodyOffset = static_cast<off_t>(head.size());
+  entry.bodySize = body.size();
+  entry.fileSize = head.size() + body.size();
+  if (entry.fileSize > _maxSize) {
+    return false;
+  }
+
+  // One job at a time per file: a hit opening it or an eviction would see the wrong one
+  uint64_t hash = hashKey(key);
+  if (_busy.count(hash)) {
+    return false;
+  }
+  auto write = [tmp = _path + "/tmp/" + hexHash(hash) + "." + std::to_string(++_tmpCounter), file = filePath(hash),
+                head = std::move(head), body = std::string(body)](const Request& req, Response& result,
+                                                                  const Server& server) {
+    (void)req;
+    (void)server;
+    if (writeFile(tmp, file, head, body)) {
+      result.setStatus(http::STATUS_OK_200);
+    }
+  };
+  return startJob({hash}, std::move(write), [this, hash, entry = std::move(entry)](bool written) mutable {
+    if (written) {
+      add(hash, std::move(entry));
+    }
+  });
+}
+
+/** Drop inactive entries, then least recently used ones over max size; runs once per interval */
+void DiskCache::sweep(std::chrono::steady_clock::time_point now) {
+  if (now < _nextSweep) {
+    return;
+  }
+  _nextSweep = now + std::chrono::milliseconds(DISK_CACHE_SWEEP_INTERVAL);
+
+  // Least recently used at the back: both passes walk from there, a batch at a time; a file in use
+  // waits for the next sweep
+  time_t wall = std::time(nullptr);
+  std::vector<uint64_t> hashes;
+  std::vector<std::string> files;
+  while (!_lru.empty() && hashes.size() < DISK_CACHE_SWEEP_BATCH) {
+    auto it = _entries.find(_lru.back());
+    if ((wall - it->second.used < _inactive && _stats.size <= _maxSize) || _busy.count(it->first)) {
+      break;
+    }
+    hashes.push_back(it->first);
+    files.push_back(filePath(it->first));
+    forget(it);
+    ++_stats.evictions;
+  }
+  if (hashes.empty()) {
+    return;
+  }
+  startJob(hashes, [files = std::move(files)](const Request& req, Response& res, const Server& server) {
+    (void)req;
+    (void)server;
+    for (const std::string& file : files) {
+      unlink(file.c_str());
+    }
+    res.setStatus(http::STATUS_OK_200);
+  }, [](bool removed) { (void)removed; });
+}
+
+/** File jobs started since the last call, for the event loop to drive until they are done */
+std::vector<std::shared_ptr<PendingResponse>> DiskCache::takeJobs() {
+  return std::move(_jobs);
+}
+
+DiskCacheStats DiskCache::stats() const {
+  return _stats;
+}
+
+/** Rebuild the index from the files of a previous run */
+void DiskCache::load() {
+  std::vector<std::pair<time_t, uint64_t>> found;
+  std::error_code error;
+  const std::string tmpDir = _path + "/tmp";
+  for (auto it = std::filesystem::recursive_directory_iterator(_path, error);
+       !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+    if (it->path() == tmpDir) {
+      it.disable_recursion_pending();
+      continue;
+    }
+    if (!it->is_regular_file(error)) {
+      continue;
+    }
+    const std::string file = it->path().string();
+    Entry entry;
+    uint64_t hash = 0;
+    if (!readHead(file, entry) || file != filePath(hash = hashKey(entry.key)) || _entries.count(hash)) {
+      std::filesystem::remove(it->path(), error);
+      error.clear();
+      continue;
+    }
+    _stats.size += entry.fileSize;
+    found.push_back({entry.used, hash});
+    _entries.emplace(hash, std::move(entry));
+  }
+  // Most recently written first
+  std::sort(found.begin(), found.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+  for (const auto& [used, hash] : found) {
+    _lru.push_back(hash);
+    _entries[hash].lru = std::prev(_lru.end());
+  }
+  _stats.entries = _entries.size();
+}
+
+/** Read the head of a stored file into entry, false when it is not one */
+bool DiskCache::readHead(const std::string& file, Entry& entry) const {
+  struct stat info;
+  if (stat(file.c_str(), &info) != 0) {
+    return false;
+  }
+  std::ifstream in(file, std::ios::binary);
+  std::string line;
+  size_t headSize = 0;
+  auto next = [&]() {
+    if (!std::getline(in, line) || headSize + line.size() + 1 > MAX_STORED_HEAD) {
+      return false;
+    }
+    headSize += line.size() + 1;
+    return true;
+  };
+
+  if (!next() || line != FILE_MAGIC || !next() || line.compare(0, 4, "KEY ") != 0) {
+    return false;
+  }
+  entry.key = line.substr(4);
+  if (!next() || line.compare(0, 8, "EXPIRES ") != 0) {
+    return false;
+  }
+  entry.expires = static_cast<time_t>(std::strtoll(line.c_str() + 8, nullptr, 10));
+  if (!next() || line.compare(0, 7, "STATUS ") != 0) {
+    return false;
+  }
+  entry.status = line.substr(7);
+  while (next() && !line.empty()) {
+    size_t colon = line.find(": ");
+    if (colon == std::string::npos) {
+      return false;
+    }
+    entry.headers.push_back({line.substr(0, colon), line.substr(colon + 2)});
+  }
+  if (!line.empty() || static_cast<uint64_t>(info.st_size) < headSize) {
+    return false;
+  }
+  entry.bodyOffset = static_cast<off_t>(headSize);
+  entry.bodySize = static_cast<size_t>(info.st_size) - headSize;
+  entry.fileSize = static_cast<uint64_t>(info.st_size);
+  entry.stored = info.st_mtime;
+  entry.used = info.st_mtime;
+  return true;
+}
+
+/** File a key hash is stored in: <path>/<last hex digit>/<two before it>/<hash> */
+std::string DiskCache::filePath(uint64_t hash) const {
+  const std::string hex = hexHash(hash);
+  return _path + "/" + hex.substr(15, 1) + "/" + hex.substr(13, 2) + "/" + hex;
+}
+
+/** Seconds the response stays fresh, 0 when it must not be stored */
+long DiskCache::freshness(const Response& res, size_t ttl) {
+  CacheControl control = parseCacheControl(res);
+  if (!control.storable) {
+    return 0;
+  }
+  return control.freshFor >= 0 ? control.freshFor : static_cast<long>(ttl);
+}
+
+/** Index the entry of a file just written, in place of the one it replaced */
+void DiskCache::add(uint64_t hash, Entry entry) {
+  // The file of another key with the same hash was just replaced
+  auto it = _entries.find(hash);
+  if (it != _entries.end()) {
+    forget(it);
+  }
+  _lru.push_front(hash);
+  entry.lru = _lru.begin();
+  _stats.size += entry.fileSize;
+  _entries.emplace(hash, std::move(entry));
+  _stats.entries = _entries.size();
+  ++_stats.stores;
+}
+
+/** Forget an entry, its file is left as it is */
+void DiskCache::forget(std::unordered_map<uint64_t, Entry>::iterator it) {
+  _stats.size -= it->second.fileSize;
+  _lru.erase(it->second.lru);
+  _entries.erase(it);
+  _stats.entries = _entries.size();
+}
+
+/** Run work on the files of hashes, left alone until done gets its outcome on the event loop */
+bool DiskCache::startJob(const std::vector<uint64_t>& hashes, FileWork work, std::function<void(bool)> done) {
+  if (!_pool) {
+    Response res;
+    work(Request(), res, *_server);
+    bool succeeded = res.getStatus() == http::STATUS_OK_200;
+    done(succeeded);
+    return succeeded;
+  }
+  for (uint64_t hash : hashes) {
+    ++_busy[hash];
+  }
+  auto job = std::make_shared<CacheFileJob>(_pool->submit(std::move(work), Request(), *_server),
+                                            [this, hashes, done = std::move(done)](bool succeeded) {
+    for (uint64_t hash : hashes) {
+      release(hash, false);
+    }
+    done(succeeded);
+  });
+  if (job->done()) {
+    return job->succeeded();
+  }
+  _jobs.push_back(job);
+  return true;
+}
+
+/** A job on the file of hash is over; gone when the file turned out to be missing */
+void DiskCache::release(uint64_t hash, bool gone) {
+  auto busy = _busy.find(hash);
+  if (busy != _busy.end() && --busy->second == 0) {
+    _busy.erase(busy);
+  }
+  auto it = _entries.find(hash);
+  if (gone && it != _entries.end()) {
+    forget(it);
+  }
+}
+
+/** Find the cache target of a location, nullptr when it has none */
+const CacheTarget* findCacheTarget(const CacheTargetMap* targets, int serverId, const std::string& location) {
+  if (!targets) {
+    return nullptr;
+  }
+  auto it = targets->find({serverId, location});
+  return it != targets->end() ? &it->second : nullptr;
+}
+
+} // namespace router::handlers
@@ -0,0 +1,264 @@
+/**
+ * @file DiskCache.hpp
+ * @brief Responses of proxy_cache locations kept on disk, in front of upstreams and CGI scripts
+ */
+
+#pragma once
+
+#include <string> // for std::string
+#include <vector> // for std::vector
+#include <list> // for std::list
+#include <map> // for std::map
+#include <unordered_map> // for std::unordered_map
+#include <functional> // for std::function
+#include <memory> // for std::shared_ptr, std::unique_ptr
+#include <chrono> // for std::chrono::steady_clock
+#include <cstdint> // for uint64_t
+#include <ctime> // for time_t
+#include <sys/types.h> // for off_t
+
+#include "../../request/Request.hpp"
+#include "../../response/Response.hpp"
+#include "../../response/PendingResponse.hpp"
+
+class Server;
+
+namespace router::handlers {
+
+class DiskCache;
+class CachedFile;
+class FileIoPool;
+
+/**
+ * @brief Counters of a DiskCache
+ */
+struct DiskCacheStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;          // not stored, or expired: the backend answers
+  uint64_t bypasses = 0;        // request not eligible, the cache is not looked at
+  uint64_t stores = 0;
+  uint64_t evictions = 0;       // removed by the sweeper, inactive or over max_size
+  size_t entries = 0;
+  uint64_t size = 0;            // bytes of the stored files
+};
+
+/**
+ * @brief Stored response sent from its file, a piece per event
+ *
+ * The file is opened and read on the file I/O threads, a piece at a time as
+ * the client takes them, so a large response is never held in memory. The
+ * head goes out with the first piece; a file that cannot be read before that
+ * is answered with an error page and dropped from the cache.
+ */
+class DiskCacheHit : public PendingResponse {
+public:
+  DiskCacheHit(DiskCache* cache, uint64_t hash, const std::string& file, off_t offset, size_t size,
+               const std::string& status, const Response::HeaderList& headers, long age, const Request& req);
+  ~DiskCacheHit() override;
+
+  DiskCacheHit(const DiskCacheHit&) = delete;
+  DiskCacheHit& operator=(const DiskCacheHit&) = delete;
+
+  int fd() const override;
+  short events() const override;
+  void onEvent(short revents) override;
+  bool done() const override;
+  void finish(Response& res) override;
+  void abort(bool timedOut) override;
+  bool streaming() const override;
+  bool takeBody(std::string& out) override;
+
+private:
+  /** Start reading the next piece, unless one is running or waits to be taken */
+  void next();
+
+  /** Take the outcome of a finished read */
+  void settle(Response& piece);
+
+  /** Let the cache replace or remove the file again, once it is open or no longer needed */
+  void unpin();
+
+  DiskCache* _cache;
+  uint64_t _hash;
+  bool _pinned;                 // the cache leaves the file alone until it is open
+  std::shared_ptr<CachedFile> _file;
+  std::shared_ptr<PendingResponse> _read;   // piece being read on a thread
+  off_t _offset;                // next body byte in the file
+  size_t _remaining;
+  size_t _size;
+  bool _started = false;        // a piece was read, the head goes out with it
+  bool _failed = false;         // the file was cut short under us
+  Response _error;              // answer when nothing could be read
+  std::string _out;             // body bytes read, not yet taken
+  std::string _status;
+  Response::HeaderList _headers;
+  long _age;
+  Request _req;
+};
+
+/**
+ * @brief Job whose response is stored once it is complete
+ */
+class DiskCacheFill : public PendingResponse {
+public:
+  /** @param ttl Seconds the response is fresh when it does not say itself */
+  DiskCacheFill(DiskCache* cache, std::string key, size_t ttl, std::shared_ptr<PendingResponse> job);
+
+  DiskCacheFill(const DiskCacheFill&) = delete;
+  DiskCacheFill& operator=(const DiskCacheFill&) = delete;
+
+  int fd() const override;
+  short events() const override;
+  void onEvent(short revents) override;
+  bool done() const override;
+  void finish(Response& res) override;
+  void abort(bool timedOut) override;
+  bool expired(long long elapsedMs) const override;
+
+private:
+  DiskCache* _cache;
+  std::string _key;
+  size_t _ttl;
+  std::shared_ptr<PendingResponse> _job;
+};
+
+/**
+ * @brief Responses of one proxy_cache_path directory
+ *
+ * A key hashes to a file two directory levels down (levels=1:2 in nginx
+ * terms), written under tmp/ and renamed into place. The index of what is
+ * stored lives in memory and is rebuilt from the file heads at startup; the
+ * server is a single process, so nothing else has to share it.
+ *
+ * Freshness comes from the response's Cache-Control (no-store, no-cache,
+ * private, s-maxage, max-age) or Expires, else from the location's
+ * proxy_cache. Only complete 200 responses without Set-Cookie or Vary are
+ * stored. The event loop sweeps the cache every DISK_CACHE_SWEEP_INTERVAL:
+ * entries unused for inactive seconds go first, then the least recently used
+ * ones while the files exceed max_size.
+ *
+ * Files are written, read and removed on the file I/O threads; the event loop
+ * only updates the index, once their job is done. A file with a job in flight
+ * is neither replaced nor evicted. Without a pool the file work runs inline.
+ */
+class DiskCache {
+public:
+  enum Lookup {
+    BYPASS,   // request not eligible: run the backend, nothing is stored
+    MISS,     // run the backend and fill()
+    HIT       // res streams the stored response
+  };
+
+  /**
+   * @param maxSize Bytes of files kept
+   * @param inactive Seconds an unused entry is kept
+   * @param server Server the cache belongs to, its error pages answer failed hits
+   * @param pool Threads running the file work, inline when null
+   * @throws std::runtime_error when the directory cannot be created
+   */
+  DiskCache(const std::string& path, uint64_t maxSize, size_t inactive, const Server& server,
+            FileIoPool* pool = nullptr);
+
+  DiskCache(const DiskCache&) = delete;
+  DiskCache& operator=(const DiskCache&) = delete;
+
+  /** Cache key of a request: method, host and path with query string */
+  static std::string key(const Request& req);
+
+  /** Answer from the cache when possible; counts the hit, miss or bypass */
+  Lookup lookup(const Request& req, Response& res);
+
+  /** Wrap the job that produces the response for key, which it must not stream */
+  std::shared_ptr<PendingResponse> fill(const std::string& key, size_t ttl, std::shared_ptr<PendingResponse> job);
+
+  /**
+   * @brief Store a complete response when it allows it, indexed once its file is written
+   * @return false when it must not be stored or the file could not be written
+   */
+  bool store(const std::string& key, size_t ttl, const Response& res);
+
+  /** Drop inactive entries, then least recently used ones over max size; runs once per interval */
+  void sweep(std::chrono::steady_clock::time_point now);
+
+  /** File jobs started since the last call, for the event loop to drive until they are done */
+  std::vector<std::shared_ptr<PendingResponse>> takeJobs();
+
+  /** Snapshot of the counters */
+  DiskCacheStats stats() const;
+
+private:
+  friend class DiskCacheHit;
+
+  /** File work of the cache, run on a pool thread with an empty request; it answers 200 when it succeeded */
+  using FileWork = std::function<void(const Request& req, Response& res, const Server& server)>;
+
+  struct Entry {
+    std::string key;
+    std::string status;
+    Response::HeaderList headers;
+    off_t bodyOffset = 0;
+    size_t bodySize = 0;
+    uint64_t fileSize = 0;
+    time_t expires = 0;
+    time_t stored = 0;
+    time_t used = 0;                        // last hit or store
+    std::list<uint64_t>::iterator lru;
+  };
+
+  /** Rebuild the index from the files of a previous run */
+  void load();
+
+  /** Read the head of a stored file into entry, false when it is not one */
+  bool readHead(const std::string& file, Entry& entry) const;
+
+  /** File a key hash is stored in */
+  std::string filePath(uint64_t hash) const;
+
+  /** Seconds the response stays fresh, 0 when it must not be stored */
+  static long freshness(const Response& res, size_t ttl);
+
+  /** Index the entry of a file just written, in place of the one it replaced */
+  void add(uint64_t hash, Entry entry);
+
+  /** Forget an entry, its file is left as it is */
+  void forget(std::unordered_map<uint64_t, Entry>::iterator it);
+
+  /**
+   * @brief Run work on the files of hashes, left alone until done gets its outcome on the event loop
+   * @return false when it failed, or was refused by a full queue
+   */
+  bool startJob(const std::vector<uint64_t>& hashes, FileWork work, std::function<void(bool)> done);
+
+  /** A job on the file of hash is over; gone when the file turned out to be missing */
+  void release(uint64_t hash, bool gone);
+
+  std::string _path;
+  uint64_t _maxSize;
+  time_t _inactive;
+  const Server* _server;
+  FileIoPool* _pool;
+  std::unordered_map<uint64_t, Entry> _entries;   // by key hash, the key is compared on lookup
+  std::list<uint64_t> _lru;                        // most recently used at the front
+  std::unordered_map<uint64_t, size_t> _busy;      // file jobs in flight by key hash
+  std::vector<std::shared_ptr<PendingResponse>> _jobs;   // started, not taken by the event loop yet
+  uint64_t _tmpCounter = 0;
+  std::chrono::steady_clock::time_point _nextSweep;
+  DiskCacheStats _stats;
+};
+
+/** Disk caches per server id */
+using DiskCacheMap = std::map<int, std::unique_ptr<DiskCache>>;
+
+/** Disk cache of a proxy_cache location and the freshness its responses get by default */
+struct CacheTarget {
+  DiskCache* cache = nullptr;
+  size_t ttl = 0;               // seconds
+};
+
+/** Cache targets per (server id, location) */
+using CacheTargetMap = std::map<std::pair<int, std::string>, CacheTarget>;
+
+/** Find the cache target of a location, nullptr when it has none */
+const CacheTarget* findCacheTarget(const CacheTargetMap* targets, int serverId, const std::string& location);
+
+} // namespace router::handlers
@@ -0,0 +1,215 @@
+/**
+ * @file FileIoPool.cpp
+ * @brief Threads running blocking file system work off the event loop implementation
+ */
+
+#include "FileIoPool.hpp"
+#include "HandlerUtils.hpp"
+#include "../HttpConstants.hpp"
+#include "../../server/Server.hpp"
+
+#include <unistd.h> // for read, write, close
+#include <poll.h> // for POLLIN
+#include <sys/eventfd.h> // for eventfd, EFD_CLOEXEC, EFD_NONBLOCK
+#include <algorithm> // for std::max
+
+namespace router::handlers {
+
+namespace {
+
+uint64_t microsSince(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point now) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(now - start).count();
+}
+
+} // namespace
+
+// ========================= JOB =========================
+
+FileIoJob::FileIoJob(Work work, const Request& req, const Server& server)
+  : _work(std::move(work)), _req(req), _server(&server) {
+  _eventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+}
+
+FileIoJob::~FileIoJob() {
+  if (_eventFd != -1) {
+    close(_eventFd);
+  }
+}
+
+int FileIoJob::fd() const {
+  if (_next) {
+    return _next->fd();
+  }
+  return _done ? -1 : _eventFd;
+}
+
+short FileIoJob::events() const {
+  return _next ? _next->events() : POLLIN;
+}
+
+void FileIoJob::onEvent(short revents) {
+  if (_next) {
+    _next->onEvent(revents);
+    return;
+  }
+  uint64_t count;
+  while (read(_eventFd, &count, sizeof(count)) > 0) {
+  }
+  if (_ready.load(std::memory_order_acquire)) {
+    settle();
+  }
+}
+
+bool FileIoJob::done() const {
+  return _next ? _next->done() : _done;
+}
+
+void FileIoJob::finish(Response& res) {
+  if (_next) {
+    _next->finish(res);
+    return;
+  }
+  if (_errorStatus) {
+    HandlerUtils::setErrorResponse(res, _errorStatus, _req, *_server);
+    return;
+  }
+  res = std::move(_result);
+}
+
+void FileIoJob::abort(bool timedOut) {
+  if (_next) {
+    _next->abort(timedOut);
+    return;
+  }
+  // A thread already running the work finishes it; the result is dropped
+  _cancelled.store(true, std::memory_order_relaxed);
+  _done = true;
+  _errorStatus = timedOut ? http::GATEWAY_TIMEOUT_504 : http::INTERNAL_SERVER_ERROR_500;
+}
+
+bool FileIoJob::streaming() const {
+  return _next && _next->streaming();
+}
+
+bool FileIoJob::takeBody(std::string& out) {
+  return _next ? _next->takeBody(out) : true;
+}
+
+/** Work finished: done, or handing over to the job the work attached to its response */
+void FileIoJob::settle() {
+  if (_result.getPending()) {
+    _next = _result.getPending();
+    return;
+  }
+  _done = true;
+}
+
+/** Run the work on the calling thread */
+void FileIoJob::run() {
+  if (!_cancelled.load(std::memory_order_relaxed)) {
+    try {
+      _work(_req, _result, *_server);
+    } catch (const std::exception&) {
+      _result = Response();
+      HandlerUtils::setErrorResponse(_result, http::INTERNAL_SERVER_ERROR_500, _req, *_server);
+    }
+  }
+  _ready.store(true, std::memory_order_release);
+}
+
+/** Wake the event loop up for a job that has run */
+void FileIoJob::signal() {
+  if (_eventFd != -1) {
+    uint64_t one = 1;
+    ssize_t written = write(_eventFd, &one, sizeof(one));
+    (void)written;
+  }
+}
+
+// ========================= POOL =========================
+
+FileIoPool::FileIoPool(size_t threads, size_t queueLimit) : _queueLimit(queueLimit) {
+  for (size_t i = 0; i < threads; ++i) {
+    _threads.emplace_back(&FileIoPool::workerLoop, this);
+  }
+}
+
+FileIoPool::~FileIoPool() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stopping = true;
+  }
+  _wakeup.notify_all();
+  for (auto& thread : _threads) {
+    thread.join();
+  }
+}
+
+std::shared_ptr<PendingResponse> FileIoPool::submit(FileIoJob::Work work, const Request& req, const Server& server) {
+  auto job = std::make_shared<FileIoJob>(std::move(work), req, server);
+
+  // No descriptor to signal through: do the work here, like before the pool existed
+  if (job->_eventFd == -1 || _threads.empty()) {
+    job->run();
+    job->settle();
+    return job;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    // Backpressure: every thread busy and the queue full
+    if (_queue.size() >= _queueLimit) {
+      _stats.rejected++;
+      job->_done = true;
+      job->_errorStatus = http::SERVICE_UNAVAILABLE_503;
+      return job;
+    }
+    job->_queuedAt = std::chrono::steady_clock::now();
+    _queue.push_back(job);
+    _stats.queued = _queue.size();
+  }
+  _wakeup.notify_one();
+  return job;
+}
+
+/** Snapshot of the counters */
+FileIoStats FileIoPool::stats() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _stats;
+}
+
+/** Thread body: take jobs until the pool stops */
+void FileIoPool::workerLoop() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (true) {
+    _wakeup.wait(lock, [this]() { return _stopping || !_queue.empty(); });
+    if (_stopping) {
+      return;
+    }
+    std::shared_ptr<FileIoJob> job = std::move(_queue.front());
+    _queue.pop_front();
+    _stats.queued = _queue.size();
+    _stats.running++;
+    lock.unlock();
+
+    auto start = std::chrono::steady_clock::now();
+    job->run();
+    auto end = std::chrono::steady_clock::now();
+
+    // Counted before the event loop hears of it, so that a finished job is always in the stats
+    lock.lock();
+    uint64_t wait = microsSince(job->_queuedAt, start);
+    uint64_t run = microsSince(start, end);
+    _stats.running--;
+    _stats.completed++;
+    _stats.waitTotal += wait;
+    _stats.waitMax = std::max(_stats.waitMax, wait);
+    _stats.runTotal += run;
+    _stats.runMax = std::max(_stats.runMax, run);
+    lock.unlock();
+    job->signal();
+    lock.lock();
+  }
+}
+
+} // namespace router::handlers
@@ -0,0 +1,126 @@
+/**
+ * @file FileIoPool.hpp
+ * @brief Threads running blocking file system work off the event loop
+ */
+
+#pragma once
+
+#include <atomic> // for std::atomic
+#include <chrono> // for std::chrono::steady_clock
+#include <condition_variable> // for std::condition_variable
+#include <cstdint> // for uint64_t
+#include <deque> // for std::deque
+#include <functional> // for std::function
+#include <memory> // for std::shared_ptr
+#include <mutex> // for std::mutex
+#include <thread> // for std::thread
+#include <vector> // for std::vector
+
+#include "../../request/Request.hpp"
+#include "../../response/Response.hpp"
+#include "../../response/PendingResponse.hpp"
+
+class Server;
+
+namespace router::handlers {
+
+class FileIoPool;
+
+/**
+ * @brief One handler run on a pool thread, completed by the event loop
+ *
+ * The thread runs the handler on copies of the request and a private Response,
+ * then signals the job's eventfd; the event loop polls that descriptor like
+ * any other pending job. A handler that attaches a pending job of its own to
+ * the response hands over to it: this job then forwards everything to it.
+ */
+class FileIoJob : public PendingResponse {
+public:
+  /** Handler run on a pool thread; it must not touch event loop state */
+  using Work = std::function<void(const Request& req, Response& res, const Server& server)>;
+
+  FileIoJob(Work work, const Request& req, const Server& server);
+  ~FileIoJob() override;
+
+  FileIoJob(const FileIoJob&) = delete;
+  FileIoJob& operator=(const FileIoJob&) = delete;
+
+  int fd() const override;
+  short events() const override;
+  void onEvent(short revents) override;
+  bool done() const override;
+  void finish(Response& res) override;
+  void abort(bool timedOut) override;
+  bool streaming() const override;
+  bool takeBody(std::string& out) override;
+
+private:
+  friend class FileIoPool;
+
+  /** Run the work on the calling thread */
+  void run();
+
+  /** Wake the event loop up for a job that has run */
+  void signal();
+
+  /** Work finished: done, or handing over to the job the work attached to its response */
+  void settle();
+
+  Work _work;
+  Response _result;
+  std::shared_ptr<PendingResponse> _next;   // job the work handed over to
+  int _eventFd = -1;
+  std::atomic<bool> _ready{false};       // set by the pool thread once _result is filled
+  std::atomic<bool> _cancelled{false};   // nobody waits any more, skip the work if not started
+  bool _done = false;
+  int _errorStatus = 0;   // non-zero when finish() must send an error page
+  Request _req;
+  const Server* _server;
+  std::chrono::steady_clock::time_point _queuedAt;
+};
+
+/**
+ * @brief Counters of a FileIoPool, times in microseconds
+ */
+struct FileIoStats {
+  size_t queued = 0;          // jobs waiting for a thread
+  size_t running = 0;         // jobs on a thread
+  uint64_t completed = 0;
+  uint64_t rejected = 0;      // refused with 503 because the queue was full
+  uint64_t waitTotal = 0;     // time spent in the queue, summed over completed jobs
+  uint64_t waitMax = 0;
+  uint64_t runTotal = 0;      // time spent on a thread, summed over completed jobs
+  uint64_t runMax = 0;
+};
+
+/**
+ * @brief Fixed set of threads with a bounded queue
+ */
+class FileIoPool {
+public:
+  FileIoPool(size_t threads, size_t queueLimit);
+  ~FileIoPool();
+
+  FileIoPool(const FileIoPool&) = delete;
+  FileIoPool& operator=(const FileIoPool&) = delete;
+
+  /** Queue a handler; the job completes through the event loop, with 503 when the queue is full */
+  std::shared_ptr<PendingResponse> submit(FileIoJob::Work work, const Request& req, const Server& server);
+
+  /** Snapshot of the counters */
+  FileIoStats stats() const;
+
+private:
+  /** Thread body: take jobs until the pool stops */
+  void workerLoop();
+
+  size_t _queueLimit;
+  mutable std::mutex _mutex;
+  std::condition_variable _wakeup;
+  std::deque<std::shared_ptr<FileIoJob>> _queue;
+  std::vector<std::thread> _threads;
+  FileIoStats _stats;
+  bool _stopping = false;
+};
+
+} // namespace router::handlers
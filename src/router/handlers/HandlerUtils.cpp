@@ -3,8 +3,11 @@
 #include "../utils/StringUtils.hpp"
 #include "../utils/Utils.hpp"
 #include "../HttpConstants.hpp"
+#include "MultipartParser.hpp"
 #include <filesystem> // for std::filesystem::create_directories, std::filesystem::remove, std::filesystem::exists
 #include <fstream> // for std::ofstream
+#include <algorithm> // for std::transform
+#include <cctype> // for std::isalnum, std::toupper
 
 namespace router::handlers {
 
@@ -57,13 +60,9 @@ const Location* HandlerUtils::findBestMatchingLocation(const std::string& reques
   return bestLocation;
 }
 
-/** Process the request body */
+/** Process the request body; a chunked body was already decoded while it arrived */
 std::string HandlerUtils::processRequestBody(const Request& req) {
-  std::string processedBody(req.getBody());
-  if (router::utils::isChunked(req)) {
-    processedBody = router::utils::parseChunkedRequestBody(processedBody);
-  }
-  return processedBody;
+  return std::string(req.getBody());
 }
 
 /** Validate the content type */
@@ -84,6 +83,56 @@ std::string HandlerUtils::extractBoundary(const std::string& contentType) {
   return "--" + contentType.substr(boundaryPos + 9);
 }
 
+/** Expose the form fields of a multipart body as FORM_<NAME> variables, file parts stay on stdin only */
+void HandlerUtils::addFormFieldsToEnv(std::vector<std::string>& env, const Request& req, const std::string& body) {
+  const auto& contentTypeKey = req.getHeaders("content-type");
+  if (!validateContentType(contentTypeKey, "multipart/form-data")) {
+    return;
+  }
+  const std::string boundary = extractBoundary(contentTypeKey[0]);
+  if (boundary.empty()) {
+    return;
+  }
+
+  // Bounded, so a large form cannot exceed the environment size limit of exec
+  const size_t maxFields = 64;
+  const size_t maxValue = 4096;
+  std::vector<std::string> fields;
+  std::string value;
+  bool isField = false;
+  std::string name;
+  MultipartParser parser(boundary,
+    [&](const MultipartParser::Part& part) {
+      isField = part.filename.empty() && !part.name.empty();
+      name = part.name;
+      value.clear();
+      return true;
+    },
+    [&](const char* data, size_t size) {
+      if (isField && value.size() + size <= maxValue) {
+        value.append(data, size);
+      } else {
+        isField = false;
+      }
+      return true;
+    },
+    [&]() {
+      // NUL cannot be passed in an environment string
+      if (isField && fields.size() < maxFields && value.find('\0') == std::string::npos) {
+        std::string variable = "FORM_";
+        for (char c : name) {
+          variable += std::isalnum(static_cast<unsigned char>(c)) ? std::toupper(static_cast<unsigned char>(c)) : '_';
+        }
+        fields.push_back(variable + "=" + value);
+      }
+      return true;
+    });
+  parser.feed(body.data(), body.size());
+  if (parser.complete()) {
+    env.insert(env.end(), fields.begin(), fields.end());
+  }
+}
+
 /** Write the file to disk */
 bool HandlerUtils::writeFileToDisk(const std::string& filePath, const std::string& content) {
   std::filesystem::create_directories(std::filesystem::path(filePath).parent_path());
@@ -141,4 +190,56 @@ void HandlerUtils::setSuccessResponse(Response& res, int statusCode, const Reque
   router::utils::HttpResponseBuilder::setSuccessResponseWithDefaultPage(res, statusCode, req);
 }
 
+/** Content-Length or Transfer-Encoding, in any case */
+static bool isCgiFramingHeader(const std::string& name) {
+  std::string lower = name;
+  std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+  return lower == "content-length" || lower == "transfer-encoding";
+}
+
+/** Set the response from a parsed CGI result */
+void HandlerUtils::setCgiResponse(Response& res, const CgiResult& cgiResult, const Request& req, const Server& server) {
+  if (!cgiResult.success) {
+    // If CGI failed, check if it's a timeout (504) or other error
+    if (cgiResult.status.find("504") != std::string::npos) {
+      router::utils::HttpResponseBuilder::setErrorResponse(res, http::GATEWAY_TIMEOUT_504, req, server);
+      return;
+    }
+    router::utils::HttpResponseBuilder::setErrorResponse(res, http::INTERNAL_SERVER_ERROR_500, req, server);
+    return;
+  }
+
+  // 1. Set status and headers
+  setCgiHead(res, cgiResult, req);
+
+  // 2. Set response body
+  res.setBody(cgiResult.body);
+
+  // 3. Set Content-Length header based on body size
+  res.setHeaders(http::CONTENT_LENGTH, std::to_string(cgiResult.body.length()));
+}
+
+/** Set status and headers from a parsed CGI result; body framing headers are left to the caller */
+void HandlerUtils::setCgiHead(Response& res, const CgiResult& cgiResult, const Request& req) {
+  // 1. Set response status from CGI output
+  res.setStatus(cgiResult.status);
+
+  // 2. Set headers from CGI output, except the ones describing the body length
+  for (const auto& [headerName, headerValue] : cgiResult.headers) {
+    if (isCgiFramingHeader(headerName)) {
+      continue;
+    }
+    res.setHeaders(headerName, headerValue);
+  }
+
+  // 3. Set default content type if not specified
+  auto contentType = res.getHeaders("Content-Type");
+  if (contentType.empty()) {
+    res.setHeaders(http::CONTENT_TYPE, http::CONTENT_TYPE_HTML);
+  }
+
+  // 4. Set connection header based on keep-alive logic
+  setConnectionHeaders(res, req);
+}
+
 } // namespace router::handlers
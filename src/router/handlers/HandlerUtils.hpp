@@ -4,6 +4,7 @@
 #include "../../request/Request.hpp"
 #include "../../response/Response.hpp"
 #include "../HttpConstants.hpp"
+#include "CgiExecutor.hpp"
 
 namespace router::handlers {
 
@@ -22,6 +23,7 @@ public:
   static std::string processRequestBody(const Request& req);
   static bool validateContentType(const std::vector<std::string>& contentTypeKey, const std::string& expectedType);
   static std::string extractBoundary(const std::string& contentType);
+  static void addFormFieldsToEnv(std::vector<std::string>& env, const Request& req, const std::string& body);
 
   // File operations
   static bool writeFileToDisk(const std::string& filePath, const std::string& content);
@@ -36,6 +38,8 @@ public:
   static void setConnectionHeaders(Response& res, const Request& req);
   static void setErrorResponse(Response& res, int statusCode, const Request& req, const Server& server);
   static void setSuccessResponse(Response& res, int statusCode, const Request& req);
+  static void setCgiResponse(Response& res, const CgiResult& cgiResult, const Request& req, const Server& server);
+  static void setCgiHead(Response& res, const CgiResult& cgiResult, const Request& req);
 };
 
 } // namespace router::handlers
@@ -5,16 +5,19 @@
 
 #include "Handlers.hpp"
 #include "HandlerUtils.hpp"
-#include "MultipartParser.hpp"
+#include "UploadSink.hpp"
+#include "DirectoryListingJob.hpp"
 #include "../utils/StringUtils.hpp"
 #include "../utils/FileUtils.hpp"
 #include "../utils/HttpResponseBuilder.hpp"
 #include "../utils/ValidationUtils.hpp"
 #include "../handlers/CgiExecutor.hpp"
 #include "../utils/Utils.hpp"
+#include "../utils/DirectoryPage.hpp"
 #include "../HttpConstants.hpp"
 #include "../../server/Server.hpp"
 #include <sstream>
+#include <algorithm> // for std::transform
 #include <filesystem> // for std::filesystem::directory_iterator, std::filesystem::path, std::filesystem::exists, std::filesystem::is_directory, std::filesystem::is_regular_file, std::filesystem::create_directories, std::filesystem::remove, std::filesystem::file_size, std::filesystem::last_write_time
 
 using namespace http;
@@ -25,10 +28,16 @@ using namespace http;
 // ********************************************************************************************** //
 
 /** Handle GET requests for static files */
-void get(const Request& req, Response& res, const Server& server) {
+void get(const Request& req, Response& res, const Server& server, router::handlers::FileIoPool* fileIo) {
   try {
-    // 1. Extract and validate file path
-    const std::string_view filePathView = req.getPath();
+    // 1. Extract and validate file path, without the query string
+    std::string_view filePathView = req.getPath();
+    std::string_view query;
+    size_t queryPos = filePathView.find('?');
+    if (queryPos != std::string_view::npos) {
+      query = filePathView.substr(queryPos + 1);
+      filePathView = filePathView.substr(0, queryPos);
+    }
     if (filePathView.empty()) {
       router::handlers::HandlerUtils::setErrorResponse(res, http::NOT_FOUND_404, req, server);
       return;
@@ -47,7 +56,21 @@ void get(const Request& req, Response& res, const Server& server) {
     if (std::filesystem::is_directory(filePath)) {
       const Location* location = router::handlers::HandlerUtils::findBestMatchingLocation(requestPath, server);
 
-      if (router::utils::handleDirectoryRequest(filePath, requestPath, location, res, req, server.getRoot())) {
+      // Paged listing (?page=, ?cursor=, ?sort=, ?format=json), read a slice at a time
+      router::utils::ListingQuery listingQuery;
+      if (location && location->autoindex && !query.empty()) {
+        if (!router::utils::parseListingQuery(query, listingQuery)) {
+          router::handlers::HandlerUtils::setErrorResponse(res, http::BAD_REQUEST_400, req, server);
+          return;
+        }
+        if (listingQuery.paged) {
+          res.setPending(std::make_shared<router::handlers::DirectoryListingJob>(filePath, requestPath, listingQuery,
+            router::utils::autoindexCache().compiledTemplate(filePath, server.getRoot()), req, server, fileIo));
+          return;
+        }
+      }
+
+      if (router::utils::handleDirectoryRequest(filePath, requestPath, location, res, req, server)) {
         return;
       }
 
@@ -61,7 +84,7 @@ void get(const Request& req, Response& res, const Server& server) {
     }
 
     // 4. Serve static file
-    if (router::utils::serveStaticFile(filePath, res, req)) {
+    if (router::utils::serveStaticFile(filePath, res, req, server)) {
       return;
     }
 
@@ -79,69 +102,49 @@ void get(const Request& req, Response& res, const Server& server) {
 // ************************************** POST HANDLER ******************************************* //
 // ********************************************************************************************** //
 
-/** Handle POST requests for file uploads */
-void post(const Request& req, Response& res, const Server& server) {
+/** Handle POST requests for file uploads; the files are written through fileIo when given */
+void post(const Request& req, Response& res, const Server& server, router::handlers::FileIoPool* fileIo) {
   try {
-    // 1. Find upload location
-    const std::string requestPath(req.getPath());
-    const Location* location = router::handlers::HandlerUtils::findUploadLocation(requestPath, server);
-    if (!location || location->upload_path.empty()) {
-      router::handlers::HandlerUtils::setErrorResponse(res, http::FORBIDDEN_403, req, server);
-      return;
-    }
+    // 1. Open the upload, the body is already complete here
+    std::unique_ptr<BodySink> sink = openUploadSink(req, server, fileIo);
 
     // 2. Process request body
     const std::string processedBody = router::handlers::HandlerUtils::processRequestBody(req);
 
-    // 3. Validate content type
-    const auto& contentTypeKey = req.getHeaders("content-type");
-    if (!router::handlers::HandlerUtils::validateContentType(contentTypeKey, "multipart/form-data")) {
-      router::handlers::HandlerUtils::setErrorResponse(res, http::BAD_REQUEST_400, req, server);
-      return;
-    }
-
-    // 4. Extract boundary
-    const std::string contentType = contentTypeKey[0];
-    const std::string boundary = router::handlers::HandlerUtils::extractBoundary(contentType);
-    if (boundary.empty()) {
-      router::handlers::HandlerUtils::setErrorResponse(res, http::BAD_REQUEST_400, req, server);
-      return;
-    }
-
-    // 5. Parse multipart data
-    const auto multipartData = router::handlers::MultipartParser::parseMultipartData(processedBody, boundary);
-    if (!multipartData.isValid) {
-      router::handlers::HandlerUtils::setErrorResponse(res, http::BAD_REQUEST_400, req, server);
-      return;
-    }
+    // 3. Parse multipart data and write the file, then respond
+    sink->write(processedBody.data(), processedBody.size());
+    sink->finish(res);
 
-    // 6. Validate filename
-    if (!router::handlers::HandlerUtils::isValidFilename(multipartData.filename)) {
-      router::handlers::HandlerUtils::setErrorResponse(res, http::BAD_REQUEST_400, req, server);
-      return;
-    }
-
-    // 7. Validate file size
-    if (!router::handlers::HandlerUtils::isValidFileSize(multipartData.content.length())) {
-      router::handlers::HandlerUtils::setErrorResponse(res, http::PAYLOAD_TOO_LARGE_413, req, server);
-      return;
-    }
-
-    // 8. Write file to disk
-    const std::string server_root = server.getRoot();
-    const std::string filePath = router::handlers::HandlerUtils::resolveFilePath(multipartData.filename, location, server_root);
+  } catch (const std::exception&) {
+    router::handlers::HandlerUtils::setErrorResponse(res, http::INTERNAL_SERVER_ERROR_500, req, server);
+  }
+}
 
-    if (!router::handlers::HandlerUtils::writeFileToDisk(filePath, multipartData.content)) {
-      router::handlers::HandlerUtils::setErrorResponse(res, http::INTERNAL_SERVER_ERROR_500, req, server);
-      return;
-    }
+/** Open the upload of a POST request whose body is still arriving; errors are answered by the sink's finish() */
+std::unique_ptr<BodySink> openUploadSink(const Request& req, const Server& server,
+                                         router::handlers::FileIoPool* fileIo) {
+  // 1. Find upload location
+  const std::string requestPath(req.getPath());
+  const Location* location = router::handlers::HandlerUtils::findUploadLocation(requestPath, server);
+  if (!location || location->upload_path.empty()) {
+    return std::make_unique<router::handlers::UploadSink>(req, server, http::FORBIDDEN_403);
+  }
 
-    // 9. Success response
-    router::handlers::HandlerUtils::setSuccessResponse(res, http::CREATED_201, req);
+  // 2. Validate content type
+  const auto& contentTypeKey = req.getHeaders("content-type");
+  if (!router::handlers::HandlerUtils::validateContentType(contentTypeKey, "multipart/form-data")) {
+    return std::make_unique<router::handlers::UploadSink>(req, server, http::BAD_REQUEST_400);
+  }
 
-  } catch (const std::exception&) {
-    router::handlers::HandlerUtils::setErrorResponse(res, http::INTERNAL_SERVER_ERROR_500, req, server);
+  // 3. Extract boundary
+  const std::string contentType = contentTypeKey[0];
+  const std::string boundary = router::handlers::HandlerUtils::extractBoundary(contentType);
+  if (boundary.empty()) {
+    return std::make_unique<router::handlers::UploadSink>(req, server, http::BAD_REQUEST_400);
   }
+
+  // 4. Parts are written to disk as they arrive, on the file I/O threads
+  return std::make_unique<router::handlers::UploadSink>(req, server, location, boundary, fileIo);
 }
 
 // ********************************************************************************************** //
@@ -201,8 +204,9 @@ void del(const Request& req, Response& res, const Server& server) {
 // ************************************** CGI HANDLER ******************************************* //
 // ********************************************************************************************** //
 
-/** Handle CGI requests for executable scripts */
-void cgi(const Request& req, Response& res, const Server& server) {
+/** Handle CGI requests for executable scripts; other files of the location are read through fileIo when given */
+void cgi(const Request& req, Response& res, const Server& server, const CgiSetup* setup,
+         router::handlers::FileIoPool* fileIo) {
   try {
     // 1. Find CGI location
     const std::string requestPath(req.getPath());
@@ -219,23 +223,58 @@ void cgi(const Request& req, Response& res, const Server& server) {
       return;
     }
 
-    // 4. File Existence and Executability Phase
+    // 4. A file that is not a script is checked and read on the file I/O threads, like any other GET
     const std::string server_root = server.getRoot();
     const std::string filePath = router::utils::StringUtils::determineFilePathCGI(filePathView, location, server_root);
+    const bool script = router::utils::isCgiScriptWithLocation(filePath, location);
+    if (!script && fileIo) {
+      res.setPending(fileIo->submit([](const Request& req, Response& res, const Server& server) {
+        cgi(req, res, server);
+      }, req, server));
+      return;
+    }
+
+    // 4.1. File Existence and Executability Phase
     if (!router::utils::isFileExistsAndExecutable(filePath, res, req, server)) {
       return;
     }
 
-     // 4. File Validation Phase
-     if (!router::utils::isCgiScriptWithLocation(filePath, location)) {
+     // 4.2. File Validation Phase
+     if (!script) {
          // Not a CGI script, handle as regular file
        std::string fileContent = router::utils::FileUtils::readFileToString(filePath);
-       std::string contentType = router::utils::FileUtils::getContentType(filePath);
+       std::string contentType(router::utils::FileUtils::getContentType(filePath, server));
        router::utils::HttpResponseBuilder::setSuccessResponse(res, fileContent, contentType, req);
        return;
      }
 
-  // 5. CGI Execution Phase
+  // 5. Answer from disk when the location sets proxy_cache
+  const router::handlers::CacheTarget* diskCache = setup ? router::handlers::findCacheTarget(&setup->diskCaches, server.getId(), location->location) : nullptr;
+  if (diskCache) {
+    router::handlers::DiskCache::Lookup diskLookup = diskCache->cache->lookup(req, res);
+    if (diskLookup == router::handlers::DiskCache::HIT) {
+      return;
+    }
+    if (diskLookup == router::handlers::DiskCache::BYPASS) {
+      diskCache = nullptr;
+    }
+  }
+
+  // 5.1. Answer from the location's cache, or join the request already running the script
+  router::handlers::CgiCache* cache = setup ? router::handlers::findCgiCache(&setup->caches, server.getId(), location->location) : nullptr;
+  std::string cacheKey;
+  router::handlers::CgiCache::Lookup lookup = router::handlers::CgiCache::MISS;
+  if (cache && cache->cacheable(req)) {
+    cacheKey = cache->key(req);
+    lookup = cache->lookup(cacheKey, req, server, res);
+    if (lookup == router::handlers::CgiCache::HIT || lookup == router::handlers::CgiCache::WAIT) {
+      return;
+    }
+  } else {
+    cache = nullptr;
+  }
+
+  // 6. CGI Execution Phase
   // READ: https://www.rfc-editor.org/rfc/rfc3875
   std::string scriptName = std::string(req.getPath());
      // Remove query string if present
@@ -244,7 +283,7 @@ void cgi(const Request& req, Response& res, const Server& server) {
          scriptName = scriptName.substr(0, queryPos);
      }
 
-  // 5.1. CGI Environment Setup
+  // 6.1. CGI Environment Setup
   auto env = router::utils::setupCgiEnvironment(req, filePath, scriptName, server);
 
   // DEBUG: Print all environment variables
@@ -255,47 +294,56 @@ void cgi(const Request& req, Response& res, const Server& server) {
   // std::cout << "=================================" << std::endl;
   // END DEBUG
 
-  // 5.2. Get and process request body for CGI input
+  // 6.2. Get and process request body for CGI input
   const std::string body = router::handlers::HandlerUtils::processRequestBody(req);
-
-     // 5.4. Execute CGI script and parse output
-     CgiResult cgiResult = executeAndParseCgiScript(filePath, env, body);
-     if (!cgiResult.success) {
-         // If CGI failed, check if it's a timeout (504) or other error
-        if (cgiResult.status.find("504") != std::string::npos) {
-            router::utils::HttpResponseBuilder::setErrorResponse(res, http::GATEWAY_TIMEOUT_504, req, server);
-            return;
-        }
+  router::handlers::HandlerUtils::addFormFieldsToEnv(env, req, body);
+
+  // 6.3. Hand the script to a pre-forked worker when the location runs a pool
+  std::string extension = std::filesystem::path(filePath).extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+  router::handlers::CgiWorkerPool* pool = setup ? router::handlers::findCgiPool(&setup->pools, server.getId(), location->location, extension) : nullptr;
+  std::shared_ptr<PendingResponse> job;
+  if (pool) {
+    job = pool->submit(filePath, env, body, req, server);
+  } else {
+    // 6.4. Use the launch plan resolved at startup, build one for routes set up without it
+    const CgiExecPlan* plan = nullptr;
+    if (setup) {
+      auto it = setup->plans.find({server.getId(), location->location, extension});
+      plan = it != setup->plans.end() ? &it->second : nullptr;
+    }
+    const CgiExecPlan fallbackPlan = plan ? CgiExecPlan() : makeCgiExecPlan(extension, std::filesystem::path(filePath).parent_path().string());
+
+    // 6.5. Launch the script, the event loop feeds it and streams its output
+    int stdinFd;
+    int stdoutFd;
+    pid_t pid = spawnCgiProcess(plan ? *plan : fallbackPlan, filePath, env, stdinFd, stdoutFd);
+    if (pid == -1) {
+      if (lookup != router::handlers::CgiCache::STALE) {
         router::utils::HttpResponseBuilder::setErrorResponse(res, http::INTERNAL_SERVER_ERROR_500, req, server);
-         return;
-     }
-
-  // 6. Set response from parsed CGI result
-  // 6.1. Set response status from CGI output
-  res.setStatus(cgiResult.status);
-
-  // 6.2. Set headers from CGI output
-  for (const auto& [headerName, headerValue] : cgiResult.headers) {
-  res.setHeaders(headerName, headerValue);
+      }
+      return;
+    }
+    // A response that goes into the cache has to be complete first
+    job = std::make_shared<router::handlers::CgiStreamJob>(pid, stdinFd, stdoutFd, body, req, server, cache == nullptr && diskCache == nullptr);
   }
 
-     // 6.3. Set default content type if not specified
-     auto contentType = res.getHeaders("Content-Type");
-     if (contentType.empty()) {
-         res.setHeaders(http::CONTENT_TYPE, http::CONTENT_TYPE_HTML);
-     }
-
-     // 6.4. Set connection header based on keep-alive logic
-     router::handlers::HandlerUtils::setConnectionHeaders(res, req);
-
-     // 6.5. Set response body
-     res.setBody(cgiResult.body);
-
-     // 6.6. Set Content-Length header based on body size
-     res.setHeaders(http::CONTENT_LENGTH, std::to_string(cgiResult.body.length()));
+  // 7. Response is built from the CGI output as it arrives
+  if (cache) {
+    job = cache->fill(cacheKey, job);
+  }
+  if (diskCache) {
+    job = diskCache->cache->fill(router::handlers::DiskCache::key(req), diskCache->ttl, job);
+  }
+  if (lookup == router::handlers::CgiCache::STALE) {
+    // res already holds the stale response, the script refreshes the cache behind it
+    res.setBackground(job);
+  } else {
+    res.setPending(job);
+  }
 
   } catch (const std::runtime_error& e) {
-     // 7. File not found or read error
+     // 8. File not found or read error
      router::utils::HttpResponseBuilder::setErrorResponse(res, http::NOT_FOUND_404, req, server);
   } catch (const std::exception& e) {
      router::utils::HttpResponseBuilder::setErrorResponse(res, http::INTERNAL_SERVER_ERROR_500, req, server);
@@ -346,4 +394,60 @@ void redirect(const Request& req, Response& res, const Server& server) {
   }
 }
 
+// ********************************************************************************************** //
+// *************************************** PROXY HANDLER **************************************** //
+// ********************************************************************************************** //
 
+/** Forward requests of a proxy_pass location to its upstream */
+void proxy(const Request& req, Response& res, const Server& server, const router::handlers::ProxyTarget& target) {
+  try {
+    // A cached location answers from disk, or buffers the response so that it can be stored
+    router::handlers::DiskCache* cache = target.cache.cache;
+    if (cache) {
+      router::handlers::DiskCache::Lookup lookup = cache->lookup(req, res);
+      if (lookup == router::handlers::DiskCache::HIT) {
+        return;
+      }
+      if (lookup == router::handlers::DiskCache::MISS) {
+        res.setPending(cache->fill(router::handlers::DiskCache::key(req), target.cache.ttl,
+                                   std::make_shared<router::handlers::ProxyJob>(target, req, server, false, false)));
+        return;
+      }
+    }
+
+    // The event loop connects, sends the request and streams the response back
+    res.setPending(std::make_shared<router::handlers::ProxyJob>(target, req, server));
+  } catch (const std::exception&) {
+    router::handlers::HandlerUtils::setErrorResponse(res, http::INTERNAL_SERVER_ERROR_500, req, server);
+  }
+}
+
+/** Forward a request whose body is still arriving, it is passed on as it comes */
+std::unique_ptr<BodySink> openProxySink(const Request& req, const Server& server, const router::handlers::ProxyTarget& target) {
+  return std::make_unique<router::handlers::ProxySink>(
+    std::make_shared<router::handlers::ProxyJob>(target, req, server, true));
+}
+
+// ********************************************************************************************** //
+// *************************************** STATUS HANDLER *************************************** //
+// ********************************************************************************************** //
+
+/** Answer a stub_status location with the server's counters, in Prometheus format under <location>/prometheus */
+void stubStatus(const Request& req, Response& res, const Server& server, const router::handlers::StatusReport& report) {
+  try {
+    static const std::string_view prometheus = "/prometheus";
+    std::string_view path = req.getPath();
+    path = path.substr(0, path.find('?'));
+    if (path.size() > prometheus.size() && path.substr(path.size() - prometheus.size()) == prometheus) {
+      router::utils::HttpResponseBuilder::setSuccessResponse(res, router::handlers::renderStatusPrometheus(report),
+                                                             "text/plain; version=0.0.4", req);
+    } else {
+      router::utils::HttpResponseBuilder::setSuccessResponse(res, router::handlers::renderStatusText(report),
+                                                             http::CONTENT_TYPE_TEXT, req);
+    }
+    // Counters are read live, never from a cache
+    res.setHeaders("Cache-Control", "no-store");
+  } catch (const std::exception&) {
+    router::handlers::HandlerUtils::setErrorResponse(res, http::INTERNAL_SERVER_ERROR_500, req, server);
+  }
+}
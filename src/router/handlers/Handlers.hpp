@@ -7,27 +7,70 @@
 
 #include <string> // for std::string
 #include <vector> // for std::vector
+#include <memory> // for std::unique_ptr
 
 #include "../../request/Request.hpp"
 #include "../../response/Response.hpp"
+#include "../../request/BodySink.hpp"
+#include "CgiExecutor.hpp"
+#include "CgiWorkerPool.hpp"
+#include "CgiStream.hpp"
+#include "CgiCache.hpp"
+#include "DiskCache.hpp"
+#include "Proxy.hpp"
+#include "HealthCheck.hpp"
+#include "Status.hpp"
 
 // Forward declarations
 struct Location;
 class Server;
+namespace router::handlers {
+class FileIoPool;
+}
+
+/** CGI launch state and caches prepared once per location by Router::setupRouter */
+struct CgiSetup {
+  CgiExecPlanMap plans;
+  router::handlers::CgiPoolMap pools;
+  router::handlers::CgiCacheMap caches;
+  router::handlers::CacheTargetMap diskCaches;
+};
+
+/** Upstream pools, groups and targets prepared once per proxy_pass location by Router::setupRouter */
+struct ProxySetup {
+  router::handlers::UpstreamPoolMap pools;
+  router::handlers::UpstreamGroupMap groups;
+  router::handlers::ProxyTargetMap targets;
+};
 
 /** Core HTTP Request Handler Functions */
 
-/** Handle GET requests for static files and pages */
-void get(const Request& req, Response& res, const Server& server);
+/** Handle GET requests for static files and pages; paged directory listings stream through fileIo when given */
+void get(const Request& req, Response& res, const Server& server, router::handlers::FileIoPool* fileIo = nullptr);
+
+/** Handle POST requests for file uploads; the files are written through fileIo when given */
+void post(const Request& req, Response& res, const Server& server, router::handlers::FileIoPool* fileIo = nullptr);
 
-/** Handle POST requests for file uploads */
-void post(const Request& req, Response& res, const Server& server);
+/** Open the upload of a POST request whose body is still arriving; errors are answered by the sink's finish() */
+std::unique_ptr<BodySink> openUploadSink(const Request& req, const Server& server,
+                                         router::handlers::FileIoPool* fileIo = nullptr);
 
 /** Handle DELETE requests for file removal */
 void del(const Request& req, Response& res, const Server& server);
 
-/** Handle CGI requests for executable scripts */
-void cgi(const Request& req, Response& res, const Server& server);
+/** Handle CGI requests for executable scripts, through a worker pool when one is configured; other files of
+ *  the location are read through fileIo when given */
+void cgi(const Request& req, Response& res, const Server& server, const CgiSetup* setup = nullptr,
+         router::handlers::FileIoPool* fileIo = nullptr);
 
 /** Handle HTTP redirection requests */
 void redirect(const Request& req, Response& res, const Server& server);
+
+/** Forward requests of a proxy_pass location to its upstream */
+void proxy(const Request& req, Response& res, const Server& server, const router::handlers::ProxyTarget& target);
+
+/** Forward a request whose body is still arriving, it is passed on as it comes */
+std::unique_ptr<BodySink> openProxySink(const Request& req, const Server& server, const router::handlers::ProxyTarget& target);
+
+/** Answer a stub_status location with the server's counters, in Prometheus format under <location>/prometheus */
+void stubStatus(const Request& req, Response& res, const Server& server, const router::handlers::StatusReport& report);
@@ -0,0 +1,145 @@
+/**
+ * @file HealthCheck.cpp
+ * @brief Active health probes of upstream backends implementation
+ */
+
+#include "HealthCheck.hpp"
+
+#include <unistd.h> // for close
+#include <sys/socket.h> // for send, recv, getsockopt
+#include <poll.h> // for POLLIN, POLLOUT
+#include <cerrno> // for errno, EAGAIN
+
+namespace router::handlers {
+
+HealthProbe::HealthProbe(UpstreamGroup& group, UpstreamGroup::Backend& backend)
+  : _group(&group), _backend(&backend), _start(std::chrono::steady_clock::now()) {
+  _backend->probing = true;
+  _out = "GET " + group.healthCheck().path + " HTTP/1.1\r\n"
+         "host: " + backend.name + "\r\n"
+         "connection: close\r\n"
+         "user-agent: webserv-health-check\r\n\r\n";
+  _fd = backend.pool->open();
+  if (_fd == -1) {
+    result(false);
+  }
+}
+
+HealthProbe::~HealthProbe() {
+  if (_state != DONE) {
+    result(false);
+  }
+}
+
+int HealthProbe::fd() const {
+  return _state == DONE ? -1 : _fd;
+}
+
+short HealthProbe::events() const {
+  return _state == READING ? POLLIN : POLLOUT;
+}
+
+void HealthProbe::onEvent(short revents) {
+  if (_state == CONNECTING) {
+    int error = 0;
+    socklen_t size = sizeof(error);
+    if (getsockopt(_fd, SOL_SOCKET, SO_ERROR, &error, &size) < 0 || error != 0) {
+      result(false);
+      return;
+    }
+    if (!(revents & (POLLOUT | POLLERR | POLLHUP))) {
+      return;
+    }
+    _state = WRITING;
+  }
+
+  if (_state == WRITING) {
+    ssize_t sent = send(_fd, _out.data(), _out.size(), MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        result(false);
+      }
+      return;
+    }
+    _out.erase(0, sent);
+    if (_out.empty()) {
+      _state = READING;
+    }
+    return;
+  }
+
+  if (_state != READING) {
+    return;
+  }
+  char buffer[512];
+  ssize_t bytesRead = recv(_fd, buffer, sizeof(buffer), 0);
+  if (bytesRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    return;
+  }
+  if (bytesRead <= 0) {
+    result(false);
+    return;
+  }
+  _in.append(buffer, bytesRead);
+  size_t lineEnd = _in.find("\r\n");
+  if (lineEnd == std::string::npos) {
+    if (_in.size() > sizeof(buffer)) {
+      result(false);
+    }
+    return;
+  }
+
+  // HTTP/1.x SP status SP reason: only the status matters
+  const std::string statusLine = _in.substr(0, lineEnd);
+  bool ok = statusLine.size() >= 12 && statusLine.compare(0, 7, "HTTP/1.") == 0 && statusLine[8] == ' '
+            && statusLine.compare(9, 3, std::to_string(_group->healthCheck().status)) == 0;
+  result(ok);
+}
+
+bool HealthProbe::done() const {
+  return _state == DONE;
+}
+
+/** Nobody reads a probe's response, its result went to the group already */
+void HealthProbe::finish(Response& res) {
+  (void)res;
+}
+
+void HealthProbe::abort(bool timedOut) {
+  (void)timedOut;
+  if (_state != DONE) {
+    result(false);
+  }
+}
+
+bool HealthProbe::expired(long long elapsedMs) const {
+  return elapsedMs > _group->healthCheck().timeout.count();
+}
+
+/** Close the connection and report the outcome */
+void HealthProbe::result(bool ok) {
+  if (_fd != -1) {
+    close(_fd);
+    _fd = -1;
+  }
+  _state = DONE;
+  auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _start);
+  _group->probed(_backend, ok, latency);
+}
+
+/** Start a probe for each backend of the group whose interval elapsed */
+void startDueProbes(UpstreamGroup& group, std::chrono::steady_clock::time_point now,
+                    std::vector<std::shared_ptr<PendingResponse>>& probes) {
+  if (group.healthCheck().path.empty()) {
+    return;
+  }
+  for (UpstreamGroup::Backend& backend : group.backends()) {
+    if (backend.probing || now < backend.nextProbe) {
+      continue;
+    }
+    backend.nextProbe = now + group.healthCheck().interval;
+    probes.push_back(std::make_shared<HealthProbe>(group, backend));
+  }
+}
+
+} // namespace router::handlers
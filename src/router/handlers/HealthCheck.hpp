@@ -0,0 +1,61 @@
+/**
+ * @file HealthCheck.hpp
+ * @brief Active health probes of upstream backends, run by the event loop
+ */
+
+#pragma once
+
+#include <string> // for std::string
+#include <vector> // for std::vector
+#include <memory> // for std::shared_ptr
+#include <chrono> // for std::chrono::steady_clock
+
+#include "../../response/PendingResponse.hpp"
+#include "Upstream.hpp"
+
+namespace router::handlers {
+
+/**
+ * @brief One GET of a backend's health check path on a connection of its own
+ *
+ * Runs as a background job: nobody waits for its response. It passes when the
+ * status line carries the expected status within the check's timeout, and
+ * reports to its group as soon as the status line is read or the attempt
+ * fails, with the time it took.
+ */
+class HealthProbe : public PendingResponse {
+public:
+  HealthProbe(UpstreamGroup& group, UpstreamGroup::Backend& backend);
+  ~HealthProbe() override;
+
+  HealthProbe(const HealthProbe&) = delete;
+  HealthProbe& operator=(const HealthProbe&) = delete;
+
+  int fd() const override;
+  short events() const override;
+  void onEvent(short revents) override;
+  bool done() const override;
+  void finish(Response& res) override;
+  void abort(bool timedOut) override;
+  bool expired(long long elapsedMs) const override;
+
+private:
+  enum State { CONNECTING, WRITING, READING, DONE };
+
+  /** Close the connection and report the outcome */
+  void result(bool ok);
+
+  UpstreamGroup* _group;
+  UpstreamGroup::Backend* _backend;
+  int _fd = -1;
+  State _state = CONNECTING;
+  std::string _out;             // request bytes not yet sent
+  std::string _in;              // response until its status line is complete
+  std::chrono::steady_clock::time_point _start;
+};
+
+/** Start a probe for each backend of the group whose interval elapsed */
+void startDueProbes(UpstreamGroup& group, std::chrono::steady_clock::time_point now,
+                    std::vector<std::shared_ptr<PendingResponse>>& probes);
+
+} // namespace router::handlers
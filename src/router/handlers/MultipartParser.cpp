@@ -1,71 +1,193 @@
 #include "MultipartParser.hpp"
+#include "../../../inc/webserv.hpp"
 
-namespace router::handlers {
+#include <algorithm> // for std::transform, std::fill
+#include <cctype> // for std::tolower
 
-MultipartData MultipartParser::parseMultipartData(const std::string& body, const std::string& boundary) {
-  MultipartData result;
+namespace router::handlers {
 
-  // Find file boundaries
-  const size_t fileStart = body.find(boundary);
-  if (fileStart == std::string::npos) {
-    return result; // isValid remains false
+MultipartParser::MultipartParser(const std::string& boundary, PartBegin onBegin, PartData onData, PartEnd onEnd)
+  : _delimiter("\r\n" + boundary), _onBegin(std::move(onBegin)), _onData(std::move(onData)), _onEnd(std::move(onEnd)) {
+  const size_t length = _delimiter.size();
+  std::fill(_skip, _skip + 256, length);
+  for (size_t i = 0; i + 1 < length; ++i) {
+    _skip[static_cast<unsigned char>(_delimiter[i])] = length - 1 - i;
   }
 
-  const size_t fileEnd = body.find(boundary, fileStart + boundary.length());
-  const std::string filePart = body.substr(fileStart, fileEnd - fileStart);
+  // The first delimiter may open the body, without the CRLF of the others
+  _buffer = "\r\n";
+}
 
-  // Extract filename
-  result.filename = extractFilename(filePart);
-  if (result.filename.empty()) {
-    return result; // isValid remains false
+bool MultipartParser::feed(const char* data, size_t size) {
+  if (_state == FAILED) {
+    return false;
   }
-
-  // Extract file content
-  result.content = extractFileContent(filePart);
-  if (result.content.empty()) {
-    return result; // isValid remains false
+  if (_state == EPILOGUE) {
+    return true;
   }
+  _buffer.append(data, size);
+
+  while (true) {
+    if (_state == PREAMBLE || _state == BODY) {
+      size_t pos = findDelimiter();
+      if (pos == std::string::npos) {
+        // The tail may be the start of a delimiter split across reads
+        size_t keep = std::min(_buffer.size(), _delimiter.size() - 1);
+        size_t ready = _buffer.size() - keep;
+        if (_state == BODY && ready > 0 && !_onData(_buffer.data(), ready)) {
+          _state = FAILED;
+          return false;
+        }
+        _buffer.erase(0, ready);
+        return true;
+      }
+      if (_state == BODY && ((pos > 0 && !_onData(_buffer.data(), pos)) || !_onEnd())) {
+        _state = FAILED;
+        return false;
+      }
+      _buffer.erase(0, pos + _delimiter.size());
+      _state = DELIMITER;
+    }
+
+    if (_state == DELIMITER) {
+      // "--" closes the body, otherwise optional padding and CRLF open the next part
+      if (_buffer.size() < 2) {
+        return true;
+      }
+      if (_buffer.compare(0, 2, "--") == 0) {
+        _buffer.clear();
+        _state = EPILOGUE;
+        return true;
+      }
+      size_t lineEnd = _buffer.find("\r\n");
+      if (lineEnd == std::string::npos) {
+        size_t padEnd = _buffer.find_first_not_of(" \t");
+        if ((padEnd != std::string::npos && padEnd != _buffer.size() - 1) || _buffer.back() != '\r' || _buffer.size() > MAX_HEADER_SIZE) {
+          _state = FAILED;
+          return false;
+        }
+        return true;
+      }
+      if (_buffer.find_first_not_of(" \t") != lineEnd) {
+        _state = FAILED;
+        return false;
+      }
+      _buffer.erase(0, lineEnd + 2);
+      _state = HEADERS;
+    }
+
+    if (_state == HEADERS) {
+      size_t headerEnd = _buffer.compare(0, 2, "\r\n") == 0 ? 0 : _buffer.find("\r\n\r\n");
+      if (headerEnd == std::string::npos) {
+        if (_buffer.size() > MAX_HEADER_SIZE) {
+          _state = FAILED;
+          return false;
+        }
+        return true;
+      }
+      Part part;
+      if (!parseHeaders(_buffer.substr(0, headerEnd), part) || !_onBegin(part)) {
+        _state = FAILED;
+        return false;
+      }
+      _buffer.erase(0, headerEnd == 0 ? 2 : headerEnd + 4);
+      _state = BODY;
+    }
+  }
+}
 
-  // Clean the content
-  result.content = cleanFileContent(result.content);
-  result.isValid = true;
-
-  return result;
+bool MultipartParser::complete() const {
+  return _state == EPILOGUE;
 }
 
-std::string MultipartParser::extractFilename(const std::string& filePart) {
-  const size_t filenamePos = filePart.find("filename=\"");
-  if (filenamePos == std::string::npos) {
-    return "";
-  }
+bool MultipartParser::failed() const {
+  return _state == FAILED;
+}
 
-  // filename=\" -> 10
-  const size_t filenameEnd = filePart.find("\"", filenamePos + 10);
-  if (filenameEnd == std::string::npos) {
-    return "";
+/** Position of the next delimiter in the buffer, npos when there is none */
+size_t MultipartParser::findDelimiter() const {
+  const size_t length = _delimiter.size();
+  const size_t size = _buffer.size();
+  const char* text = _buffer.data();
+
+  size_t pos = 0;
+  while (pos + length <= size) {
+    size_t i = length - 1;
+    while (text[pos + i] == _delimiter[i]) {
+      if (i == 0) {
+        return pos;
+      }
+      --i;
+    }
+    pos += _skip[static_cast<unsigned char>(text[pos + length - 1])];
   }
-
-  return filePart.substr(filenamePos + 10, filenameEnd - filenamePos - 10);
+  return std::string::npos;
 }
 
-std::string MultipartParser::extractFileContent(const std::string& filePart) {
-  const size_t contentStart = filePart.find("\r\n\r\n");
-  if (contentStart == std::string::npos) {
-    return "";
+/** Parse a part's header block */
+bool MultipartParser::parseHeaders(const std::string& block, Part& part) {
+  size_t pos = 0;
+  while (pos < block.size()) {
+    size_t lineEnd = block.find("\r\n", pos);
+    if (lineEnd == std::string::npos) {
+      lineEnd = block.size();
+    }
+    std::string line = block.substr(pos, lineEnd - pos);
+    pos = lineEnd + 2;
+
+    size_t colon = line.find(':');
+    if (colon == std::string::npos) {
+      return false;
+    }
+    std::string name = line.substr(0, colon);
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    std::string value = line.substr(colon + 1);
+    value.erase(0, value.find_first_not_of(" \t"));
+
+    if (name == "content-disposition") {
+      part.name = dispositionParam(value, "name");
+      part.filename = dispositionParam(value, "filename");
+    } else if (name == "content-type") {
+      part.contentType = value;
+    }
   }
-
-  return filePart.substr(contentStart + 4);
+  return true;
 }
 
-std::string MultipartParser::cleanFileContent(const std::string& content) {
-  std::string cleaned = content;
-
-  // Remove trailing \r\n if present
-  if (cleaned.length() >= 2 && cleaned.substr(cleaned.length() - 2) == "\r\n") {
-    cleaned = cleaned.substr(0, cleaned.length() - 2);
+/** Value of a Content-Disposition parameter, empty when missing */
+std::string MultipartParser::dispositionParam(const std::string& value, const std::string& name) {
+  size_t pos = value.find(';');
+  while (pos != std::string::npos) {
+    size_t start = value.find_first_not_of(" \t", pos + 1);
+    if (start == std::string::npos) {
+      break;
+    }
+    size_t eq = value.find('=', start);
+    if (eq == std::string::npos) {
+      break;
+    }
+    std::string key = value.substr(start, eq - start);
+    key.erase(key.find_last_not_of(" \t") + 1);
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+
+    std::string param;
+    if (eq + 1 < value.size() && value[eq + 1] == '"') {
+      size_t close = value.find('"', eq + 2);
+      if (close == std::string::npos) {
+        break;
+      }
+      param = value.substr(eq + 2, close - eq - 2);
+      pos = value.find(';', close);
+    } else {
+      pos = value.find(';', eq);
+      param = value.substr(eq + 1, pos == std::string::npos ? std::string::npos : pos - eq - 1);
+      param.erase(param.find_last_not_of(" \t") + 1);
+    }
+    if (key == name) {
+      return param;
+    }
   }
-
-  return cleaned;
+  return "";
 }
 
 } // namespace router::handlers
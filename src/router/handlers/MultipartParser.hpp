@@ -1,53 +1,74 @@
 #pragma once
 
 #include <string>
-#include <vector>
+#include <functional>
 
 namespace router::handlers {
 
 /**
- * @brief Structure to hold parsed multipart data
- */
-struct MultipartData {
-  std::string filename;
-  std::string content;
-  bool isValid = false;
-};
-
-/**
- * @brief Multipart form data parser
+ * @brief Incremental multipart/form-data parser
+ *
+ * Fed the body in pieces of any size. Part data is passed on as soon as it is
+ * known not to belong to a delimiter, so at most one delimiter length of it is
+ * held back between calls. Delimiters are found with Boyer-Moore-Horspool.
  */
 class MultipartParser {
 public:
   /**
-   * @brief Parse multipart form data from request body
-   * @param body The request body containing multipart data
-   * @param boundary The boundary string for multipart data
-   * @return Parsed multipart data
+   * @brief Headers of one part
    */
-  static MultipartData parseMultipartData(const std::string& body, const std::string& boundary);
+  struct Part {
+    std::string name;         // Content-Disposition name
+    std::string filename;     // Content-Disposition filename, empty for form fields
+    std::string contentType;
+  };
 
-private:
-  /**
-   * @brief Extract filename from multipart part
-   * @param filePart The multipart part containing file data
-   * @return Extracted filename or empty string if not found
-   */
-  static std::string extractFilename(const std::string& filePart);
+  /** Called with the headers of each part; returning false stops the parser */
+  using PartBegin = std::function<bool(const Part& part)>;
+
+  /** Called with the data of the current part, in pieces; returning false stops the parser */
+  using PartData = std::function<bool(const char* data, size_t size)>;
+
+  /** Called once the current part is complete; returning false stops the parser */
+  using PartEnd = std::function<bool()>;
 
   /**
-   * @brief Extract file content from multipart part
-   * @param filePart The multipart part containing file data
-   * @return Extracted file content or empty string if not found
+   * @brief Create a parser
+   * @param boundary The boundary with its leading "--", as returned by HandlerUtils::extractBoundary
    */
-  static std::string extractFileContent(const std::string& filePart);
+  MultipartParser(const std::string& boundary, PartBegin onBegin, PartData onData, PartEnd onEnd);
 
   /**
-   * @brief Clean file content by removing trailing CRLF
-   * @param content The file content to clean
-   * @return Cleaned file content
+   * @brief Parse the next body bytes
+   * @return false once the body is malformed or a callback stopped the parser
    */
-  static std::string cleanFileContent(const std::string& content);
+  bool feed(const char* data, size_t size);
+
+  /** True once the closing delimiter was seen */
+  bool complete() const;
+
+  /** True once the body is malformed or a callback stopped the parser */
+  bool failed() const;
+
+private:
+  enum State { PREAMBLE, DELIMITER, HEADERS, BODY, EPILOGUE, FAILED };
+
+  /** Position of the next delimiter in the buffer, npos when there is none */
+  size_t findDelimiter() const;
+
+  /** Parse a part's header block */
+  static bool parseHeaders(const std::string& block, Part& part);
+
+  /** Value of a Content-Disposition parameter, empty when missing */
+  static std::string dispositionParam(const std::string& value, const std::string& name);
+
+  std::string _delimiter;   // CRLF + boundary
+  size_t _skip[256];        // Horspool shift per last byte of the window
+  std::string _buffer;      // bytes not parsed yet
+  State _state = PREAMBLE;
+  PartBegin _onBegin;
+  PartData _onData;
+  PartEnd _onEnd;
 };
 
 } // namespace router::handlers
@@ -0,0 +1,636 @@
+/**
+ * @file Proxy.cpp
+ * @brief Requests forwarded to upstream HTTP/1.1 servers implementation
+ */
+
+#include "Proxy.hpp"
+#include "HandlerUtils.hpp"
+#include "../utils/HttpResponseBuilder.hpp"
+#include "../utils/StringUtils.hpp"
+#include "../HttpConstants.hpp"
+#include "../../../inc/webserv.hpp"
+#include "../../server/Server.hpp"
+
+#include <unistd.h> // for close
+#include <sys/socket.h> // for send, recv, getsockopt
+#include <poll.h> // for poll, POLLIN, POLLOUT
+#include <strings.h> // for strcasecmp
+#include <cerrno> // for errno, EAGAIN
+#include <cstdint> // for SIZE_MAX
+#include <algorithm> // for std::transform, std::min
+#include <set> // for std::set
+#include <sstream> // for std::ostringstream
+
+namespace router::handlers {
+
+namespace {
+
+/** Request headers that describe the client connection, not the request */
+const std::set<std::string> HOP_BY_HOP_REQUEST = {
+  "connection", "keep-alive", "proxy-connection", "te", "trailer", "transfer-encoding", "upgrade",
+  "expect", "content-length", "http2-settings",
+};
+
+/** Response headers replaced by this server's own */
+const char* const DROPPED_RESPONSE[] = {
+  "connection", "keep-alive", "proxy-connection", "te", "trailer", "transfer-encoding", "upgrade",
+  "content-length", "date", "server",
+};
+
+bool isDroppedResponseHeader(const std::string& name) {
+  for (const char* dropped : DROPPED_RESPONSE) {
+    if (strcasecmp(name.c_str(), dropped) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string trim(const std::string& str) {
+  size_t start = str.find_first_not_of(" \t");
+  if (start == std::string::npos) {
+    return "";
+  }
+  size_t end = str.find_last_not_of(" \t");
+  return str.substr(start, end - start + 1);
+}
+
+/** Lowercase tokens of a comma separated header value */
+std::set<std::string> headerTokens(const std::string& value) {
+  std::set<std::string> tokens;
+  std::istringstream iss(value);
+  std::string token;
+  while (std::getline(iss, token, ',')) {
+    token = trim(token);
+    std::transform(token.begin(), token.end(), token.begin(), ::tolower);
+    if (!token.empty()) {
+      tokens.insert(token);
+    }
+  }
+  return tokens;
+}
+
+/** Path sent upstream: the location prefix replaced by the URL's path when it has one */
+std::string upstreamTarget(const ProxyTarget& target, const Request& req) {
+  std::string path = router::utils::StringUtils::normalizePath(std::string(req.getPath()));
+  if (target.uri.empty() || target.location.empty() || target.location[0] != '/'
+      || path.compare(0, target.location.size(), target.location) != 0) {
+    return path;
+  }
+  std::string rest = path.substr(target.location.size());
+  if (target.uri.back() == '/' && !rest.empty() && rest[0] == '/') {
+    rest.erase(0, 1);
+  }
+  return target.uri + rest;
+}
+
+} // namespace
+
+// ========================= PROXY URL =========================
+
+/** Split a proxy_pass URL */
+bool parseProxyUrl(const std::string& url, std::string& host, int& port, std::string& uri) {
+  const std::string scheme = "http://";
+  if (url.compare(0, scheme.size(), scheme) != 0) {
+    return false;
+  }
+  size_t slash = url.find('/', scheme.size());
+  std::string authority = url.substr(scheme.size(), slash == std::string::npos ? std::string::npos : slash - scheme.size());
+  uri = slash == std::string::npos ? "" : url.substr(slash);
+
+  size_t colon = authority.find(':');
+  host = authority.substr(0, colon);
+  port = 80;
+  if (colon != std::string::npos) {
+    std::string digits = authority.substr(colon + 1);
+    if (digits.empty() || digits.size() > 5 || digits.find_first_not_of("0123456789") != std::string::npos) {
+      return false;
+    }
+    port = std::stoi(digits);
+  }
+  return !host.empty() && port >= 1 && port <= 65535;
+}
+
+// ========================= PROXY JOB =========================
+
+ProxyJob::ProxyJob(const ProxyTarget& target, const Request& req, const Server& server, bool bodyFollows, bool stream)
+  : _target(&target), _replayable(!bodyFollows), _bodyOpen(bodyFollows), _req(req), _server(&server) {
+  // Without chunked encoding the end of the body can only be told by its length
+  if (!stream || _req.getHttpVersion() != "HTTP/1.1") {
+    _mode = BUFFERED;
+  }
+
+  // Request line and the end-to-end headers of the client
+  std::string method(req.getMethod());
+  _head = method + " " + upstreamTarget(target, req) + " HTTP/1.1\r\n";
+  std::set<std::string> listed;
+  for (const std::string& value : req.getHeaders("connection")) {
+    std::set<std::string> tokens = headerTokens(value);
+    listed.insert(tokens.begin(), tokens.end());
+  }
+  for (const auto& [name, values] : req.getAllHeaders()) {
+    if (HOP_BY_HOP_REQUEST.count(name) || listed.count(name)) {
+      continue;
+    }
+    for (const std::string& value : values) {
+      _head.append(name).append(": ").append(value).append("\r\n");
+    }
+  }
+  if (req.getHeaders("host").empty()) {
+    _head.append("host: ").append(target.host).append("\r\n");
+  }
+
+  // Body framing: the client's length when it gave one, chunks for a body of unknown length
+  const std::vector<std::string>& length = req.getHeaders("content-length");
+  if (bodyFollows && length.size() != 1) {
+    _chunkedBody = true;
+    _head.append("transfer-encoding: chunked\r\n\r\n");
+  } else if (bodyFollows) {
+    _head.append("content-length: ").append(length[0]).append("\r\n\r\n");
+  } else {
+    std::string_view body = req.getBody();
+    if (!body.empty() || method == http::POST) {
+      _head.append("content-length: ").append(std::to_string(body.size())).append("\r\n");
+    }
+    _head.append("\r\n").append(body);
+  }
+
+  // The body already travels in _head
+  _req.setBody("");
+  pickBackend();
+}
+
+ProxyJob::~ProxyJob() {
+  closeUpstream(false);
+  returnBackend();   // dropped half way, the client went away: no verdict on the backend
+}
+
+int ProxyJob::fd() const {
+  return _state == DONE ? -1 : _fd;
+}
+
+short ProxyJob::events() const {
+  return _state == READING ? POLLIN : POLLOUT;
+}
+
+void ProxyJob::onEvent(short revents) {
+  if (_state == CONNECTING) {
+    int error = 0;
+    socklen_t size = sizeof(error);
+    if (getsockopt(_fd, SOL_SOCKET, SO_ERROR, &error, &size) < 0 || error != 0) {
+      backendFailed();
+      return;
+    }
+    if (!(revents & (POLLOUT | POLLERR | POLLHUP))) {
+      return;
+    }
+    _state = WRITING;
+    _since = std::chrono::steady_clock::now();
+  }
+
+  if (_state == WRITING) {
+    flush();
+    return;
+  }
+
+  if (_state != READING) {
+    return;
+  }
+
+  // One read per event keeps the response held in memory bounded
+  char buffer[16384];
+  ssize_t bytesRead = recv(_fd, buffer, sizeof(buffer), 0);
+  if (bytesRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    return;
+  }
+  if (bytesRead <= 0) {
+    if (_headDone && _framing == UNTIL_CLOSE) {
+      complete(false);
+    } else {
+      upstreamLost();
+    }
+    return;
+  }
+  _received = true;
+  _since = std::chrono::steady_clock::now();
+  if (_headDone) {
+    readBody(buffer, bytesRead);
+  } else {
+    consume(buffer, bytesRead);
+  }
+}
+
+bool ProxyJob::done() const {
+  return _state == DONE;
+}
+
+void ProxyJob::finish(Response& res) {
+  if (_errorStatus) {
+    router::utils::HttpResponseBuilder::setErrorResponse(res, _errorStatus, _req, *_server);
+    return;
+  }
+
+  res.setStatus(_status);
+  for (const Response::Header& header : _headers) {
+    res.setHeaders(header.name, header.value);
+  }
+  if (streaming()) {
+    // Head only, the body follows through takeBody()
+    if (_mode == RAW) {
+      res.setHeaders(http::CONTENT_LENGTH, _contentLength);
+    } else {
+      res.setHeaders(http::TRANSFER_ENCODING, http::TRANSFER_ENCODING_CHUNKED);
+    }
+  } else if (_framing == EMPTY) {
+    if (!_contentLength.empty()) {
+      res.setHeaders(http::CONTENT_LENGTH, _contentLength);
+    }
+  } else {
+    res.setBody(_body);
+    res.setHeaders(http::CONTENT_LENGTH, std::to_string(_body.size()));
+  }
+  HandlerUtils::setConnectionHeaders(res, _req);
+}
+
+void ProxyJob::abort(bool timedOut) {
+  if (_state == DONE) {
+    return;
+  }
+  // A timeout is the backend's doing, the client going away is not
+  fail(timedOut ? http::GATEWAY_TIMEOUT_504 : http::BAD_GATEWAY_502, timedOut);
+}
+
+bool ProxyJob::streaming() const {
+  return _headDone && (_mode == CHUNKED || _mode == RAW);
+}
+
+bool ProxyJob::takeBody(std::string& out) {
+  out.append(_outBody);
+  _outBody.clear();
+  return !_broken;
+}
+
+/** Each phase has its own timeout, counted from the job's last progress */
+bool ProxyJob::expired(long long elapsedMs) const {
+  (void)elapsedMs;
+  if (_state == DONE) {
+    return false;
+  }
+  size_t timeout = _state == CONNECTING ? _target->connectTimeout
+                 : _state == WRITING ? _target->sendTimeout
+                 : _target->readTimeout;
+  return std::chrono::steady_clock::now() - _since > std::chrono::milliseconds(timeout);
+}
+
+/** Next piece of a request body that follows the head */
+void ProxyJob::sendBody(const char* data, size_t size) {
+  if (_state == DONE || size == 0) {
+    return;
+  }
+  if (_chunkedBody) {
+    std::ostringstream chunkSize;
+    chunkSize << std::hex << size << "\r\n";
+    _out.append(chunkSize.str());
+    _out.append(data, size);
+    _out.append("\r\n");
+  } else {
+    _out.append(data, size);
+  }
+  if (_out.size() - _sent > MAX_BUFFER_SIZE) {
+    // The upstream takes the body slower than the client sends it
+    fail(http::BAD_GATEWAY_502, false);
+    return;
+  }
+
+  // The event loop polls the job only once the body is complete, so a connect is checked here
+  if (_state == CONNECTING) {
+    pollfd connecting = {_fd, POLLOUT, 0};
+    if (poll(&connecting, 1, 0) > 0) {
+      onEvent(connecting.revents);
+    }
+    return;
+  }
+  if (_state == WRITING) {
+    flush();
+  }
+}
+
+/** Request body complete */
+void ProxyJob::endBody() {
+  if (!_bodyOpen) {
+    return;
+  }
+  _bodyOpen = false;
+  if (_state == DONE) {
+    return;
+  }
+  if (_chunkedBody) {
+    _out.append("0\r\n\r\n");
+  }
+  if (_state == WRITING) {
+    flush();
+  }
+}
+
+/** Pick a backend and start on it, 502 when none is left */
+void ProxyJob::pickBackend() {
+  _backend = _target->group->pick(_req, _tried);
+  if (!_backend) {
+    fail(http::BAD_GATEWAY_502);
+    return;
+  }
+  _retried = false;
+  start(false);
+}
+
+/** Get a connection and queue the request on it; a retry always opens a new one */
+void ProxyJob::start(bool fresh) {
+  _fd = fresh ? -1 : _backend->pool->acquire();
+  _reused = _fd != -1;
+  if (!_reused) {
+    _fd = _backend->pool->open();
+  }
+  _since = std::chrono::steady_clock::now();
+  if (_fd == -1) {
+    backendFailed();
+    return;
+  }
+  _out = _head;
+  _sent = 0;
+  _state = _reused ? WRITING : CONNECTING;
+}
+
+/** Backend unreachable: count the failure and move on to another one when the request allows */
+void ProxyJob::backendFailed() {
+  closeUpstream(false);
+  const UpstreamGroup::Backend* failed = _backend;
+  releaseBackend(false);
+  if (!_replayable || _received) {
+    fail(http::BAD_GATEWAY_502);
+    return;
+  }
+  _tried.push_back(failed);
+  pickBackend();
+}
+
+/** Report the outcome and hand the backend back to its group, once */
+void ProxyJob::releaseBackend(bool ok) {
+  if (_backend) {
+    _target->group->report(_backend, ok);
+  }
+  returnBackend();
+}
+
+/** Hand the backend back to its group without a verdict on it */
+void ProxyJob::returnBackend() {
+  if (_backend) {
+    _target->group->release(_backend);
+    _backend = nullptr;
+  }
+}
+
+/** Write what is queued for the upstream */
+void ProxyJob::flush() {
+  while (_sent < _out.size()) {
+    ssize_t sent = send(_fd, _out.data() + _sent, _out.size() - _sent, MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        upstreamLost();
+      }
+      return;
+    }
+    _sent += sent;
+    _since = std::chrono::steady_clock::now();
+  }
+  _out.clear();
+  _sent = 0;
+  if (!_bodyOpen) {
+    _state = READING;
+  }
+}
+
+/** Parse the response head once it is complete; interim 1xx heads are skipped */
+void ProxyJob::consume(const char* data, size_t size) {
+  _in.append(data, size);
+  while (!_headDone) {
+    size_t headerEnd = _in.find("\r\n\r\n");
+    if (headerEnd == std::string::npos) {
+      if (_in.size() > MAX_HEADER_SIZE) {
+        fail(http::BAD_GATEWAY_502);
+      }
+      return;
+    }
+    std::string head = _in.substr(0, headerEnd);
+    _in.erase(0, headerEnd + 4);
+    if (!parseHead(head)) {
+      fail(http::BAD_GATEWAY_502);
+      return;
+    }
+  }
+
+  std::string body;
+  body.swap(_in);
+  if (_framing == EMPTY) {
+    complete(_keepAlive && body.empty());
+    return;
+  }
+  if (_framing == LENGTH && _remaining == 0) {
+    complete(_keepAlive && body.empty());
+    return;
+  }
+  if (!body.empty()) {
+    readBody(body.data(), body.size());
+  }
+}
+
+/** Status line and headers of a response head, false when malformed */
+bool ProxyJob::parseHead(const std::string& head) {
+  size_t lineEnd = head.find("\r\n");
+  std::string statusLine = head.substr(0, lineEnd);
+  if (statusLine.size() < 12 || statusLine.compare(0, 7, "HTTP/1.") != 0 || statusLine[8] != ' ') {
+    return false;
+  }
+  std::string code = statusLine.substr(9, 3);
+  if (code.find_first_not_of("0123456789") != std::string::npos || (statusLine.size() > 12 && statusLine[12] != ' ')) {
+    return false;
+  }
+  int status = std::stoi(code);
+  if (status >= 100 && status < 200) {
+    return true;   // interim response, the final one follows
+  }
+
+  _status = code + (statusLine.size() > 13 ? " " + statusLine.substr(13) : " ");
+  _keepAlive = statusLine[7] == '1';
+  _headers.clear();
+  bool chunked = false;
+  bool hasLength = false;
+  size_t pos = lineEnd == std::string::npos ? head.size() : lineEnd + 2;
+  while (pos < head.size()) {
+    size_t eol = head.find("\r\n", pos);
+    std::string line = head.substr(pos, eol == std::string::npos ? std::string::npos : eol - pos);
+    pos = eol == std::string::npos ? head.size() : eol + 2;
+    size_t colon = line.find(':');
+    if (colon == std::string::npos || colon == 0) {
+      return false;
+    }
+    std::string name = line.substr(0, colon);
+    std::string value = trim(line.substr(colon + 1));
+
+    if (strcasecmp(name.c_str(), "connection") == 0) {
+      std::set<std::string> tokens = headerTokens(value);
+      if (tokens.count("close")) {
+        _keepAlive = false;
+      } else if (tokens.count("keep-alive")) {
+        _keepAlive = true;
+      }
+    } else if (strcasecmp(name.c_str(), "transfer-encoding") == 0) {
+      chunked = headerTokens(value).count("chunked") > 0;
+    } else if (strcasecmp(name.c_str(), "content-length") == 0) {
+      if (value.empty() || value.size() > 20 || value.find_first_not_of("0123456789") != std::string::npos
+          || (hasLength && value != _contentLength)) {
+        return false;
+      }
+      hasLength = true;
+      _contentLength = value;
+    }
+    if (!isDroppedResponseHeader(name)) {
+      _headers.push_back({name, value});
+    }
+  }
+
+  // RFC 9112 section 6.3: no body for these, then chunked over Content-Length, else up to the close
+  if (_req.getMethod() == "HEAD" || status == 204 || status == 304) {
+    _framing = EMPTY;
+  } else if (chunked) {
+    _framing = CHUNKS;
+    _contentLength.clear();
+    _decoder = std::make_unique<ChunkedDecoder>(SIZE_MAX);
+  } else if (hasLength) {
+    _framing = LENGTH;
+    _remaining = std::strtoull(_contentLength.c_str(), nullptr, 10);
+  } else {
+    _framing = UNTIL_CLOSE;
+    _keepAlive = false;
+  }
+
+  _headDone = true;
+  if (_mode != BUFFERED && _framing != EMPTY) {
+    _mode = _framing == LENGTH ? RAW : CHUNKED;
+  }
+  return true;
+}
+
+/** Pass response body bytes on, checking them against the upstream's framing */
+void ProxyJob::readBody(const char* data, size_t size) {
+  if (_framing == LENGTH) {
+    size_t take = std::min(size, _remaining);
+    appendBody(data, take);
+    _remaining -= take;
+    if (_remaining == 0 && _state != DONE) {
+      // Bytes past the body mean the upstream is out of step, its connection is not reused
+      complete(_keepAlive && take == size);
+    }
+    return;
+  }
+  if (_framing == CHUNKS) {
+    size_t used = _decoder->decode(data, size, [this](const char* piece, size_t pieceSize) {
+      appendBody(piece, pieceSize);
+    });
+    if (_decoder->failed()) {
+      fail(http::BAD_GATEWAY_502);
+    } else if (_decoder->done() && _state != DONE) {
+      complete(_keepAlive && used == size);
+    }
+    return;
+  }
+  appendBody(data, size);
+}
+
+/** Add body bytes in the client's framing */
+void ProxyJob::appendBody(const char* data, size_t size) {
+  if (size == 0 || _state == DONE) {
+    return;
+  }
+  if (_mode == BUFFERED) {
+    _body.append(data, size);
+    if (_body.size() > MAX_BUFFER_SIZE) {
+      fail(http::BAD_GATEWAY_502, false);
+    }
+    return;
+  }
+  if (_mode == CHUNKED) {
+    std::ostringstream chunkSize;
+    chunkSize << std::hex << size << "\r\n";
+    _outBody.append(chunkSize.str());
+    _outBody.append(data, size);
+    _outBody.append("\r\n");
+    return;
+  }
+  _outBody.append(data, size);
+}
+
+/** Response read to its end; reusable hands the connection back */
+void ProxyJob::complete(bool reusable) {
+  closeUpstream(reusable);
+  releaseBackend(true);
+  _state = DONE;
+  if (_mode == CHUNKED) {
+    _outBody.append("0\r\n\r\n");
+  }
+}
+
+/** Connection lost; one taken from the pool that failed before answering is retried once on a new one */
+void ProxyJob::upstreamLost() {
+  // A POST may have been acted on already, so it is not sent twice
+  if (_reused && !_received && !_retried && _replayable && _req.getMethod() != http::POST) {
+    closeUpstream(false);
+    _retried = true;
+    start(true);
+    return;
+  }
+  fail(http::BAD_GATEWAY_502);
+}
+
+/** Stop with an error page, or cut the body when the head is out */
+void ProxyJob::fail(int status, bool backendFault) {
+  closeUpstream(false);
+  if (backendFault) {
+    releaseBackend(false);
+  } else {
+    returnBackend();
+  }
+  _state = DONE;
+  if (streaming()) {
+    _broken = true;
+  } else {
+    _errorStatus = status;
+  }
+}
+
+/** Close or pool the upstream connection */
+void ProxyJob::closeUpstream(bool reusable) {
+  if (_fd == -1) {
+    return;
+  }
+  if (reusable) {
+    _backend->pool->release(_fd);
+  } else {
+    close(_fd);
+  }
+  _fd = -1;
+}
+
+// ========================= BODY SINK =========================
+
+ProxySink::ProxySink(std::shared_ptr<ProxyJob> job) : _job(std::move(job)) {}
+
+void ProxySink::write(const char* data, size_t size) {
+  _job->sendBody(data, size);
+}
+
+void ProxySink::finish(Response& res) {
+  _job->endBody();
+  res.setPending(_job);
+}
+
+} // namespace router::handlers
@@ -0,0 +1,185 @@
+/**
+ * @file Proxy.hpp
+ * @brief Requests forwarded to upstream HTTP/1.1 servers over pooled keep-alive connections
+ */
+
+#pragma once
+
+#include <string> // for std::string
+#include <vector> // for std::vector
+#include <map> // for std::map
+#include <memory> // for std::shared_ptr, std::unique_ptr
+#include <chrono> // for std::chrono::steady_clock
+
+#include "../../request/Request.hpp"
+#include "../../request/BodySink.hpp"
+#include "../../request/ChunkedDecoder.hpp"
+#include "../../response/Response.hpp"
+#include "../../response/PendingResponse.hpp"
+#include "Upstream.hpp"
+#include "DiskCache.hpp"
+
+class Server;
+
+namespace router::handlers {
+
+/**
+ * @brief Where a proxy_pass location sends its requests
+ */
+struct ProxyTarget {
+  UpstreamGroup* group = nullptr;
+  std::string host;             // host[:port] of the URL, or the upstream name, sent when the client gave no Host
+  std::string location;         // location the requests come in under
+  std::string uri;              // replaces the location prefix of the path, empty to pass the path unchanged
+  size_t connectTimeout = 0;    // ms
+  size_t sendTimeout = 0;       // ms
+  size_t readTimeout = 0;       // ms
+  CacheTarget cache;            // proxy_cache, none when cache.cache is nullptr
+};
+
+/** Targets per (server id, location) */
+using ProxyTargetMap = std::map<std::pair<int, std::string>, ProxyTarget>;
+
+/**
+ * @brief Split a proxy_pass URL
+ * @return false when it is not http://host[:port][/uri]
+ */
+bool parseProxyUrl(const std::string& url, std::string& host, int& port, std::string& uri);
+
+/**
+ * @brief One request forwarded to an upstream, driven by the event loop
+ *
+ * The request goes to a backend its group picks, on an idle pooled connection
+ * when there is one; one that turns out closed before any response byte
+ * arrives is retried once on a new connection. A backend that cannot be
+ * reached counts as failed, and a request that can be sent again moves on to
+ * another backend of the group. The response head goes out as soon as it is parsed and the
+ * body follows as it is read: as is when the upstream set Content-Length,
+ * re-chunked otherwise. HTTP/1.0 clients, and callers that need the whole
+ * response (stream = false), get a buffered response. A connection whose
+ * response was read to its end goes back to the pool.
+ */
+class ProxyJob : public PendingResponse {
+public:
+  /** @param bodyFollows The request body arrives later through sendBody() and endBody() */
+  ProxyJob(const ProxyTarget& target, const Request& req, const Server& server, bool bodyFollows = false,
+           bool stream = true);
+  ~ProxyJob() override;
+
+  ProxyJob(const ProxyJob&) = delete;
+  ProxyJob& operator=(const ProxyJob&) = delete;
+
+  int fd() const override;
+  short events() const override;
+  void onEvent(short revents) override;
+  bool done() const override;
+  void finish(Response& res) override;
+  void abort(bool timedOut) override;
+  bool streaming() const override;
+  bool takeBody(std::string& out) override;
+  bool expired(long long elapsedMs) const override;
+
+  /** Next piece of a request body that follows the head */
+  void sendBody(const char* data, size_t size);
+
+  /** Request body complete */
+  void endBody();
+
+private:
+  enum State { CONNECTING, WRITING, READING, DONE };
+  enum Mode { HEAD, CHUNKED, RAW, BUFFERED };
+  enum Framing { LENGTH, CHUNKS, UNTIL_CLOSE, EMPTY };
+
+  /** Pick a backend and start on it, 502 when none is left */
+  void pickBackend();
+
+  /** Get a connection and queue the request on it; a retry always opens a new one */
+  void start(bool fresh);
+
+  /** Backend unreachable: count the failure and move on to another one when the request allows */
+  void backendFailed();
+
+  /** Report the outcome and hand the backend back to its group, once */
+  void releaseBackend(bool ok);
+
+  /** Hand the backend back to its group without a verdict on it */
+  void returnBackend();
+
+  /** Write what is queued for the upstream */
+  void flush();
+
+  /** Parse the response head once it is complete */
+  void consume(const char* data, size_t size);
+
+  /** Status line and headers of a response head, false when malformed */
+  bool parseHead(const std::string& head);
+
+  /** Pass response body bytes on, checking them against the upstream's framing */
+  void readBody(const char* data, size_t size);
+
+  /** Add body bytes in the client's framing */
+  void appendBody(const char* data, size_t size);
+
+  /** Response read to its end; reusable hands the connection back */
+  void complete(bool reusable);
+
+  /** Connection lost; one taken from the pool that failed before answering is retried once on a new one */
+  void upstreamLost();
+
+  /**
+   * @brief Stop with an error page, or cut the body when the head is out
+   * @param backendFault Count a failure against the backend; false for the client going away and local limits
+   */
+  void fail(int status, bool backendFault = true);
+
+  /** Close or pool the upstream connection */
+  void closeUpstream(bool reusable);
+
+  const ProxyTarget* _target;
+  UpstreamGroup::Backend* _backend = nullptr;
+  std::vector<const UpstreamGroup::Backend*> _tried;   // backends found unreachable
+  int _fd = -1;
+  bool _reused = false;         // connection came from the pool
+  bool _retried = false;
+  bool _replayable;             // whole request kept in _head, it can be sent again
+  State _state = CONNECTING;
+  Mode _mode = HEAD;
+  Framing _framing = UNTIL_CLOSE;
+  std::string _head;            // request head, with the body unless it follows
+  std::string _out;             // bytes to write to the upstream
+  size_t _sent = 0;             // of _out
+  bool _bodyOpen = false;       // request body still arriving
+  bool _chunkedBody = false;    // request body sent with the chunked coding
+  bool _received = false;       // any response byte read
+  std::string _in;              // response until its head is complete
+  bool _headDone = false;
+  std::string _status;
+  std::string _contentLength;   // upstream's Content-Length, empty when it sent none
+  Response::HeaderList _headers;
+  bool _keepAlive = true;       // upstream allows reusing the connection
+  size_t _remaining = 0;        // body bytes still due with Content-Length
+  std::unique_ptr<ChunkedDecoder> _decoder;
+  std::string _body;            // whole body when buffered
+  std::string _outBody;         // framed body bytes not yet taken
+  bool _broken = false;         // body cut short after the head went out
+  int _errorStatus = 0;         // non-zero when finish() must send an error page
+  std::chrono::steady_clock::time_point _since;   // last progress, for the phase timeouts
+  Request _req;
+  const Server* _server;
+};
+
+/**
+ * @brief Request body passed on to the upstream as it arrives
+ */
+class ProxySink : public BodySink {
+public:
+  explicit ProxySink(std::shared_ptr<ProxyJob> job);
+
+  void write(const char* data, size_t size) override;
+  void finish(Response& res) override;
+
+private:
+  std::shared_ptr<ProxyJob> _job;
+};
+
+} // namespace router::handlers
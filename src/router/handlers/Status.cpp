@@ -0,0 +1,209 @@
+/**
+ * @file Status.cpp
+ * @brief Report of stub_status locations implementation
+ */
+
+#include "Status.hpp"
+
+#include <sstream> // for std::ostringstream
+#include <iomanip> // for std::fixed, std::setprecision
+
+namespace router::handlers {
+
+namespace {
+
+/** Label value with its backslashes, quotes and line breaks escaped */
+std::string label(const std::string& value) {
+  std::string out;
+  out.reserve(value.size());
+  for (char c : value) {
+    if (c == '\\' || c == '"') {
+      out += '\\';
+      out += c;
+    } else if (c == '\n') {
+      out += "\\n";
+    } else {
+      out += c;
+    }
+  }
+  return out;
+}
+
+/** HELP and TYPE lines of a metric family */
+void family(std::ostringstream& out, const char* name, const char* type, const char* help) {
+  out << "# HELP " << name << ' ' << help << "\n# TYPE " << name << ' ' << type << '\n';
+}
+
+/** Percentiles of a phase on one line of the text report */
+void percentiles(std::ostringstream& out, const char* phase, const LatencySummary& summary) {
+  out << "  " << phase << " p50 " << summary.p50 << "us p90 " << summary.p90 << "us p99 " << summary.p99
+      << "us p999 " << summary.p999 << "us max " << summary.max << "us\n";
+}
+
+/** Quantiles, sum and count of a phase as a Prometheus summary, in seconds */
+void quantiles(std::ostringstream& out, const LocationMetrics& location, const char* phase,
+               const LatencySummary& summary) {
+  const std::string labels = "server=\"" + label(location.server) + "\",location=\"" + label(location.location)
+                             + "\",handler=\"" + location.handler + "\",phase=\"" + phase + "\"";
+  const std::pair<const char*, uint64_t> values[] = {
+    {"0.5", summary.p50}, {"0.9", summary.p90}, {"0.99", summary.p99}, {"0.999", summary.p999}};
+  for (const auto& [quantile, value] : values) {
+    out << "webserv_request_duration_seconds{" << labels << ",quantile=\"" << quantile << "\"} "
+        << std::setprecision(6) << value / 1e6 << "\n";
+  }
+  out << "webserv_request_duration_seconds_sum{" << labels << "} " << summary.sum / 1e6 << "\n"
+      << "webserv_request_duration_seconds_count{" << labels << "} " << summary.count << "\n";
+}
+
+/** {upstream="...",backend="..."} of a backend, extra labels appended */
+std::string upstreamLabels(const BackendStatus& backend, const std::string& extra = "") {
+  return "{upstream=\"" + label(backend.upstream) + "\",backend=\"" + label(backend.backend) + "\"" + extra + "}";
+}
+
+} // namespace
+
+/** nginx stub_status text, followed by the counters it does not have */
+std::string renderStatusText(const StatusReport& report) {
+  const MetricsSnapshot& metrics = report.metrics;
+  std::ostringstream out;
+  out << "Active connections: " << metrics.connections.active << "\n"
+      << "server accepts handled requests\n"
+      << ' ' << metrics.accepted << ' ' << metrics.handled << ' ' << metrics.requests << "\n"
+      << "Reading: " << metrics.connections.reading << " Writing: " << metrics.connections.writing
+      << " Waiting: " << metrics.connections.idle << "\n";
+
+  out << "Requests per second: " << std::fixed << std::setprecision(2) << metrics.requests_per_second << "\n"
+      << "Bytes in: " << metrics.bytes_in << " out: " << metrics.bytes_out << "\n";
+  for (const auto& [code, count] : metrics.statuses) {
+    out << "Status " << code << ": " << count << "\n";
+  }
+  for (const LocationMetrics& location : metrics.locations) {
+    out << "Location " << location.server << ' ' << location.location << ' ' << location.handler
+        << ": requests " << location.requests << "\n";
+    percentiles(out, "receive", location.receive);
+    percentiles(out, "handle", location.handle);
+    percentiles(out, "send", location.send);
+  }
+  out << "File I/O: queued " << report.fileIo.queued << " running " << report.fileIo.running
+      << " completed " << report.fileIo.completed << " rejected " << report.fileIo.rejected << "\n"
+      << "  wait total " << report.fileIo.waitTotal << "us max " << report.fileIo.waitMax
+      << "us run total " << report.fileIo.runTotal << "us max " << report.fileIo.runMax << "us\n"
+      << "Disk cache: hits " << report.cache.hits << " misses " << report.cache.misses
+      << " bypasses " << report.cache.bypasses << " stores " << report.cache.stores
+      << " evictions " << report.cache.evictions << " entries " << report.cache.entries
+      << " size " << report.cache.size << "\n";
+  for (const BackendStatus& backend : report.upstreams) {
+    out << "Upstream " << backend.upstream << ' ' << backend.backend << ": " << (backend.up ? "up" : "down")
+        << " active " << backend.active << " fails " << backend.fails;
+    if (backend.checked) {
+      out << " probes " << backend.probes << " failed " << backend.probeFailures
+          << " latency " << backend.latency << "us";
+    }
+    out << "\n";
+  }
+  return out.str();
+}
+
+/** Prometheus text exposition format, version 0.0.4 */
+std::string renderStatusPrometheus(const StatusReport& report) {
+  const MetricsSnapshot& metrics = report.metrics;
+  std::ostringstream out;
+
+  family(out, "webserv_connections", "gauge", "Client connections by state.");
+  out << "webserv_connections{state=\"active\"} " << metrics.connections.active << "\n"
+      << "webserv_connections{state=\"reading\"} " << metrics.connections.reading << "\n"
+      << "webserv_connections{state=\"writing\"} " << metrics.connections.writing << "\n"
+      << "webserv_connections{state=\"waiting\"} " << metrics.connections.idle << "\n";
+  family(out, "webserv_connections_accepted_total", "counter", "Client connections accepted.");
+  out << "webserv_connections_accepted_total " << metrics.accepted << "\n";
+  family(out, "webserv_connections_handled_total", "counter", "Client connections handled.");
+  out << "webserv_connections_handled_total " << metrics.handled << "\n";
+  family(out, "webserv_requests_total", "counter", "Requests answered.");
+  out << "webserv_requests_total " << metrics.requests << "\n";
+  family(out, "webserv_requests_per_second", "gauge", "Requests answered per second, over the last seconds.");
+  out << "webserv_requests_per_second " << std::fixed << std::setprecision(2) << metrics.requests_per_second << "\n";
+  family(out, "webserv_received_bytes_total", "counter", "Bytes read from clients.");
+  out << "webserv_received_bytes_total " << metrics.bytes_in << "\n";
+  family(out, "webserv_sent_bytes_total", "counter", "Bytes sent to clients.");
+  out << "webserv_sent_bytes_total " << metrics.bytes_out << "\n";
+
+  family(out, "webserv_responses_total", "counter", "Responses by status code.");
+  for (const auto& [code, count] : metrics.statuses) {
+    out << "webserv_responses_total{status=\"" << code << "\"} " << count << "\n";
+  }
+
+  family(out, "webserv_location_requests_total", "counter", "Requests by location and handler.");
+  for (const LocationMetrics& location : metrics.locations) {
+    out << "webserv_location_requests_total{server=\"" << label(location.server) << "\",location=\""
+        << label(location.location) << "\",handler=\"" << location.handler << "\"} " << location.requests << "\n";
+  }
+  family(out, "webserv_request_duration_seconds", "summary",
+         "Request phases by location and handler: receive (first to last request byte), "
+         "handle (handler start to response head), send (response head to last byte sent).");
+  for (const LocationMetrics& location : metrics.locations) {
+    quantiles(out, location, "receive", location.receive);
+    quantiles(out, location, "handle", location.handle);
+    quantiles(out, location, "send", location.send);
+  }
+
+  family(out, "webserv_file_io_jobs", "gauge", "File I/O jobs by state.");
+  out << "webserv_file_io_jobs{state=\"queued\"} " << report.fileIo.queued << "\n"
+      << "webserv_file_io_jobs{state=\"running\"} " << report.fileIo.running << "\n";
+  family(out, "webserv_file_io_completed_total", "counter", "File I/O jobs completed.");
+  out << "webserv_file_io_completed_total " << report.fileIo.completed << "\n";
+  family(out, "webserv_file_io_rejected_total", "counter", "File I/O jobs refused because the queue was full.");
+  out << "webserv_file_io_rejected_total " << report.fileIo.rejected << "\n";
+  family(out, "webserv_file_io_wait_seconds_sum", "counter", "Time completed file I/O jobs spent in the queue.");
+  out << "webserv_file_io_wait_seconds_sum " << std::setprecision(6) << report.fileIo.waitTotal / 1e6 << "\n";
+  family(out, "webserv_file_io_wait_seconds_max", "gauge", "Longest time a file I/O job spent in the queue.");
+  out << "webserv_file_io_wait_seconds_max " << report.fileIo.waitMax / 1e6 << "\n";
+  family(out, "webserv_file_io_run_seconds_sum", "counter", "Time completed file I/O jobs spent on a thread.");
+  out << "webserv_file_io_run_seconds_sum " << report.fileIo.runTotal / 1e6 << "\n";
+  family(out, "webserv_file_io_run_seconds_max", "gauge", "Longest time a file I/O job spent on a thread.");
+  out << "webserv_file_io_run_seconds_max " << report.fileIo.runMax / 1e6 << "\n";
+
+  family(out, "webserv_disk_cache_lookups_total", "counter", "Disk cache lookups by result.");
+  out << "webserv_disk_cache_lookups_total{result=\"hit\"} " << report.cache.hits << "\n"
+      << "webserv_disk_cache_lookups_total{result=\"miss\"} " << report.cache.misses << "\n"
+      << "webserv_disk_cache_lookups_total{result=\"bypass\"} " << report.cache.bypasses << "\n";
+  family(out, "webserv_disk_cache_stores_total", "counter", "Responses stored in disk caches.");
+  out << "webserv_disk_cache_stores_total " << report.cache.stores << "\n";
+  family(out, "webserv_disk_cache_evictions_total", "counter", "Responses removed by the disk cache sweeper.");
+  out << "webserv_disk_cache_evictions_total " << report.cache.evictions << "\n";
+  family(out, "webserv_disk_cache_entries", "gauge", "Responses kept in disk caches.");
+  out << "webserv_disk_cache_entries " << report.cache.entries << "\n";
+  family(out, "webserv_disk_cache_size_bytes", "gauge", "Bytes of the disk cache files.");
+  out << "webserv_disk_cache_size_bytes " << report.cache.size << "\n";
+
+  family(out, "webserv_upstream_backend_up", "gauge", "1 while a backend takes requests, 0 while it is down.");
+  for (const BackendStatus& backend : report.upstreams) {
+    out << "webserv_upstream_backend_up" << upstreamLabels(backend) << ' ' << (backend.up ? 1 : 0) << "\n";
+  }
+  family(out, "webserv_upstream_backend_active", "gauge", "Requests in progress on a backend.");
+  for (const BackendStatus& backend : report.upstreams) {
+    out << "webserv_upstream_backend_active" << upstreamLabels(backend) << ' ' << backend.active << "\n";
+  }
+  family(out, "webserv_upstream_backend_fails", "gauge", "Request failures of a backend within its fail_timeout.");
+  for (const BackendStatus& backend : report.upstreams) {
+    out << "webserv_upstream_backend_fails" << upstreamLabels(backend) << ' ' << backend.fails << "\n";
+  }
+  family(out, "webserv_upstream_probes_total", "counter", "Health probes of a backend by result.");
+  for (const BackendStatus& backend : report.upstreams) {
+    if (backend.checked) {
+      out << "webserv_upstream_probes_total" << upstreamLabels(backend, ",result=\"passed\"") << ' '
+          << backend.probes - backend.probeFailures << "\n"
+          << "webserv_upstream_probes_total" << upstreamLabels(backend, ",result=\"failed\"") << ' '
+          << backend.probeFailures << "\n";
+    }
+  }
+  family(out, "webserv_upstream_probe_latency_seconds", "gauge", "Duration of the last health probe of a backend.");
+  for (const BackendStatus& backend : report.upstreams) {
+    if (backend.checked) {
+      out << "webserv_upstream_probe_latency_seconds" << upstreamLabels(backend) << ' ' << std::setprecision(6)
+          << backend.latency / 1e6 << "\n";
+    }
+  }
+  return out.str();
+}
+
+} // namespace router::handlers
@@ -0,0 +1,49 @@
+/**
+ * @file Status.hpp
+ * @brief Report of stub_status locations
+ */
+
+#pragma once
+
+#include <cstdint> // for uint64_t
+#include <string> // for std::string
+#include <vector> // for std::vector
+
+#include "../../server/Metrics.hpp"
+#include "FileIoPool.hpp"
+#include "DiskCache.hpp"
+
+namespace router::handlers {
+
+/**
+ * @brief One backend of an upstream group, as the balancer and health checks see it
+ */
+struct BackendStatus {
+  std::string upstream;       // group key: "<server id>/<name>" of an upstream {}, or a proxy_pass address
+  std::string backend;        // host:port
+  bool up = true;             // healthy and not taken out by failures
+  bool checked = false;       // the group has an active health check
+  uint64_t latency = 0;       // microseconds of the last probe
+  uint64_t probes = 0;
+  uint64_t probeFailures = 0;
+  uint64_t fails = 0;         // request failures within the current fail_timeout
+  uint64_t active = 0;        // requests in progress
+};
+
+/**
+ * @brief What a stub_status location reports, read when it is requested
+ */
+struct StatusReport {
+  MetricsSnapshot metrics;
+  FileIoStats fileIo;
+  DiskCacheStats cache;
+  std::vector<BackendStatus> upstreams;
+};
+
+/** nginx stub_status text, followed by the counters it does not have */
+std::string renderStatusText(const StatusReport& report);
+
+/** Prometheus text exposition format, version 0.0.4 */
+std::string renderStatusPrometheus(const StatusReport& report);
+
+} // namespace router::handlers
@@ -0,0 +1,452 @@
+/**
+ * @file UploadSink.cpp
+ * @brief Multipart upload written to disk as the body arrives implementation
+ */
+
+#include "UploadSink.hpp"
+#include "FileIoPool.hpp"
+#include "HandlerUtils.hpp"
+#include "MultipartParser.hpp"
+#include "../utils/StringUtils.hpp"
+#include "../HttpConstants.hpp"
+#include "../../server/Server.hpp"
+
+#include <unistd.h> // for write, close, link, unlink
+#include <fcntl.h> // for AT_FDCWD
+#include <cstdio> // for renameat2, RENAME_NOREPLACE
+#include <cstdlib> // for mkstemp
+#include <cerrno> // for errno, EINTR, EEXIST, EINVAL, ENOSYS
+#include <sys/stat.h> // for fchmod
+#include <poll.h> // for POLLIN
+#include <filesystem> // for std::filesystem::create_directories
+#include <vector> // for std::vector
+
+namespace router::handlers {
+
+namespace {
+
+/** File parts accepted in one request */
+const size_t MAX_UPLOAD_FILES = 1024;
+
+/** Body bytes held while the previous ones are written; the connection is not read past it */
+const size_t UPLOAD_BACKLOG = 262144;
+
+/** Numbered names tried for a file whose name is taken, before the upload fails */
+const int MAX_NAME_SUFFIX = 100;
+
+/** Move from to to, failing with EEXIST rather than replacing a file */
+bool renameNoReplace(const std::string& from, const std::string& to) {
+  if (renameat2(AT_FDCWD, from.c_str(), AT_FDCWD, to.c_str(), RENAME_NOREPLACE) == 0) {
+    return true;
+  }
+  if (errno != EINVAL && errno != ENOSYS) {
+    return false;
+  }
+  // Filesystem without RENAME_NOREPLACE: link refuses an existing name as well
+  if (link(from.c_str(), to.c_str()) != 0) {
+    return false;
+  }
+  unlink(from.c_str());
+  return true;
+}
+
+/** report-<n>.pdf for report.pdf, README-<n> for README */
+std::string numberedName(const std::string& filename, int n) {
+  size_t dot = filename.rfind('.');
+  if (dot == 0 || dot == std::string::npos) {
+    dot = filename.size();
+  }
+  return filename.substr(0, dot) + "-" + std::to_string(n) + filename.substr(dot);
+}
+
+} // namespace
+
+/**
+ * @brief Parts of one upload and their temporary files
+ *
+ * Only the thread running the upload's current batch touches it. The temporary
+ * files left when it goes away, stored or not, are removed.
+ */
+class UploadFiles {
+public:
+  UploadFiles(const std::string& uploadDir, const std::string& boundary)
+    : _parser(boundary,
+              [this](const MultipartParser::Part& part) { return beginPart(part); },
+              [this](const char* data, size_t size) { return writePart(data, size); },
+              [this]() { return endPart(); }),
+      _uploadDir(uploadDir) {}
+
+  ~UploadFiles() {
+    discardFiles();
+  }
+
+  UploadFiles(const UploadFiles&) = delete;
+  UploadFiles& operator=(const UploadFiles&) = delete;
+
+  /** Parse the next body bytes into the temporary files */
+  void feed(const char* data, size_t size);
+
+  /** Body complete: store the files and answer */
+  void finish(Response& res, const Request& req, const Server& server);
+
+private:
+  /** File part written to a temporary file */
+  struct StoredFile {
+    std::string filename;
+    std::string tempPath;
+    std::string storedName;   // final name once moved, filename or a numbered variant
+    size_t size = 0;
+  };
+
+  bool beginPart(const MultipartParser::Part& part);
+  bool writePart(const char* data, size_t size);
+  bool endPart();
+  bool storeFiles();
+  void unstoreFiles();
+  void discardFiles();
+  std::string summary() const;
+
+  MultipartParser _parser;
+  std::string _uploadDir;
+  std::vector<StoredFile> _files;
+  std::vector<std::string> _fields;   // names of the form fields, which are not stored
+  int _fd = -1;             // temporary file of the part being written, the last of _files
+  int _errorStatus = 0;     // non-zero when finish() must send an error page
+};
+
+// ========================= SINK =========================
+
+UploadSink::UploadSink(const Request& req, const Server& server, const Location* location, const std::string& boundary,
+                       FileIoPool* pool)
+  : _req(req), _server(&server) {
+  // The body arrives through write()
+  _req.setBody("");
+  std::string uploadDir = router::utils::StringUtils::resolvePath(location->upload_path, server.getRoot());
+  _job = std::make_shared<UploadJob>(uploadDir, boundary, _req, server, pool);
+}
+
+UploadSink::UploadSink(const Request& req, const Server& server, int errorStatus)
+  : _errorStatus(errorStatus), _req(req), _server(&server) {
+  _req.setBody("");
+}
+
+void UploadSink::write(const char* data, size_t size) {
+  if (_job) {
+    _job->write(data, size);
+  }
+}
+
+void UploadSink::finish(Response& res) {
+  if (!_job) {
+    HandlerUtils::setErrorResponse(res, _errorStatus, _req, *_server);
+    return;
+  }
+  _job->close();
+  if (_job->done()) {
+    _job->finish(res);
+  } else {
+    res.setPending(_job);
+  }
+}
+
+int UploadSink::fd() const {
+  return _job ? _job->fd() : -1;
+}
+
+void UploadSink::onEvent() {
+  if (_job) {
+    _job->onEvent(POLLIN);
+  }
+}
+
+bool UploadSink::full() const {
+  return _job && _job->full();
+}
+
+// ========================= JOB =========================
+
+UploadJob::UploadJob(const std::string& uploadDir, const std::string& boundary, const Request& req,
+                     const Server& server, FileIoPool* pool)
+  : _files(std::make_shared<UploadFiles>(uploadDir, boundary)), _pool(pool), _req(req), _server(&server) {}
+
+UploadJob::~UploadJob() {
+  // A batch already running finishes; the files go with its last reference
+  if (_batch) {
+    _batch->abort(false);
+  }
+}
+
+void UploadJob::write(const char* data, size_t size) {
+  if (_done || _closed) {
+    return;
+  }
+  _pending.append(data, size);
+  if (!_batch) {
+    next();
+  }
+}
+
+void UploadJob::close() {
+  _closed = true;
+  if (!_batch) {
+    next();
+  }
+}
+
+bool UploadJob::full() const {
+  return _batch && _pending.size() >= UPLOAD_BACKLOG;
+}
+
+int UploadJob::fd() const {
+  return _batch ? _batch->fd() : -1;
+}
+
+short UploadJob::events() const {
+  return POLLIN;
+}
+
+void UploadJob::onEvent(short revents) {
+  if (!_batch) {
+    return;
+  }
+  _batch->onEvent(revents);
+  if (!_batch->done()) {
+    return;
+  }
+  Response batch;
+  _batch->finish(batch);
+  _batch.reset();
+  settle(batch);
+  next();
+}
+
+bool UploadJob::done() const {
+  return _done;
+}
+
+void UploadJob::finish(Response& res) {
+  res = std::move(_result);
+}
+
+void UploadJob::abort(bool timedOut) {
+  if (_done) {
+    return;
+  }
+  if (_batch) {
+    _batch->abort(false);
+    _batch.reset();
+  }
+  _done = true;
+  _result = Response();
+  HandlerUtils::setErrorResponse(_result, timedOut ? http::GATEWAY_TIMEOUT_504 : http::INTERNAL_SERVER_ERROR_500,
+                                 _req, *_server);
+}
+
+/** Hand the queued bytes to batches until one is left running on a thread or the upload is answered */
+void UploadJob::next() {
+  while (!_done && (!_pending.empty() || _closed)) {
+    _storing = _closed;
+    std::shared_ptr<UploadFiles> files = _files;
+    auto work = [files, data = std::move(_pending), last = _storing](const Request& req, Response& res,
+                                                                      const Server& server) {
+      files->feed(data.data(), data.size());
+      if (last) {
+        files->finish(res, req, server);
+      } else {
+        res.setStatus(http::STATUS_OK_200);
+      }
+    };
+    _pending.clear();
+
+    if (!_pool) {
+      Response batch;
+      work(_req, batch, *_server);
+      settle(batch);
+      continue;
+    }
+    _batch = _pool->submit(std::move(work), _req, *_server);
+    if (!_batch->done()) {
+      return;
+    }
+    Response batch;   // refused by a full queue
+    _batch->finish(batch);
+    _batch.reset();
+    settle(batch);
+  }
+}
+
+/** Take the outcome of a finished batch: the last one answers, so does an earlier one that failed */
+void UploadJob::settle(Response& batch) {
+  if (_storing || batch.getStatus() != http::STATUS_OK_200) {
+    _result = std::move(batch);
+    _done = true;
+  }
+}
+
+// ========================= FILES =========================
+
+void UploadFiles::feed(const char* data, size_t size) {
+  if (_errorStatus) {
+    return;
+  }
+  if (!_parser.feed(data, size) && !_errorStatus) {
+    _errorStatus = http::BAD_REQUEST_400;
+  }
+  if (_errorStatus) {
+    discardFiles();
+  }
+}
+
+void UploadFiles::finish(Response& res, const Request& req, const Server& server) {
+  if (!_errorStatus && (!_parser.complete() || _files.empty())) {
+    _errorStatus = http::BAD_REQUEST_400;
+  }
+  if (!_errorStatus && !storeFiles()) {
+    _errorStatus = http::INTERNAL_SERVER_ERROR_500;
+  }
+  if (_errorStatus) {
+    discardFiles();
+    HandlerUtils::setErrorResponse(res, _errorStatus, req, server);
+    return;
+  }
+
+  std::string body = summary();
+  res.setStatus(http::STATUS_CREATED_201);
+  res.setHeaders(http::CONTENT_TYPE, http::CONTENT_TYPE_TEXT);
+  res.setHeaders(http::CONTENT_LENGTH, std::to_string(body.size()));
+  HandlerUtils::setConnectionHeaders(res, req);
+  res.setBody(body);
+}
+
+/** Open a temporary file for a file part, count form fields */
+bool UploadFiles::beginPart(const MultipartParser::Part& part) {
+  if (part.filename.empty()) {
+    _fields.push_back(part.name);
+    return true;
+  }
+  if (!HandlerUtils::isValidFilename(part.filename)) {
+    _errorStatus = http::BAD_REQUEST_400;
+    return false;
+  }
+  if (_files.size() >= MAX_UPLOAD_FILES) {
+    _errorStatus = http::PAYLOAD_TOO_LARGE_413;
+    return false;
+  }
+
+  // Same directory as the final name, so the rename cannot cross filesystems
+  std::error_code error;
+  std::filesystem::create_directories(_uploadDir, error);
+  StoredFile file;
+  file.filename = part.filename;
+  file.tempPath = _uploadDir + "/.upload-XXXXXX";
+  _fd = mkstemp(file.tempPath.data());
+  if (_fd == -1) {
+    _errorStatus = http::INTERNAL_SERVER_ERROR_500;
+    return false;
+  }
+  fchmod(_fd, 0644);
+  _files.push_back(file);
+  return true;
+}
+
+/** Append data of the current part */
+bool UploadFiles::writePart(const char* data, size_t size) {
+  if (_fd == -1) {
+    return true;
+  }
+  while (size > 0) {
+    ssize_t written = ::write(_fd, data, size);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      _errorStatus = http::INTERNAL_SERVER_ERROR_500;
+      return false;
+    }
+    data += written;
+    size -= written;
+    _files.back().size += written;
+  }
+  return true;
+}
+
+/** Close the temporary file of a complete part */
+bool UploadFiles::endPart() {
+  if (_fd == -1) {
+    return true;
+  }
+  int fd = _fd;
+  _fd = -1;
+  if (close(fd) != 0) {
+    _errorStatus = http::INTERNAL_SERVER_ERROR_500;
+    return false;
+  }
+  return true;
+}
+
+/** Move every temporary file to its final name, all or none */
+bool UploadFiles::storeFiles() {
+  for (auto& file : _files) {
+    // A taken name, on disk or earlier in this request, gets the next free number
+    std::string name = file.filename;
+    int n = 0;
+    while (!renameNoReplace(file.tempPath, _uploadDir + "/" + name)) {
+      if (errno != EEXIST || ++n > MAX_NAME_SUFFIX) {
+        unstoreFiles();
+        return false;
+      }
+      name = numberedName(file.filename, n);
+    }
+    file.storedName = name;
+    file.tempPath.clear();
+  }
+  return true;
+}
+
+/** Remove the files a failed storeFiles() already moved; none of them replaced anything */
+void UploadFiles::unstoreFiles() {
+  for (auto& file : _files) {
+    if (!file.storedName.empty()) {
+      unlink((_uploadDir + "/" + file.storedName).c_str());
+      file.storedName.clear();
+    }
+  }
+}
+
+/** Close and remove the temporary files */
+void UploadFiles::discardFiles() {
+  if (_fd != -1) {
+    close(_fd);
+    _fd = -1;
+  }
+  for (auto& file : _files) {
+    if (!file.tempPath.empty()) {
+      unlink(file.tempPath.c_str());
+      file.tempPath.clear();
+    }
+  }
+}
+
+/** Plain text summary of the stored files */
+std::string UploadFiles::summary() const {
+  size_t total = 0;
+  for (const auto& file : _files) {
+    total += file.size;
+  }
+
+  std::string body = "Uploaded " + std::to_string(_files.size()) + (_files.size() == 1 ? " file, " : " files, ")
+    + std::to_string(total) + " bytes\n";
+  for (const auto& file : _files) {
+    body += file.storedName + " " + std::to_string(file.size) + "\n";
+  }
+  if (!_fields.empty()) {
+    body += "Ignored form fields:";
+    for (const auto& field : _fields) {
+      body += " " + field;
+    }
+    body += "\n";
+  }
+  return body;
+}
+
+} // namespace router::handlers
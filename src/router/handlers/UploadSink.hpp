@@ -0,0 +1,113 @@
+/**
+ * @file UploadSink.hpp
+ * @brief Multipart upload written to disk as the body arrives
+ */
+
+#pragma once
+
+#include <memory> // for std::shared_ptr
+#include <string> // for std::string
+
+#include "../../request/Request.hpp"
+#include "../../request/BodySink.hpp"
+#include "../../response/Response.hpp"
+#include "../../response/PendingResponse.hpp"
+
+struct Location;
+class Server;
+
+namespace router::handlers {
+
+class FileIoPool;
+class UploadFiles;
+
+/**
+ * @brief File work of one upload, run one batch at a time on the file I/O threads
+ *
+ * A batch is the body bytes that arrived since the previous one was handed
+ * over: its thread parses them and writes the parts to their temporary files.
+ * The batch after the end of the body moves the files to their final names
+ * and builds the response. Callers without a pool run every batch inline.
+ */
+class UploadJob : public PendingResponse {
+public:
+  /** Upload into uploadDir, boundary as returned by HandlerUtils::extractBoundary */
+  UploadJob(const std::string& uploadDir, const std::string& boundary, const Request& req, const Server& server,
+            FileIoPool* pool);
+  ~UploadJob() override;
+
+  UploadJob(const UploadJob&) = delete;
+  UploadJob& operator=(const UploadJob&) = delete;
+
+  /** Queue body bytes, handed to a batch once the previous one is done */
+  void write(const char* data, size_t size);
+
+  /** Body complete: the last batch stores the files */
+  void close();
+
+  /** True while a batch runs and enough bytes wait behind it for the next one */
+  bool full() const;
+
+  int fd() const override;
+  short events() const override;
+  void onEvent(short revents) override;
+  bool done() const override;
+  void finish(Response& res) override;
+  void abort(bool timedOut) override;
+
+private:
+  /** Hand the queued bytes to batches until one is left running on a thread or the upload is answered */
+  void next();
+
+  /** Take the outcome of a finished batch */
+  void settle(Response& batch);
+
+  std::shared_ptr<UploadFiles> _files;
+  FileIoPool* _pool;
+  std::shared_ptr<PendingResponse> _batch;   // batch running on a thread
+  std::string _pending;   // body bytes not handed to a batch yet
+  bool _closed = false;   // body complete
+  bool _storing = false;  // the running batch is the last one
+  bool _done = false;
+  Response _result;       // response once done
+  Request _req;
+  const Server* _server;
+};
+
+/**
+ * @brief Upload handler fed by the event loop
+ *
+ * Every file part goes to its own temporary file in the upload directory. They
+ * are renamed to their final names only once the whole body is parsed, and all
+ * of them or none are stored. Existing files are never replaced: a taken name,
+ * on disk or earlier in the same request, is stored as name-1.ext, name-2.ext
+ * and so on. Memory use does not depend on the body size; the response lists
+ * the names the files were stored under. The file work runs on the UploadJob,
+ * which answers the request once the files are stored.
+ */
+class UploadSink : public BodySink {
+public:
+  /** Upload into location's upload_path, boundary as returned by HandlerUtils::extractBoundary */
+  UploadSink(const Request& req, const Server& server, const Location* location, const std::string& boundary,
+             FileIoPool* pool = nullptr);
+
+  /** Discard the body and answer with errorStatus */
+  UploadSink(const Request& req, const Server& server, int errorStatus);
+
+  UploadSink(const UploadSink&) = delete;
+  UploadSink& operator=(const UploadSink&) = delete;
+
+  void write(const char* data, size_t size) override;
+  void finish(Response& res) override;
+  int fd() const override;
+  void onEvent() override;
+  bool full() const override;
+
+private:
+  std::shared_ptr<UploadJob> _job;   // null when the request is refused
+  int _errorStatus = 0;
+  Request _req;
+  const Server* _server;
+};
+
+} // namespace router::handlers
@@ -0,0 +1,280 @@
+/**
+ * @file Upstream.cpp
+ * @brief Upstream backends implementation
+ */
+
+#include "Upstream.hpp"
+#include "../../../inc/webserv.hpp"
+
+#include <unistd.h> // for close
+#include <sys/socket.h> // for socket, connect, recv, setsockopt
+#include <netinet/tcp.h> // for TCP_NODELAY
+#include <cerrno> // for errno, EAGAIN, EINPROGRESS
+#include <algorithm> // for std::find, std::min, std::sort, std::lower_bound
+
+namespace router::handlers {
+
+namespace {
+
+/** FNV-1a, finished with the murmur3 mixer so that near-identical keys spread over the ring */
+uint32_t hashKey(const std::string& key) {
+  uint32_t hash = 2166136261u;
+  for (unsigned char c : key) {
+    hash ^= c;
+    hash *= 16777619u;
+  }
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6bu;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35u;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+} // namespace
+
+// ========================= UPSTREAM POOL =========================
+
+UpstreamPool::UpstreamPool(const sockaddr_in& address, size_t keepalive) : _address(address), _keepalive(keepalive) {}
+
+UpstreamPool::~UpstreamPool() {
+  for (const Idle& idle : _idle) {
+    close(idle.fd);
+  }
+}
+
+/** Idle connection still open, -1 when there is none */
+int UpstreamPool::acquire() {
+  auto now = std::chrono::steady_clock::now();
+  while (!_idle.empty()) {
+    Idle idle = _idle.back();
+    _idle.pop_back();
+    if (now - idle.since > std::chrono::milliseconds(PROXY_KEEPALIVE_TIMEOUT)) {
+      close(idle.fd);
+      continue;
+    }
+    // An idle upstream has nothing to say: a readable one closed or misbehaves
+    char byte;
+    ssize_t peeked = recv(idle.fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (peeked < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return idle.fd;
+    }
+    close(idle.fd);
+  }
+  return -1;
+}
+
+/** Start a non-blocking connection, -1 when it failed at once */
+int UpstreamPool::open() const {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  if (connect(fd, reinterpret_cast<const sockaddr*>(&_address), sizeof(_address)) < 0 && errno != EINPROGRESS) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/** Take a connection back after a complete exchange */
+void UpstreamPool::release(int fd) {
+  _idle.push_back({fd, std::chrono::steady_clock::now()});
+  while (_idle.size() > _keepalive) {
+    close(_idle.front().fd);
+    _idle.pop_front();
+  }
+}
+
+// ========================= UPSTREAM GROUP =========================
+
+UpstreamGroup::UpstreamGroup(Balance balance) : _balance(balance) {}
+
+/** Add a backend; failTimeout in seconds */
+void UpstreamGroup::addBackend(const std::string& name, UpstreamPool* pool, int weight, size_t maxFails,
+                               size_t failTimeout) {
+  Backend backend;
+  backend.name = name;
+  backend.pool = pool;
+  backend.weight = weight;
+  backend.maxFails = maxFails;
+  backend.failTimeout = std::chrono::seconds(failTimeout);
+  _backends.push_back(backend);
+
+  if (_balance == HASH_URI || _balance == HASH_IP) {
+    size_t index = _backends.size() - 1;
+    for (int i = 0; i < weight * UPSTREAM_HASH_POINTS; ++i) {
+      _ring.push_back({hashKey(name + "-" + std::to_string(i)), index});
+    }
+    std::sort(_ring.begin(), _ring.end());
+  }
+}
+
+/** Backend for a request, counted active until release() */
+UpstreamGroup::Backend* UpstreamGroup::pick(const Request& req, const std::vector<const Backend*>& tried) {
+  auto now = std::chrono::steady_clock::now();
+  Backend* backend = nullptr;
+  if (_balance == LEAST_CONN) {
+    backend = pickLeastConn(now, tried);
+  } else if (_balance == HASH_URI) {
+    backend = pickHash(std::string(req.getPath()), now, tried);
+  } else if (_balance == HASH_IP) {
+    backend = pickHash(req.getRemoteAddr(), now, tried);
+  } else {
+    backend = pickRoundRobin(now, tried);
+  }
+  if (backend) {
+    ++backend->active;
+  }
+  return backend;
+}
+
+/** Request done with its backend */
+void UpstreamGroup::release(Backend* backend) {
+  if (backend->active > 0) {
+    --backend->active;
+  }
+}
+
+/** Outcome of an exchange with a backend; a failure counts towards taking it out */
+void UpstreamGroup::report(Backend* backend, bool ok) {
+  auto now = std::chrono::steady_clock::now();
+  if (ok) {
+    backend->fails = 0;
+    if (now >= backend->downUntil) {
+      backend->backoff = 0;
+    }
+    return;
+  }
+  if (backend->maxFails == 0 || _backends.size() == 1) {
+    return;
+  }
+
+  // Back from a time out and failing again: out at once, for longer
+  bool probation = backend->backoff > 0 && now >= backend->downUntil;
+  if (!probation) {
+    if (backend->fails == 0 || now - backend->firstFail > backend->failTimeout) {
+      backend->fails = 0;
+      backend->firstFail = now;
+    }
+    if (++backend->fails < backend->maxFails) {
+      return;
+    }
+  }
+  unsigned doublings = std::min(backend->backoff, static_cast<unsigned>(UPSTREAM_MAX_BACKOFF));
+  backend->downUntil = now + backend->failTimeout * (1 << doublings);
+  backend->backoff++;
+  backend->fails = 0;
+}
+
+size_t UpstreamGroup::size() const {
+  return _backends.size();
+}
+
+/** Probe the backends of this group as configured */
+void UpstreamGroup::setHealthCheck(const HealthCheck& check) {
+  _check = check;
+}
+
+const UpstreamGroup::HealthCheck& UpstreamGroup::healthCheck() const {
+  return _check;
+}
+
+/** Result of a health probe of a backend */
+void UpstreamGroup::probed(Backend* backend, bool ok, std::chrono::microseconds latency) {
+  backend->probing = false;
+  backend->latency = latency;
+  ++backend->probes;
+  if (!ok) {
+    ++backend->probeFailures;
+  }
+  if (ok != backend->healthy) {
+    ++backend->streak;
+  } else {
+    backend->streak = 0;
+  }
+  if (backend->healthy && backend->streak >= _check.fall) {
+    backend->healthy = false;
+    backend->streak = 0;
+  } else if (!backend->healthy && backend->streak >= _check.rise) {
+    // Seen up: passive failures counted before no longer keep it out
+    backend->healthy = true;
+    backend->streak = 0;
+    backend->fails = 0;
+    backend->backoff = 0;
+    backend->downUntil = {};
+  }
+}
+
+std::deque<UpstreamGroup::Backend>& UpstreamGroup::backends() {
+  return _backends;
+}
+
+const std::deque<UpstreamGroup::Backend>& UpstreamGroup::backends() const {
+  return _backends;
+}
+
+bool UpstreamGroup::live(const Backend& backend, std::chrono::steady_clock::time_point now,
+                         const std::vector<const Backend*>& tried) const {
+  return backend.healthy && now >= backend.downUntil && std::find(tried.begin(), tried.end(), &backend) == tried.end();
+}
+
+/** Smooth weighted round robin: weights 5,1,1 give a a b a c a a, not a a a a a b c */
+UpstreamGroup::Backend* UpstreamGroup::pickRoundRobin(std::chrono::steady_clock::time_point now,
+                                                      const std::vector<const Backend*>& tried) {
+  Backend* best = nullptr;
+  int total = 0;
+  for (Backend& backend : _backends) {
+    if (!live(backend, now, tried)) {
+      continue;
+    }
+    backend.currentWeight += backend.weight;
+    total += backend.weight;
+    if (!best || backend.currentWeight > best->currentWeight) {
+      best = &backend;
+    }
+  }
+  if (best) {
+    best->currentWeight -= total;
+  }
+  return best;
+}
+
+/** Fewest active requests per unit of weight, ties taken in turn */
+UpstreamGroup::Backend* UpstreamGroup::pickLeastConn(std::chrono::steady_clock::time_point now,
+                                                     const std::vector<const Backend*>& tried) {
+  Backend* best = nullptr;
+  size_t count = _backends.size();
+  for (size_t i = 0; i < count; ++i) {
+    Backend& backend = _backends[(_next + i) % count];
+    if (!live(backend, now, tried)) {
+      continue;
+    }
+    if (!best || backend.active * best->weight < best->active * backend.weight) {
+      best = &backend;
+    }
+  }
+  _next = (_next + 1) % count;
+  return best;
+}
+
+/** First live backend clockwise from the key's point on the ring */
+UpstreamGroup::Backend* UpstreamGroup::pickHash(const std::string& key, std::chrono::steady_clock::time_point now,
+                                                const std::vector<const Backend*>& tried) {
+  if (_ring.empty()) {
+    return nullptr;
+  }
+  std::pair<uint32_t, size_t> point(hashKey(key), 0);
+  size_t start = std::lower_bound(_ring.begin(), _ring.end(), point) - _ring.begin();
+  for (size_t i = 0; i < _ring.size(); ++i) {
+    Backend& backend = _backends[_ring[(start + i) % _ring.size()].second];
+    if (live(backend, now, tried)) {
+      return &backend;
+    }
+  }
+  return nullptr;
+}
+
+} // namespace router::handlers
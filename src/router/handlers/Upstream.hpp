@@ -0,0 +1,164 @@
+/**
+ * @file Upstream.hpp
+ * @brief Upstream backends: pooled keep-alive connections and load balancing between them
+ */
+
+#pragma once
+
+#include <string> // for std::string
+#include <deque> // for std::deque
+#include <vector> // for std::vector
+#include <map> // for std::map
+#include <memory> // for std::unique_ptr
+#include <chrono> // for std::chrono::steady_clock
+#include <cstdint> // for uint32_t
+#include <netinet/in.h> // for sockaddr_in
+
+#include "../../request/Request.hpp"
+
+namespace router::handlers {
+
+/**
+ * @brief Idle keep-alive connections to one upstream address
+ *
+ * A connection comes back after a complete exchange and is handed to the next
+ * request for that address, newest first. Connections the upstream closed
+ * while idle, or idle longer than PROXY_KEEPALIVE_TIMEOUT, are dropped when
+ * they are next looked at.
+ */
+class UpstreamPool {
+public:
+  /** @param keepalive Idle connections kept, 0 closes each one after its request */
+  UpstreamPool(const sockaddr_in& address, size_t keepalive);
+  ~UpstreamPool();
+
+  UpstreamPool(const UpstreamPool&) = delete;
+  UpstreamPool& operator=(const UpstreamPool&) = delete;
+
+  /** Idle connection still open, -1 when there is none */
+  int acquire();
+
+  /** Start a non-blocking connection, -1 when it failed at once */
+  int open() const;
+
+  /** Take a connection back after a complete exchange */
+  void release(int fd);
+
+private:
+  struct Idle {
+    int fd;
+    std::chrono::steady_clock::time_point since;
+  };
+
+  sockaddr_in _address;
+  size_t _keepalive;
+  std::deque<Idle> _idle;   // most recently released at the back
+};
+
+/**
+ * @brief Backends of an upstream {} block, or the single address of a plain proxy_pass
+ *
+ * Each request picks a backend by the group's policy: smooth weighted round
+ * robin, fewest active requests per unit of weight, or a consistent hash of the
+ * request URI or client address, which keeps a key on the same backend while
+ * the set of live backends does not change.
+ *
+ * Failures are detected passively. max_fails failed requests within
+ * fail_timeout take a backend out for fail_timeout; one that fails again on
+ * its first request back is taken out for twice as long, up to
+ * 2^UPSTREAM_MAX_BACKOFF times. A success ends the backoff. The only backend
+ * of a group is never taken out this way.
+ *
+ * With a health check, the event loop also probes every backend each interval
+ * (see HealthProbe): fall failed probes in a row take it out until rise
+ * probes in a row pass, whether or not requests reach it.
+ */
+class UpstreamGroup {
+public:
+  enum Balance { ROUND_ROBIN, LEAST_CONN, HASH_URI, HASH_IP };
+
+  struct Backend {
+    std::string name;             // host:port
+    UpstreamPool* pool = nullptr;
+    int weight = 1;
+    size_t maxFails = 0;          // 0 = never taken out
+    std::chrono::milliseconds failTimeout{0};
+    int currentWeight = 0;        // smooth round robin state
+    size_t active = 0;            // requests in progress
+    size_t fails = 0;             // within the current fail_timeout window
+    std::chrono::steady_clock::time_point firstFail;
+    std::chrono::steady_clock::time_point downUntil;
+    unsigned backoff = 0;         // times taken out in a row
+    bool healthy = true;          // by the active health check
+    unsigned streak = 0;          // probes in a row contradicting healthy
+    bool probing = false;         // a probe is running
+    std::chrono::steady_clock::time_point nextProbe;
+    std::chrono::microseconds latency{0};   // of the last probe
+    size_t probes = 0;
+    size_t probeFailures = 0;
+  };
+
+  struct HealthCheck {
+    std::string path;             // empty = no active checks
+    int status = 200;
+    std::chrono::milliseconds interval{0};
+    std::chrono::milliseconds timeout{0};
+    unsigned rise = 1;
+    unsigned fall = 1;
+  };
+
+  explicit UpstreamGroup(Balance balance);
+
+  UpstreamGroup(const UpstreamGroup&) = delete;
+  UpstreamGroup& operator=(const UpstreamGroup&) = delete;
+
+  /** Add a backend; failTimeout in seconds */
+  void addBackend(const std::string& name, UpstreamPool* pool, int weight, size_t maxFails, size_t failTimeout);
+
+  /**
+   * @brief Backend for a request, counted active until release()
+   * @param tried Backends this request already failed on, skipped
+   * @return nullptr when no live backend is left
+   */
+  Backend* pick(const Request& req, const std::vector<const Backend*>& tried = {});
+
+  /** Request done with its backend */
+  void release(Backend* backend);
+
+  /** Outcome of an exchange with a backend; a failure counts towards taking it out */
+  void report(Backend* backend, bool ok);
+
+  size_t size() const;
+
+  /** Probe the backends of this group as configured */
+  void setHealthCheck(const HealthCheck& check);
+  const HealthCheck& healthCheck() const;
+
+  /** Result of a health probe of a backend */
+  void probed(Backend* backend, bool ok, std::chrono::microseconds latency);
+
+  std::deque<Backend>& backends();
+  const std::deque<Backend>& backends() const;
+
+private:
+  bool live(const Backend& backend, std::chrono::steady_clock::time_point now,
+            const std::vector<const Backend*>& tried) const;
+  Backend* pickRoundRobin(std::chrono::steady_clock::time_point now, const std::vector<const Backend*>& tried);
+  Backend* pickLeastConn(std::chrono::steady_clock::time_point now, const std::vector<const Backend*>& tried);
+  Backend* pickHash(const std::string& key, std::chrono::steady_clock::time_point now,
+                    const std::vector<const Backend*>& tried);
+
+  Balance _balance;
+  HealthCheck _check;
+  std::deque<Backend> _backends;                    // stable addresses, handed out to jobs
+  std::vector<std::pair<uint32_t, size_t>> _ring;   // hash point → backend index, sorted
+  size_t _next = 0;                                 // least_conn tie breaker
+};
+
+/** Pools per upstream "host:port", shared by the groups reaching it */
+using UpstreamPoolMap = std::map<std::string, std::unique_ptr<UpstreamPool>>;
+
+/** Groups per upstream {} block ("<server id>/<name>") or plain proxy_pass address ("host:port") */
+using UpstreamGroupMap = std::map<std::string, std::unique_ptr<UpstreamGroup>>;
+
+} // namespace router::handlers
@@ -0,0 +1,322 @@
+/**
+ * @file AutoindexCache.cpp
+ * @brief Compiled autoindex templates and rendered directory listings implementation
+ */
+
+#include "AutoindexCache.hpp"
+#include "FileUtils.hpp"
+#include "StringUtils.hpp"
+#include "../HttpConstants.hpp"
+#include "../../server/Log.hpp"
+
+#include <sys/stat.h> // for stat
+#include <filesystem> // for std::filesystem::directory_iterator, std::filesystem::exists
+#include <stdexcept> // for std::runtime_error
+
+namespace router {
+namespace utils {
+
+namespace {
+
+bool sameTime(const timespec& a, const timespec& b) {
+  return a.tv_sec == b.tv_sec && a.tv_nsec == b.tv_nsec;
+}
+
+void appendSize(std::string& out, const AutoindexCache::Item& item) {
+  if (item.isDir || !item.statOk) {
+    out += '-';
+  } else if (item.size < 1024) {
+    out += std::to_string(item.size);
+    out += " B";
+  } else if (item.size < 1024 * 1024) {
+    out += std::to_string(item.size / 1024);
+    out += " KB";
+  } else {
+    out += std::to_string(item.size / (1024 * 1024));
+    out += " MB";
+  }
+}
+
+/** Local time to the minute; entries of one directory often share it, so the last one is reused */
+void appendDate(std::string& out, const AutoindexCache::Item& item) {
+  thread_local bool valid = false;
+  thread_local time_t lastMinute = 0;
+  thread_local std::string text;
+
+  if (!item.statOk) {
+    out += '-';
+    return;
+  }
+  time_t minute = item.mtime / 60;
+  if (!valid || minute != lastMinute) {
+    std::tm local {};
+    localtime_r(&item.mtime, &local);
+    char buffer[20];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M", &local);
+    text = buffer;
+    lastMinute = minute;
+    valid = true;
+  }
+  out += text;
+}
+
+} // namespace
+
+AutoindexCache::AutoindexCache(size_t maxEntries, long ttlMs)
+  : _maxEntries(maxEntries), _ttl(ttlMs) {}
+
+/** Listing of dirPath for requestPath; throws std::runtime_error when no template is found */
+std::string AutoindexCache::listing(const std::string& dirPath, const std::string& requestPath, const std::string& serverRoot) {
+  std::string key = dirPath + '\0' + requestPath;
+  struct stat dirStat {};
+  bool dirOk = stat(dirPath.c_str(), &dirStat) == 0;
+  auto now = std::chrono::steady_clock::now();
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _listings.find(key);
+    if (dirOk && it != _listings.end() && now - it->second.renderedAt < _ttl
+        && sameTime(it->second.dirMtime, dirStat.st_mtim)) {
+      struct stat templateStat {};
+      if (stat(it->second.templatePath.c_str(), &templateStat) == 0
+          && sameTime(it->second.templateMtime, templateStat.st_mtim)) {
+        return it->second.html;
+      }
+    }
+  }
+
+  std::string templatePath;
+  struct stat templateStat {};
+  Template page = compiledTemplate(dirPath, serverRoot, templatePath, templateStat);
+
+  // Rendered without the lock, other listings are served meanwhile
+  std::string html;
+  render(page, dirPath, requestPath, html);
+  if (!dirOk) {
+    return html;
+  }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (_listings.size() >= _maxEntries && !_listings.count(key)) {
+    auto oldest = _listings.begin();
+    for (auto it = _listings.begin(); it != _listings.end(); ++it) {
+      if (it->second.renderedAt < oldest->second.renderedAt) {
+        oldest = it;
+      }
+    }
+    _listings.erase(oldest);
+  }
+  Listing& entry = _listings[key];
+  entry.dirMtime = dirStat.st_mtim;
+  entry.templateMtime = templateStat.st_mtim;
+  entry.templatePath = templatePath;
+  entry.html = html;
+  entry.renderedAt = now;
+  return html;
+}
+
+/** Compiled template for a listing of dirPath; throws std::runtime_error when none is found */
+AutoindexCache::Template AutoindexCache::compiledTemplate(const std::string& dirPath, const std::string& serverRoot) {
+  std::string templatePath;
+  struct stat templateStat {};
+  return compiledTemplate(dirPath, serverRoot, templatePath, templateStat);
+}
+
+/** Split a template at its placeholders */
+AutoindexCache::Template AutoindexCache::compile(const std::string& html) {
+  static const struct {
+    const char* name;
+    Segment::Kind kind;
+  } placeholders[] = {
+    {"{{PATH}}", Segment::PATH},
+    {"{{PARENT_LINK}}", Segment::PARENT_LINK},
+    {"{{ITEMS}}", Segment::ITEMS},
+  };
+
+  Template page;
+  size_t textStart = 0;
+  size_t pos = html.find("{{");
+  while (pos != std::string::npos) {
+    bool matched = false;
+    for (const auto& placeholder : placeholders) {
+      std::string_view name(placeholder.name);
+      if (html.compare(pos, name.size(), name) == 0) {
+        if (pos > textStart) {
+          page.push_back({Segment::TEXT, html.substr(textStart, pos - textStart)});
+        }
+        page.push_back({placeholder.kind, ""});
+        textStart = pos + name.size();
+        matched = true;
+        break;
+      }
+    }
+    pos = html.find("{{", matched ? textStart : pos + 2);
+  }
+  if (textStart < html.size()) {
+    page.push_back({Segment::TEXT, html.substr(textStart)});
+  }
+  return page;
+}
+
+/** Render a listing of dirPath into out, which is sized once up front */
+void AutoindexCache::render(const Template& page, const std::string& dirPath, const std::string& requestPath, std::string& out) {
+  std::string parentLink = AutoindexCache::parentLink(requestPath);
+
+  std::string linkBase = requestPath;
+  if (linkBase.empty() || linkBase.back() != '/') linkBase += '/';
+
+  // One stat per entry gives type, size and date
+  std::vector<Item> entries;
+  std::string error;
+  try {
+    for (const auto& dirEntry : std::filesystem::directory_iterator(dirPath)) {
+      Item entry;
+      entry.name = dirEntry.path().filename().string();
+      struct stat st {};
+      if (stat(dirEntry.path().c_str(), &st) == 0) {
+        entry.statOk = true;
+        entry.isDir = S_ISDIR(st.st_mode);
+        entry.size = st.st_size;
+        entry.mtime = st.st_mtim.tv_sec;
+      } else {
+        entry.isDir = dirEntry.is_directory();
+      }
+      entries.push_back(std::move(entry));
+    }
+  } catch (const std::exception& e) {
+    error = "    <div class=\"item\">Error reading directory: " + std::string(e.what()) + "</div>\n";
+  }
+
+  // Fixed markup of an item is under 200 bytes, plus the link and the name twice
+  size_t estimate = error.size();
+  for (const auto& segment : page) {
+    estimate += segment.kind == Segment::TEXT ? segment.text.size() : requestPath.size() + parentLink.size();
+  }
+  for (const auto& entry : entries) {
+    estimate += 200 + linkBase.size() + 2 * entry.name.size();
+  }
+  out.clear();
+  out.reserve(estimate);
+
+  for (const auto& segment : page) {
+    switch (segment.kind) {
+      case Segment::TEXT:
+        out += segment.text;
+        break;
+      case Segment::PATH:
+        out += requestPath;
+        break;
+      case Segment::PARENT_LINK:
+        out += parentLink;
+        break;
+      case Segment::ITEMS:
+        for (const auto& entry : entries) {
+          appendItem(out, linkBase, entry);
+        }
+        out += error;
+        break;
+    }
+  }
+}
+
+/** Template lookup shared by listing() and compiledTemplate(), reporting the file it came from */
+AutoindexCache::Template AutoindexCache::compiledTemplate(const std::string& dirPath, const std::string& serverRoot,
+                                                          std::string& templatePath, struct stat& templateStat) {
+  templatePath = findTemplate(dirPath, serverRoot);
+  if (templatePath.empty() || stat(templatePath.c_str(), &templateStat) != 0) {
+    // If no template found anywhere, throw an exception
+    LOG_ERROR("Could not find autoindex template for " << dirPath);
+    throw std::runtime_error("Could not load directory listing template");
+  }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  const Template* compiled = loadTemplate(templatePath, templateStat.st_mtim);
+  if (!compiled) {
+    throw std::runtime_error("Could not load directory listing template");
+  }
+  return *compiled;
+}
+
+/** Back link to the parent of requestPath, empty for "/" */
+std::string AutoindexCache::parentLink(const std::string& requestPath) {
+  if (requestPath == "/") {
+    return "";
+  }
+  std::string parentPath = requestPath;
+  if (!parentPath.empty() && parentPath.back() == '/') {
+    parentPath.pop_back();
+  }
+  size_t lastSlash = parentPath.find_last_of('/');
+  if (lastSlash == std::string::npos) {
+    return "";
+  }
+  parentPath = parentPath.substr(0, lastSlash);
+  if (parentPath.empty()) parentPath = "/";
+  return "  <a href=\"" + parentPath + "\" class=\"back-link\">← Parent directory</a>\n";
+}
+
+/** Markup of one item; linkBase ends with '/' */
+void AutoindexCache::appendItem(std::string& out, const std::string& linkBase, const Item& item) {
+  out += "    <div class=\"item\">\n      <span class=\"";
+  out += item.isDir ? "dir-icon\">📁" : "file-icon\">📄";
+  out += "</span>\n      <a href=\"";
+  out += linkBase;
+  out += item.name;
+  out += "\" class=\"name\">";
+  out += item.name;
+  out += "</a>\n      <span class=\"size\">";
+  appendSize(out, item);
+  out += "</span>\n      <span class=\"date\">";
+  appendDate(out, item);
+  out += "</span>\n    </div>\n";
+}
+
+/** First template found from dirPath up to serverRoot, empty when there is none */
+std::string AutoindexCache::findTemplate(const std::string& dirPath, const std::string& serverRoot) {
+  // 1. Current directory
+  std::vector<std::string> searchPaths;
+  searchPaths.push_back(StringUtils::normalizePath(dirPath + "/" + page::AUTOINDEX_TEMPLATE));
+  searchPaths.push_back(StringUtils::normalizePath(dirPath + "/" + page::AUTOINDEX_FALLBACK));
+
+  // 2. Parent directories (walking up the tree)
+  std::string currentPath = dirPath;
+  while (currentPath != serverRoot && currentPath.length() > serverRoot.length()) {
+    currentPath = currentPath.substr(0, currentPath.find_last_of('/'));
+    if (currentPath.length() >= serverRoot.length()) {
+      searchPaths.push_back(StringUtils::normalizePath(currentPath + "/" + page::AUTOINDEX_TEMPLATE));
+      searchPaths.push_back(StringUtils::normalizePath(currentPath + "/" + page::AUTOINDEX_FALLBACK));
+    }
+  }
+
+  // 3. Server root as final fallback
+  searchPaths.push_back(StringUtils::normalizePath(serverRoot + "/" + page::AUTOINDEX_TEMPLATE));
+  searchPaths.push_back(StringUtils::normalizePath(serverRoot + "/" + page::AUTOINDEX_FALLBACK));
+
+  for (const auto& templatePath : searchPaths) {
+    std::error_code error;
+    if (std::filesystem::exists(templatePath, error)) {
+      return templatePath;
+    }
+  }
+  return "";
+}
+
+/** Compiled template at path, re-read when its mtime changed; nullptr when it cannot be read */
+const AutoindexCache::Template* AutoindexCache::loadTemplate(const std::string& path, const timespec& mtime) {
+  auto it = _templates.find(path);
+  if (it != _templates.end() && sameTime(it->second.mtime, mtime)) {
+    return &it->second.page;
+  }
+  try {
+    CompiledTemplate& compiled = _templates[path];
+    compiled.page = compile(FileUtils::readFileToString(path));
+    compiled.mtime = mtime;
+    return &compiled.page;
+  } catch (const std::exception&) {
+    _templates.erase(path);
+    return nullptr;
+  }
+}
+
+} // namespace utils
+} // namespace router
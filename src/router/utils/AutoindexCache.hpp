@@ -0,0 +1,102 @@
+/**
+ * @file AutoindexCache.hpp
+ * @brief Compiled autoindex templates and rendered directory listings
+ */
+
+#pragma once
+
+#include <chrono> // for std::chrono::steady_clock
+#include <ctime> // for timespec, time_t
+#include <sys/stat.h> // for struct stat
+#include <sys/types.h> // for off_t
+#include <map> // for std::map
+#include <mutex> // for std::mutex
+#include <string> // for std::string
+#include <vector> // for std::vector
+
+namespace router {
+namespace utils {
+
+/**
+ * @brief Directory listings rendered once and served until the directory changes
+ *
+ * Templates are split into literal text and placeholders when first read.
+ * A listing stays valid while the directory's and the template's mtimes are
+ * unchanged and it is younger than the cache TTL, which bounds how long an
+ * in-place file edit (which leaves the directory mtime alone) shows stale
+ * sizes. Safe to use from the file I/O threads.
+ */
+class AutoindexCache {
+public:
+  /** Piece of a compiled template */
+  struct Segment {
+    enum Kind { TEXT, PATH, PARENT_LINK, ITEMS };
+    Kind kind;
+    std::string text;   // TEXT only
+  };
+
+  /** Template split at its {{PATH}}, {{PARENT_LINK}} and {{ITEMS}} placeholders */
+  using Template = std::vector<Segment>;
+
+  /** Directory entry, stat()ed once */
+  struct Item {
+    std::string name;
+    bool isDir = false;
+    bool statOk = false;   // size and mtime are known
+    off_t size = 0;
+    time_t mtime = 0;
+  };
+
+  AutoindexCache(size_t maxEntries, long ttlMs);
+
+  /** Listing of dirPath for requestPath; throws std::runtime_error when no template is found */
+  std::string listing(const std::string& dirPath, const std::string& requestPath, const std::string& serverRoot);
+
+  /** Compiled template for a listing of dirPath; throws std::runtime_error when none is found */
+  Template compiledTemplate(const std::string& dirPath, const std::string& serverRoot);
+
+  /** Split a template at its placeholders */
+  static Template compile(const std::string& html);
+
+  /** Render a listing of dirPath into out, which is sized once up front */
+  static void render(const Template& page, const std::string& dirPath, const std::string& requestPath, std::string& out);
+
+  /** Back link to the parent of requestPath, empty for "/" */
+  static std::string parentLink(const std::string& requestPath);
+
+  /** Markup of one item; linkBase ends with '/' */
+  static void appendItem(std::string& out, const std::string& linkBase, const Item& item);
+
+private:
+  struct CompiledTemplate {
+    timespec mtime {};
+    Template page;
+  };
+
+  struct Listing {
+    timespec dirMtime {};
+    timespec templateMtime {};
+    std::string templatePath;
+    std::string html;
+    std::chrono::steady_clock::time_point renderedAt;
+  };
+
+  /** Template lookup shared by listing() and compiledTemplate(), reporting the file it came from */
+  Template compiledTemplate(const std::string& dirPath, const std::string& serverRoot, std::string& templatePath,
+                            struct stat& templateStat);
+
+  /** First template found from dirPath up to serverRoot, empty when there is none */
+  static std::string findTemplate(const std::string& dirPath, const std::string& serverRoot);
+
+  /** Compiled template at path, re-read when its mtime changed; nullptr when it cannot be read */
+  const Template* loadTemplate(const std::string& path, const timespec& mtime);
+
+  size_t _maxEntries;
+  std::chrono::milliseconds _ttl;
+  std::mutex _mutex;
+  std::map<std::string, CompiledTemplate> _templates;   // template path -> compiled template
+  std::map<std::string, Listing> _listings;            // dirPath + '\0' + requestPath -> listing
+};
+
+} // namespace utils
+} // namespace router
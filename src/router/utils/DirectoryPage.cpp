@@ -0,0 +1,403 @@
+/**
+ * @file DirectoryPage.cpp
+ * @brief One page of a directory listing, read and rendered a batch at a time implementation
+ */
+
+#include "DirectoryPage.hpp"
+
+#include <fcntl.h> // for open, O_RDONLY, O_DIRECTORY, O_CLOEXEC
+#include <dirent.h> // for DT_DIR
+#include <sys/stat.h> // for fstatat
+#include <sys/syscall.h> // for SYS_getdents64
+#include <unistd.h> // for close, lseek, syscall
+#include <algorithm> // for std::nth_element, std::partial_sort
+#include <cerrno> // for errno
+#include <cstdint> // for uint64_t, int64_t
+#include <cstdio> // for std::snprintf
+#include <climits> // for LLONG_MAX
+#include <cstring> // for std::strcmp, std::strerror
+#include <stdexcept> // for std::runtime_error
+
+namespace router {
+namespace utils {
+
+namespace {
+
+/** Record layout returned by getdents64 */
+struct LinuxDirent64 {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+const size_t DIRENT_BUFFER_SIZE = 32768;
+
+/** Decimal number that fits a long long, with an optional sign when allowNegative */
+bool parseNumber(std::string_view text, long long& out, bool allowNegative) {
+  bool negative = allowNegative && !text.empty() && text[0] == '-';
+  if (negative) {
+    text.remove_prefix(1);
+  }
+  if (text.empty()) {
+    return false;
+  }
+  long long value = 0;
+  for (char c : text) {
+    if (c < '0' || c > '9' || value > (LLONG_MAX - (c - '0')) / 10) {
+      return false;
+    }
+    value = value * 10 + (c - '0');
+  }
+  out = negative ? -value : value;
+  return true;
+}
+
+void appendJsonString(std::string& out, const std::string& text) {
+  out += '"';
+  for (unsigned char c : text) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += static_cast<char>(c);
+    } else if (c < 0x20) {
+      char escaped[7];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      out += escaped;
+    } else {
+      out += static_cast<char>(c);
+    }
+  }
+  out += '"';
+}
+
+} // namespace
+
+/** Read page, cursor, limit, sort, order and format from a query string; false when one is malformed */
+bool parseListingQuery(std::string_view query, ListingQuery& out) {
+  out = ListingQuery();
+  bool hasPage = false;
+  while (!query.empty()) {
+    size_t amp = query.find('&');
+    std::string_view param = query.substr(0, amp);
+    query = amp == std::string_view::npos ? std::string_view() : query.substr(amp + 1);
+
+    size_t eq = param.find('=');
+    std::string_view key = param.substr(0, eq);
+    std::string_view value = eq == std::string_view::npos ? std::string_view() : param.substr(eq + 1);
+    long long number = 0;
+
+    if (key == "page") {
+      if (!parseNumber(value, number, false) || number < 1) {
+        return false;
+      }
+      out.page = static_cast<size_t>(number);
+      hasPage = true;
+    } else if (key == "cursor") {
+      if (!parseNumber(value, number, true)) {
+        return false;
+      }
+      out.cursor = number;
+      out.hasCursor = true;
+    } else if (key == "limit") {
+      if (!parseNumber(value, number, false) || number < 1 || number > AUTOINDEX_PAGE_MAX) {
+        return false;
+      }
+      out.limit = static_cast<size_t>(number);
+    } else if (key == "sort") {
+      if (value == "name") out.sort = ListingQuery::NAME;
+      else if (value == "size") out.sort = ListingQuery::SIZE;
+      else if (value == "mtime") out.sort = ListingQuery::MTIME;
+      else if (value == "none") out.sort = ListingQuery::NONE;
+      else return false;
+    } else if (key == "order") {
+      if (value != "asc" && value != "desc") {
+        return false;
+      }
+      out.descending = value == "desc";
+    } else if (key == "format") {
+      if (value != "html" && value != "json") {
+        return false;
+      }
+      out.json = value == "json";
+    } else {
+      continue;   // not a listing parameter
+    }
+    out.paged = true;
+  }
+
+  // A cursor is a position in directory order, it means nothing in a sorted listing
+  if (out.hasCursor && (hasPage || out.sort != ListingQuery::NONE)) {
+    return false;
+  }
+  return true;
+}
+
+// ========================= PAGE =========================
+
+DirectoryPage::DirectoryPage(const std::string& dirPath, const std::string& requestPath, const ListingQuery& query,
+                             AutoindexCache::Template page)
+  : _requestPath(requestPath), _linkBase(requestPath), _query(query), _template(std::move(page)) {
+  _fd = open(dirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (_fd == -1) {
+    throw std::runtime_error("Error reading directory: " + std::string(std::strerror(errno)));
+  }
+  if (_linkBase.empty() || _linkBase.back() != '/') _linkBase += '/';
+
+  _items = _template.size();
+  for (size_t i = 0; i < _template.size(); ++i) {
+    if (_template[i].kind == AutoindexCache::Segment::ITEMS) {
+      _items = i;
+      break;
+    }
+  }
+  _buffer.resize(DIRENT_BUFFER_SIZE);
+}
+
+DirectoryPage::~DirectoryPage() {
+  close(_fd);
+}
+
+/** Append up to count more entries, the page head before the first and its tail after the last */
+void DirectoryPage::renderNext(std::string& out, size_t count) {
+  if (_state == DONE) {
+    return;
+  }
+  if (_state == START) {
+    start(out);
+    _state = ENTRIES;
+  }
+
+  bool sorted = _query.sort != ListingQuery::NONE;
+  bool exhausted = false;
+  for (; count > 0 && _remaining > 0; --count, --_remaining) {
+    if (sorted) {
+      const auto& [item, type] = _sorted[_next++];
+      // Sorting by name needs no inode, so it is read for the slice only
+      appendEntry(out, item.statOk || _query.sort != ListingQuery::NAME ? item : statItem(item.name, type));
+      continue;
+    }
+    Name name;
+    if (!readName(name)) {
+      exhausted = true;
+      break;
+    }
+    appendEntry(out, statItem(name.name, name.type));
+    _lastOffset = name.offset;
+  }
+
+  if (_remaining > 0 && !exhausted) {
+    return;
+  }
+  if (!sorted && !exhausted) {
+    // More entries after the page only if one can still be read; the cursor stays before it
+    Name name;
+    _hasMore = readName(name);
+  }
+  end(out);
+  _state = DONE;
+}
+
+/** True once the tail is rendered */
+bool DirectoryPage::finished() const {
+  return _state == DONE;
+}
+
+/** Next entry in directory order without "." and "..", false at the end */
+bool DirectoryPage::readName(Name& out) {
+  while (true) {
+    if (_bufferPos >= _bufferEnd) {
+      if (_eof) {
+        return false;
+      }
+      long bytes = syscall(SYS_getdents64, _fd, _buffer.data(), _buffer.size());
+      if (bytes < 0) {
+        throw std::runtime_error("Error reading directory: " + std::string(std::strerror(errno)));
+      }
+      if (bytes == 0) {
+        _eof = true;
+        return false;
+      }
+      _bufferPos = 0;
+      _bufferEnd = static_cast<size_t>(bytes);
+    }
+
+    const LinuxDirent64* entry = reinterpret_cast<const LinuxDirent64*>(_buffer.data() + _bufferPos);
+    _bufferPos += entry->d_reclen;
+    if (std::strcmp(entry->d_name, ".") == 0 || std::strcmp(entry->d_name, "..") == 0) {
+      continue;
+    }
+    out.name = entry->d_name;
+    out.type = entry->d_type;
+    out.offset = entry->d_off;
+    return true;
+  }
+}
+
+/** Entry with its inode data; type decides isDir when stat() fails */
+AutoindexCache::Item DirectoryPage::statItem(const std::string& name, unsigned char type) const {
+  AutoindexCache::Item item;
+  item.name = name;
+  struct stat st {};
+  if (fstatat(_fd, name.c_str(), &st, 0) == 0) {
+    item.statOk = true;
+    item.isDir = S_ISDIR(st.st_mode);
+    item.size = st.st_size;
+    item.mtime = st.st_mtim.tv_sec;
+  } else {
+    item.isDir = type == DT_DIR;
+  }
+  return item;
+}
+
+/** Position at the page and render everything before the first entry */
+void DirectoryPage::start(std::string& out) {
+  size_t skip = (_query.page - 1) * _query.limit;
+
+  if (_query.sort == ListingQuery::NONE) {
+    if (_query.hasCursor) {
+      if (lseek(_fd, _query.cursor, SEEK_SET) == -1) {
+        throw std::runtime_error("Error reading directory: " + std::string(std::strerror(errno)));
+      }
+      _lastOffset = _query.cursor;
+    } else {
+      // Earlier pages cost a name each, no stat()
+      Name name;
+      for (size_t i = 0; i < skip && readName(name); ++i) {
+        _lastOffset = name.offset;
+      }
+    }
+    _remaining = _query.limit;
+  } else {
+    ListingQuery::Sort sort = _query.sort;
+    Name name;
+    while (readName(name)) {
+      AutoindexCache::Item item;
+      if (sort == ListingQuery::NAME) {
+        item.name = std::move(name.name);
+        item.isDir = name.type == DT_DIR;
+      } else {
+        item = statItem(name.name, name.type);
+      }
+      _sorted.emplace_back(std::move(item), name.type);
+    }
+
+    bool descending = _query.descending;
+    auto less = [sort, descending](const std::pair<AutoindexCache::Item, unsigned char>& left,
+                                   const std::pair<AutoindexCache::Item, unsigned char>& right) {
+      const AutoindexCache::Item& a = descending ? right.first : left.first;
+      const AutoindexCache::Item& b = descending ? left.first : right.first;
+      if (sort == ListingQuery::SIZE && a.size != b.size) return a.size < b.size;
+      if (sort == ListingQuery::MTIME && a.mtime != b.mtime) return a.mtime < b.mtime;
+      return a.name < b.name;
+    };
+
+    // Only the page's slice ends up in order
+    _next = std::min(skip, _sorted.size());
+    _end = std::min(_next + _query.limit, _sorted.size());
+    if (_next < _end) {
+      std::nth_element(_sorted.begin(), _sorted.begin() + _next, _sorted.end(), less);
+      std::partial_sort(_sorted.begin() + _next, _sorted.begin() + _end, _sorted.end(), less);
+    }
+    _remaining = _end - _next;
+    _hasMore = _end < _sorted.size();
+  }
+
+  if (_query.json) {
+    out += "{\"path\":";
+    appendJsonString(out, _requestPath);
+    out += ",\"entries\":[";
+    return;
+  }
+  std::string parentLink = AutoindexCache::parentLink(_requestPath);
+  for (size_t i = 0; i < _items; ++i) {
+    const AutoindexCache::Segment& segment = _template[i];
+    out += segment.kind == AutoindexCache::Segment::PATH ? _requestPath
+         : segment.kind == AutoindexCache::Segment::PARENT_LINK ? parentLink : segment.text;
+  }
+}
+
+/** Render everything after the last entry */
+void DirectoryPage::end(std::string& out) {
+  // Directory order continues from a cursor; sorted pages are numbered
+  bool byCursor = _query.sort == ListingQuery::NONE;
+  std::string next;
+  if (_hasMore) {
+    next = byCursor ? link(0, _lastOffset, true) : link(_query.page + 1, 0, false);
+  }
+
+  if (_query.json) {
+    out += "],\"next\":";
+    if (next.empty()) {
+      out += "null";
+    } else {
+      appendJsonString(out, next);
+    }
+    out += "}\n";
+    return;
+  }
+
+  std::string previous;
+  if (!_query.hasCursor && _query.page > 1) {
+    previous = link(_query.page - 1, 0, false);
+  }
+  if (!previous.empty() || !next.empty()) {
+    out += "    <div class=\"pager\">\n";
+    if (!previous.empty()) {
+      out += "      <a href=\"" + previous + "\" class=\"prev-link\">← Previous page</a>\n";
+    }
+    if (!next.empty()) {
+      out += "      <a href=\"" + next + "\" class=\"next-link\">Next page →</a>\n";
+    }
+    out += "    </div>\n";
+  }
+
+  std::string parentLink = AutoindexCache::parentLink(_requestPath);
+  for (size_t i = _items + 1; i < _template.size(); ++i) {
+    const AutoindexCache::Segment& segment = _template[i];
+    out += segment.kind == AutoindexCache::Segment::PATH ? _requestPath
+         : segment.kind == AutoindexCache::Segment::PARENT_LINK ? parentLink : segment.text;
+  }
+}
+
+void DirectoryPage::appendEntry(std::string& out, const AutoindexCache::Item& item) {
+  if (!_query.json) {
+    AutoindexCache::appendItem(out, _linkBase, item);
+    return;
+  }
+  if (!_firstEntry) {
+    out += ',';
+  }
+  _firstEntry = false;
+  out += "\n{\"name\":";
+  appendJsonString(out, item.name);
+  out += item.isDir ? ",\"type\":\"dir\"" : ",\"type\":\"file\"";
+  out += ",\"size\":";
+  out += item.statOk ? std::to_string(item.size) : "null";
+  out += ",\"mtime\":";
+  out += item.statOk ? std::to_string(item.mtime) : "null";
+  out += '}';
+}
+
+/** Link to this listing with the same parameters, at another page or cursor */
+std::string DirectoryPage::link(size_t page, long long cursor, bool useCursor) const {
+  static const char* sortNames[] = {"none", "name", "size", "mtime"};
+
+  std::string url = _requestPath;
+  url += useCursor ? "?cursor=" + std::to_string(cursor) : "?page=" + std::to_string(page);
+  url += "&limit=" + std::to_string(_query.limit);
+  if (_query.sort != ListingQuery::NONE) {
+    url += "&sort=";
+    url += sortNames[_query.sort];
+  }
+  if (_query.descending) {
+    url += "&order=desc";
+  }
+  if (_query.json) {
+    url += "&format=json";
+  }
+  return url;
+}
+
+} // namespace utils
+} // namespace router
@@ -0,0 +1,112 @@
+/**
+ * @file DirectoryPage.hpp
+ * @brief One page of a directory listing, read and rendered a batch at a time
+ */
+
+#pragma once
+
+#include <string> // for std::string
+#include <string_view> // for std::string_view
+#include <vector> // for std::vector
+
+#include "AutoindexCache.hpp"
+#include "../../../inc/webserv.hpp"
+
+namespace router {
+namespace utils {
+
+/** Paged listing parameters from the query string */
+struct ListingQuery {
+  enum Sort { NONE, NAME, SIZE, MTIME };
+
+  bool paged = false;        // any listing parameter was given
+  size_t page = 1;
+  bool hasCursor = false;
+  long long cursor = 0;      // directory offset after the last entry already sent
+  size_t limit = AUTOINDEX_PAGE_SIZE;
+  Sort sort = NONE;          // NONE keeps directory order, the only order a cursor works in
+  bool descending = false;
+  bool json = false;
+};
+
+/** Read page, cursor, limit, sort, order and format from a query string; false when one is malformed */
+bool parseListingQuery(std::string_view query, ListingQuery& out);
+
+/**
+ * @brief Page of a listing, as HTML from the autoindex template or as JSON
+ *
+ * Entries are read with getdents64. In directory order only the requested
+ * slice is stat()ed, and a cursor seeks straight to it; a page number skips
+ * the entries before it by name alone. Sorting reads every name, and every
+ * inode too when sorting by size or date, but still renders the slice only.
+ * Used from one thread at a time.
+ */
+class DirectoryPage {
+public:
+  /** Open dirPath; throws std::runtime_error when it cannot be read */
+  DirectoryPage(const std::string& dirPath, const std::string& requestPath, const ListingQuery& query,
+                AutoindexCache::Template page);
+  ~DirectoryPage();
+
+  DirectoryPage(const DirectoryPage&) = delete;
+  DirectoryPage& operator=(const DirectoryPage&) = delete;
+
+  /** Append up to count more entries, the page head before the first and its tail after the last */
+  void renderNext(std::string& out, size_t count);
+
+  /** True once the tail is rendered */
+  bool finished() const;
+
+private:
+  /** Entry as read from the directory */
+  struct Name {
+    std::string name;
+    unsigned char type;
+    long long offset;   // d_off: where reading continues after this entry
+  };
+
+  /** Next entry in directory order without "." and "..", false at the end */
+  bool readName(Name& out);
+
+  /** Entry with its inode data; type decides isDir when stat() fails */
+  AutoindexCache::Item statItem(const std::string& name, unsigned char type) const;
+
+  /** Position at the page and render everything before the first entry */
+  void start(std::string& out);
+
+  /** Render everything after the last entry */
+  void end(std::string& out);
+
+  void appendEntry(std::string& out, const AutoindexCache::Item& item);
+
+  /** Link to this listing with the same parameters, at another page or cursor */
+  std::string link(size_t page, long long cursor, bool useCursor) const;
+
+  int _fd;
+  std::string _requestPath;
+  std::string _linkBase;
+  ListingQuery _query;
+  AutoindexCache::Template _template;
+  size_t _items;   // index of the ITEMS segment, size() when the template has none
+
+  enum State { START, ENTRIES, DONE };
+  State _state = START;
+  size_t _remaining = 0;   // entries of the page not rendered yet
+  bool _firstEntry = true;
+
+  // getdents64 results not consumed yet
+  std::vector<char> _buffer;
+  size_t _bufferPos = 0;
+  size_t _bufferEnd = 0;
+  bool _eof = false;
+  long long _lastOffset = 0;
+  bool _hasMore = false;
+
+  // Sorted mode: the page's slice of the sorted entries
+  std::vector<std::pair<AutoindexCache::Item, unsigned char>> _sorted;
+  size_t _next = 0;
+  size_t _end = 0;
+};
+
+} // namespace utils
+} // namespace router
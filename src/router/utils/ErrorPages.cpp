@@ -0,0 +1,127 @@
+/**
+ * @file ErrorPages.cpp
+ * @brief Error responses of a server, built once when the configuration is loaded implementation
+ */
+
+#include "ErrorPages.hpp"
+#include "HttpResponseBuilder.hpp"
+#include "FileUtils.hpp"
+#include "../HttpConstants.hpp"
+#include "../../server/Server.hpp"
+
+namespace router {
+namespace utils {
+
+namespace {
+
+/** Statuses answered with an error page, the last one also stands in for all others */
+struct KnownStatus {
+  int code;
+  const std::string* status;
+  const char* reason;
+};
+
+const KnownStatus KNOWN_STATUSES[] = {
+  {http::BAD_REQUEST_400, &http::STATUS_BAD_REQUEST_400, "Bad Request"},
+  {http::FORBIDDEN_403, &http::STATUS_FORBIDDEN_403, "Forbidden"},
+  {http::NOT_FOUND_404, &http::STATUS_NOT_FOUND_404, "Not Found"},
+  {http::METHOD_NOT_ALLOWED_405, &http::STATUS_METHOD_NOT_ALLOWED_405, "Method Not Allowed"},
+  {http::REQUEST_TIMEOUT_408, &http::STATUS_REQUEST_TIMEOUT_408, "Request Timeout"},
+  {http::PAYLOAD_TOO_LARGE_413, &http::STATUS_PAYLOAD_TOO_LARGE_413, "Payload Too Large"},
+  {http::BAD_GATEWAY_502, &http::STATUS_BAD_GATEWAY_502, "Bad Gateway"},
+  {http::SERVICE_UNAVAILABLE_503, &http::STATUS_SERVICE_UNAVAILABLE_503, "Service Unavailable"},
+  {http::GATEWAY_TIMEOUT_504, &http::STATUS_GATEWAY_TIMEOUT_504, "Gateway Timeout"},
+  {http::INTERNAL_SERVER_ERROR_500, &http::STATUS_INTERNAL_SERVER_ERROR_500, "Internal Server Error"},
+};
+
+const int FIRST_CODE = 400;
+
+/** Custom page of code, empty when none is configured or the file can't be read */
+std::string readCustomPage(const Server& server, int code) {
+  const std::map<int, std::string>& errorPages = server.getErrorPages();
+  auto it = errorPages.find(code);
+  if (it == errorPages.end()) {
+    return "";
+  }
+  try {
+    return FileUtils::readFileToString(server.getRoot() + "/" + it->second);
+  } catch (const std::exception&) {
+    return "";
+  }
+}
+
+/** Headers and body as appendResponse would write them after the status line, Date and Server */
+std::shared_ptr<const std::string> serialize(const ErrorPages::Page& page, const std::string& connection) {
+  std::string out;
+  out.reserve(page.body.size() + 128);
+  out.append(http::CONTENT_TYPE).append(": ").append(http::CONTENT_TYPE_HTML).append("\r\n");
+  out.append(http::CONTENT_LENGTH).append(": ").append(page.contentLength).append("\r\n");
+  out.append(http::CONNECTION).append(": ").append(connection).append("\r\n");
+  out.append("\r\n");
+  out.append(page.body);
+  return std::make_shared<const std::string>(std::move(out));
+}
+
+} // namespace
+
+ErrorPages::ErrorPages() {
+  build(nullptr);
+}
+
+ErrorPages::ErrorPages(const Server& server) {
+  build(&server);
+}
+
+void ErrorPages::build(const Server* server) {
+  _pages.reserve(std::size(KNOWN_STATUSES));
+  for (const KnownStatus& known : KNOWN_STATUSES) {
+    Page page;
+    page.code = known.code;
+    page.status = *known.status;
+    if (server) {
+      page.body = readCustomPage(*server, known.code);
+    }
+    if (page.body.empty()) {
+      page.body = HttpResponseBuilder::makeDefaultErrorPage(known.code, known.reason);
+    }
+    page.contentLength = std::to_string(page.body.size());
+    page.keepAlive = serialize(page, http::CONNECTION_KEEP_ALIVE);
+    page.close = serialize(page, http::CONNECTION_CLOSE);
+    _pages.push_back(std::move(page));
+  }
+
+  // _pages doesn't grow past this point, so the pointers stay valid
+  for (const Page& page : _pages) {
+    _byCode[page.code - FIRST_CODE] = &page;
+    if (page.code == http::INTERNAL_SERVER_ERROR_500) {
+      _fallback = &page;
+    }
+  }
+}
+
+const ErrorPages::Page& ErrorPages::find(int status) const {
+  return contains(status) ? *_byCode[status - FIRST_CODE] : *_fallback;
+}
+
+bool ErrorPages::contains(int status) const {
+  return status >= FIRST_CODE && status < FIRST_CODE + static_cast<int>(_byCode.size())
+         && _byCode[status - FIRST_CODE] != nullptr;
+}
+
+std::shared_ptr<const ErrorPages> ErrorPages::of(const Server& server) {
+  if (server.getErrorPageCache()) {
+    return server.getErrorPageCache();
+  }
+  if (server.getErrorPages().empty()) {
+    return defaults();
+  }
+  return std::make_shared<const ErrorPages>(server);
+}
+
+const std::shared_ptr<const ErrorPages>& ErrorPages::defaults() {
+  static const std::shared_ptr<const ErrorPages> pages = std::make_shared<const ErrorPages>();
+  return pages;
+}
+
+} // namespace utils
+} // namespace router
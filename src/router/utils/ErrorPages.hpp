@@ -0,0 +1,68 @@
+/**
+ * @file ErrorPages.hpp
+ * @brief Error responses of a server, built once when the configuration is loaded
+ */
+
+#pragma once
+
+#include <array> // for std::array
+#include <memory> // for std::shared_ptr
+#include <string> // for std::string
+#include <vector> // for std::vector
+
+// Forward declarations
+class Server;
+
+namespace router {
+namespace utils {
+
+/**
+ * @brief Every error page a server sends, ready to go out
+ *
+ * Custom error_page files are read once here instead of on every error.
+ * Each page also keeps its headers and body serialized for either Connection
+ * value, so sending it is a copy after the status line.
+ */
+class ErrorPages {
+public:
+  /** One status with its page */
+  struct Page {
+    int code = 0;
+    std::string status;          // status line without the protocol, "404 Not Found"
+    std::string body;
+    std::string contentLength;
+    std::shared_ptr<const std::string> keepAlive;   // headers and body with Connection: keep-alive
+    std::shared_ptr<const std::string> close;       // headers and body with Connection: close
+  };
+
+  /** Default pages only */
+  ErrorPages();
+
+  /** Pages of server: its error_page files where they can be read, default pages for the rest */
+  explicit ErrorPages(const Server& server);
+
+  ErrorPages(const ErrorPages&) = delete;
+  ErrorPages& operator=(const ErrorPages&) = delete;
+
+  /** Page for status; statuses without a page get the 500 one */
+  const Page& find(int status) const;
+
+  /** Whether status has a page of its own */
+  bool contains(int status) const;
+
+  /** Pages loaded for server, built on the spot for a server that was never loaded */
+  static std::shared_ptr<const ErrorPages> of(const Server& server);
+
+  /** Shared default pages */
+  static const std::shared_ptr<const ErrorPages>& defaults();
+
+private:
+  void build(const Server* server);
+
+  std::vector<Page> _pages;
+  std::array<const Page*, 200> _byCode {};   // 400-599
+  const Page* _fallback = nullptr;
+};
+
+} // namespace utils
+} // namespace router
@@ -4,11 +4,10 @@
  */
 
 #include "FileUtils.hpp"
-#include "../HttpConstants.hpp"
+#include "MimeTypes.hpp"
+#include "../../server/Server.hpp"
 #include <fstream> // for std::ifstream, std::ios
 #include <stdexcept> // for std::runtime_error
-#include <filesystem> // for std::filesystem::path, std::filesystem::path::extension
-#include <algorithm> // for std::transform
 
 namespace router {
 namespace utils {
@@ -24,29 +23,13 @@ std::string FileUtils::readFileToString(const std::string& filename) {
   return content;
 }
 
-std::string FileUtils::getContentType(const std::string& filePath) {
-  std::string extension = std::filesystem::path(filePath).extension().string();
-
-  // Convert to lowercase
-  std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
-
-  if (extension == file_extensions::HTML || extension == file_extensions::HTM) return content_types::HTML;
-  if (extension == file_extensions::CSS) return content_types::CSS;
-  if (extension == file_extensions::JS) return content_types::JAVASCRIPT;
-  if (extension == ".json") return "application/json";
-  if (extension == ".xml") return "application/xml";
-  if (extension == ".txt") return content_types::PLAIN_TEXT;
-  if (extension == file_extensions::JPG || extension == file_extensions::JPEG) return content_types::JPG;
-  if (extension == file_extensions::PNG) return content_types::PNG;
-  if (extension == file_extensions::GIF) return content_types::GIF;
-  if (extension == ".svg") return "image/svg+xml";
-  if (extension == file_extensions::ICO) return content_types::ICO;
-  if (extension == ".pdf") return "application/pdf";
-  if (extension == ".zip") return "application/zip";
-  if (extension == ".mp4") return "video/mp4";
-  if (extension == ".mp3") return "audio/mpeg";
+std::string_view FileUtils::getContentType(std::string_view filePath) {
+  // Perfect-hashed built-in table, see MimeTypes.cpp
+  return mimeTypeFor(filePath);
+}
 
-  return "application/octet-stream"; // Default for unknown types
+std::string_view FileUtils::getContentType(std::string_view filePath, const Server& server) {
+  return mimeTypeFor(filePath, &server.getTypes());
 }
 
 } // namespace utils
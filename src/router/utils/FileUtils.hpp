@@ -6,6 +6,10 @@
 #pragma once
 
 #include <string> // for std::string
+#include <string_view> // for std::string_view
+
+// Forward declarations
+class Server;
 
 namespace router {
 namespace utils {
@@ -17,7 +21,10 @@ public:
     static std::string readFileToString(const std::string& filename);
 
     /** Get MIME content type for a file based on its extension */
-    static std::string getContentType(const std::string& filePath);
+    static std::string_view getContentType(std::string_view filePath);
+
+    /** Get MIME content type for a file, with the server's types {} overrides */
+    static std::string_view getContentType(std::string_view filePath, const Server& server);
 
 private:
     FileUtils() = delete; // Static class
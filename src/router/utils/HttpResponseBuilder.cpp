@@ -10,89 +10,44 @@
 #include "../../server/Server.hpp"
 #include "Utils.hpp"
 #include "FileUtils.hpp"
+#include "ErrorPages.hpp"
 
 #include <iostream> // for std::cout, std::endl
 #include <algorithm> // for std::transform
 #include <sstream> // for std::ostringstream
+#include <cctype> // for std::isdigit
 
 namespace router {
 namespace utils {
 
-void HttpResponseBuilder::setErrorResponse(Response& res, int status, const Request& req) {
-  // Set the HTTP status line based on the error code
-  if (status == http::NOT_FOUND_404) {
-    res.setStatus(http::STATUS_NOT_FOUND_404);
-  } else if (status == http::METHOD_NOT_ALLOWED_405) {
-    res.setStatus(http::STATUS_METHOD_NOT_ALLOWED_405);
-  } else if (status == http::BAD_REQUEST_400) {
-    res.setStatus(http::STATUS_BAD_REQUEST_400);
-  } else if (status == http::PAYLOAD_TOO_LARGE_413) {
-    res.setStatus(http::STATUS_PAYLOAD_TOO_LARGE_413);
-  } else if (status == http::FORBIDDEN_403) {
-    res.setStatus(http::STATUS_FORBIDDEN_403);
-  } else if (status == http::INTERNAL_SERVER_ERROR_500) {
-    res.setStatus(http::STATUS_INTERNAL_SERVER_ERROR_500);
-  } else if (status == http::GATEWAY_TIMEOUT_504) {
-    res.setStatus(http::STATUS_GATEWAY_TIMEOUT_504);
-  } else if (status == http::REQUEST_TIMEOUT_408) {
-    res.setStatus(http::STATUS_REQUEST_TIMEOUT_408);
-  } else {
-    res.setStatus(http::STATUS_INTERNAL_SERVER_ERROR_500);
-  }
+namespace {
 
-  // Set standard headers for HTML error responses
+/** Fill res from a prebuilt page, with its serialized form attached when nothing else was set on res */
+void setErrorPage(Response& res, const ErrorPages::Page& page, const Request& req) {
+  bool keepAlive = router::utils::shouldKeepAlive(req);
+  bool untouched = res.getHeaderList().empty();
+
+  res.setStatus(page.status);
   res.setHeaders(http::CONTENT_TYPE, http::CONTENT_TYPE_HTML);
-  res.setHeaders(http::CONTENT_LENGTH, std::to_string(getErrorPageHtml(status).length()));
+  res.setHeaders(http::CONTENT_LENGTH, page.contentLength);
+  res.setHeaders(http::CONNECTION, keepAlive ? http::CONNECTION_KEEP_ALIVE : http::CONNECTION_CLOSE);
+  res.setBody(page.body);
 
-  // Set connection header based on keep-alive logic
-  if (router::utils::shouldKeepAlive(req)) {
-    res.setHeaders(http::CONNECTION, http::CONNECTION_KEEP_ALIVE);
-  } else {
-    res.setHeaders(http::CONNECTION, http::CONNECTION_CLOSE);
+  if (untouched) {
+    res.setSerialized(keepAlive ? page.keepAlive : page.close);
   }
-
-  // Set the response body with the default error page HTML
-  res.setBody(getErrorPageHtml(status));
 }
 
-void HttpResponseBuilder::setErrorResponse(Response& res, int status, const Request& req, const Server& server) {
-  // Set the HTTP status line based on the error code
-  if (status == http::NOT_FOUND_404) {
-    res.setStatus(http::STATUS_NOT_FOUND_404);
-  } else if (status == http::METHOD_NOT_ALLOWED_405) {
-    res.setStatus(http::STATUS_METHOD_NOT_ALLOWED_405);
-  } else if (status == http::BAD_REQUEST_400) {
-    res.setStatus(http::STATUS_BAD_REQUEST_400);
-  } else if (status == http::PAYLOAD_TOO_LARGE_413) {
-    res.setStatus(http::STATUS_PAYLOAD_TOO_LARGE_413);
-  } else if (status == http::FORBIDDEN_403) {
-    res.setStatus(http::STATUS_FORBIDDEN_403);
-  } else if (status == http::INTERNAL_SERVER_ERROR_500) {
-    res.setStatus(http::STATUS_INTERNAL_SERVER_ERROR_500);
-  } else if (status == http::GATEWAY_TIMEOUT_504) {
-    res.setStatus(http::STATUS_GATEWAY_TIMEOUT_504);
-  } else if (status == http::REQUEST_TIMEOUT_408) {
-    res.setStatus(http::STATUS_REQUEST_TIMEOUT_408);
-  } else {
-    res.setStatus(http::STATUS_INTERNAL_SERVER_ERROR_500);
-  }
-
-  // Get error page HTML (will use server-level custom pages if configured)
-  std::string errorPageHtml = getErrorPageHtml(status, server);
-
-  // Set standard headers for HTML error responses
-  res.setHeaders(http::CONTENT_TYPE, http::CONTENT_TYPE_HTML);
-  res.setHeaders(http::CONTENT_LENGTH, std::to_string(errorPageHtml.length()));
+} // namespace
 
-  // Set connection header based on keep-alive logic
-  if (router::utils::shouldKeepAlive(req)) {
-    res.setHeaders(http::CONNECTION, http::CONNECTION_KEEP_ALIVE);
-  } else {
-    res.setHeaders(http::CONNECTION, http::CONNECTION_CLOSE);
-  }
+void HttpResponseBuilder::setErrorResponse(Response& res, int status, const Request& req) {
+  setErrorPage(res, ErrorPages::defaults()->find(status), req);
+}
 
-  // Set the response body with the error page HTML (custom or default)
-  res.setBody(errorPageHtml);
+void HttpResponseBuilder::setErrorResponse(Response& res, int status, const Request& req, const Server& server) {
+  // Pages are read when the configuration is loaded, see ErrorPages
+  std::shared_ptr<const ErrorPages> pages = ErrorPages::of(server);
+  setErrorPage(res, pages->find(status), req);
 }
 
 void HttpResponseBuilder::setSuccessResponse(Response& res, const std::string& content, const std::string& contentType, const Request& req) {
@@ -155,8 +110,8 @@ void HttpResponseBuilder::setMethodNotAllowedResponse(Response& res, const std::
   res.setHeaders(http::ALLOW, allowHeader);
 
   // Set content length
-  std::string errorHtml = getErrorPageHtml(http::METHOD_NOT_ALLOWED_405);
-  res.setHeaders(http::CONTENT_LENGTH, std::to_string(errorHtml.length()));
+  const ErrorPages::Page& page = ErrorPages::defaults()->find(http::METHOD_NOT_ALLOWED_405);
+  res.setHeaders(http::CONTENT_LENGTH, page.contentLength);
 
   // Set connection header based on keep-alive logic
   if (router::utils::shouldKeepAlive(req)) {
@@ -166,7 +121,7 @@ void HttpResponseBuilder::setMethodNotAllowedResponse(Response& res, const std::
   }
 
   // Set the response body with the error page HTML
-  res.setBody(errorHtml);
+  res.setBody(page.body);
 }
 
 std::string HttpResponseBuilder::makeDefaultErrorPage(int code, const std::string& reason) {
@@ -189,27 +144,8 @@ std::string HttpResponseBuilder::makeDefaultSuccessPage(int code, const std::str
 }
 
 std::string HttpResponseBuilder::getErrorPageHtml(int status) {
-  switch (status) {
-    case http::BAD_REQUEST_400:
-      return makeDefaultErrorPage(400, "Bad Request");
-    case http::FORBIDDEN_403:
-      return makeDefaultErrorPage(403, "Forbidden");
-    case http::NOT_FOUND_404:
-      return makeDefaultErrorPage(404, "Not Found");
-    case http::METHOD_NOT_ALLOWED_405:
-      return makeDefaultErrorPage(405, "Method Not Allowed");
-    case http::PAYLOAD_TOO_LARGE_413:
-      return makeDefaultErrorPage(413, "Payload Too Large");
-    case http::INTERNAL_SERVER_ERROR_500:
-      return makeDefaultErrorPage(500, "Internal Server Error");
-    case http::GATEWAY_TIMEOUT_504:
-      return makeDefaultErrorPage(504, "Gateway Timeout");
-    case http::REQUEST_TIMEOUT_408:
-      return makeDefaultErrorPage(408, "Request Timeout");
-    default:
-      // Fallback to generic 500 error for unknown status codes
-      return makeDefaultErrorPage(500, "Internal Server Error");
-  }
+  // Unknown status codes get the 500 page
+  return ErrorPages::defaults()->find(status).body;
 }
 
 std::string HttpResponseBuilder::getSuccessPageHtml(int status) {
@@ -225,54 +161,23 @@ std::string HttpResponseBuilder::getSuccessPageHtml(int status) {
 }
 
 std::string HttpResponseBuilder::getErrorPageHtml(int status, const Server& server) {
-  // Check if server has custom error page for this status
-  const std::map<int, std::string>& errorPages = server.getErrorPages();
-  auto it = errorPages.find(status);
-
-  if (it != errorPages.end()) {
-    // Server has custom error page configured
-    std::string customErrorPath = it->second;
-
-    // Build full path using server root
-    std::string fullPath = server.getRoot() + "/" + customErrorPath;
-
-    // Try to read the custom error page file
-    try {
-      std::string customErrorContent = FileUtils::readFileToString(fullPath);
-      if (!customErrorContent.empty()) {
-        return customErrorContent;
-      }
-    } catch (const std::exception&) {
-      // File doesn't exist or can't be read, fall back to default
-    }
-  }
-
-  // No custom error page or file doesn't exist, use default
-  return getErrorPageHtml(status);
+  // Custom page where the server configures a readable one, default page otherwise
+  return ErrorPages::of(server)->find(status).body;
 }
 
 int HttpResponseBuilder::parseStatusCodeFromString(const std::string& statusString) {
   // Extract the numeric status code from strings like "400 Bad Request"
-  if (statusString.find("400") != std::string::npos) {
-    return http::BAD_REQUEST_400;
-  } else if (statusString.find("403") != std::string::npos) {
-    return http::FORBIDDEN_403;
-  } else if (statusString.find("404") != std::string::npos) {
-    return http::NOT_FOUND_404;
-  } else if (statusString.find("405") != std::string::npos) {
-    return http::METHOD_NOT_ALLOWED_405;
-  } else if (statusString.find("413") != std::string::npos) {
-    return http::PAYLOAD_TOO_LARGE_413;
-  } else if (statusString.find("500") != std::string::npos) {
-    return http::INTERNAL_SERVER_ERROR_500;
-  } else if (statusString.find("504") != std::string::npos) {
-    return http::GATEWAY_TIMEOUT_504;
-  } else if (statusString.find("408") != std::string::npos) {
-    return http::REQUEST_TIMEOUT_408;
-  } else {
-    // Default to 400 Bad Request for unknown status codes
-    return http::BAD_REQUEST_400;
+  size_t pos = statusString.find_first_of("0123456789");
+  if (pos != std::string::npos && pos + 3 <= statusString.size()
+      && std::isdigit(static_cast<unsigned char>(statusString[pos + 1]))
+      && std::isdigit(static_cast<unsigned char>(statusString[pos + 2]))) {
+    int code = std::stoi(statusString.substr(pos, 3));
+    if (ErrorPages::defaults()->contains(code)) {
+      return code;
+    }
   }
+  // Default to 400 Bad Request for unknown status codes
+  return http::BAD_REQUEST_400;
 }
 
 } // namespace utils
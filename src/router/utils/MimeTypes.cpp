@@ -0,0 +1,174 @@
+/**
+ * @file MimeTypes.cpp
+ * @brief Extension to MIME type lookup implementation
+ */
+
+#include "MimeTypes.hpp"
+
+#include <array> // for std::array
+#include <cstdint> // for uint8_t, uint32_t
+
+namespace router {
+namespace utils {
+
+namespace {
+
+struct MimeEntry {
+  std::string_view extension;   // lowercase, without the dot
+  std::string_view type;
+};
+
+constexpr MimeEntry MIME_TYPES[] = {
+  // Text
+  {"html", "text/html"}, {"htm", "text/html"}, {"shtml", "text/html"},
+  {"css", "text/css"}, {"txt", "text/plain"}, {"text", "text/plain"}, {"log", "text/plain"},
+  {"csv", "text/csv"}, {"md", "text/markdown"}, {"xml", "application/xml"},
+  {"ics", "text/calendar"}, {"vtt", "text/vtt"}, {"xhtml", "application/xhtml+xml"},
+  // Scripts and data
+  {"js", "application/javascript"}, {"mjs", "application/javascript"},
+  {"json", "application/json"}, {"map", "application/json"},
+  {"webmanifest", "application/manifest+json"}, {"jsonld", "application/ld+json"},
+  {"wasm", "application/wasm"}, {"yaml", "application/yaml"}, {"yml", "application/yaml"},
+  {"atom", "application/atom+xml"}, {"rss", "application/rss+xml"},
+  // Images
+  {"png", "image/png"}, {"apng", "image/apng"}, {"jpg", "image/jpeg"}, {"jpeg", "image/jpeg"},
+  {"gif", "image/gif"}, {"svg", "image/svg+xml"}, {"svgz", "image/svg+xml"},
+  {"ico", "image/x-icon"}, {"webp", "image/webp"}, {"avif", "image/avif"},
+  {"bmp", "image/bmp"}, {"tif", "image/tiff"}, {"tiff", "image/tiff"},
+  {"heic", "image/heic"}, {"jxl", "image/jxl"},
+  // Fonts
+  {"woff", "font/woff"}, {"woff2", "font/woff2"}, {"ttf", "font/ttf"}, {"otf", "font/otf"},
+  {"eot", "application/vnd.ms-fontobject"},
+  // Audio
+  {"mp3", "audio/mpeg"}, {"ogg", "audio/ogg"}, {"oga", "audio/ogg"}, {"opus", "audio/ogg"},
+  {"wav", "audio/wav"}, {"m4a", "audio/mp4"}, {"aac", "audio/aac"}, {"flac", "audio/flac"},
+  {"weba", "audio/webm"}, {"mid", "audio/midi"}, {"midi", "audio/midi"},
+  // Video
+  {"mp4", "video/mp4"}, {"m4v", "video/mp4"}, {"webm", "video/webm"}, {"ogv", "video/ogg"},
+  {"mov", "video/quicktime"}, {"avi", "video/x-msvideo"}, {"mkv", "video/x-matroska"},
+  {"mpeg", "video/mpeg"}, {"mpg", "video/mpeg"}, {"3gp", "video/3gpp"}, {"ts", "video/mp2t"},
+  // Documents
+  {"pdf", "application/pdf"}, {"rtf", "application/rtf"}, {"epub", "application/epub+zip"},
+  {"doc", "application/msword"},
+  {"docx", "application/vnd.openxmlformats-officedocument.wordprocessingml.document"},
+  {"xls", "application/vnd.ms-excel"},
+  {"xlsx", "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet"},
+  {"ppt", "application/vnd.ms-powerpoint"},
+  {"pptx", "application/vnd.openxmlformats-officedocument.presentationml.presentation"},
+  {"odt", "application/vnd.oasis.opendocument.text"},
+  {"ods", "application/vnd.oasis.opendocument.spreadsheet"},
+  {"odp", "application/vnd.oasis.opendocument.presentation"},
+  // Archives
+  {"zip", "application/zip"}, {"gz", "application/gzip"}, {"tgz", "application/gzip"},
+  {"tar", "application/x-tar"}, {"bz2", "application/x-bzip2"}, {"xz", "application/x-xz"},
+  {"7z", "application/x-7z-compressed"}, {"rar", "application/vnd.rar"},
+  {"jar", "application/java-archive"}, {"zst", "application/zstd"},
+};
+
+const std::string_view DEFAULT_MIME_TYPE = "application/octet-stream";
+
+constexpr size_t MIME_SLOTS = 2048;   // power of two, sparse enough for a seed without collisions
+constexpr size_t OVERRIDE_EXTENSION_MAX = 32;
+
+constexpr char lower(char c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+/** FNV-1a of the lowercased extension, seeded */
+constexpr uint32_t hashExtension(std::string_view extension, uint32_t seed) {
+  uint32_t hash = 2166136261u ^ seed;
+  for (char c : extension) {
+    hash ^= static_cast<unsigned char>(lower(c));
+    hash *= 16777619u;
+  }
+  return hash ^ (hash >> 15);
+}
+
+constexpr size_t longestExtension() {
+  size_t longest = 0;
+  for (const MimeEntry& entry : MIME_TYPES) {
+    longest = entry.extension.size() > longest ? entry.extension.size() : longest;
+  }
+  return longest;
+}
+
+/** Slot of every extension, entry index + 1, 0 for empty */
+struct MimeIndex {
+  uint32_t seed;
+  std::array<uint8_t, MIME_SLOTS> slots;
+};
+
+/** First seed that sends every extension to a slot of its own */
+constexpr MimeIndex buildIndex() {
+  for (uint32_t seed = 1; seed < 10000; ++seed) {
+    MimeIndex index{seed, {}};
+    bool collision = false;
+    for (size_t i = 0; i < std::size(MIME_TYPES) && !collision; ++i) {
+      uint8_t& slot = index.slots[hashExtension(MIME_TYPES[i].extension, seed) & (MIME_SLOTS - 1)];
+      collision = slot != 0;
+      slot = static_cast<uint8_t>(i + 1);
+    }
+    if (!collision) {
+      return index;
+    }
+  }
+  return MimeIndex{0, {}};
+}
+
+static_assert(std::size(MIME_TYPES) < 255, "MIME_TYPES indexes must fit a slot");
+constexpr MimeIndex MIME_INDEX = buildIndex();
+static_assert(MIME_INDEX.seed != 0, "MIME_TYPES has a duplicate extension or needs more MIME_SLOTS");
+constexpr size_t MIME_EXTENSION_MAX = longestExtension();
+
+} // namespace
+
+std::string_view builtinMimeType(std::string_view extension) {
+  if (extension.empty() || extension.size() > MIME_EXTENSION_MAX) {
+    return {};
+  }
+  uint8_t slot = MIME_INDEX.slots[hashExtension(extension, MIME_INDEX.seed) & (MIME_SLOTS - 1)];
+  if (slot == 0) {
+    return {};
+  }
+  const MimeEntry& entry = MIME_TYPES[slot - 1];
+  if (entry.extension.size() != extension.size()) {
+    return {};
+  }
+  for (size_t i = 0; i < extension.size(); ++i) {
+    if (lower(extension[i]) != entry.extension[i]) {
+      return {};
+    }
+  }
+  return entry.type;
+}
+
+std::string_view fileExtension(std::string_view path) {
+  size_t slash = path.find_last_of('/');
+  std::string_view name = slash == std::string_view::npos ? path : path.substr(slash + 1);
+  size_t dot = name.find_last_of('.');
+  if (dot == std::string_view::npos || dot == 0) {
+    return {};
+  }
+  return name.substr(dot + 1);
+}
+
+std::string_view mimeTypeFor(std::string_view path, const MimeTypeMap* overrides) {
+  std::string_view extension = fileExtension(path);
+
+  if (overrides && !overrides->empty() && !extension.empty() && extension.size() <= OVERRIDE_EXTENSION_MAX) {
+    char lowered[OVERRIDE_EXTENSION_MAX];
+    for (size_t i = 0; i < extension.size(); ++i) {
+      lowered[i] = lower(extension[i]);
+    }
+    auto it = overrides->find(std::string_view(lowered, extension.size()));
+    if (it != overrides->end()) {
+      return it->second;
+    }
+  }
+
+  std::string_view type = builtinMimeType(extension);
+  return type.empty() ? DEFAULT_MIME_TYPE : type;
+}
+
+} // namespace utils
+} // namespace router
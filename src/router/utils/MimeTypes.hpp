@@ -0,0 +1,29 @@
+/**
+ * @file MimeTypes.hpp
+ * @brief Extension to MIME type lookup
+ */
+
+#pragma once
+
+#include <functional> // for std::less
+#include <map> // for std::map
+#include <string> // for std::string
+#include <string_view> // for std::string_view
+
+namespace router {
+namespace utils {
+
+/** types {} overrides of a server: extension without the dot, lowercase, to MIME type */
+typedef std::map<std::string, std::string, std::less<>> MimeTypeMap;
+
+/** MIME type of an extension without the dot, any case; empty when the built-in table doesn't know it */
+std::string_view builtinMimeType(std::string_view extension);
+
+/** Extension of the last path segment without the dot; empty for none and for dotfiles like ".bashrc" */
+std::string_view fileExtension(std::string_view path);
+
+/** MIME type of path: overrides first, then the built-in table, application/octet-stream otherwise */
+std::string_view mimeTypeFor(std::string_view path, const MimeTypeMap* overrides = nullptr);
+
+} // namespace utils
+} // namespace router
@@ -4,13 +4,12 @@
 #include "HttpResponseBuilder.hpp"
 #include "StringUtils.hpp"
 #include "FileUtils.hpp"
+#include "../../../inc/webserv.hpp"
+#include "../../server/Log.hpp"
 
 #include <algorithm> // for std::transform
 #include <cctype> // for std::tolower
 #include <filesystem> // for std::filesystem
-#include <iostream> // for std::cout
-#include <chrono> // for std::chrono::system_clock::to_time_t, std::chrono::file_clock::to_sys
-#include <ctime> // for std::strftime, std::localtime
 
 namespace router {
 namespace utils {
@@ -43,26 +42,6 @@ bool shouldKeepAlive(const Request& req) {
   return false;
 }
 
-/** Check if the request is chunked */
-bool isChunked(const Request& req) {
-  // READ: https://www.rfc-editor.org/rfc/rfc7230#section-3.3.1
-  auto transferEncoding = req.getHeaders("transfer-encoding");
-  // example: transfer-encoding: chunked
-  bool findChunk = false;
-  if (!transferEncoding.empty()) {
-    // example: transfer-encoding: chunked -> true
-    for (const auto& encoding : transferEncoding) {
-      std::string lowerEncoding = encoding;
-      std::transform(lowerEncoding.begin(), lowerEncoding.end(), lowerEncoding.begin(), ::tolower);
-      if (lowerEncoding.find("chunked") != std::string::npos) {
-        findChunk = true;
-        break;
-      }
-    }
-  }
-  return findChunk;
-}
-
 bool isCgiScriptWithLocation(const std::string& filename, const Location* location) {
   if (!location || location->cgi_ext.empty()) {
     return false;
@@ -96,69 +75,6 @@ bool isCgiScriptWithLocation(const std::string& filename, const Location* locati
   return false;
 }
 
-/** Parse chunked request body */
-std::string parseChunkedRequestBody(const std::string& body) {
-  std::string result;
-  size_t pos = 0;
-
-  while (pos < body.length()) {
-    // Find the end of the chunk size line
-    // \r is carriage return, \n is line feed (CRLF)
-    size_t lineEnd = body.find("\r\n", pos);
-    if (lineEnd == std::string::npos) {
-      lineEnd = body.find("\n", pos);
-      if (lineEnd == std::string::npos) break;
-    }
-
-    // Extract chunk size
-    std::string chunkSizeStr = body.substr(pos, lineEnd - pos);
-    size_t chunkSize = 0;
-
-    /*
-    1f\r\n
-    abcdefghijklmnopqrstuvwxyz123\r\n
-    0\r\n
-    \r\n
-    */
-    // example: 1f\r\n -> 31
-    // read 31 bytes → "abcdefghijklmnopqrstuvwxyz123"
-    // example: 0\r\n -> 0
-    // read 0 bytes → ""
-    try {
-      // should be a valid hexadecimal number
-      // convrt to unsigned long with base 16
-      chunkSize = std::stoul(chunkSizeStr, nullptr, 16);
-    } catch (...) {
-      break; // Invalid chunk size
-    }
-
-    // If chunk size is 0, no more chunks
-    if (chunkSize == 0) break;
-
-    // Move past the chunk size line
-    // start from the next line
-    pos = lineEnd + (body[lineEnd] == '\r' ? 2 : 1);
-
-    // Extract chunk data
-    if (pos + chunkSize <= body.length()) {
-      result += body.substr(pos, chunkSize);
-      pos += chunkSize;
-
-      // Skip the trailing CRLF
-      if (pos + 2 <= body.length() && body.substr(pos, 2) == "\r\n") {
-        pos += 2;
-      } else if (pos + 1 <= body.length() && body[pos] == '\n') {
-        pos += 1;
-      }
-    } else {
-      break; // Invalid chunk
-    }
-  }
-  // example: "abcdefghijklmnopqrstuvwxyz123"
-  return result;
-}
-
-
 /** Set up CGI environment variables */
 // READ: https://datatracker.ietf.org/doc/html/rfc3875
 std::vector<std::string> setupCgiEnvironment(const Request& req, const std::string& scriptPath, const std::string& scriptName, const Server& server) {
@@ -202,38 +118,8 @@ std::vector<std::string> setupCgiEnvironment(const Request& req, const std::stri
     env.push_back("QUERY_STRING=");
   }
 
-  // Content handling - handle chunked requests
+  // Content handling - the event loop already removed any chunked transfer coding
   std::string body = std::string(req.getBody());
-  auto transferEncoding = req.getHeaders("transfer-encoding");
-  // example: transfer-encoding: chunked
-  bool isChunked = false;
-
-  /*
-  HTTP/1.1 200 OK
-  Transfer-Encoding: chunked
-
-  4\r\n
-  Wiki\r\n
-  5\r\n
-  pedia\r\n
-  0\r\n
-  \r\n
-  */
-  if (!transferEncoding.empty()) {
-    // example: transfer-encoding: chunked -> true
-    for (const auto& encoding : transferEncoding) {
-      // example: transfer-encoding: chunked -> true
-      if (encoding.find("chunked") != std::string::npos) {
-        isChunked = true;
-        break;
-      }
-    }
-  }
-
-  // Unchunk the body if it's chunked
-  if (isChunked) {
-    body = parseChunkedRequestBody(body);
-  }
 
   auto contentType = req.getHeaders("content-type");
   if (!contentType.empty()) {
@@ -263,136 +149,29 @@ std::vector<std::string> setupCgiEnvironment(const Request& req, const std::stri
   return env;
 }
 
+/** Listings and templates shared by the file I/O threads */
+AutoindexCache& autoindexCache() {
+  static AutoindexCache cache(AUTOINDEX_CACHE_ENTRIES, AUTOINDEX_CACHE_TTL);
+  return cache;
+}
+
 /** Generate HTML directory listing */
 std::string generateDirectoryListing(const std::string& dirPath, const std::string& requestPath, const std::string& serverRoot) {
-  // Search for template files in multiple locations
-  std::vector<std::string> searchPaths;
-
-  // 1. Current directory
-  searchPaths.push_back(StringUtils::normalizePath(dirPath + "/" + page::AUTOINDEX_TEMPLATE));
-  searchPaths.push_back(StringUtils::normalizePath(dirPath + "/" + page::AUTOINDEX_FALLBACK));
-
-  // 2. Parent directories (walking up the tree)
-  std::string currentPath = dirPath;
-  while (currentPath != serverRoot && currentPath.length() > serverRoot.length()) {
-    currentPath = currentPath.substr(0, currentPath.find_last_of('/'));
-    if (currentPath.length() >= serverRoot.length()) {
-      searchPaths.push_back(StringUtils::normalizePath(currentPath + "/" + page::AUTOINDEX_TEMPLATE));
-      searchPaths.push_back(StringUtils::normalizePath(currentPath + "/" + page::AUTOINDEX_FALLBACK));
-    }
-  }
-
-  // 3. Server root as final fallback
-  searchPaths.push_back(StringUtils::normalizePath(serverRoot + "/" + page::AUTOINDEX_TEMPLATE));
-  searchPaths.push_back(StringUtils::normalizePath(serverRoot + "/" + page::AUTOINDEX_FALLBACK));
-
-  std::string html;
-  bool templateFound = false;
-
-  // Try to find and load template
-  for (const auto& templatePath : searchPaths) {
-    try {
-      if (std::filesystem::exists(templatePath)) {
-        html = FileUtils::readFileToString(templatePath);
-        templateFound = true;
-        break;
-      }
-    } catch (const std::exception& e) {
-      // Continue to next path
-      continue;
-    }
-  }
-
-  if (!templateFound) {
-    // If no template found anywhere, throw an exception
-    std::cout << "Error: Could not find autoindex template in any location" << std::endl;
-    throw std::runtime_error("Could not load directory listing template");
-  }
-
-  // Replace placeholders
-  html = StringUtils::replaceAll(html, "{{PATH}}", requestPath);
-
-  // Generate parent directory link
-  std::string parentLink = "";
-  if (requestPath != "/") {
-    std::string parentPath = requestPath;
-
-    // Remove trailing slash if present
-    if (parentPath.back() == '/') {
-      parentPath.pop_back();
-    }
-
-    // Find the last slash to get the parent directory
-    size_t lastSlash = parentPath.find_last_of('/');
-    if (lastSlash != std::string::npos) {
-      parentPath = parentPath.substr(0, lastSlash);
-      if (parentPath.empty()) parentPath = "/";
-      parentLink = "  <a href=\"" + parentPath + "\" class=\"back-link\">← Parent directory</a>\n";
-    }
-  }
-  html = StringUtils::replaceAll(html, "{{PARENT_LINK}}", parentLink);
-
-  // Generate directory items
-  std::string items = "";
-  try {
-    for (const auto& entry : std::filesystem::directory_iterator(dirPath)) {
-      std::string name = entry.path().filename().string();
-      std::string linkPath = requestPath;
-      if (linkPath.back() != '/') linkPath += '/';
-      linkPath += name;
-
-      bool isDir = entry.is_directory();
-      std::string icon = isDir ? "📁" : "📄";
-      std::string cssClass = isDir ? "dir-icon" : "file-icon";
-
-      // Get file size
-      std::string sizeStr = "-";
-      if (!isDir) {
-        try {
-          auto size = entry.file_size();
-          if (size < 1024) sizeStr = std::to_string(size) + " B";
-          else if (size < 1024 * 1024) sizeStr = std::to_string(size / 1024) + " KB";
-          else sizeStr = std::to_string(size / (1024 * 1024)) + " MB";
-        } catch (...) {}
-      }
-
-      // Get last modified time
-      std::string dateStr = "-";
-      try {
-        auto time = entry.last_write_time();
-        auto time_t = std::chrono::system_clock::to_time_t(std::chrono::file_clock::to_sys(time));
-        char buffer[20];
-        std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M", std::localtime(&time_t));
-        dateStr = buffer;
-      } catch (...) {}
-
-      items += "    <div class=\"item\">\n";
-      items += "      <span class=\"" + cssClass + "\">" + icon + "</span>\n";
-      items += "      <a href=\"" + linkPath + "\" class=\"name\">" + name + "</a>\n";
-      items += "      <span class=\"size\">" + sizeStr + "</span>\n";
-      items += "      <span class=\"date\">" + dateStr + "</span>\n";
-      items += "    </div>\n";
-    }
-  } catch (const std::exception& e) {
-    items += "    <div class=\"item\">Error reading directory: " + std::string(e.what()) + "</div>\n";
-  }
-
-  html = StringUtils::replaceAll(html, "{{ITEMS}}", items);
-
-  return html;
+  // Re-rendered when the directory or its template changes
+  return autoindexCache().listing(dirPath, requestPath, serverRoot);
 }
 
 bool handleDirectoryRequest(const std::string& dirPath, const std::string& requestPath,
-                            const Location* location, Response& res, const Request& req, const std::string& serverRoot) {
+                            const Location* location, Response& res, const Request& req, const Server& server) {
   // Try autoindex first if enabled
   if (location && location->autoindex) {
     try {
-      std::string dirListing = generateDirectoryListing(dirPath, requestPath, serverRoot);
+      std::string dirListing = generateDirectoryListing(dirPath, requestPath, server.getRoot());
       HttpResponseBuilder::setSuccessResponse(res, dirListing, http::CONTENT_TYPE_HTML, req);
       return true;
     } catch (const std::exception& e) {
       // Template loading failed, return 500 error
-      std::cout << "Error generating directory listing: " << e.what() << std::endl;
+      LOG_ERROR("Error generating directory listing: " << e.what());
       return false; // This will cause the caller to return 500
     }
   }
@@ -413,7 +192,7 @@ bool handleDirectoryRequest(const std::string& dirPath, const std::string& reque
   for (const auto& path : indexPaths) {
     if (std::filesystem::exists(path) && std::filesystem::is_regular_file(path)) {
       std::string fileContent = FileUtils::readFileToString(path);
-      std::string contentType = FileUtils::getContentType(path);
+      std::string contentType(FileUtils::getContentType(path, server));
       HttpResponseBuilder::setSuccessResponse(res, fileContent, contentType, req);
       return true;
     }
@@ -427,12 +206,13 @@ bool handleDirectoryRequest(const std::string& dirPath, const std::string& reque
  * @param filePath Path to the file to serve
  * @param res Response object
  * @param req HTTP request
+ * @param server Server whose types {} overrides apply
  * @return true if served successfully
  */
-bool serveStaticFile(const std::string& filePath, Response& res, const Request& req) {
+bool serveStaticFile(const std::string& filePath, Response& res, const Request& req, const Server& server) {
   try {
     std::string fileContent = FileUtils::readFileToString(filePath);
-    std::string contentType = FileUtils::getContentType(filePath);
+    std::string contentType(FileUtils::getContentType(filePath, server));
     HttpResponseBuilder::setSuccessResponse(res, fileContent, contentType, req);
     return true;
   } catch (const std::exception&) {
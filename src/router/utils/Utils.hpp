@@ -6,6 +6,7 @@
 #include "../../request/Request.hpp"
 #include "../../response/Response.hpp"
 #include "../../server/Server.hpp"
+#include "AutoindexCache.hpp"
 
 struct Location;
 
@@ -13,13 +14,12 @@ namespace router {
 namespace utils {
 
 bool isCgiScriptWithLocation(const std::string& filename, const Location* location);
-bool isChunked(const Request& req);
 bool shouldKeepAlive(const Request& req);
-std::string parseChunkedRequestBody(const std::string& body);
 std::vector<std::string> setupCgiEnvironment(const Request& req, const std::string& scriptPath, const std::string& scriptName, const Server& server);
+AutoindexCache& autoindexCache();
 std::string generateDirectoryListing(const std::string& dirPath, const std::string& requestPath, const std::string& serverRoot);
-bool handleDirectoryRequest(const std::string& dirPath, const std::string& requestPath, const Location* location, Response& res, const Request& req, const std::string& serverRoot);
-bool serveStaticFile(const std::string& filePath, Response& res, const Request& req);
+bool handleDirectoryRequest(const std::string& dirPath, const std::string& requestPath, const Location* location, Response& res, const Request& req, const Server& server);
+bool serveStaticFile(const std::string& filePath, Response& res, const Request& req, const Server& server);
 
 } // namespace utils
 } // namespace router
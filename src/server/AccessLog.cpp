@@ -0,0 +1,316 @@
+#include "AccessLog.hpp"
+
+#include <algorithm>	// for std::min, std::max
+#include <charconv>		// for std::to_chars
+#include <cstring>		// for std::memcpy, std::strerror
+#include <ctime>		// for localtime_r, strftime
+#include <cerrno>
+#include <stdexcept>	// for std::runtime_error
+#include <fcntl.h>		// for open
+#include <sys/uio.h>	// for writev
+
+namespace {
+
+// Variables a log_format can name, and the field each one is
+const std::pair<std::string_view, AccessLogFormat::Field>	VARIABLES[] = {
+	{"remote_addr", AccessLogFormat::REMOTE_ADDR},
+	{"host", AccessLogFormat::HOST},
+	{"request", AccessLogFormat::REQUEST},
+	{"request_method", AccessLogFormat::REQUEST_METHOD},
+	{"request_uri", AccessLogFormat::REQUEST_URI},
+	{"server_protocol", AccessLogFormat::SERVER_PROTOCOL},
+	{"status", AccessLogFormat::STATUS},
+	{"bytes_sent", AccessLogFormat::BYTES_SENT},
+	{"request_time", AccessLogFormat::REQUEST_TIME},
+	{"receive_time", AccessLogFormat::RECEIVE_TIME},
+	{"handle_time", AccessLogFormat::HANDLE_TIME},
+	{"send_time", AccessLogFormat::SEND_TIME},
+	{"time_local", AccessLogFormat::TIME_LOCAL},
+	{"time_iso8601", AccessLogFormat::TIME_ISO8601},
+	{"msec", AccessLogFormat::MSEC},
+	{"location", AccessLogFormat::LOCATION},
+	{"handler", AccessLogFormat::HANDLER}
+};
+
+const char	MAIN_FORMAT[] = "$remote_addr - - [$time_local] \"$request\" $status $bytes_sent \"$host\" "
+	"$request_time $receive_time $handle_time $send_time";
+
+const char	JSON_FORMAT[] = "{\"time\":\"$time_iso8601\",\"client\":\"$remote_addr\",\"host\":\"$host\","
+	"\"method\":\"$request_method\",\"uri\":\"$request_uri\",\"protocol\":\"$server_protocol\","
+	"\"status\":$status,\"bytes\":$bytes_sent,\"location\":\"$location\",\"handler\":\"$handler\","
+	"\"request_time\":$request_time,\"receive_time\":$receive_time,\"handle_time\":$handle_time,"
+	"\"send_time\":$send_time}";
+
+bool	isNameChar(char c) {
+	return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+void	number(std::string& out, uint64_t value) {
+	char buffer[24];
+	auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+	out.append(buffer, result.ptr);
+}
+
+// Seconds with a millisecond resolution, like nginx's $request_time
+void	seconds(std::string& out, int64_t micros) {
+	uint64_t millis = static_cast<uint64_t>(std::max<int64_t>(micros, 0) + 500) / 1000;
+	number(out, millis / 1000);
+	out += '.';
+	out += static_cast<char>('0' + millis / 100 % 10);
+	out += static_cast<char>('0' + millis / 10 % 10);
+	out += static_cast<char>('0' + millis % 10);
+}
+
+int64_t	micros(std::chrono::steady_clock::duration elapsed) {
+	return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+} // namespace
+
+// localtime and strftime run once a second, the lines in between reuse their text
+void	LogClock::update(std::chrono::system_clock::time_point now) {
+	int64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+	millis = ms % 1000;
+	if (ms / 1000 == second)
+		return ;
+	second = ms / 1000;
+	std::time_t t = static_cast<std::time_t>(second);
+	std::tm tm;
+	localtime_r(&t, &tm);
+	char buffer[64];
+	local.assign(buffer, std::strftime(buffer, sizeof(buffer), "%d/%b/%Y:%H:%M:%S %z", &tm));
+	iso8601.assign(buffer, std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S%z", &tm));
+	if (iso8601.size() > 2)
+		iso8601.insert(iso8601.size() - 2, 1, ':');
+}
+
+bool	AccessLogFormat::compile(const LogFormat& format, AccessLogFormat& out) {
+	out._segments.clear();
+	out._json = format.json;
+	const std::string& pattern = format.pattern;
+	std::string literal;
+	for (size_t i = 0; i < pattern.size(); ) {
+		size_t end = i + 1;
+		while (pattern[i] == '$' && end < pattern.size() && isNameChar(pattern[end]))
+			++end;
+		if (end == i + 1) {
+			literal += pattern[i++];
+			continue ;
+		}
+		std::string_view name(pattern.data() + i + 1, end - i - 1);
+		auto it = std::find_if(std::begin(VARIABLES), std::end(VARIABLES),
+			[&](const auto& variable) { return variable.first == name; });
+		if (it == std::end(VARIABLES))
+			return false;
+		if (!literal.empty())
+			out._segments.push_back({LITERAL, std::move(literal)});
+		literal.clear();
+		out._segments.push_back({it->second, ""});
+		i = end;
+	}
+	if (!literal.empty())
+		out._segments.push_back({LITERAL, std::move(literal)});
+	return true;
+}
+
+bool	AccessLogFormat::builtin(const std::string& name, LogFormat& out) {
+	if (name == "main")
+		out = {MAIN_FORMAT, false};
+	else if (name == "json")
+		out = {JSON_FORMAT, true};
+	else
+		return false;
+	return true;
+}
+
+// Request text is the client's: quotes, backslashes and control bytes are escaped, as \xHH
+// or, with escape=json, as JSON string escapes. An empty value is "-" outside JSON.
+void	AccessLogFormat::value(std::string& out, std::string_view text) const {
+	static const char hex[] = "0123456789ABCDEF";
+	if (text.empty() && !_json) {
+		out += '-';
+		return ;
+	}
+	for (char c : text) {
+		unsigned char byte = static_cast<unsigned char>(c);
+		if (c == '"' || c == '\\') {
+			out += '\\';
+			out += c;
+		}
+		else if (byte >= 0x20 && byte != 0x7f && (byte < 0x80 || _json))
+			out += c;
+		else if (_json) {
+			out += "\\u00";
+			out += hex[byte >> 4];
+			out += hex[byte & 0xf];
+		}
+		else {
+			out += "\\x";
+			out += hex[byte >> 4];
+			out += hex[byte & 0xf];
+		}
+	}
+}
+
+void	AccessLogFormat::render(std::string& out, const RequestTrace& trace, const LogClock& clock,
+			std::chrono::steady_clock::time_point now) const {
+	using time_point = std::chrono::steady_clock::time_point;
+	int64_t receive = std::max<int64_t>(trace.receive, 0);
+	int64_t handle = trace.start != time_point{} && trace.head != time_point{} ? micros(trace.head - trace.start) : 0;
+	int64_t send = trace.head != time_point{} ? micros(now - trace.head) : 0;
+
+	for (const Segment& segment : _segments) {
+		switch (segment.field) {
+			case LITERAL:			out += segment.text; break ;
+			case REMOTE_ADDR:		value(out, trace.client); break ;
+			case HOST:				value(out, trace.host); break ;
+			case REQUEST:
+				value(out, trace.method);
+				out += ' ';
+				value(out, trace.uri);
+				out += ' ';
+				value(out, trace.protocol);
+				break ;
+			case REQUEST_METHOD:	value(out, trace.method); break ;
+			case REQUEST_URI:		value(out, trace.uri); break ;
+			case SERVER_PROTOCOL:	value(out, trace.protocol); break ;
+			case STATUS:			number(out, trace.status); break ;
+			case BYTES_SENT:		number(out, trace.bytes); break ;
+			case REQUEST_TIME:		seconds(out, receive + handle + send); break ;
+			case RECEIVE_TIME:		seconds(out, receive); break ;
+			case HANDLE_TIME:		seconds(out, handle); break ;
+			case SEND_TIME:			seconds(out, send); break ;
+			case TIME_LOCAL:		out += clock.local; break ;
+			case TIME_ISO8601:		out += clock.iso8601; break ;
+			case MSEC:
+				number(out, static_cast<uint64_t>(clock.second));
+				out += '.';
+				out += static_cast<char>('0' + clock.millis / 100);
+				out += static_cast<char>('0' + clock.millis / 10 % 10);
+				out += static_cast<char>('0' + clock.millis % 10);
+				break ;
+			case LOCATION:			value(out, trace.route ? *trace.route : std::string_view()); break ;
+			case HANDLER:			value(out, trace.handler ? trace.handler : ""); break ;
+		}
+	}
+}
+
+AccessLog::AccessLog(const std::string& path, size_t buffer, size_t flush)
+	: _ring(buffer * 1024), _flush(flush) {
+	_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	if (_fd < 0)
+		throw std::runtime_error("Error: Cannot open access_log " + path + ": " + std::strerror(errno));
+	_flusher = std::thread(&AccessLog::flushLoop, this);
+}
+
+AccessLog::~AccessLog() {
+	_stop.store(true);
+	{
+		std::lock_guard<std::mutex> lock(_mutex);	// the flusher is asleep or has not checked _stop yet
+	}
+	_wakeup.notify_one();
+	_flusher.join();
+	close(_fd);
+}
+
+// One producer, the event loop: it owns _head and only reads _tail to know the room left.
+// The flusher is woken once the ring crosses half full, or else wakes every flush interval.
+bool	AccessLog::append(std::string_view line) {
+	uint64_t head = _head.load(std::memory_order_relaxed);
+	uint64_t tail = _tail.load(std::memory_order_acquire);
+	size_t size = _ring.size();
+	if (line.size() > size - (head - tail)) {
+		_dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	size_t at = head % size;
+	size_t first = std::min(line.size(), size - at);
+	std::memcpy(_ring.data() + at, line.data(), first);
+	std::memcpy(_ring.data(), line.data() + first, line.size() - first);
+	_head.store(head + line.size(), std::memory_order_release);
+	if (head - tail < size / 2 && head + line.size() - tail >= size / 2)
+		_wakeup.notify_one();	// without the lock: a missed wakeup only waits for the next interval
+	return true;
+}
+
+uint64_t	AccessLog::dropped() const {
+	return _dropped.load(std::memory_order_relaxed);
+}
+
+void	AccessLog::flushLoop() {
+	while (!_stop.load()) {
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_wakeup.wait_for(lock, _flush, [this]() {
+				return _stop.load() || _head.load(std::memory_order_acquire)
+					- _tail.load(std::memory_order_relaxed) >= _ring.size() / 2;
+			});
+		}
+		flush();
+	}
+	flush();
+}
+
+// Everything in the ring goes out in one writev, two pieces when it wraps around. Lines the
+// file refuses (disk full...) are dropped so the event loop is never held up by them.
+void	AccessLog::flush() {
+	uint64_t tail = _tail.load(std::memory_order_relaxed);
+	uint64_t head = _head.load(std::memory_order_acquire);
+	size_t size = _ring.size();
+	while (tail < head) {
+		size_t at = tail % size;
+		size_t pending = head - tail;
+		size_t first = std::min(pending, size - at);
+		iovec iov[2] = {{_ring.data() + at, first}, {_ring.data(), pending - first}};
+		ssize_t written = writev(_fd, iov, pending > first ? 2 : 1);
+		if (written < 0 && errno == EINTR)
+			continue ;
+		if (written <= 0) {
+			tail = head;
+			break ;
+		}
+		tail += static_cast<uint64_t>(written);
+	}
+	_tail.store(tail, std::memory_order_release);
+}
+
+// Files are opened once per path; a format is looked up in the server's log_format lines first
+void	AccessLogs::open(const std::vector<Server>& servers) {
+	for (const Server& serv : servers) {
+		const AccessLogConfig& config = serv.getAccessLog();
+		if (config.path.empty())
+			continue ;
+		std::unique_ptr<AccessLog>& file = _files[config.path];
+		if (!file)
+			file = std::make_unique<AccessLog>(config.path, config.buffer, config.flush);
+
+		LogFormat format;
+		auto it = serv.getLogFormats().find(config.format);
+		if (it != serv.getLogFormats().end())
+			format = it->second;
+		else if (!AccessLogFormat::builtin(config.format, format))
+			throw std::runtime_error("Error: Unknown log_format " + config.format);
+
+		size_t id = static_cast<size_t>(serv.getId());
+		if (_targets.size() <= id)
+			_targets.resize(id + 1);
+		_targets[id].log = file.get();
+		if (!AccessLogFormat::compile(format, _targets[id].format))
+			throw std::runtime_error("Error: Invalid log_format " + config.format);
+	}
+}
+
+bool	AccessLogs::enabled(int server) const {
+	return server >= 0 && static_cast<size_t>(server) < _targets.size() && _targets[server].log;
+}
+
+void	AccessLogs::write(const RequestTrace& trace) {
+	if (!enabled(trace.server))
+		return ;
+	const Target& target = _targets[trace.server];
+	_clock.update(std::chrono::system_clock::now());
+	_line.clear();
+	target.format.render(_line, trace, _clock, std::chrono::steady_clock::now());
+	_line += '\n';
+	target.log->append(_line);
+}
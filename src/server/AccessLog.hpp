@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+#include "webserv.hpp"
+#include "Server.hpp"
+#include "Metrics.hpp"
+
+// Formatted time of the current second, shared by every line logged within it
+struct LogClock {
+	int64_t		second = -1;
+	int64_t		millis = 0;
+	std::string	local;		// 18/Oct/2026:14:03:07 +0200
+	std::string	iso8601;	// 2026-10-18T14:03:07+02:00
+
+	void	update(std::chrono::system_clock::time_point now);
+};
+
+// A log_format compiled once at startup: literal text between $variables, so a line is written
+// without looking anything up
+class AccessLogFormat {
+
+	public:
+		enum Field {
+			LITERAL,
+			REMOTE_ADDR,
+			HOST,
+			REQUEST,
+			REQUEST_METHOD,
+			REQUEST_URI,
+			SERVER_PROTOCOL,
+			STATUS,
+			BYTES_SENT,
+			REQUEST_TIME,
+			RECEIVE_TIME,
+			HANDLE_TIME,
+			SEND_TIME,
+			TIME_LOCAL,
+			TIME_ISO8601,
+			MSEC,
+			LOCATION,
+			HANDLER
+		};
+
+	private:
+		struct Segment {
+			Field		field;
+			std::string	text;	// literal text, for LITERAL
+		};
+
+		std::vector<Segment>	_segments;
+		bool					_json = false;
+
+		void	value(std::string& out, std::string_view text) const;
+
+	public:
+		// False when the pattern names a variable there is no field for
+		static bool	compile(const LogFormat& format, AccessLogFormat& out);
+		// The formats every server has: main and json
+		static bool	builtin(const std::string& name, LogFormat& out);
+
+		void	render(std::string& out, const RequestTrace& trace, const LogClock& clock,
+					std::chrono::steady_clock::time_point now) const;
+};
+
+// One access_log file. Lines go into a lock-free ring written by the event loop only, a flusher
+// thread writes what is in it with one writev every flush interval, or as soon as the ring is
+// half full. A line that does not fit is dropped rather than waited for.
+class AccessLog {
+
+	private:
+		int							_fd = -1;
+		std::vector<char>			_ring;
+		std::atomic<uint64_t>		_head {0};		// bytes put in the ring, by the event loop
+		std::atomic<uint64_t>		_tail {0};		// bytes written to the file, by the flusher
+		std::atomic<uint64_t>		_dropped {0};	// lines that found the ring full
+		std::chrono::milliseconds	_flush;
+		std::atomic<bool>			_stop {false};
+		std::mutex					_mutex;		// only for the flusher to sleep on
+		std::condition_variable		_wakeup;
+		std::thread					_flusher;
+
+		void	flushLoop();
+		void	flush();
+
+	public:
+		AccessLog(const std::string& path, size_t buffer, size_t flush);
+		~AccessLog();
+
+		AccessLog(const AccessLog&) = delete;
+		AccessLog&	operator=(const AccessLog&) = delete;
+
+		// False when the ring has no room for the line, which is then dropped
+		bool		append(std::string_view line);
+		uint64_t	dropped() const;
+};
+
+// Access logs of every server, the files shared by servers that name the same path
+class AccessLogs {
+
+	private:
+		struct Target {
+			AccessLog*		log = nullptr;
+			AccessLogFormat	format;
+		};
+
+		std::map<std::string, std::unique_ptr<AccessLog>>	_files;
+		std::vector<Target>	_targets;	// by server id
+		LogClock			_clock;
+		std::string			_line;		// keeps its capacity between lines
+
+	public:
+		void	open(const std::vector<Server>& servers);
+
+		bool	enabled(int server) const;
+		void	write(const RequestTrace& trace);
+};
@@ -1,10 +1,12 @@
 #include "Cluster.hpp"
+#include <charconv>	// for std::from_chars
 #include "dev/devHelpers.hpp"
 #include "../config/Config.hpp"
 #include "../parser/Parser.hpp"
 #include "../request/Request.hpp"
 #include "../router/Router.hpp"
 #include "../router/utils/HttpResponseBuilder.hpp"
+#include "../router/utils/ErrorPages.hpp"
 #include "../response/Response.hpp"
 
 void	Cluster::config(const std::string& config_file) {
@@ -12,19 +14,40 @@ void	Cluster::config(const std::string& config_file) {
 
 	signal(SIGINT, handleSigTerminate);
 	signal(SIGTERM, handleSigTerminate);
+	signal(SIGPIPE, SIG_IGN);	// a closed client or CGI pipe surfaces as EPIPE instead
 
 	config.validate(config_file);
 	_configs = config.parse(config_file);
-	groupConfigs();
 
-	_max_clients = getMaxClients();
+	// The most verbose log_level of the servers applies to the whole process
+	int level = -1;
+	for (const Server& conf : _configs) {
+		Log::Level server_level;
+		if (Log::parse(conf.getLogLevel(), server_level))
+			level = std::max(level, static_cast<int>(server_level));
+	}
+	if (level >= 0)
+		Log::setLevel(static_cast<Log::Level>(level));
+	if (Log::level() > LOG_MAX_LEVEL)
+		LOG_WARN("log_level " << Log::name(Log::level()) << " needs a build keeping its messages (make debug)");
 
-	// Assign sequential IDs to server configurations
+	// Assign sequential IDs to server configurations, and read their error pages once,
+	// before groups copy them
 	for (size_t i = 0; i < _configs.size(); ++i) {
 		_configs[i].setId(static_cast<int>(i));
+		_configs[i].setErrorPageCache(std::make_shared<const router::utils::ErrorPages>(_configs[i]));
 	}
 
+	groupConfigs();
+
+	_max_clients = getMaxClients();
+
 	_router.setupRouter(_configs);
+	_router.setMetrics(&_metrics);
+	_access_logs.open(_configs);
+	_metrics.setConnectionCounter([this]() { return countConnections(); });
+	for (const Server& conf : _configs)
+		_metrics.nameServer(conf.getId(), (conf.getName().empty() ? "_" : conf.getName()) + ":" + std::to_string(conf.getPort()));
 }
 
 void	Cluster::groupConfigs() {
@@ -65,7 +88,7 @@ void	Cluster::createGroup(const Server& conf) {
 }
 
 void	Cluster::create() {
-	std::cout << CYAN << time_now() << "	Initializing servers...\n" << RESET;
+	LOG_INFO("Initializing servers...");
 	for (auto& group : _listener_groups)
 	{
 		Server serv = *group.default_config;
@@ -87,6 +110,13 @@ void	Cluster::run() {
 		}
 
 		for (size_t i = 0; i < _fds.size(); ++i) {
+			if (_fds[i].fd < 0)
+				continue ;
+			if (_pending_fds.count(_fds[i].fd)) {
+				if (_fds[i].revents)
+					handlePendingEvent(i);
+				continue ;
+			}
 			if (_fds[i].revents & (POLLERR | POLLHUP | POLLNVAL))
 				handlePollError(i, _fds[i].revents);
 			if (_fds[i].revents & POLLIN) {
@@ -103,7 +133,11 @@ void	Cluster::run() {
 			}
 		}
 		checkForTimeouts();
+		startHealthProbes();
+		startCacheJobs();
+		std::erase_if(_fds, [](const pollfd& p) { return p.fd < 0; });
 	}
+	LOG_INFO("Server closed");
 }
 
 void	Cluster::handlePollError(size_t& i, short int event) {
@@ -122,20 +156,28 @@ void	Cluster::handleNewClient(size_t i) {
 	sockaddr_in client_addr{};
 	socklen_t addrlen = sizeof(client_addr);
 	int client_fd = accept(_fds[i].fd, (sockaddr*)&client_addr, &addrlen);
-	if (client_fd < 0)
+	if (client_fd < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNABORTED || errno == EINTR)
+			return ;	// client gone before it was accepted
 		throw std::runtime_error("Error: accept");
+	}
+	_metrics.accepted();
 
 	setSocketToNonBlockingMode(client_fd);
 
-	std::cout << CYAN
-			<< time_now()
-			<< "	New client connected"
-			<< ". Assigned socket: "
-			<< client_fd << "\n"
-			<< RESET;
+	LOG_DEBUG("New client connected. Assigned socket: " << client_fd);
+
+	char addr[INET_ADDRSTRLEN] = "";
+	inet_ntop(AF_INET, &client_addr.sin_addr, addr, sizeof(addr));
+	addClient(client_fd, _fds[i].fd, addr);
+	_metrics.handled();
+}
 
+// Polls client_fd for requests to the servers listening on server_fd
+void	Cluster::addClient(int client_fd, int server_fd, const std::string& remote_addr) {
+	_client_buffers[client_fd].remote_addr = remote_addr;
 	_fds.push_back({client_fd, POLLIN, 0});
-	_clients[client_fd] = _servers[_fds[i].fd];
+	_clients[client_fd] = _servers[server_fd];
 }
 
 void	Cluster::handleClientInData(size_t& i) {
@@ -145,81 +187,914 @@ void	Cluster::handleClientInData(size_t& i) {
 		dropClient(i, CLIENT_DISCONNECT);
 	else if (bytes == -1)
 		dropClient(i, CLIENT_ERROR);
-	else
+	else {
+		_metrics.received(bytes);
 		processReceivedData(i, buffer, bytes);
+	}
 }
 
-void	Cluster::prepareResponse(ClientRequestState& client_state, const Server& conf, Request& req, int i) {
+void	Cluster::prepareResponse(ClientRequestState& client_state, const Server& conf, Request& req, int i, uint32_t stream) {
 	Response res;
-	_router.handleRequest(conf, req, res);
-	client_state.response.append(responseToString(res));
+	RequestTrace trace;
+	traceRequest(trace, conf, req, client_state);
+	trace.receive = receiveTime(client_state);
+	trace.start = std::chrono::steady_clock::now();
+	req.setRemoteAddr(client_state.remote_addr);
+	_router.handleRequest(conf, req, res, &trace);
+	startResponse(client_state, res, i, stream, trace);
+}
+
+// A response with pending work waits in flight for its job, any other is delivered right away
+void	Cluster::startResponse(ClientRequestState& client_state, const Response& res, int i, uint32_t stream,
+			const RequestTrace& trace) {
+	if (res.getBackground()) {
+		_background.push_back({res.getBackground(), -1, std::chrono::high_resolution_clock::now()});
+		syncPendingFds();
+	}
+	if (res.getPending()) {
+		InFlight slot;
+		slot.job = res.getPending();
+		slot.start = std::chrono::high_resolution_clock::now();
+		slot.stream = stream;
+		slot.trace = trace;
+		client_state.in_flight.push_back(std::move(slot));
+		syncPendingFds();
+		advancePending(_fds[i].fd);
+		return ;
+	}
+	deliverResponse(client_state, res, i, stream, trace);
+}
+
+void	Cluster::queueResponse(ClientRequestState& client_state, const std::string& data, int i) {
+	client_state.response.append(data);
+	client_state.queued += data.size();
 	_fds[i].events |= POLLOUT;
 	client_state.send_start = std::chrono::high_resolution_clock::now();
 	client_state.waiting_response = true;
 }
 
+// Serializes straight into the client's send buffer, which keeps its capacity between responses
+void	Cluster::queueResponse(ClientRequestState& client_state, const Response& res, int i) {
+	size_t before = client_state.response.size();
+	appendResponse(client_state.response, res);
+	client_state.queued += client_state.response.size() - before;
+	_fds[i].events |= POLLOUT;
+	client_state.send_start = std::chrono::high_resolution_clock::now();
+	client_state.waiting_response = true;
+}
+
+// Responses go out in request order: straight to the client when nothing is in flight,
+// otherwise they wait in the queue behind the requests ahead of them. HTTP/2 streams do not wait.
+void	Cluster::deliverResponse(ClientRequestState& client_state, const Response& res, int i, uint32_t stream,
+			RequestTrace trace) {
+	countResponse(res, trace);
+	if (client_state.h2) {
+		dropUploads(client_state, stream);
+		client_state.h2->respond(stream, res, false);
+		flushSession(client_state, i);
+		awaitSent(client_state, trace);
+		return ;
+	}
+	if (client_state.in_flight.empty()) {
+		queueResponse(client_state, res, i);
+		awaitSent(client_state, trace);
+		return ;
+	}
+	InFlight slot;
+	appendResponse(slot.ready, res);
+	slot.trace = trace;
+	client_state.in_flight.push_back(std::move(slot));
+}
+
+void	Cluster::deliverResponse(ClientRequestState& client_state, const std::string& data, int i) {
+	if (client_state.in_flight.empty()) {
+		queueResponse(client_state, data, i);
+		return ;
+	}
+	InFlight slot;
+	slot.ready = data;
+	client_state.in_flight.push_back(std::move(slot));
+}
+
 void	Cluster::processReceivedData(size_t& i, const char* buffer, int bytes) {
 	ClientRequestState& client_state = _client_buffers[_fds[i].fd];
 	client_state.buffer.append(buffer, bytes);
 	client_state.receive_start = std::chrono::high_resolution_clock::now();
+	if (client_state.request_start == std::chrono::high_resolution_clock::time_point{})
+		client_state.request_start = client_state.receive_start;
+	processBufferedRequests(i);
+}
 
-	while (requestComplete(client_state, _fds[i].fd, this)) {
+// Pipelined requests are handled while fewer than pipeline_depth wait for their response,
+// the responses still go out in request order (advancePending)
+void	Cluster::processBufferedRequests(size_t& i) {
+	ClientRequestState& client_state = _client_buffers[_fds[i].fd];
+
+	// A client with prior knowledge of HTTP/2 starts with its preface instead of a request
+	size_t preface = std::min(client_state.buffer.size(), http2::PREFACE.size());
+	if (client_state.h2 || (preface >= 3 && !client_state.body_sink && !client_state.body_decoder
+		&& std::string_view(client_state.buffer).substr(0, preface) == http2::PREFACE.substr(0, preface))) {
+		processStreams(i);
+		return ;
+	}
+
+	client_state.parsing = true;
+	while (!client_state.kick_me && client_state.in_flight.size() < client_state.pipeline_depth) {
+		if (!client_state.head_checked && !answerExpectation(i))
+			break ;
+		if (client_state.body_sink || openBodySink(i)) {
+			if (!feedBodySink(i))
+				break ;
+			client_state.head_checked = false;
+			continue ;
+		}
+		if (!requestComplete(client_state, _fds[i].fd, this))
+			break ;
+		client_state.head_checked = false;
 		client_state.request = client_state.clean_buffer.substr(0, client_state.request_size);
 		const Server& conf = findRelevantConfig(_fds[i].fd, client_state.clean_buffer);
+		client_state.pipeline_depth = conf.getPipelineDepth();
 		Parser parse;
 		Request req = parse.parseRequest(client_state.request, client_state.kick_me, false);
+		if (upgradeToHttp2(i, conf, req)) {
+			prepareResponse(client_state, conf, req, i, 1);
+			break ;
+		}
 		prepareResponse(client_state, conf, req, i);
 		setTimer(client_state);
 	}
+	client_state.parsing = false;
+	if (client_state.h2) {
+		processStreams(i);	// the client's preface follows the upgraded request
+		return ;
+	}
 
-	if (client_state.data_validity == false) {
+	if (client_state.data_validity == false && !client_state.kick_me) {
 		const Server& conf = findRelevantConfig(_fds[i].fd, client_state.clean_buffer);
 		Parser parse;
 		Request req = parse.parseRequest("400 Bad Request", client_state.kick_me, false);
 		prepareResponse(client_state, conf, req, i);
 		client_state.kick_me = true;
 	}
+	updateReading(i);
+}
+
+// A connection with a full pipeline is not read until responses go out, nor one with a full body
+// sink until the sink's write is done; the socket buffers the rest
+void	Cluster::updateReading(size_t i) {
+	watchBodySinks(_fds[i].fd);
+	ClientRequestState& client_state = _client_buffers[_fds[i].fd];
+	if (client_state.kick_me || (!client_state.h2 && client_state.in_flight.size() >= client_state.pipeline_depth)
+		|| bodySinkFull(client_state))
+		_fds[i].events &= ~POLLIN;
+	else
+		_fds[i].events |= POLLIN;
+}
+
+// A client sending "Expect: 100-continue" waits for the go-ahead before the body, so a request
+// refused on its head (413, 404, 405) is answered without reading the body at all.
+// Returns false when the request was refused and the connection is closing.
+bool	Cluster::answerExpectation(size_t i) {
+	ClientRequestState& client_state = _client_buffers[_fds[i].fd];
+	size_t header_end = findHeader(client_state.buffer);
+	if (header_end == std::string::npos || header_end > MAX_HEADER_SIZE)
+		return true;
+	client_state.head_checked = true;
+
+	// Most requests carry no expectation, they are not parsed twice
+	static const std::string token = "100-continue";
+	auto head_end = client_state.buffer.begin() + header_end;
+	auto found = std::search(client_state.buffer.begin(), head_end, token.begin(), token.end(),
+		[](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == b; });
+	if (found == head_end)
+		return true;
+
+	Request req = Parser::parseRequest(client_state.buffer.substr(0, header_end), client_state.kick_me, false);
+	const std::vector<std::string>& expect = req.getHeaders("expect");
+	if (req.getError() || expect.size() != 1 || req.getHttpVersion() != "HTTP/1.1")
+		return true;
+	std::string value = expect[0];
+	std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+	if (value != token)
+		return true;
+
+	const Server& conf = findRelevantConfig(_fds[i].fd, client_state.buffer);
+	Response res;
+	if (!_router.refuseHead(conf, req, res)) {
+		// A client that stopped waiting has already started the body
+		if (client_state.buffer.size() == header_end)
+			deliverResponse(client_state, "HTTP/1.1 100 Continue\r\n\r\n", i);
+		return true;
+	}
+
+	deliverResponse(client_state, res, i);
+	client_state.buffer.clear();
+	client_state.kick_me = true;
+	_fds[i].events &= ~POLLIN;
+	return false;
+}
+
+// Uploads go to their handler while they arrive, so only the head and one read are ever buffered.
+// A chunked upload is decoded on the way, the sink only sees the body.
+bool	Cluster::openBodySink(size_t i) {
+	ClientRequestState& client_state = _client_buffers[_fds[i].fd];
+	if (client_state.body_decoder)
+		return false;	// chunked body already being buffered by requestComplete()
+	size_t header_end = findHeader(client_state.buffer);
+	if (header_end == std::string::npos || header_end > MAX_HEADER_SIZE)
+		return false;
+
+	const Server& conf = findRelevantConfig(_fds[i].fd, client_state.buffer);
+	Request req = Parser::parseRequest(client_state.buffer.substr(0, header_end), client_state.kick_me, false);
+	const std::vector<std::string>& length = req.getHeaders("content-length");
+	const std::vector<std::string>& coding = req.getHeaders("transfer-encoding");
+	if (req.getError())
+		return false;
+	size_t body_size = 0;
+	bool chunked = coding.size() == 1 && coding[0] == "chunked" && length.empty();
+	if (!chunked) {
+		if (length.size() != 1 || !coding.empty())
+			return false;
+		if (length[0].empty() || length[0].find_first_not_of("0123456789") != std::string::npos)
+			return false;
+		body_size = std::strtoull(length[0].c_str(), nullptr, 10);
+		if (body_size > conf.getMaxBodySize())
+			return false;	// rejected by requestComplete()
+	}
+
+	req.setRemoteAddr(client_state.remote_addr);
+	client_state.body_trace = RequestTrace();
+	traceRequest(client_state.body_trace, conf, req, client_state);
+	client_state.body_sink = _router.openBodySink(conf, req, &client_state.body_trace);
+	if (!client_state.body_sink)
+		return false;
+	if (chunked)
+		client_state.body_decoder = std::make_unique<ChunkedDecoder>(conf.getMaxBodySize());
+	client_state.body_remaining = body_size;
+	client_state.buffer.erase(0, header_end);
+	return true;
+}
+
+// Passes what arrived of the body on; once it is complete the response is queued like any other
+bool	Cluster::feedBodySink(size_t i) {
+	ClientRequestState& client_state = _client_buffers[_fds[i].fd];
+	if (client_state.body_decoder) {
+		ChunkedDecoder& decoder = *client_state.body_decoder;
+		BodySink& sink = *client_state.body_sink;
+		size_t used = decoder.decode(client_state.buffer.data(), client_state.buffer.size(),
+			[&sink](const char* data, size_t size) { sink.write(data, size); });
+		client_state.buffer.erase(0, used);
+		if (decoder.failed()) {
+			// The sink discards what it stored; the client gets a 400 and is closed
+			closeBodySink(client_state);
+			client_state.body_decoder.reset();
+			client_state.data_validity = false;
+			return false;
+		}
+		if (!decoder.done())
+			return false;
+		client_state.body_decoder.reset();
+	}
+	else {
+		size_t size = std::min(client_state.body_remaining, client_state.buffer.size());
+		client_state.body_sink->write(client_state.buffer.data(), size);
+		client_state.buffer.erase(0, size);
+		client_state.body_remaining -= size;
+		if (client_state.body_remaining > 0)
+			return false;
+	}
+
+	Response res;
+	client_state.body_trace.receive = receiveTime(client_state);
+	client_state.body_trace.start = std::chrono::steady_clock::now();
+	unregisterPendingFd(client_state.body_sink_fd);	// a job the sink hands over polls it from here
+	client_state.body_sink->finish(res);
+	client_state.body_sink.reset();
+	startResponse(client_state, res, i, 0, client_state.body_trace);
+	setTimer(client_state);
+	return true;
+}
+
+// "Upgrade: h2c" switches the connection to HTTP/2 after the request, which is answered on stream 1.
+// Only a request without a body and with nothing in flight is upgraded, otherwise the header is ignored.
+bool	Cluster::upgradeToHttp2(size_t i, const Server& conf, const Request& req) {
+	ClientRequestState& client_state = _client_buffers[_fds[i].fd];
+	const std::vector<std::string>& upgrade = req.getHeaders("upgrade");
+	const std::vector<std::string>& settings = req.getHeaders("http2-settings");
+	if (req.getError() || upgrade.size() != 1 || settings.size() != 1 || !client_state.in_flight.empty()
+		|| !req.getBody().empty() || !req.getHeaders("transfer-encoding").empty())
+		return false;
+
+	bool h2c = false;
+	std::istringstream protocols(upgrade[0]);
+	for (std::string protocol; std::getline(protocols, protocol, ',');)
+		h2c = h2c || trim(protocol) == "h2c";
+	if (!h2c)
+		return false;
+
+	auto session = std::make_unique<http2::Session>(conf.getPipelineDepth());
+	if (!session->upgrade(settings[0], req))
+		return false;
+	queueResponse(client_state, "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n", i);
+	client_state.h2 = std::move(session);
+	flushSession(client_state, i);
+	return true;
+}
+
+// An HTTP/2 connection carries its requests as streams: each is handled as soon as its head is in
+// and answered on its stream once its handler is done, in whatever order that happens
+void	Cluster::processStreams(size_t& i) {
+	ClientRequestState& client_state = _client_buffers[_fds[i].fd];
+	if (!client_state.h2)
+		client_state.h2 = std::make_unique<http2::Session>(_clients[_fds[i].fd]->default_config->getPipelineDepth());
+
+	client_state.h2->feed(client_state.buffer);
+	http2::StreamEvent event;
+	while (client_state.h2->nextEvent(event))
+		handleStreamEvent(i, event);
+	setTimer(client_state);
+
+	if (client_state.h2->closing()) {
+		if (!client_state.in_flight.empty()) {
+			abortInFlight(client_state, 0);
+			syncPendingFds();
+		}
+		dropUploads(client_state, 0);
+		client_state.kick_me = true;
+		_fds[i].events |= POLLOUT;
+	}
+	else if (!client_state.in_flight.empty())
+		syncPendingFds();	// a window update may let a paused stream go on
+	flushSession(client_state, i);
+	updateReading(i);
+}
+
+// Bodies go to the upload handler as they arrive, like on HTTP/1.1, or are buffered for the others
+void	Cluster::handleStreamEvent(size_t i, http2::StreamEvent& event) {
+	ClientRequestState& client_state = _client_buffers[_fds[i].fd];
+	auto it = client_state.h2_uploads.find(event.stream);
+
+	switch (event.type) {
+		case http2::StreamEvent::REQUEST: {
+			const std::vector<std::string>& host = event.request.getHeaders("host");
+			const Server& conf = configForHost(_fds[i].fd, host.empty() ? "" : host[0]);
+			if (event.end) {
+				prepareResponse(client_state, conf, event.request, i, event.stream);
+				break ;
+			}
+			Response res;
+			if (_router.refuseHead(conf, event.request, res)) {
+				deliverResponse(client_state, res, i, event.stream);
+				break ;
+			}
+			StreamUpload& upload = client_state.h2_uploads[event.stream];
+			upload.config = &conf;
+			event.request.setRemoteAddr(client_state.remote_addr);
+			traceRequest(upload.trace, conf, event.request, client_state);
+			upload.sink = _router.openBodySink(conf, event.request, &upload.trace);
+			upload.request = std::move(event.request);
+			break ;
+		}
+		case http2::StreamEvent::DATA: {
+			if (it == client_state.h2_uploads.end())
+				break ;	// answered already
+			StreamUpload& upload = it->second;
+			upload.size += event.data.size();
+			if (upload.size > upload.config->getMaxBodySize()) {
+				// The sink discards what it stored
+				Response res;
+				router::utils::HttpResponseBuilder::setErrorResponse(res, http::PAYLOAD_TOO_LARGE_413, upload.request, *upload.config);
+				deliverResponse(client_state, res, i, event.stream);
+				break ;
+			}
+			if (upload.sink)
+				upload.sink->write(event.data.data(), event.data.size());
+			else
+				upload.body.append(event.data);
+			break ;
+		}
+		case http2::StreamEvent::END: {
+			if (it == client_state.h2_uploads.end())
+				break ;
+			unregisterPendingFd(it->second.sink_fd);	// a job the sink hands over polls it from here
+			StreamUpload upload = std::move(it->second);
+			client_state.h2_uploads.erase(it);
+			if (upload.sink) {
+				Response res;
+				upload.trace.receive = receiveTime(client_state);
+				upload.trace.start = std::chrono::steady_clock::now();
+				upload.sink->finish(res);
+				startResponse(client_state, res, i, event.stream, upload.trace);
+				break ;
+			}
+			upload.request.setBody(upload.body);
+			if (upload.request.getHeaders("content-length").empty())
+				upload.request.setHeaders("content-length", std::to_string(upload.size));
+			prepareResponse(client_state, *upload.config, upload.request, i, event.stream);
+			break ;
+		}
+		case http2::StreamEvent::CANCELLED: {
+			dropUploads(client_state, event.stream);
+			for (auto slot = client_state.in_flight.begin(); slot != client_state.in_flight.end(); ++slot) {
+				if (slot->stream != event.stream)
+					continue ;
+				slot->job->abort(false);
+				unregisterPendingFd(slot->fd);
+				client_state.in_flight.erase(slot);
+				break ;
+			}
+			break ;
+		}
+	}
+}
+
+void	Cluster::flushSession(ClientRequestState& client_state, int i) {
+	std::string& frames = client_state.h2->output();
+	if (frames.empty())
+		return ;
+	queueResponse(client_state, frames, i);
+	frames.clear();
 }
 
 void	Cluster::sendPendingData(size_t& i) {
 	ClientRequestState& client_state = _client_buffers[_fds[i].fd];
-	if (!client_state.response.size())
+	if (!client_state.response.size()) {
+		if (client_state.kick_me && client_state.in_flight.empty())
+			dropClient(i, CLIENT_CLOSE_CONNECTION);
 		return ;
+	}
 
 	if (client_state.waiting_response == true) {
 		std::string response = popResponseChunk(client_state);
-		std::cout << RED << time_now() << "	Sending response to client " << _fds[i].fd << RESET << std::endl;
+		LOG_TRACE("Sending response to client " << _fds[i].fd);
 		ssize_t sent = send(_fds[i].fd, response.c_str(), response.size(), 0);
-		if (sent <= 0)
+		if (sent <= 0) {
 			dropClient(i, CLIENT_ERROR);
-		else if (sent > 0 && client_state.response.empty()) {
+			return ;
+		}
+		_metrics.sent(sent);
+		if (client_state.response.empty()) {
 			_fds[i].events &= ~POLLOUT;
 			client_state.send_start = std::chrono::high_resolution_clock::time_point{};
 			client_state.waiting_response = false;
+			for (const RequestTrace& trace : client_state.sending) {
+				_metrics.delivered(trace);
+				_access_logs.write(trace);
+			}
+			client_state.sending.clear();
 		}
-		if (client_state.kick_me && client_state.response.empty()) {
+		if (client_state.kick_me && client_state.response.empty() && client_state.in_flight.empty()) {
 			dropClient(i, CLIENT_CLOSE_CONNECTION);
 		}
+		else if (std::any_of(client_state.in_flight.begin(), client_state.in_flight.end(),
+			[](const InFlight& slot) { return slot.job && slot.job->streaming(); }))
+			syncPendingFds();
+	}
+}
+
+void	Cluster::handlePendingEvent(size_t i) {
+	int client_fd = _pending_fds[_fds[i].fd];
+	if (client_fd < 0) {
+		for (auto& background : _background) {
+			if (background.fd == _fds[i].fd)
+				background.job->onEvent(_fds[i].revents);
+		}
+		syncPendingFds();
+		return ;
+	}
+	if (handleBodySinkEvent(client_fd, _fds[i].fd))
+		return ;
+	ClientRequestState& client_state = _client_buffers[client_fd];
+
+	for (auto& slot : client_state.in_flight) {
+		if (slot.job && slot.fd == _fds[i].fd) {
+			slot.job->onEvent(_fds[i].revents);
+			break ;
+		}
 	}
+	advancePending(client_fd);
+	syncPendingFds();
+}
+
+// A body sink's write is done: it hands over what arrived meanwhile and the connection is read again
+bool	Cluster::handleBodySinkEvent(int client_fd, int fd) {
+	ClientRequestState& client_state = _client_buffers[client_fd];
+	BodySink* sink = client_state.body_sink_fd == fd ? client_state.body_sink.get() : nullptr;
+	for (auto& [stream, upload] : client_state.h2_uploads) {
+		if (upload.sink_fd == fd)
+			sink = upload.sink.get();
+	}
+	if (!sink)
+		return false;
+	sink->onEvent();
+	client_state.receive_start = std::chrono::high_resolution_clock::now();	// the wait was on the disk, not the client
+	updateReading(findFdIndex(client_fd));
+	return true;
+}
+
+// Sinks writing on a file I/O thread are polled through their fd until the write is done
+void	Cluster::watchBodySinks(int client_fd) {
+	ClientRequestState& client_state = _client_buffers[client_fd];
+	watchBodySink(client_state.body_sink.get(), client_state.body_sink_fd, client_fd);
+	for (auto& [stream, upload] : client_state.h2_uploads)
+		watchBodySink(upload.sink.get(), upload.sink_fd, client_fd);
+}
+
+void	Cluster::watchBodySink(BodySink* sink, int& sink_fd, int client_fd) {
+	int fd = sink ? sink->fd() : -1;
+	if (fd == sink_fd)
+		return ;
+	unregisterPendingFd(sink_fd);
+	if (fd < 0)
+		return ;
+	_fds.push_back({fd, POLLIN, 0});
+	_pending_fds[fd] = client_fd;
+	sink_fd = fd;
+}
+
+// A sink's fd leaves the poll set before the sink goes, the thread still writing may close it any time
+void	Cluster::closeBodySink(ClientRequestState& client_state) {
+	unregisterPendingFd(client_state.body_sink_fd);
+	client_state.body_sink.reset();
+}
+
+// Forgets the body of stream, or of every stream with 0
+void	Cluster::dropUploads(ClientRequestState& client_state, uint32_t stream) {
+	for (auto it = client_state.h2_uploads.begin(); it != client_state.h2_uploads.end(); ) {
+		if (stream && it->first != stream) {
+			++it;
+			continue ;
+		}
+		unregisterPendingFd(it->second.sink_fd);
+		it = client_state.h2_uploads.erase(it);
+	}
+}
+
+// Passes on what in-flight jobs produced, in request order. The front job's response goes out,
+// a streaming one's head and body as they come; a job behind it that finishes first is finished
+// into its slot and waits there. Then the next pipelined requests are read.
+void	Cluster::advancePending(int client_fd) {
+	ClientRequestState& client_state = _client_buffers[client_fd];
+	if (client_state.in_flight.empty())
+		return ;	// already advanced from syncPendingFds
+	if (client_state.h2) {
+		advanceStreams(client_fd);
+		return ;
+	}
+	size_t i = findFdIndex(client_fd);
+	auto now = std::chrono::high_resolution_clock::now();
+	bool freed = false;
+
+	for (size_t j = 0; j < client_state.in_flight.size(); ) {
+		InFlight& slot = client_state.in_flight[j];
+		bool front = j == 0;
+		if (slot.job && front && slot.job->streaming()) {
+			if (!slot.head_sent) {
+				Response res;
+				slot.job->finish(res);
+				countResponse(res, slot.trace);
+				queueResponse(client_state, res, i);
+				slot.head_sent = true;
+			}
+			std::string body;
+			bool intact = slot.job->takeBody(body);
+			if (!body.empty()) {
+				queueResponse(client_state, body, i);
+				slot.start = now;	// idle timeout while streaming
+			}
+			if (!intact) {
+				// The client learns from the closed connection, nothing after it is sent
+				client_state.kick_me = true;
+				abortInFlight(client_state, 1);
+			}
+		}
+		if (slot.job && slot.job->done()) {
+			unregisterPendingFd(slot.fd);
+			if (!slot.head_sent) {
+				Response res;
+				slot.job->finish(res);
+				countResponse(res, slot.trace);
+				if (front)
+					queueResponse(client_state, res, i);
+				else
+					appendResponse(slot.ready, res);
+			}
+			if (front)
+				awaitSent(client_state, slot.trace);
+			slot.job.reset();
+		}
+		if (front && !slot.job) {
+			if (!slot.ready.empty()) {
+				queueResponse(client_state, slot.ready, i);
+				awaitSent(client_state, slot.trace);
+			}
+			client_state.in_flight.pop_front();
+			freed = true;
+			// A streaming job was paused behind it, its timeout starts now
+			if (!client_state.in_flight.empty() && client_state.in_flight.front().job)
+				client_state.in_flight.front().start = now;
+			continue ;
+		}
+		++j;
+	}
+
+	if (client_state.kick_me) {
+		if (client_state.in_flight.empty())
+			_fds[i].events |= POLLOUT;	// close once the rest is flushed, even if nothing is left
+	}
+	else if (freed && !client_state.parsing)
+		processBufferedRequests(i);
+}
+
+// Every stream goes on by itself: its response goes out when its job is done, a streaming one's
+// head and body as they come
+void	Cluster::advanceStreams(int client_fd) {
+	ClientRequestState& client_state = _client_buffers[client_fd];
+	http2::Session& session = *client_state.h2;
+	size_t i = findFdIndex(client_fd);
+	auto now = std::chrono::high_resolution_clock::now();
+
+	for (size_t j = 0; j < client_state.in_flight.size(); ) {
+		InFlight& slot = client_state.in_flight[j];
+		if (slot.job->streaming()) {
+			if (!slot.head_sent) {
+				Response res;
+				slot.job->finish(res);
+				countResponse(res, slot.trace);
+				session.respond(slot.stream, res, true);
+				slot.head_sent = true;
+			}
+			std::string body;
+			bool intact = slot.job->takeBody(body);
+			if (!body.empty()) {
+				session.sendData(slot.stream, body, false);
+				slot.start = now;
+			}
+			if (!intact) {
+				// Only this stream is cut, the client sees it reset
+				session.reset(slot.stream, http2::INTERNAL_ERROR);
+				slot.job->abort(false);
+				unregisterPendingFd(slot.fd);
+				client_state.in_flight.erase(client_state.in_flight.begin() + j);
+				continue ;
+			}
+		}
+		if (slot.job->done()) {
+			unregisterPendingFd(slot.fd);
+			if (slot.head_sent)
+				session.sendData(slot.stream, "", true);
+			else {
+				Response res;
+				slot.job->finish(res);
+				countResponse(res, slot.trace);
+				session.respond(slot.stream, res, false);
+			}
+			flushSession(client_state, i);	// its frames are counted as its bytes
+			awaitSent(client_state, slot.trace);
+			client_state.in_flight.erase(client_state.in_flight.begin() + j);
+			continue ;
+		}
+		++j;
+	}
+
+	flushSession(client_state, i);
+	if (session.closing()) {
+		client_state.kick_me = true;
+		_fds[i].events |= POLLOUT;
+	}
+}
+
+// Stops the jobs from index from to the back of the queue, their responses will never be sent
+void	Cluster::abortInFlight(ClientRequestState& client_state, size_t from) {
+	while (client_state.in_flight.size() > from) {
+		InFlight& slot = client_state.in_flight.back();
+		if (slot.job)
+			slot.job->abort(false);
+		unregisterPendingFd(slot.fd);
+		client_state.in_flight.pop_back();
+	}
+}
+
+// An in-flight job may change the fd it waits on (queued -> dispatched to a worker) or its events.
+// A streaming job is not polled while the client is behind or responses are ahead of it, which
+// bounds the buffered output. Jobs without an fd (waiting on another request's job) are done as
+// a side effect, so they are advanced here.
+void	Cluster::syncPendingFds() {
+	advanceBackground();
+
+	std::vector<int> finished;
+	for (auto& [client_fd, client_state] : _client_buffers) {
+		for (const auto& slot : client_state.in_flight) {
+			if (slot.job && slot.job->fd() < 0 && slot.job->done()) {
+				finished.push_back(client_fd);
+				break ;
+			}
+		}
+	}
+	for (int client_fd : finished) {
+		// An earlier advance may have started and finished other jobs for this client
+		auto it = _client_buffers.find(client_fd);
+		if (it != _client_buffers.end() && !it->second.in_flight.empty())
+			advancePending(client_fd);
+	}
+
+	for (auto& [client_fd, client_state] : _client_buffers) {
+		for (size_t j = 0; j < client_state.in_flight.size(); ++j) {
+			InFlight& slot = client_state.in_flight[j];
+			if (!slot.job)
+				continue ;
+			int fd = slot.job->fd();
+			short events = slot.job->events();
+			if (slot.job->streaming() && (client_state.response.size() >= MAX_STREAM_BACKLOG || (client_state.h2
+				? client_state.h2->backlog(slot.stream) >= MAX_STREAM_BACKLOG : j > 0)))
+				events = 0;
+			if (fd != slot.fd) {
+				unregisterPendingFd(slot.fd);
+				if (fd < 0)
+					continue ;
+				_fds.push_back({fd, events, 0});
+				_pending_fds[fd] = client_fd;
+				slot.fd = fd;
+			}
+			else if (fd >= 0)
+				_fds[findFdIndex(fd)].events = events;
+		}
+	}
+
+	for (auto& background : _background) {
+		int fd = background.job->fd();
+		if (fd != background.fd) {
+			unregisterPendingFd(background.fd);
+			if (fd < 0)
+				continue ;
+			_fds.push_back({fd, background.job->events(), 0});
+			_pending_fds[fd] = -1;
+			background.fd = fd;
+		}
+		else if (fd >= 0)
+			_fds[findFdIndex(fd)].events = background.job->events();
+	}
+}
+
+// Finished background jobs are finished into a response nobody reads, which lets them store their result
+void	Cluster::advanceBackground() {
+	for (size_t j = 0; j < _background.size(); ) {
+		if (!_background[j].job->done()) {
+			++j;
+			continue ;
+		}
+		unregisterPendingFd(_background[j].fd);
+		Response discarded;
+		_background[j].job->finish(discarded);
+		_background.erase(_background.begin() + j);
+	}
+}
+
+// Entries are only marked here; run() compacts _fds so loop indexes stay valid
+void	Cluster::unregisterPendingFd(int& pending_fd) {
+	if (pending_fd < 0)
+		return ;
+	_fds[findFdIndex(pending_fd)].fd = -1;
+	_pending_fds.erase(pending_fd);
+	pending_fd = -1;
+}
+
+// Servers with an access_log keep the request line and client for it, the others skip the copies
+void	Cluster::traceRequest(RequestTrace& trace, const Server& conf, const Request& req,
+			const ClientRequestState& client_state) const {
+	trace.server = conf.getId();
+	if (!_access_logs.enabled(trace.server))
+		return ;
+	const std::vector<std::string>& host = req.getHeaders("host");
+	trace.client = client_state.remote_addr;
+	trace.host = host.empty() ? conf.getName() : host[0];
+	trace.method = req.getMethod();
+	trace.uri = req.getPath();
+	trace.protocol = req.getHttpVersion();
+}
+
+// The response head is known: the request is counted with how long it took to receive and handle
+void	Cluster::countResponse(const Response& res, RequestTrace& trace) {
+	trace.head = std::chrono::steady_clock::now();
+	std::string_view status = res.getStatus().substr(0, 3);
+	std::from_chars(status.data(), status.data() + status.size(), trace.status);
+	_metrics.response(res.getStatus(), trace);
+}
+
+// The last byte of the response is queued, everything queued since the previous one is its own.
+// Its send time is counted, and its access_log line written, once the client has it all.
+void	Cluster::awaitSent(ClientRequestState& client_state, const RequestTrace& trace) {
+	uint64_t bytes = client_state.queued - client_state.traced;
+	client_state.traced = client_state.queued;
+	if (!trace.route && !_access_logs.enabled(trace.server))
+		return ;
+	client_state.sending.push_back(trace);
+	client_state.sending.back().bytes = bytes;
+}
+
+// Connections for stub_status: writing while a response is produced or sent, reading while a
+// request or body is partly in, waiting otherwise
+ConnectionCounts	Cluster::countConnections() const {
+	ConnectionCounts counts;
+	for (const auto& [fd, client_state] : _client_buffers) {
+		++counts.active;
+		if (!client_state.response.empty() || !client_state.in_flight.empty())
+			++counts.writing;
+		else if (!client_state.buffer.empty() || client_state.body_sink || !client_state.h2_uploads.empty())
+			++counts.reading;
+		else
+			++counts.idle;
+	}
+	return counts;
+}
+
+size_t	Cluster::findFdIndex(int fd) const {
+	for (size_t i = 0; i < _fds.size(); ++i) {
+		if (_fds[i].fd == fd)
+			return i;
+	}
+	throw std::runtime_error("Error: fd is not polled");
 }
 
 void	Cluster::dropClient(size_t& i, const std::string& msg) {
-	std::cout << CYAN << time_now() << "	Client " << _fds[i].fd << msg << RESET;
+	LOG_DEBUG("Client " << _fds[i].fd << msg);
+	ClientRequestState& client_state = _client_buffers[_fds[i].fd];
+	for (const RequestTrace& trace : client_state.sending)
+		_access_logs.write(trace);	// answered, though the client may not have it all
+	if (!client_state.in_flight.empty()) {
+		abortInFlight(client_state, 0);
+		syncPendingFds();
+	}
+	closeBodySink(client_state);
+	dropUploads(client_state, 0);
 	close (_fds[i].fd);
 	_client_buffers.erase(_fds[i].fd);
 	_fds.erase(_fds.begin() + i);
 	--i;
 }
 
+// Upstream health probes run as background jobs, they report to their group when done
+void	Cluster::startHealthProbes() {
+	std::vector<std::shared_ptr<PendingResponse>> probes = _router.dueHealthProbes();
+	if (probes.empty())
+		return ;
+	auto now = std::chrono::high_resolution_clock::now();
+	for (auto& probe : probes)
+		_background.push_back({probe, -1, now});
+	syncPendingFds();
+}
+
+// Disk cache writes and evictions run as background jobs, the cache indexes their files when done
+void	Cluster::startCacheJobs() {
+	std::vector<std::shared_ptr<PendingResponse>> jobs = _router.sweepCaches();
+	if (jobs.empty())
+		return ;
+	auto now = std::chrono::high_resolution_clock::now();
+	for (auto& job : jobs)
+		_background.push_back({job, -1, now});
+	syncPendingFds();
+}
+
 void	Cluster::checkForTimeouts() {
 	auto now = std::chrono::high_resolution_clock::now();
+	bool background_expired = false;
+	for (auto& background : _background) {
+		auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - background.start).count();
+		if (background.job->expired(elapsed_ms)) {
+			background.job->abort(true);
+			background_expired = true;
+		}
+	}
+	if (background_expired)
+		syncPendingFds();
+
 	for (size_t i = 0; i < _fds.size(); ++i) {
-		if (isServerSocket(_fds[i].fd, getServerFds()))
+		if (_fds[i].fd < 0 || _pending_fds.count(_fds[i].fd) || isServerSocket(_fds[i].fd, getServerFds()))
+			continue ;
+		if (!_client_buffers[_fds[i].fd].in_flight.empty()) {
+			ClientRequestState& client_state = _client_buffers[_fds[i].fd];
+			bool expired = false;
+			for (size_t j = 0; j < client_state.in_flight.size(); ++j) {
+				InFlight& slot = client_state.in_flight[j];
+				if (!slot.job || (!client_state.h2 && j > 0 && slot.job->streaming()))
+					continue ;	// paused behind the front, its clock starts there
+				auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - slot.start).count();
+				if (slot.job->expired(elapsed_ms)) {
+					slot.job->abort(true);
+					expired = true;
+				}
+			}
+			if (expired) {
+				advancePending(_fds[i].fd);
+				syncPendingFds();
+			}
 			continue ;
+		}
 		if (_client_buffers[_fds[i].fd].receive_start != std::chrono::high_resolution_clock::time_point{}) {
 			auto elapsed = now - _client_buffers[_fds[i].fd].receive_start;
 			auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
-			if (elapsed_ms > TIME_OUT_REQUEST && _client_buffers[_fds[i].fd].buffer.size() > 0) {
+			if (elapsed_ms > TIME_OUT_REQUEST && (_client_buffers[_fds[i].fd].buffer.size() > 0 || _client_buffers[_fds[i].fd].body_sink
+				|| !_client_buffers[_fds[i].fd].h2_uploads.empty()) && !bodySinkFull(_client_buffers[_fds[i].fd])) {
 				send408Response(i);
 				dropClient(i, CLIENT_TIMEOUT);
 			}
@@ -235,6 +1110,9 @@ void	Cluster::checkForTimeouts() {
 }
 
 void	Cluster::send408Response(size_t i) {
+	if (_client_buffers[_fds[i].fd].h2)
+		return ;	// an HTTP/2 client learns it from the closed connection
+
 	// Create a minimal Request object for the 408 response
 	Request req;
 	req.setHttpVersion("HTTP/1.1");
@@ -252,11 +1130,14 @@ void	Cluster::send408Response(size_t i) {
 	std::string responseStr = responseToString(res);
 
 	// Send the 408 response immediately
-	// std::cout << RED << time_now() << "	Sending 408 Request Timeout to client " << _fds[i].fd << RESET << std::endl;
+	LOG_DEBUG("Sending 408 Request Timeout to client " << _fds[i].fd);
+	_metrics.response(res.getStatus(), RequestTrace());
 	ssize_t sent = send(_fds[i].fd, responseStr.c_str(), responseStr.size(), 0);
 	if (sent < 0) {
-		std::cout << "Failed to send 408 response" << std::endl;
+		LOG_WARN("Failed to send 408 response to client " << _fds[i].fd);
 	}
+	else
+		_metrics.sent(sent);
 }
 
 const Server&	Cluster::findRelevantConfig(int client_fd, const std::string& buffer) {
@@ -269,10 +1150,16 @@ const Server&	Cluster::findRelevantConfig(int client_fd, const std::string& buff
 	if (!std::regex_search(header, match, re))
 		return *conf->default_config;
 
-	std::string host = match[1];
+	return configForHost(client_fd, match[1].str());
+}
+
+// Server of the listener named host, the listener's default one for any other name
+const Server&	Cluster::configForHost(int client_fd, std::string_view host) {
+	ListenerGroup*	conf = _clients[client_fd];
+	host = host.substr(0, host.find(':'));
 	for (auto& conf : conf->configs) {
 		if (conf.getName() == host) {
-			std::cout << "non-default sent\n";
+			LOG_TRACE("Host " << host << " served by its server_name");
 			return conf;
 		}
 	}
@@ -284,6 +1171,8 @@ const std::set<int>&	Cluster::getServerFds() const {
 }
 
 Cluster::~Cluster() {
-	for (const pollfd& fd : _fds)
-		close(fd.fd);
+	for (const pollfd& fd : _fds) {
+		if (fd.fd >= 0 && !_pending_fds.count(fd.fd))
+			close(fd.fd);
+	}
 }
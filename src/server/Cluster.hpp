@@ -4,6 +4,7 @@
 #include <poll.h>
 #include <map>
 #include <set>
+#include <deque>
 #include <chrono>
 #include <iostream>
 #include <errno.h>
@@ -11,11 +12,17 @@
 #include "webserv.hpp"
 #include "Server.hpp"
 #include "HelperFunctions.hpp"
+#include "Metrics.hpp"
+#include "AccessLog.hpp"
+#include "Log.hpp"
 #include "dev/devHelpers.hpp"
 #include "../router/Router.hpp"
 #include "../config/Config.hpp"
 #include "../parser/Parser.hpp"
 #include "../request/Request.hpp"
+#include "../request/BodySink.hpp"
+#include "../request/ChunkedDecoder.hpp"
+#include "../http2/Session.hpp"
 
 #define RED "\033[1;31m"
 #define GREEN "\033[1;32m"
@@ -23,11 +30,11 @@
 #define YELLOW "\033[1;33m"
 #define RESET "\033[0m"
 
-#define CLIENT_DISCONNECT			" disconnected\n"
-#define CLIENT_TIMEOUT				" dropped by the server: Timeout\n"
-#define CLIENT_CLOSE_CONNECTION		" dropped by the server: Connection closed\n"
-#define CLIENT_MALFORMED_REQUEST	" dropped by the server: Malformed request\n"
-#define CLIENT_ERROR				" dropped by the server: Client dropped\n"
+#define CLIENT_DISCONNECT			" disconnected"
+#define CLIENT_TIMEOUT				" dropped by the server: Timeout"
+#define CLIENT_CLOSE_CONNECTION		" dropped by the server: Connection closed"
+#define CLIENT_MALFORMED_REQUEST	" dropped by the server: Malformed request"
+#define CLIENT_ERROR				" dropped by the server: Client dropped"
 #define SOCKET_ERROR				" dropped by the server: Socket error\n"
 #define INVALID_FD					" dropped by the server: Invalid file descriptor\n"
 
@@ -39,19 +46,63 @@ struct ListenerGroup {
 	const Server*		default_config;
 };
 
+// A request of the connection whose response has not gone out yet
+struct InFlight {
+	std::shared_ptr<PendingResponse>	job;	// work still running, nullptr once finished into ready
+	int			fd = -1;
+	bool		head_sent = false;	// streaming job at the front, its head is out
+	std::string	ready;				// response finished before the ones ahead of it
+	uint32_t	stream = 0;			// HTTP/2 stream it answers, 0 on HTTP/1.x
+	std::chrono::time_point<std::chrono::high_resolution_clock>	start {};
+	RequestTrace	trace;			// counted once the job's response head is known
+};
+
+// Request of an HTTP/2 stream whose body is still arriving
+struct StreamUpload {
+	Request						request;
+	const Server*				config = nullptr;
+	std::unique_ptr<BodySink>	sink;		// handler taking the body as it arrives, else it is buffered
+	int							sink_fd = -1;	// fd of sink polled while it writes
+	std::string					body;
+	size_t						size = 0;
+	RequestTrace				trace;		// location of the sink
+};
+
 struct ClientRequestState {
 	std::chrono::time_point<std::chrono::high_resolution_clock>	receive_start {};
+	std::chrono::time_point<std::chrono::high_resolution_clock>	request_start {};	// first byte of the next request
 	std::chrono::time_point<std::chrono::high_resolution_clock>	send_start {};
 	std::string	clean_buffer;
+	std::string	remote_addr;	// peer IPv4 address, handed to every request of the connection
 	std::string	buffer;
 	std::string	request;
 	size_t		request_size;
 	std::string	response;
+	std::vector<RequestTrace>	sending;	// responses in response, their send time is counted once it is flushed
+	uint64_t	queued = 0;		// bytes ever queued for the client
+	uint64_t	traced = 0;		// queued when the last response was complete, the next one's bytes start there
 	Server*		config;
 	bool		data_validity = 1;
 	bool		waiting_response = 0;
 	bool		kick_me = 0;
 	size_t		max_body_size = 0;
+	std::deque<InFlight>	in_flight;	// pipelined requests in request order, answered from the front
+	size_t		pipeline_depth = PIPELINE_DEPTH;	// in-flight requests allowed, from the server of the last request
+	bool		parsing = false;	// processBufferedRequests running, it takes up the slots advancePending frees
+	std::unique_ptr<BodySink>	body_sink;	// handler taking the body of the current request as it arrives
+	int			body_sink_fd = -1;	// fd of body_sink polled while it writes
+	RequestTrace	body_trace;	// location of the body sink
+	size_t		body_remaining = 0;
+	std::unique_ptr<ChunkedDecoder>	body_decoder;	// chunked body being decoded, kept across reads
+	bool		head_checked = false;	// Expect of the current request already answered
+	std::unique_ptr<http2::Session>		h2;	// set once the connection speaks HTTP/2
+	std::map<uint32_t, StreamUpload>	h2_uploads;
+};
+
+struct BackgroundJob {
+	std::shared_ptr<PendingResponse>	job;	// nobody waits for its response
+	int			fd = -1;
+	std::chrono::time_point<std::chrono::high_resolution_clock>	start {};
 };
 
 class Cluster {
@@ -64,7 +115,11 @@ class Cluster {
 		std::vector<ListenerGroup>		_listener_groups;	// groups of configs with same IP+port
 		std::map<int, ListenerGroup*>	_servers;			// fd of server and related ListenerGroup. Reason to have is to find quickly related ListeningGroup to key
 		std::map<int, ListenerGroup*>	_clients;			// fd of client and related config
+		std::map<int, int>				_pending_fds;		// fd polled for an in-flight response and related client fd, -1 for background jobs
 		Router							_router;			// HTTP router for handling requests
+		std::vector<BackgroundJob>		_background;		// jobs left running after their response went out, they use _router state
+		Metrics							_metrics;			// counters reported by stub_status locations
+		AccessLogs						_access_logs;		// a line per request of servers with an access_log
 
 		std::map<int, ClientRequestState>	_client_buffers;	// storing client related information
 
@@ -76,10 +131,47 @@ class Cluster {
 		void	handleClientInData(size_t& i);
 		void	sendPendingData(size_t& i);
 		void	checkForTimeouts();
+		void	startHealthProbes();
+		void	startCacheJobs();
 		void	dropClient(size_t& i, const std::string& msg);
 		void	processReceivedData(size_t& i, const char* buffer, int bytes);
+		void	processBufferedRequests(size_t& i);
 		void	send408Response(size_t i);
-		void	prepareResponse(ClientRequestState& client_state, const Server& conf, Request& req, int i);
+		void	prepareResponse(ClientRequestState& client_state, const Server& conf, Request& req, int i, uint32_t stream = 0);
+		void	startResponse(ClientRequestState& client_state, const Response& res, int i, uint32_t stream = 0,
+					const RequestTrace& trace = {});
+		void	queueResponse(ClientRequestState& client_state, const std::string& data, int i);
+		void	queueResponse(ClientRequestState& client_state, const Response& res, int i);
+		void	deliverResponse(ClientRequestState& client_state, const Response& res, int i, uint32_t stream = 0,
+					RequestTrace trace = {});
+		void	deliverResponse(ClientRequestState& client_state, const std::string& data, int i);
+		bool	answerExpectation(size_t i);
+		bool	openBodySink(size_t i);
+		bool	feedBodySink(size_t i);
+		bool	upgradeToHttp2(size_t i, const Server& conf, const Request& req);
+		void	processStreams(size_t& i);
+		void	handleStreamEvent(size_t i, http2::StreamEvent& event);
+		void	flushSession(ClientRequestState& client_state, int i);
+
+		void	handlePendingEvent(size_t i);
+		bool	handleBodySinkEvent(int client_fd, int fd);
+		void	watchBodySinks(int client_fd);
+		void	watchBodySink(BodySink* sink, int& sink_fd, int client_fd);
+		void	closeBodySink(ClientRequestState& client_state);
+		void	dropUploads(ClientRequestState& client_state, uint32_t stream);
+		void	advancePending(int client_fd);
+		void	advanceStreams(int client_fd);
+		void	abortInFlight(ClientRequestState& client_state, size_t from);
+		void	updateReading(size_t i);
+		void	syncPendingFds();
+		void	advanceBackground();
+		void	unregisterPendingFd(int& pending_fd);
+		size_t	findFdIndex(int fd) const;
+		ConnectionCounts	countConnections() const;
+		void	traceRequest(RequestTrace& trace, const Server& conf, const Request& req,
+					const ClientRequestState& client_state) const;
+		void	countResponse(const Response& res, RequestTrace& trace);
+		void	awaitSent(ClientRequestState& client_state, const RequestTrace& trace);
 
 	public:
 		~Cluster();
@@ -87,8 +179,10 @@ class Cluster {
 		void	config(const std::string& config);
 		void	create();
 		void	run();
+		void	addClient(int client_fd, int server_fd, const std::string& remote_addr);
 
 		const Server&	findRelevantConfig(int client_fd, const std::string& buffer);
+		const Server&	configForHost(int client_fd, std::string_view host);
 
 		const std::set<int>&	getServerFds() const;
 };
@@ -1,10 +1,14 @@
 #include "HelperFunctions.hpp"
+#include "../router/HttpConstants.hpp"
+
+#include <strings.h>	// for strcasecmp
+#include <ctime>		// for gmtime_r, strftime
 
 volatile sig_atomic_t	signal_to_terminate = false;
 
+// Only the flag is set here, the event loop logs the shutdown once it stops
 void	handleSigTerminate(int sig) {
 	signal_to_terminate = sig;
-	std::cout << RED << "\n" << time_now() << "	Server closed\n" << RESET;
 }
 
 bool	isServerSocket(int fd, const std::set<int>& server_fds) {
@@ -35,7 +39,8 @@ void	setReuseAddress(int sock) {
 std::string	time_now() {
 	auto now = std::chrono::system_clock::now();
 	std::time_t t = std::chrono::system_clock::to_time_t(now);
-	std::tm tm = *std::localtime(&t);
+	std::tm tm;
+	localtime_r(&t, &tm);
 
 	std::ostringstream oss;
 	oss << std::put_time(&tm, "[%Y-%m-%d %H:%M:%S]");
@@ -71,30 +76,104 @@ uint64_t	getMaxClients() {
 	return max_clients;
 }
 
-std::string	headersToString(const std::unordered_map<std::string, std::vector<std::string>>& headers) {
-	std::string result;
-	for (const auto& pair : headers) {
-		const std::string& key = pair.first;
-		const std::vector<std::string>& values = pair.second;
-		for (const auto& value : values)
-			result += key + ": " + value + "\r\n";
+// "Date: <IMF-fixdate>\r\n", formatted again when the second changes
+const std::string&	dateHeaderLine() {
+	thread_local std::string	line;
+	thread_local time_t			formatted = -1;
+
+	time_t now = time(nullptr);
+	if (now != formatted) {
+		struct tm	gmt;
+		char		buf[64];
+		gmtime_r(&now, &gmt);
+		size_t len = strftime(buf, sizeof(buf), "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &gmt);
+		line.assign(buf, len);
+		formatted = now;
+	}
+	return line;
+}
+
+static bool	hasHeader(const Response::HeaderList& headers, const std::string& name) {
+	for (const auto& header : headers) {
+		if (strcasecmp(header.name.c_str(), name.c_str()) == 0)
+			return true;
 	}
-	return result;
+	return false;
+}
+
+// Writes res into out as it goes on the wire: status line, Date and Server unless the
+// handler set them, headers in the order they were set, body. out is reserved once for
+// the whole response, so a buffer reused across responses stops allocating.
+void	appendResponse(std::string& out, const Response& res) {
+	static const std::string	serverLine = http::SERVER + ": " + network::SERVER_SOFTWARE + "\r\n";
+	const Response::HeaderList&	headers = res.getHeaderList();
+	const std::string&			dateLine = dateHeaderLine();
+	bool						addDate = !hasHeader(headers, http::DATE);
+	bool						addServer = !hasHeader(headers, http::SERVER);
+
+	size_t size = 9 + res.getStatus().size() + 2;
+	if (addDate)
+		size += dateLine.size();
+	if (addServer)
+		size += serverLine.size();
+	if (res.getSerialized())
+		size += res.getSerialized()->size();
+	else {
+		for (const auto& header : headers)
+			size += header.name.size() + 2 + header.value.size() + 2;
+		size += 2 + res.getBody().size();
+	}
+	out.reserve(out.size() + size);
+
+	out.append("HTTP/1.1 ", 9).append(res.getStatus()).append("\r\n", 2);
+	if (addDate)
+		out.append(dateLine);
+	if (addServer)
+		out.append(serverLine);
+	if (res.getSerialized()) {
+		out.append(*res.getSerialized());
+		return ;
+	}
+	for (const auto& header : headers)
+		out.append(header.name).append(": ", 2).append(header.value).append("\r\n", 2);
+	out.append("\r\n", 2);
+	out.append(res.getBody());
 }
 
 std::string	responseToString(const Response& res) {
-	std::string responseStr = "HTTP/1.1 " + std::string(res.getStatus()) + "\r\n";
-	responseStr += headersToString(res.getAllHeaders());
-		responseStr += "\r\n";
-	responseStr += std::string(res.getBody());
+	std::string responseStr;
+	appendResponse(responseStr, res);
 	return responseStr;
 }
 
 void	setTimer(ClientRequestState& client_state) {
-	if (client_state.buffer.empty())
+	if (client_state.buffer.empty()) {
 		client_state.receive_start = {};
-	else
+		client_state.request_start = {};
+	}
+	else {
 		client_state.receive_start = std::chrono::high_resolution_clock::now();
+		client_state.request_start = client_state.receive_start;
+	}
+}
+
+// µs from the first byte of the request being handled to now, -1 when it is not known
+int64_t	receiveTime(const ClientRequestState& client_state) {
+	if (client_state.request_start == std::chrono::high_resolution_clock::time_point{})
+		return -1;
+	auto elapsed = std::chrono::high_resolution_clock::now() - client_state.request_start;
+	return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+// A body sink of the connection takes no more until its write is done
+bool	bodySinkFull(const ClientRequestState& client_state) {
+	if (client_state.body_sink && client_state.body_sink->full())
+		return true;
+	for (const auto& [stream, upload] : client_state.h2_uploads) {
+		if (upload.sink && upload.sink->full())
+			return true;
+	}
+	return false;
 }
 
 void	setMaxBodySize(ClientRequestState& client_state, Cluster* cluster, int fd) {
@@ -126,57 +205,31 @@ bool	requestComplete(ClientRequestState& client_state, int fd, Cluster* cluster)
 	return status;
 }
 
+// Decodes what arrived since the last read; only the head and an unfinished chunk line stay in buffer
 bool	decodeChunkedBody(ClientRequestState& client_state) {
-	std::string result;
-	size_t pos = 0;
 	size_t header_end = findHeader(client_state.buffer);
-	std::string headers = client_state.buffer.substr(0, header_end);
-	std::string body = client_state.buffer.substr(header_end);
-	bool endReq = false;
-	while (pos < body.size()) {
-		size_t lineEnd = body.find("\r\n", pos);
-		if (lineEnd == std::string::npos) {
-			client_state.data_validity = false;
-			break ;
-		}
-
-		std::string sizeLine = body.substr(pos, lineEnd - pos);
-		size_t chunkSize = 0;
-		std::istringstream(sizeLine) >> std::hex >> chunkSize;
-
-		if (chunkSize == 0) {
-			size_t trailersEnd = body.find("\r\n\r\n", pos);
-			if (trailersEnd == std::string::npos) {
-				client_state.data_validity = false;
-				endReq = false;
-				break;
-			}
-			pos = trailersEnd + 4;
-			client_state.buffer = body.substr(pos);
-			endReq = true;
-			break;
-		}
-
-		pos = lineEnd + 2;
-		if (pos + chunkSize + 2 > body.size()) {
-			client_state.data_validity = false;
-			endReq = false;
-			break;
-		}
-
-		result.append(body.substr(pos, chunkSize));
-		pos += chunkSize + 2;
+	if (!client_state.body_decoder) {
+		client_state.body_decoder = std::make_unique<ChunkedDecoder>(std::min<size_t>(client_state.max_body_size, MAX_BUFFER_SIZE));
+		client_state.clean_buffer = client_state.buffer.substr(0, header_end);
 	}
 
-	client_state.clean_buffer = headers + result;
-	size_t body_size = client_state.clean_buffer.substr(header_end).size();
-	if (body_size > client_state.max_body_size) {
+	ChunkedDecoder& decoder = *client_state.body_decoder;
+	size_t used = decoder.decode(client_state.buffer.data() + header_end, client_state.buffer.size() - header_end,
+		[&client_state](const char* data, size_t size) { client_state.clean_buffer.append(data, size); });
+	client_state.buffer.erase(header_end, used);
+
+	if (decoder.failed()) {
+		client_state.body_decoder.reset();
 		client_state.data_validity = false;
-		endReq = false;
-		return endReq;
+		return false;
 	}
+	if (!decoder.done())
+		return false;
+
+	client_state.body_decoder.reset();
 	client_state.request_size = client_state.clean_buffer.size();
-	return (endReq);
+	client_state.buffer.erase(0, header_end);
+	return true;
 }
 
 int	isChunkedBodyComplete(ClientRequestState& client_state, size_t header_end) {
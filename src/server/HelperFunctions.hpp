@@ -21,9 +21,12 @@ void		setReuseAddress(int sock);
 void		checkNameRepitition(const std::vector<Server> configs, const Server config);
 uint64_t	getMaxClients();
 size_t		findHeader(const std::string& buffer);
+const std::string&	dateHeaderLine();
+void		appendResponse(std::string& out, const Response& res);
 std::string	responseToString(const Response& res);
-std::string	headersToString(const std::unordered_map<std::string, std::vector<std::string>>& headers);
 void		setTimer(ClientRequestState& client_state);
+int64_t		receiveTime(const ClientRequestState& client_state);
+bool		bodySinkFull(const ClientRequestState& client_state);
 
 bool		requestComplete(ClientRequestState& client_state, int fd, Cluster* cluster);
 void		setMaxBodySize(ClientRequestState& client_state, Cluster* cluster, int fd);
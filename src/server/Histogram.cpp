@@ -0,0 +1,56 @@
+#include "Histogram.hpp"
+
+#include <algorithm>	// for std::min, std::max
+#include <bit>			// for std::bit_width
+#include <cmath>		// for std::ceil
+
+// Exact below SUB_BUCKETS, then SUB_BUCKETS buckets per power of two
+size_t	Histogram::bucket(uint64_t value) {
+	if (value < SUB_BUCKETS)
+		return static_cast<size_t>(value);
+	value = std::min(value, (uint64_t(1) << MAX_BITS) - 1);
+	int exponent = std::bit_width(value) - 1;
+	uint64_t sub = (value >> (exponent - SUB_BITS)) - SUB_BUCKETS;
+	return static_cast<size_t>(SUB_BUCKETS * (exponent - SUB_BITS + 1) + sub);
+}
+
+// Largest value counted in a bucket
+uint64_t	Histogram::upper(size_t bucket) {
+	if (bucket < SUB_BUCKETS)
+		return bucket;
+	int shift = static_cast<int>(bucket / SUB_BUCKETS) - 1;
+	uint64_t lower = (SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+	return lower + (uint64_t(1) << shift) - 1;
+}
+
+void	Histogram::record(uint64_t value) {
+	++_counts[bucket(value)];
+	++_count;
+	_sum += value;
+	_max = std::max(_max, value);
+}
+
+uint64_t	Histogram::count() const {
+	return _count;
+}
+
+uint64_t	Histogram::sum() const {
+	return _sum;
+}
+
+uint64_t	Histogram::max() const {
+	return _max;
+}
+
+uint64_t	Histogram::percentile(double q) const {
+	if (_count == 0)
+		return 0;
+	uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * _count)));
+	uint64_t seen = 0;
+	for (size_t i = 0; i < _counts.size(); ++i) {
+		seen += _counts[i];
+		if (seen >= rank)
+			return std::min(upper(i), _max);
+	}
+	return _max;
+}
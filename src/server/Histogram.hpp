@@ -0,0 +1,35 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+// Latencies in µs counted in log-linear buckets, HDR-style: values below 16 are exact, each
+// power of two above is split in 16 equal buckets. A percentile is the upper end of its bucket,
+// off by less than 1/16. Recording is an array increment, the buckets are only walked when a
+// percentile is read.
+class Histogram {
+
+	private:
+		static constexpr int		SUB_BITS = 4;
+		static constexpr uint64_t	SUB_BUCKETS = uint64_t(1) << SUB_BITS;
+		static constexpr int		MAX_BITS = 40;	// values from 2^40 µs (12 days) on share the last bucket
+
+		std::array<uint64_t, SUB_BUCKETS * (MAX_BITS - SUB_BITS + 1)>	_counts {};
+		uint64_t	_count = 0;
+		uint64_t	_sum = 0;
+		uint64_t	_max = 0;
+
+		static size_t	bucket(uint64_t value);
+		static uint64_t	upper(size_t bucket);
+
+	public:
+		void		record(uint64_t value);
+
+		uint64_t	count() const;
+		uint64_t	sum() const;
+		uint64_t	max() const;
+
+		// Smallest bucket end at or below which a fraction q (0.5, 0.99...) of the values lies, 0 when empty
+		uint64_t	percentile(double q) const;
+};
@@ -0,0 +1,72 @@
+#include "Log.hpp"
+
+#include <ctime>	// for std::time, localtime_r, std::strftime
+#include <unistd.h>	// for write
+
+namespace {
+
+const char*	NAMES[] = {"error", "warn", "info", "debug", "trace"};
+
+// Errors and warnings stand out, the rest keeps the colour the server's messages always had
+const char*	COLOURS[] = {"\033[1;31m", "\033[1;33m", "\033[1;36m", "", ""};
+
+// [2026-10-18 14:03:07] of the current second, formatted again only when the second changes.
+// One per thread, since the file I/O threads log too
+struct Stamp {
+	std::time_t	second = -1;
+	char		text[32];
+	size_t		size = 0;
+};
+
+thread_local Stamp	stamp;
+
+const Stamp&	currentStamp() {
+	std::time_t now = std::time(nullptr);
+	if (now != stamp.second) {
+		std::tm tm;
+		localtime_r(&now, &tm);
+		stamp.size = std::strftime(stamp.text, sizeof(stamp.text), "[%Y-%m-%d %H:%M:%S]", &tm);
+		stamp.second = now;
+	}
+	return stamp;
+}
+
+} // namespace
+
+void	Log::setLevel(Level level) {
+	_level.store(level, std::memory_order_relaxed);
+}
+
+Log::Level	Log::level() {
+	return _level.load(std::memory_order_relaxed);
+}
+
+bool	Log::parse(const std::string& name, Level& level) {
+	for (int i = ERROR; i <= TRACE; ++i) {
+		if (name == NAMES[i]) {
+			level = static_cast<Level>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+const char*	Log::name(Level level) {
+	return NAMES[level];
+}
+
+// One write() per line, so lines of the file I/O threads do not interleave with the event loop's
+void	Log::write(Level level, const std::string& message) {
+	const Stamp& now = currentStamp();
+	std::string line;
+	line.reserve(16 + now.size + message.size());
+	line += COLOURS[level];
+	line.append(now.text, now.size);
+	line += '\t';
+	line += message;
+	if (*COLOURS[level])
+		line += "\033[0m";
+	line += '\n';
+	ssize_t written = ::write(STDOUT_FILENO, line.data(), line.size());
+	(void)written;	// nowhere left to report it
+}
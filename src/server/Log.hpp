@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <sstream>
+#include <string>
+
+#include "webserv.hpp"
+
+// Server messages by level, most severe first: a level logs itself and everything above it.
+// Sites above LOG_MAX_LEVEL are discarded at compile time, their message is never built; the
+// others check the level log_level sets before building theirs. Lines go out with one write().
+class Log {
+
+	public:
+		enum Level {
+			ERROR = LOG_LEVEL_ERROR,
+			WARN = LOG_LEVEL_WARN,
+			INFO = LOG_LEVEL_INFO,
+			DEBUG = LOG_LEVEL_DEBUG,
+			TRACE = LOG_LEVEL_TRACE
+		};
+
+	private:
+		static inline std::atomic<Level>	_level {INFO};
+
+	public:
+		static void		setLevel(Level level);
+		static Level	level();
+		static bool		enabled(Level level) { return level <= _level.load(std::memory_order_relaxed); }
+
+		// error, warn, info, debug or trace
+		static bool			parse(const std::string& name, Level& level);
+		static const char*	name(Level level);
+
+		static void		write(Level level, const std::string& message);
+};
+
+#define WEBSERV_LOG(level, message) \
+	do { \
+		if constexpr (Log::level <= LOG_MAX_LEVEL) { \
+			if (Log::enabled(Log::level)) { \
+				std::ostringstream log_message; \
+				log_message << message; \
+				Log::write(Log::level, log_message.str()); \
+			} \
+		} \
+	} while (0)
+
+#define LOG_ERROR(message)	WEBSERV_LOG(ERROR, message)
+#define LOG_WARN(message)	WEBSERV_LOG(WARN, message)
+#define LOG_INFO(message)	WEBSERV_LOG(INFO, message)
+#define LOG_DEBUG(message)	WEBSERV_LOG(DEBUG, message)
+#define LOG_TRACE(message)	WEBSERV_LOG(TRACE, message)
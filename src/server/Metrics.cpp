@@ -0,0 +1,122 @@
+#include "Metrics.hpp"
+
+#include <cstdlib>	// for std::strtol
+
+int64_t	Metrics::second(std::chrono::steady_clock::time_point now) {
+	return std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
+}
+
+LatencySummary	Metrics::summarize(const Histogram& histogram) {
+	LatencySummary summary;
+	summary.count = histogram.count();
+	summary.sum = histogram.sum();
+	summary.max = histogram.max();
+	summary.p50 = histogram.percentile(0.5);
+	summary.p90 = histogram.percentile(0.9);
+	summary.p99 = histogram.percentile(0.99);
+	summary.p999 = histogram.percentile(0.999);
+	return summary;
+}
+
+// Connections taken from a listening socket
+void	Metrics::accepted() {
+	++_accepted;
+}
+
+// Accepted connections the server went on with
+void	Metrics::handled() {
+	++_handled;
+}
+
+void	Metrics::received(size_t bytes) {
+	_bytes_in += bytes;
+}
+
+void	Metrics::sent(size_t bytes) {
+	_bytes_out += bytes;
+}
+
+// A response head is known: counts the request, its status, and how long its location took to
+// receive and handle it
+void	Metrics::response(std::string_view status, const RequestTrace& trace) {
+	auto now = trace.head == std::chrono::steady_clock::time_point{} ? std::chrono::steady_clock::now() : trace.head;
+	++_requests;
+
+	long code = std::strtol(std::string(status.substr(0, 3)).c_str(), nullptr, 10);
+	if (code >= 100 && code < static_cast<long>(_statuses.size()))
+		++_statuses[code];
+
+	int64_t sec = second(now);
+	size_t slot = static_cast<size_t>(sec % METRICS_RATE_WINDOW);
+	if (_rate_second[slot] != sec) {
+		_rate_second[slot] = sec;
+		_rate[slot] = 0;
+	}
+	++_rate[slot];
+
+	if (!trace.route || trace.start == std::chrono::steady_clock::time_point{})
+		return ;
+	Location& location = _locations[{trace.server, trace.route, trace.handler}];
+	location.handle.record(std::chrono::duration_cast<std::chrono::microseconds>(now - trace.start).count());
+	if (trace.receive >= 0)
+		location.receive.record(static_cast<uint64_t>(trace.receive));
+}
+
+// The last byte of a response went out
+void	Metrics::delivered(const RequestTrace& trace) {
+	if (!trace.route || trace.head == std::chrono::steady_clock::time_point{})
+		return ;
+	auto it = _locations.find({trace.server, trace.route, trace.handler});
+	if (it == _locations.end())
+		return ;
+	auto elapsed = std::chrono::steady_clock::now() - trace.head;
+	it->second.send.record(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+}
+
+void	Metrics::nameServer(int id, const std::string& label) {
+	_servers[id] = label;
+}
+
+// Connection states are not tracked as they change, the counter walks the clients when asked
+void	Metrics::setConnectionCounter(std::function<ConnectionCounts()> counter) {
+	_connections = std::move(counter);
+}
+
+MetricsSnapshot	Metrics::snapshot() const {
+	MetricsSnapshot snapshot;
+	if (_connections)
+		snapshot.connections = _connections();
+	snapshot.accepted = _accepted;
+	snapshot.handled = _handled;
+	snapshot.requests = _requests;
+	snapshot.bytes_in = _bytes_in;
+	snapshot.bytes_out = _bytes_out;
+
+	// Whole seconds only, the current one is still counting
+	int64_t now = second(std::chrono::steady_clock::now());
+	uint64_t recent = 0;
+	for (size_t slot = 0; slot < _rate.size(); ++slot) {
+		if (_rate_second[slot] < now && _rate_second[slot] >= now - METRICS_RATE_WINDOW)
+			recent += _rate[slot];
+	}
+	snapshot.requests_per_second = static_cast<double>(recent) / METRICS_RATE_WINDOW;
+
+	for (size_t code = 0; code < _statuses.size(); ++code) {
+		if (_statuses[code])
+			snapshot.statuses[static_cast<int>(code)] = _statuses[code];
+	}
+	for (const auto& [key, histograms] : _locations) {
+		const auto& [id, route, handler] = key;
+		LocationMetrics location;
+		auto server = _servers.find(id);
+		location.server = server != _servers.end() ? server->second : std::to_string(id);
+		location.location = *route;
+		location.handler = handler ? handler : "";
+		location.requests = histograms.handle.count();
+		location.receive = summarize(histograms.receive);
+		location.handle = summarize(histograms.handle);
+		location.send = summarize(histograms.send);
+		snapshot.locations.push_back(location);
+	}
+	return snapshot;
+}
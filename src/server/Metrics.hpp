@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <map>
+#include <tuple>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+#include "webserv.hpp"
+#include "Histogram.hpp"
+
+// Where a request went and how long its phases took, recorded once its response head is known
+// and once its last byte is sent. The request line and client are only filled in for servers
+// with an access_log.
+struct RequestTrace {
+	int					server = -1;
+	const std::string*	route = nullptr;	// location the router picked, nullptr when none matched
+	const char*			handler = nullptr;	// kind of handler of the route: static, cgi, upload...
+	int64_t				receive = -1;		// µs from the first byte of the request to its last, -1 when unknown
+	std::chrono::steady_clock::time_point	start {};	// handler start, unset for answers no handler produced (408, 413...)
+	std::chrono::steady_clock::time_point	head {};	// response head known
+	int					status = 0;
+	uint64_t			bytes = 0;			// response bytes queued for the client, head included
+	std::string			client;
+	std::string			host;				// Host header, the server_name without one
+	std::string			method;
+	std::string			uri;
+	std::string			protocol;
+};
+
+// Client connections by what they are doing, counted when the status is read
+struct ConnectionCounts {
+	uint64_t	active = 0;
+	uint64_t	reading = 0;	// request or body partly received
+	uint64_t	writing = 0;	// response being produced or sent
+	uint64_t	idle = 0;		// kept alive between requests
+};
+
+// Latencies of one phase of a location's requests, µs
+struct LatencySummary {
+	uint64_t	count = 0;
+	uint64_t	sum = 0;
+	uint64_t	max = 0;
+	uint64_t	p50 = 0;
+	uint64_t	p90 = 0;
+	uint64_t	p99 = 0;
+	uint64_t	p999 = 0;
+};
+
+struct LocationMetrics {
+	std::string		server;				// server_name:port
+	std::string		location;
+	std::string		handler;			// static, cgi, upload, redirect, delete, proxy or status
+	uint64_t		requests = 0;
+	LatencySummary	receive;			// first to last byte of the request
+	LatencySummary	handle;				// handler start to response head
+	LatencySummary	send;				// response head to its last byte sent
+};
+
+struct MetricsSnapshot {
+	ConnectionCounts				connections;
+	uint64_t						accepted = 0;
+	uint64_t						handled = 0;
+	uint64_t						requests = 0;
+	double							requests_per_second = 0;	// over the last METRICS_RATE_WINDOW seconds
+	uint64_t						bytes_in = 0;
+	uint64_t						bytes_out = 0;
+	std::map<int, uint64_t>			statuses;	// responses by status code, codes never sent left out
+	std::vector<LocationMetrics>	locations;
+};
+
+// Counters of the event loop, read by stub_status locations. Everything is counted on the
+// event loop thread, so they are plain integers: no lock or atomic on the request path.
+class Metrics {
+
+	private:
+		struct Location {
+			Histogram	receive;
+			Histogram	handle;
+			Histogram	send;
+		};
+
+		using LocationKey = std::tuple<int, const std::string*, const char*>;	// server id, route, handler
+
+		uint64_t	_accepted = 0;
+		uint64_t	_handled = 0;
+		uint64_t	_requests = 0;
+		uint64_t	_bytes_in = 0;
+		uint64_t	_bytes_out = 0;
+		std::array<uint64_t, 600>	_statuses {};	// by status code, 100 to 599
+		std::array<uint64_t, METRICS_RATE_WINDOW>	_rate {};			// requests of each second of the window
+		std::array<int64_t, METRICS_RATE_WINDOW>	_rate_second {};	// second each slot counts
+		std::map<LocationKey, Location>	_locations;
+		std::map<int, std::string>	_servers;	// labels by server id
+		std::function<ConnectionCounts()>	_connections;
+
+		static int64_t			second(std::chrono::steady_clock::time_point now);
+		static LatencySummary	summarize(const Histogram& histogram);
+
+	public:
+		void	accepted();
+		void	handled();
+		void	received(size_t bytes);
+		void	sent(size_t bytes);
+		void	response(std::string_view status, const RequestTrace& trace);
+		void	delivered(const RequestTrace& trace);
+
+		void	nameServer(int id, const std::string& label);
+		void	setConnectionCounter(std::function<ConnectionCounts()> counter);
+
+		MetricsSnapshot	snapshot() const;
+};
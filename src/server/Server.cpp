@@ -1,5 +1,6 @@
 #include "Server.hpp"
 #include "HelperFunctions.hpp"
+#include "Log.hpp"
 
 int	Server::create() {
 	int fd = socket(AF_INET, SOCK_STREAM, 0); // create TCP socket that can talk over IPv4.
@@ -23,13 +24,7 @@ int	Server::create() {
 	struct in_addr inaddr;
 	inaddr.s_addr = _address;
 
-	std::cout << RED
-				<< time_now()
-				<< "	Server created: Host["
-				<< inet_ntoa(inaddr)
-				<< "] Port:["
-				<< _port << "]\n"
-				<< RESET;
+	LOG_INFO("Server created: Host[" << inet_ntoa(inaddr) << "] Port:[" << _port << "]");
 	return fd;
 }
 
@@ -45,10 +40,14 @@ void	Server::setPort(int port) {
 	_port = port;
 }
 
-void	Server::setMaxBodySize(int max_body_size) {
+void	Server::setMaxBodySize(size_t max_body_size) {
 	_client_max_body_size = max_body_size;
 }
 
+void	Server::setPipelineDepth(size_t depth) {
+	_pipeline_depth = depth;
+}
+
 void	Server::setName(const std::string& name) {
 	_name = name;
 }
@@ -65,6 +64,34 @@ void	Server::setErrorPage(int error_index, const std::string& page) {
 	_error_pages[error_index] = page;
 }
 
+void	Server::setType(const std::string& extension, const std::string& type) {
+	_types[extension] = type;
+}
+
+void	Server::setUpstream(const Upstream& upstream) {
+	_upstreams[upstream.name] = upstream;
+}
+
+void	Server::setCachePath(const CachePath& cache_path) {
+	_cache_path = cache_path;
+}
+
+void	Server::setAccessLog(const AccessLogConfig& access_log) {
+	_access_log = access_log;
+}
+
+void	Server::setLogLevel(const std::string& level) {
+	_log_level = level;
+}
+
+void	Server::setLogFormat(const std::string& name, const LogFormat& format) {
+	_log_formats[name] = format;
+}
+
+void	Server::setErrorPageCache(std::shared_ptr<const router::utils::ErrorPages> pages) {
+	_error_page_cache = std::move(pages);
+}
+
 void	Server::setLocation(Location loc) {
 	_locations.push_back(loc);
 }
@@ -81,10 +108,14 @@ int	Server::getPort() const {
 	return _port;
 }
 
-int	Server::getMaxBodySize() const {
+size_t	Server::getMaxBodySize() const {
 	return _client_max_body_size;
 }
 
+size_t	Server::getPipelineDepth() const {
+	return _pipeline_depth;
+}
+
 const std::string&	Server::getName() const {
 	return _name;
 }
@@ -101,6 +132,34 @@ const std::map<int, std::string>&	Server::getErrorPages() const {
 	return _error_pages;
 }
 
+const router::utils::MimeTypeMap&	Server::getTypes() const {
+	return _types;
+}
+
+const std::map<std::string, Upstream>&	Server::getUpstreams() const {
+	return _upstreams;
+}
+
+const CachePath&	Server::getCachePath() const {
+	return _cache_path;
+}
+
+const AccessLogConfig&	Server::getAccessLog() const {
+	return _access_log;
+}
+
+const std::string&	Server::getLogLevel() const {
+	return _log_level;
+}
+
+const std::map<std::string, LogFormat>&	Server::getLogFormats() const {
+	return _log_formats;
+}
+
+const std::shared_ptr<const router::utils::ErrorPages>&	Server::getErrorPageCache() const {
+	return _error_page_cache;
+}
+
 const std::vector<Location>&	Server::getLocations() const {
 	return _locations;
 }
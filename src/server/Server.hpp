@@ -2,8 +2,14 @@
 #include <vector>
 #include <poll.h>
 #include <map>
+#include <memory>
 
 #include "webserv.hpp"
+#include "../router/utils/MimeTypes.hpp"
+
+namespace router::utils {
+class ErrorPages;
+}
 
 struct Location
 {
@@ -15,6 +21,68 @@ struct Location
 	std::vector<std::string>	cgi_ext;
 	std::string					upload_path;
 	std::string					return_url;
+	size_t						cgi_pool_workers = 0;		// pre-forked interpreters per extension, 0 = fork per request
+	size_t						cgi_pool_max_requests = 0;	// recycle a worker after this many requests, 0 = never
+	size_t						cgi_pool_queue = 0;			// requests allowed to wait for a busy pool
+	size_t						cgi_cache_ttl = 0;			// seconds a CGI response is reused, 0 = no cache
+	size_t						cgi_cache_stale = 0;		// seconds an expired response is still served while it is refreshed
+	std::vector<std::string>	cgi_cache_key_headers;		// request headers the cached response varies on
+	std::string					proxy_pass;					// upstream URL (http://host:port/uri), empty = not proxied
+	size_t						proxy_connect_timeout = PROXY_CONNECT_TIMEOUT;	// ms
+	size_t						proxy_send_timeout = PROXY_SEND_TIMEOUT;		// ms
+	size_t						proxy_read_timeout = PROXY_READ_TIMEOUT;		// ms
+	size_t						proxy_keepalive = PROXY_KEEPALIVE;	// idle upstream connections kept, 0 = close after each request
+	bool						stub_status = false;		// location answers with the server's counters
+	size_t						proxy_cache = 0;			// seconds a proxied or CGI response is kept on disk without its own freshness, 0 = no cache
+};
+
+// One server line of an upstream {} block
+struct UpstreamServer
+{
+	std::string					host;
+	int							port = 80;
+	size_t						weight = 1;
+	size_t						max_fails = UPSTREAM_MAX_FAILS;		// 0 = never taken out
+	size_t						fail_timeout = UPSTREAM_FAIL_TIMEOUT;	// seconds
+};
+
+// Backends a proxy_pass can name instead of a single address
+struct Upstream
+{
+	std::string					name;
+	std::string					balance = "round_robin";	// round_robin, least_conn or hash
+	std::string					hash_key;					// uri or ip, with balance hash
+	std::vector<UpstreamServer>	servers;
+	std::string					health_path;				// path probed on each backend, empty = no active checks
+	int							health_status = 200;		// status a passing probe answers with
+	size_t						health_interval = HEALTH_CHECK_INTERVAL;	// ms
+	size_t						health_timeout = HEALTH_CHECK_TIMEOUT;		// ms
+	size_t						health_rise = HEALTH_CHECK_RISE;
+	size_t						health_fall = HEALTH_CHECK_FALL;
+};
+
+// Directory responses of proxy_cache locations are stored in
+struct CachePath
+{
+	std::string					path;						// empty = no disk cache
+	size_t						max_size = DISK_CACHE_MAX_SIZE;	// MB
+	size_t						inactive = DISK_CACHE_INACTIVE;	// seconds
+};
+
+// log_format <name> [escape=json] <pattern>: text with $variables, one line per request
+struct LogFormat
+{
+	std::string					pattern;
+	bool						json = false;				// values escaped for JSON strings instead of as \xHH
+};
+
+// access_log <path> [format] [buffer=KB] [flush=ms]
+struct AccessLogConfig
+{
+	std::string					path;						// empty = requests are not logged
+	std::string					format = "main";			// main, json or a log_format of the server
+	size_t						buffer = ACCESS_LOG_BUFFER;	// KB
+	size_t						flush = ACCESS_LOG_FLUSH;	// ms
 };
 
 class Server {
@@ -27,7 +95,15 @@ class Server {
 		std::string					_root;
 		std::string					_index;
 		std::map<int, std::string>	_error_pages;
+		std::shared_ptr<const router::utils::ErrorPages>	_error_page_cache;	// pages built from _error_pages at config load
+		router::utils::MimeTypeMap	_types;	// types {} overrides of the built-in MIME table
+		std::map<std::string, Upstream>	_upstreams;	// upstream {} blocks by name
+		CachePath					_cache_path;
+		AccessLogConfig				_access_log;
+		std::string					_log_level;		// error, warn, info, debug or trace, empty = not set
+		std::map<std::string, LogFormat>	_log_formats;	// log_format lines by name
 		size_t						_client_max_body_size = MAX_BODY_SIZE;
+		size_t						_pipeline_depth = PIPELINE_DEPTH;	// pipelined requests of a connection awaiting their response
 		std::vector<Location>		_locations;
 
 	public:
@@ -39,20 +115,36 @@ class Server {
 		void	setId(int id);
 		void	setAddress(uint32_t address);
 		void	setPort(int port);
-		void	setMaxBodySize(int max_body_size);
+		void	setMaxBodySize(size_t max_body_size);
+		void	setPipelineDepth(size_t depth);
 		void	setName(const std::string& name);
 		void	setRoot(const std::string& root);
 		void	setIndex(const std::string& index);
 		void	setErrorPage(int error_index, const std::string& page);
+		void	setErrorPageCache(std::shared_ptr<const router::utils::ErrorPages> pages);
+		void	setType(const std::string& extension, const std::string& type);
+		void	setUpstream(const Upstream& upstream);
+		void	setCachePath(const CachePath& cache_path);
+		void	setAccessLog(const AccessLogConfig& access_log);
+		void	setLogLevel(const std::string& level);
+		void	setLogFormat(const std::string& name, const LogFormat& format);
 		void	setLocation(Location loc);
 
 		int									getId() const;
 		uint32_t							getAddress() const;
 		int									getPort() const;
-		int									getMaxBodySize() const;
+		size_t								getMaxBodySize() const;
+		size_t								getPipelineDepth() const;
 		const std::string&					getName() const;
 		const std::string&					getRoot() const;
 		const std::string&					getIndex() const;
 		const std::map<int, std::string>&	getErrorPages() const;
+		const std::shared_ptr<const router::utils::ErrorPages>&	getErrorPageCache() const;
+		const router::utils::MimeTypeMap&	getTypes() const;
+		const std::map<std::string, Upstream>&	getUpstreams() const;
+		const CachePath&					getCachePath() const;
+		const AccessLogConfig&				getAccessLog() const;
+		const std::string&					getLogLevel() const;
+		const std::map<std::string, LogFormat>&	getLogFormats() const;
 		const std::vector<Location>&		getLocations() const;
 };
@@ -0,0 +1,84 @@
+#include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include "../src/server/Cluster.hpp"
+#include "../src/server/HelperFunctions.hpp"
+#include "corpus.hpp"
+
+// Utility: cluster listening for range(0) virtual hosts, with one client connected to them.
+// The client is /dev/null: nothing is read from it, it only has to be a descriptor to close.
+class ConnectedCluster {
+public:
+    explicit ConnectedCluster(int servers) : _file(corpus::manyServers(servers)) {
+        _cluster.config(_file.path());
+        _cluster.create();
+        _client = open("/dev/null", O_RDONLY);
+        _cluster.addClient(_client, *_cluster.getServerFds().begin(), "127.0.0.1");
+    }
+
+    Cluster& cluster() { return _cluster; }
+    int client() const { return _client; }
+
+private:
+    corpus::ConfigFile  _file;
+    Cluster             _cluster;
+    int                 _client = -1;
+};
+
+// Utility: request of the browser corpus for host
+static std::string browserGet(const std::string& host) {
+    std::string raw = corpus::BROWSER_GET;
+    raw.replace(raw.find("www.example.com"), 15, host);
+    return raw;
+}
+
+// Utility: server for raw on a listener of range(0) virtual hosts, expecting name
+static void findConfig(benchmark::State& state, const std::string& raw, const std::string& name) {
+    ConnectedCluster connected(state.range(0));
+    for (auto _ : state) {
+        const Server& conf = connected.cluster().findRelevantConfig(connected.client(), raw);
+        if (conf.getName() != name) {
+            state.SkipWithError(("served by " + conf.getName()).c_str());
+            break ;
+        }
+        benchmark::DoNotOptimize(&conf);
+    }
+}
+
+// Host named by the last server of the listener
+static void BM_FindRelevantConfig(benchmark::State& state) {
+    std::string last = "host" + std::to_string(state.range(0) - 1) + ".example.com";
+    findConfig(state, browserGet(last + ":18481"), last);
+}
+BENCHMARK(BM_FindRelevantConfig)->Arg(1)->Arg(16)->Arg(128);
+
+// Host no server is named, served by the default one
+static void BM_FindRelevantConfigDefault(benchmark::State& state) {
+    findConfig(state, corpus::BROWSER_GET, "host0.example.com");
+}
+BENCHMARK(BM_FindRelevantConfigDefault)->Arg(1)->Arg(16)->Arg(128);
+
+// Utility: check raw, received in one read, is a complete request
+static void complete(benchmark::State& state, const std::string& raw) {
+    ConnectedCluster connected(1);
+    for (auto _ : state) {
+        ClientRequestState client_state;
+        client_state.buffer = raw;
+        if (!requestComplete(client_state, connected.client(), &connected.cluster())) {
+            state.SkipWithError("request not complete");
+            break ;
+        }
+        benchmark::DoNotOptimize(client_state.clean_buffer.data());
+    }
+    state.SetBytesProcessed(state.iterations() * raw.size());
+}
+
+static void BM_RequestCompleteGet(benchmark::State& state) { complete(state, corpus::BROWSER_GET); }
+BENCHMARK(BM_RequestCompleteGet);
+
+static void BM_RequestCompletePost(benchmark::State& state) { complete(state, corpus::jsonPost()); }
+BENCHMARK(BM_RequestCompletePost);
+
+static void BM_RequestCompleteChunked(benchmark::State& state) {
+    complete(state, corpus::chunkedUpload(state.range(0), 8 << 10));
+}
+BENCHMARK(BM_RequestCompleteChunked)->Arg(64 << 10)->Arg(1 << 20);
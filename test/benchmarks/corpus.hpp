@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+// Requests and configs the benchmarks run on, shaped after what browsers, curl and the
+// siege runs in test/siege_text.txt send
+
+namespace corpus {
+
+// Navigation request of a current browser
+inline const std::string BROWSER_GET =
+    "GET /docs/guide/index.html?lang=en&page=2 HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "sec-ch-ua: \"Chromium\";v=\"124\", \"Not-A.Brand\";v=\"99\"\r\n"
+    "sec-ch-ua-mobile: ?0\r\n"
+    "sec-ch-ua-platform: \"Linux\"\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/124.0.0.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Sec-Fetch-Mode: navigate\r\n"
+    "Sec-Fetch-User: ?1\r\n"
+    "Sec-Fetch-Dest: document\r\n"
+    "Referer: https://www.example.com/docs/\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: en-US,en;q=0.9,de;q=0.8\r\n"
+    "Cookie: session=7f3a9c1e2b4d6f80; theme=dark; _ga=GA1.1.123456789.1700000000\r\n"
+    "\r\n";
+
+// What curl sends by default
+inline const std::string CURL_GET =
+    "GET /index.html HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "User-Agent: curl/8.5.0\r\n"
+    "Accept: */*\r\n"
+    "\r\n";
+
+// API call with a small JSON body
+inline std::string jsonPost() {
+    const std::string body =
+        "{\"user\":{\"id\":4182,\"name\":\"Ada Lovelace\",\"email\":\"ada@example.com\"},"
+        "\"items\":[{\"sku\":\"A-100\",\"qty\":2},{\"sku\":\"B-220\",\"qty\":1}],\"note\":\"leave at door\"}";
+    return "POST /api/v1/orders HTTP/1.1\r\n"
+           "Host: api.example.com\r\n"
+           "User-Agent: python-requests/2.31.0\r\n"
+           "Accept: application/json\r\n"
+           "Content-Type: application/json\r\n"
+           "Content-Length: " + std::to_string(body.size()) + "\r\n"
+           "\r\n" + body;
+}
+
+// Upload of size bytes sent in chunks of chunk bytes
+inline std::string chunkedUpload(size_t size, size_t chunk) {
+    std::string request =
+        "POST /upload/data.bin HTTP/1.1\r\n"
+        "Host: www.example.com\r\n"
+        "User-Agent: curl/8.5.0\r\n"
+        "Content-Type: application/octet-stream\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n";
+    char hex[32];
+    for (size_t sent = 0; sent < size; sent += chunk) {
+        size_t n = std::min(chunk, size - sent);
+        snprintf(hex, sizeof(hex), "%zx\r\n", n);
+        request += hex;
+        request.append(n, static_cast<char>('a' + sent / chunk % 26));
+        request += "\r\n";
+    }
+    return request + "0\r\n\r\n";
+}
+
+// Body of the form test/siege_text.txt posts: two fields and a file of size bytes
+inline const std::string BOUNDARY = "MyBoundary123";
+
+inline std::string multipartBody(size_t size) {
+    std::string body =
+        "--" + BOUNDARY + "\r\n"
+        "Content-Disposition: form-data; name=\"title\"\r\n"
+        "\r\n"
+        "quarterly report\r\n"
+        "--" + BOUNDARY + "\r\n"
+        "Content-Disposition: form-data; name=\"tags\"\r\n"
+        "\r\n"
+        "finance,2024,q3\r\n"
+        "--" + BOUNDARY + "\r\n"
+        "Content-Disposition: form-data; name=\"file\"; filename=\"report.pdf\"\r\n"
+        "Content-Type: application/pdf\r\n"
+        "\r\n";
+    // Binary-looking content, with the odd "\r\n--" a parser has to look past
+    for (size_t i = 0; i < size; ++i)
+        body += (i % 997 == 996) ? '\n' : (i % 991 == 990) ? '-' : static_cast<char>(i * 131 % 251);
+    return body + "\r\n--" + BOUNDARY + "--\r\n";
+}
+
+// Config file removed with the object
+class ConfigFile {
+public:
+    explicit ConfigFile(const std::string& text)
+        : _path(std::filesystem::temp_directory_path() / ("webserv_bench_" + std::to_string(getpid()) + "_"
+                + std::to_string(_count++) + ".conf")) {
+        std::ofstream(_path) << text;
+    }
+    ~ConfigFile() { std::filesystem::remove(_path); }
+
+    std::string path() const { return _path.string(); }
+
+private:
+    static inline int       _count = 0;
+    std::filesystem::path   _path;
+};
+
+// www.example.com with locations /api/v<i>/resource<i> redirecting, any other path is a 404
+inline std::string manyLocations(int locations) {
+    std::string text =
+        "server {\n"
+        "\tserver_name www.example.com\n"
+        "\tlisten 18480\n"
+        "\thost 127.0.0.1\n"
+        "\troot /tmp\n"
+        "\tindex index.html\n";
+    for (int i = 0; i < locations; ++i) {
+        std::string n = std::to_string(i);
+        text += "\n\tlocation /api/v" + n + "/resource" + n + " {\n"
+                "\t\tallow_methods GET POST\n"
+                "\t\tindex index.html\n"
+                "\t\treturn /moved/" + n + "\n"
+                "\t}\n";
+    }
+    return text + "}\n";
+}
+
+// servers virtual hosts host<i>.example.com sharing one listener
+inline std::string manyServers(int servers) {
+    std::string text;
+    for (int i = 0; i < servers; ++i) {
+        text += "server {\n"
+                "\tserver_name host" + std::to_string(i) + ".example.com\n"
+                "\tlisten 18481\n"
+                "\thost 127.0.0.1\n"
+                "\troot /tmp\n"
+                "\tclient_max_body_size 10000000\n"
+                "\tlog_level warn\n"
+                "\n"
+                "\tlocation / {\n"
+                "\t\tallow_methods GET POST\n"
+                "\t\tindex index.html\n"
+                "\t}\n"
+                "}\n";
+    }
+    return text;
+}
+
+} // namespace corpus
@@ -0,0 +1,66 @@
+#include <benchmark/benchmark.h>
+#include "../src/parser/Parser.hpp"
+#include "../src/server/HelperFunctions.hpp"
+#include "../src/router/handlers/MultipartParser.hpp"
+#include "corpus.hpp"
+
+using router::handlers::MultipartParser;
+
+// Utility: parse one request per iteration
+static void parse(benchmark::State& state, const std::string& raw) {
+    for (auto _ : state) {
+        bool kick_me = false;
+        Request req = Parser::parseRequest(raw, kick_me, false);
+        benchmark::DoNotOptimize(req);
+    }
+    state.SetBytesProcessed(state.iterations() * raw.size());
+}
+
+static void BM_ParseBrowserGet(benchmark::State& state) { parse(state, corpus::BROWSER_GET); }
+BENCHMARK(BM_ParseBrowserGet);
+
+static void BM_ParseCurlGet(benchmark::State& state) { parse(state, corpus::CURL_GET); }
+BENCHMARK(BM_ParseCurlGet);
+
+static void BM_ParseJsonPost(benchmark::State& state) { parse(state, corpus::jsonPost()); }
+BENCHMARK(BM_ParseJsonPost);
+
+// Chunked upload of range(0) bytes in chunks of range(1), decoded as if it arrived in one read.
+// Copying the request into the client's buffer is part of the time, as it is when it is read.
+static void BM_DecodeChunkedBody(benchmark::State& state) {
+    const std::string raw = corpus::chunkedUpload(state.range(0), state.range(1));
+    for (auto _ : state) {
+        ClientRequestState client_state;
+        client_state.max_body_size = MAX_BUFFER_SIZE;
+        client_state.buffer = raw;
+        if (!decodeChunkedBody(client_state)) {
+            state.SkipWithError("body not decoded");
+            break ;
+        }
+        benchmark::DoNotOptimize(client_state.clean_buffer.data());
+    }
+    state.SetBytesProcessed(state.iterations() * raw.size());
+}
+BENCHMARK(BM_DecodeChunkedBody)->Args({64 << 10, 8 << 10})->Args({1 << 20, 16 << 10})->Args({1 << 20, 256});
+
+// Form with a file of range(0) bytes, fed in reads of range(1) bytes
+static void BM_MultipartParser(benchmark::State& state) {
+    const std::string body = corpus::multipartBody(state.range(0));
+    const size_t read = state.range(1);
+    for (auto _ : state) {
+        size_t received = 0;
+        MultipartParser parser("--" + corpus::BOUNDARY,
+            [](const MultipartParser::Part& part) { benchmark::DoNotOptimize(part.name.data()); return true; },
+            [&received](const char*, size_t size) { received += size; return true; },
+            []() { return true; });
+        for (size_t pos = 0; pos < body.size(); pos += read)
+            parser.feed(body.data() + pos, std::min(read, body.size() - pos));
+        if (!parser.complete()) {
+            state.SkipWithError("body not parsed");
+            break ;
+        }
+        benchmark::DoNotOptimize(received);
+    }
+    state.SetBytesProcessed(state.iterations() * body.size());
+}
+BENCHMARK(BM_MultipartParser)->Args({4 << 10, 4096})->Args({1 << 20, 4096})->Args({1 << 20, 65536});
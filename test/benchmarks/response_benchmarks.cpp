@@ -0,0 +1,58 @@
+#include <benchmark/benchmark.h>
+#include "../src/server/HelperFunctions.hpp"
+#include "../src/router/utils/HttpResponseBuilder.hpp"
+
+// Utility: a 200 of the static handler, body of size bytes
+static Response makeResponse(size_t size) {
+    Response res;
+    res.setStatus(http::STATUS_OK_200);
+    res.setHeaders(http::CONTENT_TYPE, "text/html");
+    res.setHeaders(http::CONTENT_LENGTH, std::to_string(size));
+    res.setHeaders("Last-Modified", "Tue, 15 Oct 2024 08:12:31 GMT");
+    res.setHeaders("ETag", "\"670e2387-1f40\"");
+    res.setHeaders(http::CONNECTION, http::CONNECTION_KEEP_ALIVE);
+    res.setBody(std::string(size, 'x'));
+    return res;
+}
+
+// A new string per response
+static void BM_ResponseToString(benchmark::State& state) {
+    const Response res = makeResponse(state.range(0));
+    size_t size = 0;
+    for (auto _ : state) {
+        std::string out = responseToString(res);
+        size = out.size();
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_ResponseToString)->Arg(0)->Arg(1 << 10)->Arg(64 << 10);
+
+// Responses appended to a client's send buffer that is emptied as it goes out
+static void BM_AppendResponse(benchmark::State& state) {
+    const Response res = makeResponse(state.range(0));
+    std::string out;
+    size_t size = 0;
+    for (auto _ : state) {
+        out.clear();
+        appendResponse(out, res);
+        size = out.size();
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_AppendResponse)->Arg(0)->Arg(1 << 10)->Arg(64 << 10);
+
+// The 404 page every miss builds
+static void BM_ErrorResponse(benchmark::State& state) {
+    Server server;
+    Request req;
+    req.setHttpVersion("HTTP/1.1");
+    for (auto _ : state) {
+        Response res;
+        router::utils::HttpResponseBuilder::setErrorResponse(res, 404, req, server);
+        std::string out = responseToString(res);
+        benchmark::DoNotOptimize(out.data());
+    }
+}
+BENCHMARK(BM_ErrorResponse);
@@ -0,0 +1,98 @@
+#include <benchmark/benchmark.h>
+#include "../src/config/Config.hpp"
+#include "../src/parser/Parser.hpp"
+#include "../src/router/Router.hpp"
+#include "../src/router/utils/FileUtils.hpp"
+#include "corpus.hpp"
+
+using router::utils::FileUtils;
+
+// Utility: router set up with the servers of a config, numbered the way Cluster::config does
+class RoutedConfig {
+public:
+    explicit RoutedConfig(const std::string& text) {
+        corpus::ConfigFile file(text);
+        Config config;
+        config.validate(file.path());
+        _configs = config.parse(file.path());
+        for (size_t i = 0; i < _configs.size(); ++i)
+            _configs[i].setId(static_cast<int>(i));
+        _router.setupRouter(_configs);
+    }
+
+    const Server& server() const { return _configs.front(); }
+    const Router& router() const { return _router; }
+
+private:
+    std::vector<Server> _configs;
+    Router              _router;
+};
+
+// Utility: GET of path on www.example.com
+static Request get(const std::string& path) {
+    bool kick_me = false;
+    return Parser::parseRequest("GET " + path + " HTTP/1.1\r\nHost: www.example.com\r\n\r\n", kick_me, false);
+}
+
+// Utility: route req on a server of range(0) locations, expecting status
+static void route(benchmark::State& state, const std::string& path, const std::string& status) {
+    RoutedConfig routed(corpus::manyLocations(state.range(0)));
+    const Request req = get(path);
+    for (auto _ : state) {
+        Response res;
+        routed.router().handleRequest(routed.server(), req, res);
+        if (res.getStatus().compare(0, status.size(), status) != 0) {
+            state.SkipWithError(("answered " + std::string(res.getStatus())).c_str());
+            break ;
+        }
+        benchmark::DoNotOptimize(res);
+    }
+}
+
+// Path naming the last location exactly
+static void BM_RouteExact(benchmark::State& state) {
+    std::string n = std::to_string(state.range(0) - 1);
+    route(state, "/api/v" + n + "/resource" + n, "30");
+}
+BENCHMARK(BM_RouteExact)->Arg(8)->Arg(64)->Arg(512);
+
+// Path under the last location, found by prefix
+static void BM_RoutePrefix(benchmark::State& state) {
+    std::string n = std::to_string(state.range(0) - 1);
+    route(state, "/api/v" + n + "/resource" + n + "/items/42", "30");
+}
+BENCHMARK(BM_RoutePrefix)->Arg(8)->Arg(64)->Arg(512);
+
+// Path no location matches
+static void BM_RouteMiss(benchmark::State& state) {
+    route(state, "/static/js/app.3f9a1c.js", "404");
+}
+BENCHMARK(BM_RouteMiss)->Arg(8)->Arg(64)->Arg(512);
+
+// Paths of a typical page load, with and without a known extension
+static const std::vector<std::string> ASSETS = {
+    "/index.html", "/css/site.min.css", "/js/app.3f9a1c.js", "/img/logo.svg", "/img/hero@2x.webp",
+    "/fonts/inter.woff2", "/favicon.ico", "/api/data.json", "/downloads/report.pdf", "/README", "/archive.tar.gz",
+};
+
+static void BM_GetContentType(benchmark::State& state) {
+    for (auto _ : state) {
+        for (const std::string& path : ASSETS)
+            benchmark::DoNotOptimize(FileUtils::getContentType(path));
+    }
+    state.SetItemsProcessed(state.iterations() * ASSETS.size());
+}
+BENCHMARK(BM_GetContentType);
+
+// Same, checking a server's types {} first
+static void BM_GetContentTypeServer(benchmark::State& state) {
+    Server server;
+    server.setType("js", "text/javascript; charset=utf-8");
+    server.setType("wasm", "application/wasm");
+    for (auto _ : state) {
+        for (const std::string& path : ASSETS)
+            benchmark::DoNotOptimize(FileUtils::getContentType(path, server));
+    }
+    state.SetItemsProcessed(state.iterations() * ASSETS.size());
+}
+BENCHMARK(BM_GetContentTypeServer);
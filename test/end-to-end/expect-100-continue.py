@@ -0,0 +1,29 @@
+# Expect: 100-continue is answered from the head alone.
+# The first request gets "100 Continue" before the body is sent, the second one
+# (Content-Length above client_max_body_size) gets 413 and the body is never read.
+
+import socket
+
+HOST = '127.0.0.1'
+PORT = 8080
+
+def send_head(sock, length):
+	sock.sendall((
+		"POST /cgi-bin/hello.py HTTP/1.1\r\n"
+		f"Host: {HOST}:{PORT}\r\n"
+		"Content-Type: text/plain\r\n"
+		f"Content-Length: {length}\r\n"
+		"Expect: 100-continue\r\n"
+		"\r\n"
+	).encode())
+	return sock.recv(8192).decode()
+
+with socket.create_connection((HOST, PORT)) as sock:
+	print("=== Small body ===")
+	print(send_head(sock, 5))
+	sock.sendall(b"hello")
+	print(sock.recv(8192).decode())
+
+with socket.create_connection((HOST, PORT)) as sock:
+	print("=== Body over client_max_body_size ===")
+	print(send_head(sock, 100000000000))
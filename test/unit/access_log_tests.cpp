@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+#include "../src/server/AccessLog.hpp"
+
+// Utility: fresh log file per test
+class AccessLogTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        _path = std::filesystem::temp_directory_path() / ("webserv_access_" + std::to_string(getpid()) + ".log");
+        std::filesystem::remove(_path);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove(_path);
+    }
+
+    std::string path() const { return _path.string(); }
+
+    std::string contents() const {
+        std::ifstream file(_path);
+        std::stringstream ss;
+        ss << file.rdbuf();
+        return ss.str();
+    }
+
+private:
+    std::filesystem::path _path;
+};
+
+// Utility: a GET answered 200 that took 2 ms to handle
+static RequestTrace makeTrace(const std::string* route) {
+    RequestTrace trace;
+    trace.server = 0;
+    trace.route = route;
+    trace.handler = "static";
+    trace.receive = 1500;
+    trace.head = std::chrono::steady_clock::now();
+    trace.start = trace.head - std::chrono::milliseconds(2);
+    trace.status = 200;
+    trace.bytes = 512;
+    trace.client = "127.0.0.1";
+    trace.host = "example.com";
+    trace.method = "GET";
+    trace.uri = "/index.html?q=1";
+    trace.protocol = "HTTP/1.1";
+    return trace;
+}
+
+// Utility: render with the clock at a fixed second
+static std::string render(const LogFormat& format, const RequestTrace& trace) {
+    AccessLogFormat compiled;
+    EXPECT_TRUE(AccessLogFormat::compile(format, compiled));
+    LogClock clock;
+    clock.update(std::chrono::system_clock::from_time_t(1700000000) + std::chrono::milliseconds(42));
+    std::string line;
+    compiled.render(line, trace, clock, trace.head);
+    return line;
+}
+
+// ✅ Test: variables are replaced, literal text and lone dollars are kept
+TEST_F(AccessLogTest, Variables) {
+    const std::string root = "/";
+    LogFormat format = {"$remote_addr $host \"$request\" $status $bytes_sent $ $location $handler "
+                        "$receive_time $handle_time $send_time $request_time $msec", false};
+    EXPECT_EQ(render(format, makeTrace(&root)),
+              "127.0.0.1 example.com \"GET /index.html?q=1 HTTP/1.1\" 200 512 $ / static "
+              "0.002 0.002 0.000 0.004 1700000000.042");
+}
+
+// ✅ Test: request text is escaped, and a missing value is a dash
+TEST_F(AccessLogTest, Escaping) {
+    RequestTrace trace = makeTrace(nullptr);
+    trace.uri = "/a\"b\\c\n";
+    EXPECT_EQ(render({"$request_uri $location", false}, trace), "/a\\\"b\\\\c\\x0A -");
+    EXPECT_EQ(render({"\"$request_uri\",\"$location\"", true}, trace), "\"/a\\\"b\\\\c\\u000A\",\"\"");
+}
+
+// ✅ Test: the built-in formats compile, json renders one object per line
+TEST_F(AccessLogTest, Builtin) {
+    LogFormat format;
+    ASSERT_TRUE(AccessLogFormat::builtin("main", format));
+    ASSERT_TRUE(AccessLogFormat::builtin("json", format));
+    EXPECT_FALSE(AccessLogFormat::builtin("combined", format));
+
+    const std::string api = "/api";
+    std::string line = render(format, makeTrace(&api));
+    EXPECT_EQ(line.front(), '{');
+    EXPECT_EQ(line.back(), '}');
+    EXPECT_NE(line.find("\"status\":200,\"bytes\":512,\"location\":\"/api\""), std::string::npos);
+}
+
+// ❌ Test: a variable there is no field for is refused
+TEST_F(AccessLogTest, UnknownVariable) {
+    AccessLogFormat compiled;
+    EXPECT_FALSE(AccessLogFormat::compile({"$remote_addr $http_user_agent", false}, compiled));
+}
+
+// ✅ Test: lines reach the file by the time the log is closed
+TEST_F(AccessLogTest, Flush) {
+    {
+        AccessLog log(path(), 1, 1000);
+        for (int i = 0; i < 10; ++i)
+            EXPECT_TRUE(log.append("line " + std::to_string(i) + "\n"));
+    }
+    std::string text = contents();
+    EXPECT_EQ(text.find("line 0\n"), 0u);
+    EXPECT_NE(text.find("line 9\n"), std::string::npos);
+}
+
+// ✅ Test: the flusher wakes once the ring is half full, without waiting for its interval
+TEST_F(AccessLogTest, HalfFull) {
+    AccessLog log(path(), 1, 60000);
+    std::string line(600, 'x');
+    line += '\n';
+    EXPECT_TRUE(log.append(line));
+    for (int i = 0; i < 100 && contents().empty(); ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(contents(), line);
+}
+
+// ❌ Test: a line the ring has no room for is dropped, the event loop does not wait
+TEST_F(AccessLogTest, Full) {
+    AccessLog log(path(), 1, 60000);
+    EXPECT_FALSE(log.append(std::string(2000, 'x')));
+    EXPECT_EQ(log.dropped(), 1u);
+}
+
+// ❌ Test: a log in a missing directory is refused at startup
+TEST_F(AccessLogTest, MissingDirectory) {
+    EXPECT_THROW(AccessLog("/nonexistent/dir/access.log", 64, 1000), std::runtime_error);
+}
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+#include "../src/router/utils/AutoindexCache.hpp"
+
+using router::utils::AutoindexCache;
+
+// Utility: fresh directory holding an autoindex template
+static std::string makeListingDir(const std::string& name) {
+    std::string dir = std::filesystem::temp_directory_path().string() + "/" + name + "_" + std::to_string(getpid());
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    std::ofstream(dir + "/autoindex_template.html") << "<h1>{{PATH}}</h1>\n{{PARENT_LINK}}<div>\n{{ITEMS}}</div>\n";
+    return dir;
+}
+
+static void writeFile(const std::string& path, size_t size) {
+    std::ofstream(path) << std::string(size, 'x');
+}
+
+// ✅ Test: template is split into text and placeholders
+TEST(AutoindexCacheTest, CompileSplitsPlaceholders) {
+    AutoindexCache::Template page = AutoindexCache::compile("a{{PATH}}b{{UNKNOWN}}{{ITEMS}}");
+    ASSERT_EQ(page.size(), 4u);
+    EXPECT_EQ(page[0].kind, AutoindexCache::Segment::TEXT);
+    EXPECT_EQ(page[0].text, "a");
+    EXPECT_EQ(page[1].kind, AutoindexCache::Segment::PATH);
+    EXPECT_EQ(page[2].kind, AutoindexCache::Segment::TEXT);
+    EXPECT_EQ(page[2].text, "b{{UNKNOWN}}");
+    EXPECT_EQ(page[3].kind, AutoindexCache::Segment::ITEMS);
+}
+
+// ✅ Test: rendered listing has the path, the parent link and one item per entry
+TEST(AutoindexCacheTest, RendersListing) {
+    std::string dir = makeListingDir("autoindex_render");
+    writeFile(dir + "/small.txt", 10);
+    writeFile(dir + "/big.bin", 3000);
+    std::filesystem::create_directory(dir + "/sub");
+
+    std::string html;
+    AutoindexCache::render(AutoindexCache::compile("{{PATH}}|{{PARENT_LINK}}|{{ITEMS}}"), dir, "/files/a", html);
+
+    EXPECT_EQ(html.rfind("/files/a|  <a href=\"/files\" class=\"back-link\">", 0), 0u);
+    EXPECT_NE(html.find("<a href=\"/files/a/small.txt\" class=\"name\">small.txt</a>\n      <span class=\"size\">10 B</span>"), std::string::npos);
+    EXPECT_NE(html.find("<span class=\"size\">2 KB</span>"), std::string::npos);
+    EXPECT_NE(html.find("<span class=\"dir-icon\">📁</span>\n      <a href=\"/files/a/sub\" class=\"name\">sub</a>\n      <span class=\"size\">-</span>"), std::string::npos);
+    std::filesystem::remove_all(dir);
+}
+
+// ✅ Test: root listing has no parent link
+TEST(AutoindexCacheTest, RootHasNoParentLink) {
+    std::string dir = makeListingDir("autoindex_root");
+    std::string html;
+    AutoindexCache::render(AutoindexCache::compile("[{{PARENT_LINK}}]"), dir, "/", html);
+    EXPECT_EQ(html, "[]");
+    std::filesystem::remove_all(dir);
+}
+
+// ✅ Test: listing is served from the cache until the directory changes
+TEST(AutoindexCacheTest, InvalidatedByDirectoryChange) {
+    std::string dir = makeListingDir("autoindex_cache");
+    AutoindexCache cache(8, 60000);
+    writeFile(dir + "/a.txt", 10);
+
+    std::string first = cache.listing(dir, "/d/", dir);
+    EXPECT_NE(first.find("a.txt"), std::string::npos);
+
+    // In-place edit leaves the directory mtime alone: still the cached listing
+    writeFile(dir + "/a.txt", 20);
+    EXPECT_EQ(cache.listing(dir, "/d/", dir), first);
+
+    // New entry changes the directory mtime
+    writeFile(dir + "/b.txt", 10);
+    std::string second = cache.listing(dir, "/d/", dir);
+    EXPECT_NE(second.find("b.txt"), std::string::npos);
+    EXPECT_NE(second.find("20 B"), std::string::npos);
+    std::filesystem::remove_all(dir);
+}
+
+// ✅ Test: expired listing is rendered again
+TEST(AutoindexCacheTest, ExpiresAfterTtl) {
+    std::string dir = makeListingDir("autoindex_ttl");
+    AutoindexCache cache(8, 0);
+    writeFile(dir + "/a.txt", 10);
+    cache.listing(dir, "/d/", dir);
+    writeFile(dir + "/a.txt", 20);
+    EXPECT_NE(cache.listing(dir, "/d/", dir).find("20 B"), std::string::npos);
+    std::filesystem::remove_all(dir);
+}
+
+// ❌ Test: no template anywhere up to the root
+TEST(AutoindexCacheTest, MissingTemplateThrows) {
+    std::string dir = makeListingDir("autoindex_missing");
+    std::filesystem::remove(dir + "/autoindex_template.html");
+    AutoindexCache cache(8, 1000);
+    EXPECT_THROW(cache.listing(dir, "/", dir), std::runtime_error);
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include <ctime>
+#include "../src/router/handlers/CacheControl.hpp"
+#include "../src/router/HttpConstants.hpp"
+
+using router::handlers::CacheControl;
+using router::handlers::parseCacheControl;
+
+// Utility: 200 carrying header name: value
+static Response makeResponse(const std::string& name = "", const std::string& value = "") {
+    Response res;
+    res.setStatus(http::STATUS_OK_200);
+    if (!name.empty())
+        res.setHeaders(name, value);
+    return res;
+}
+
+// Utility: IMF-fixdate seconds from now
+static std::string httpDate(long offset) {
+    time_t when = std::time(nullptr) + offset;
+    char buffer[64];
+    strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", gmtime(&when));
+    return buffer;
+}
+
+// ✅ Test: a plain 200 is storable and leaves the lifetimes to the location
+TEST(CacheControlTest, Defaults) {
+    CacheControl control = parseCacheControl(makeResponse());
+    EXPECT_TRUE(control.storable);
+    EXPECT_EQ(control.freshFor, -1);
+    EXPECT_EQ(control.staleFor, -1);
+}
+
+// ✅ Test: max-age, s-maxage and stale-while-revalidate, in any case and order
+TEST(CacheControlTest, Lifetimes) {
+    CacheControl control = parseCacheControl(makeResponse("Cache-Control", "public, Max-Age=60, stale-while-revalidate=30"));
+    EXPECT_TRUE(control.storable);
+    EXPECT_EQ(control.freshFor, 60);
+    EXPECT_EQ(control.staleFor, 30);
+
+    EXPECT_EQ(parseCacheControl(makeResponse("cache-control", "s-maxage=10, max-age=60")).freshFor, 10);
+    EXPECT_EQ(parseCacheControl(makeResponse("Cache-Control", "max-age=\"60\"")).freshFor, 60);
+    EXPECT_EQ(parseCacheControl(makeResponse("Cache-Control", "max-age=99999999999999")).freshFor, 2147483648L);
+}
+
+// ✅ Test: Expires counts only without max-age; malformed or past means stale
+TEST(CacheControlTest, Expires) {
+    long fresh = parseCacheControl(makeResponse("Expires", httpDate(120))).freshFor;
+    EXPECT_GE(fresh, 119);
+    EXPECT_LE(fresh, 120);
+    EXPECT_EQ(parseCacheControl(makeResponse("Expires", httpDate(-120))).freshFor, 0);
+    EXPECT_EQ(parseCacheControl(makeResponse("Expires", "0")).freshFor, 0);
+
+    Response both = makeResponse("Expires", httpDate(-120));
+    both.setHeaders("Cache-Control", "max-age=60");
+    EXPECT_EQ(parseCacheControl(both).freshFor, 60);
+}
+
+// ❌ Test: negative or malformed delta-seconds mean already stale
+TEST(CacheControlTest, MalformedDeltaSeconds) {
+    for (const char* value : {"max-age=-1", "max-age=", "max-age=1O", "max-age=0x10"}) {
+        CacheControl control = parseCacheControl(makeResponse("Cache-Control", value));
+        EXPECT_TRUE(control.storable) << value;
+        EXPECT_EQ(control.freshFor, 0) << value;
+    }
+}
+
+// ❌ Test: responses that must not be shared
+TEST(CacheControlTest, NotStorable) {
+    EXPECT_FALSE(parseCacheControl(makeResponse("Cache-Control", "public, no-store")).storable);
+    EXPECT_FALSE(parseCacheControl(makeResponse("Cache-Control", "no-cache")).storable);
+    EXPECT_FALSE(parseCacheControl(makeResponse("Cache-Control", "Private, max-age=60")).storable);
+    EXPECT_FALSE(parseCacheControl(makeResponse("Set-Cookie", "id=1")).storable);
+    EXPECT_FALSE(parseCacheControl(makeResponse("Vary", "Accept-Encoding")).storable);
+
+    Response notFound = makeResponse("Cache-Control", "max-age=60");
+    notFound.setStatus(http::STATUS_NOT_FOUND_404);
+    EXPECT_FALSE(parseCacheControl(notFound).storable);
+}
@@ -0,0 +1,234 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+#include "../src/router/handlers/CgiCache.hpp"
+#include "../src/router/HttpConstants.hpp"
+#include "../src/server/Server.hpp"
+
+using router::handlers::CgiCache;
+
+// Stub job: done once answered, finishes with the scripted response
+class StubJob : public PendingResponse {
+public:
+    explicit StubJob(const std::string& body, const std::string& status = http::STATUS_OK_200) {
+        _response.setStatus(status);
+        _response.setBody(body);
+    }
+
+    void header(const std::string& name, const std::string& value) { _response.setHeaders(name, value); }
+    void answer() { _done = true; }
+
+    int fd() const override { return -1; }
+    short events() const override { return 0; }
+    void onEvent(short revents) override { (void)revents; }
+    bool done() const override { return _done; }
+    void finish(Response& res) override { res = _response; }
+    void abort(bool timedOut) override { (void)timedOut; _done = true; }
+
+private:
+    Response _response;
+    bool _done = false;
+};
+
+static Request makeRequest(const std::string& path, const std::string& method = "GET") {
+    Request req;
+    req.setMethod(method);
+    req.setPath(path);
+    req.setHeaders("host", "example.com");
+    return req;
+}
+
+// Utility: run job as the filling request for key, the way Cluster finishes it
+static void fill(CgiCache& cache, const std::string& key, const std::shared_ptr<StubJob>& job) {
+    std::shared_ptr<PendingResponse> filling = cache.fill(key, job);
+    job->answer();
+    Response res;
+    filling->finish(res);
+}
+
+// Utility: body served from the cache for req, empty when the lookup is not a hit
+static std::string hit(CgiCache& cache, const Request& req, const Server& server) {
+    Response res;
+    if (cache.lookup(cache.key(req), req, server, res) != CgiCache::HIT)
+        return "";
+    return std::string(res.getBody());
+}
+
+// ✅ Test: key made of method, path with query and the configured headers only
+TEST(CgiCacheTest, Key) {
+    CgiCache cache(60, 0, {"Accept-Language"});
+    Request fr = makeRequest("/cgi-bin/list.py?page=2");
+    fr.setHeaders("accept-language", "fr");
+    Request de = makeRequest("/cgi-bin/list.py?page=2");
+    de.setHeaders("accept-language", "de");
+    Request other = makeRequest("/cgi-bin/list.py?page=2");
+    other.setHeaders("accept-language", "fr");
+    other.setHeaders("user-agent", "curl/8.5.0");
+
+    EXPECT_EQ(cache.key(fr), "GET /cgi-bin/list.py?page=2\naccept-language:fr,");
+    EXPECT_NE(cache.key(fr), cache.key(de));
+    EXPECT_EQ(cache.key(fr), cache.key(other));
+    EXPECT_NE(cache.key(fr), cache.key(makeRequest("/cgi-bin/list.py?page=3")));
+}
+
+// ✅ Test: only GET requests without credentials are shared
+TEST(CgiCacheTest, Cacheable) {
+    CgiCache cache(60, 0, {});
+    Request withCookie = makeRequest("/cgi-bin/list.py");
+    withCookie.setHeaders("cookie", "session=1");
+    Request withAuth = makeRequest("/cgi-bin/list.py");
+    withAuth.setHeaders("authorization", "Basic dXNlcjpwYXNz");
+
+    EXPECT_TRUE(cache.cacheable(makeRequest("/cgi-bin/list.py")));
+    EXPECT_FALSE(cache.cacheable(makeRequest("/cgi-bin/list.py", "POST")));
+    EXPECT_FALSE(cache.cacheable(withCookie));
+    EXPECT_FALSE(cache.cacheable(withAuth));
+}
+
+// ✅ Test: a filled response is served with its age, without running the script again
+TEST(CgiCacheTest, HitAfterFill) {
+    CgiCache cache(60, 0, {});
+    Server server;
+    Request req = makeRequest("/cgi-bin/list.py");
+    std::string key = cache.key(req);
+    Response res;
+    ASSERT_EQ(cache.lookup(key, req, server, res), CgiCache::MISS);
+    fill(cache, key, std::make_shared<StubJob>("listing"));
+
+    Response cached;
+    ASSERT_EQ(cache.lookup(key, req, server, cached), CgiCache::HIT);
+    EXPECT_EQ(cached.getBody(), "listing");
+    EXPECT_EQ(cached.getHeaders("Age"), std::vector<std::string>{"0"});
+    EXPECT_EQ(hit(cache, makeRequest("/cgi-bin/list.py?page=2"), server), "");
+}
+
+// ✅ Test: requests arriving while the script runs wait for its response
+TEST(CgiCacheTest, CoalescesWhileFilling) {
+    CgiCache cache(60, 0, {});
+    Server server;
+    Request req = makeRequest("/cgi-bin/list.py");
+    std::string key = cache.key(req);
+    Response res;
+    ASSERT_EQ(cache.lookup(key, req, server, res), CgiCache::MISS);
+    auto job = std::make_shared<StubJob>("listing");
+    std::shared_ptr<PendingResponse> filling = cache.fill(key, job);
+
+    Response waiting;
+    ASSERT_EQ(cache.lookup(key, req, server, waiting), CgiCache::WAIT);
+    std::shared_ptr<PendingResponse> waiter = waiting.getPending();
+    ASSERT_NE(waiter, nullptr);
+    EXPECT_FALSE(waiter->done());
+
+    job->answer();
+    Response leader;
+    filling->finish(leader);
+    ASSERT_TRUE(waiter->done());
+    Response follower;
+    waiter->finish(follower);
+    EXPECT_EQ(follower.getStatus(), http::STATUS_OK_200);
+    EXPECT_EQ(follower.getBody(), "listing");
+}
+
+// ❌ Test: a leader dropped before finishing fails its waiters and leaves nothing behind
+TEST(CgiCacheTest, LeaderDropped) {
+    CgiCache cache(60, 0, {});
+    Server server;
+    Request req = makeRequest("/cgi-bin/list.py");
+    std::string key = cache.key(req);
+    std::shared_ptr<PendingResponse> filling = cache.fill(key, std::make_shared<StubJob>("listing"));
+    Response waiting;
+    ASSERT_EQ(cache.lookup(key, req, server, waiting), CgiCache::WAIT);
+    std::shared_ptr<PendingResponse> waiter = waiting.getPending();
+
+    filling.reset();
+    ASSERT_TRUE(waiter->done());
+    Response follower;
+    waiter->finish(follower);
+    EXPECT_EQ(follower.getStatus().rfind("500", 0), 0u);
+    Response res;
+    EXPECT_EQ(cache.lookup(key, req, server, res), CgiCache::MISS);
+}
+
+// ❌ Test: a leader answering an error passes it on but does not store it
+TEST(CgiCacheTest, LeaderFails) {
+    CgiCache cache(60, 0, {});
+    Server server;
+    Request req = makeRequest("/cgi-bin/list.py");
+    std::string key = cache.key(req);
+    auto job = std::make_shared<StubJob>("boom", http::STATUS_INTERNAL_SERVER_ERROR_500);
+    std::shared_ptr<PendingResponse> filling = cache.fill(key, job);
+    Response waiting;
+    ASSERT_EQ(cache.lookup(key, req, server, waiting), CgiCache::WAIT);
+    std::shared_ptr<PendingResponse> waiter = waiting.getPending();
+
+    job->answer();
+    Response leader;
+    filling->finish(leader);
+    ASSERT_TRUE(waiter->done());
+    Response follower;
+    waiter->finish(follower);
+    EXPECT_EQ(follower.getStatus(), http::STATUS_INTERNAL_SERVER_ERROR_500);
+    Response res;
+    EXPECT_EQ(cache.lookup(key, req, server, res), CgiCache::MISS);
+}
+
+// ✅ Test: an expired response is served stale once, then as a hit while the refresh runs
+TEST(CgiCacheTest, StaleWhileRevalidate) {
+    CgiCache cache(1, 30, {});
+    Server server;
+    Request req = makeRequest("/cgi-bin/list.py");
+    std::string key = cache.key(req);
+    fill(cache, key, std::make_shared<StubJob>("old"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+
+    Response stale;
+    ASSERT_EQ(cache.lookup(key, req, server, stale), CgiCache::STALE);
+    EXPECT_EQ(stale.getBody(), "old");
+    auto refresh = std::make_shared<StubJob>("new");
+    std::shared_ptr<PendingResponse> filling = cache.fill(key, refresh);
+    EXPECT_EQ(hit(cache, req, server), "old");
+
+    refresh->answer();
+    Response background;
+    filling->finish(background);
+    EXPECT_EQ(hit(cache, req, server), "new");
+}
+
+// ✅ Test: Cache-Control of the script overrides the location lifetime
+TEST(CgiCacheTest, CacheControlOverrides) {
+    Server server;
+    CgiCache cache(0, 0, {});
+    Request req = makeRequest("/cgi-bin/list.py");
+
+    auto lasting = std::make_shared<StubJob>("lasting");
+    lasting->header("Cache-Control", "public, max-age=60");
+    fill(cache, cache.key(req), lasting);
+    EXPECT_EQ(hit(cache, req, server), "lasting");
+
+    Request shared = makeRequest("/cgi-bin/shared.py");
+    auto sharedAge = std::make_shared<StubJob>("shared");
+    sharedAge->header("Cache-Control", "s-maxage=0, max-age=60");
+    fill(cache, cache.key(shared), sharedAge);
+    EXPECT_EQ(hit(cache, shared, server), "");
+}
+
+// ❌ Test: responses refusing to be shared are not stored
+TEST(CgiCacheTest, Refused) {
+    Server server;
+    const std::vector<std::pair<std::string, std::string>> refusals = {
+        {"Cache-Control", "no-store"},
+        {"Cache-Control", "no-cache"},
+        {"Cache-Control", "private, max-age=60"},
+        {"Cache-Control", "max-age=0"},
+        {"Set-Cookie", "session=7f3a9c1e; HttpOnly"},
+        {"Vary", "Accept-Encoding"},
+    };
+    for (const auto& [name, value] : refusals) {
+        CgiCache cache(60, 0, {});
+        Request req = makeRequest("/cgi-bin/list.py");
+        auto job = std::make_shared<StubJob>("private");
+        job->header(name, value);
+        fill(cache, cache.key(req), job);
+        EXPECT_EQ(hit(cache, req, server), "") << name << ": " << value;
+    }
+}
@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include "../src/router/handlers/CgiStream.hpp"
+#include "../src/router/HttpConstants.hpp"
+#include "../src/parser/Parser.hpp"
+#include "../src/server/Server.hpp"
+
+using router::handlers::CgiStreamJob;
+
+// Utility: shell script removed with the object, spawned the way the CGI handler does
+class Script {
+public:
+    explicit Script(const std::string& body)
+        : _path(std::filesystem::temp_directory_path() / ("webserv_cgi_stream_" + std::to_string(getpid()) + "_"
+                + std::to_string(_count++) + ".sh")) {
+        std::ofstream(_path) << body;
+        _plan.program = "/bin/sh";
+        _plan.argv = {"sh"};
+        _plan.workDir = _path.parent_path().string();
+    }
+    ~Script() { std::filesystem::remove(_path); }
+
+    pid_t spawn(int& stdinFd, int& stdoutFd) const {
+        return spawnCgiProcess(_plan, _path.string(), {"PATH=/bin:/usr/bin"}, stdinFd, stdoutFd);
+    }
+
+private:
+    static inline int       _count = 0;
+    std::filesystem::path   _path;
+    CgiExecPlan             _plan;
+};
+
+// Utility: drive a job the way Cluster does, through its descriptor
+static bool waitForJob(PendingResponse& job) {
+    for (int i = 0; i < 2000 && !job.done(); ++i) {
+        pollfd pfd = {job.fd(), job.events(), 0};
+        if (poll(&pfd, 1, 20) > 0)
+            job.onEvent(pfd.revents);
+    }
+    return job.done();
+}
+
+static Request makeRequest(const std::string& version = "HTTP/1.1") {
+    bool kick_me = false;
+    return Parser::parseRequest("GET /cgi-bin/run.sh " + version + "\r\nHost: example.com\r\n\r\n", kick_me, false);
+}
+
+// Utility: run script to the end, the head set on res and the framed body in body
+static bool run(const Script& script, Response& res, std::string& body, const std::string& input = "",
+                const std::string& version = "HTTP/1.1") {
+    int stdinFd = -1;
+    int stdoutFd = -1;
+    pid_t pid = script.spawn(stdinFd, stdoutFd);
+    EXPECT_GT(pid, 0);
+    Server server;
+    CgiStreamJob job(pid, stdinFd, stdoutFd, input, makeRequest(version), server);
+    EXPECT_TRUE(waitForJob(job));
+    job.finish(res);
+    if (!job.streaming()) {
+        body = res.getBody();
+        return true;
+    }
+    return job.takeBody(body);
+}
+
+// ✅ Test: output without Content-Length streams chunked, stdin reaches the script
+TEST(CgiStreamTest, ChunkedBody) {
+    Script script("printf 'Content-Type: text/plain\\r\\n\\r\\n'\ncat\n");
+    Response res;
+    std::string body;
+    EXPECT_TRUE(run(script, res, body, "hello"));
+    EXPECT_EQ(res.getStatus(), "200 OK");
+    ASSERT_EQ(res.getHeaders(http::TRANSFER_ENCODING).size(), 1u);
+    EXPECT_EQ(res.getHeaders(http::TRANSFER_ENCODING)[0], http::TRANSFER_ENCODING_CHUNKED);
+    EXPECT_EQ(body, "5\r\nhello\r\n0\r\n\r\n");
+}
+
+// ✅ Test: output with Content-Length passes through as is
+TEST(CgiStreamTest, RawBody) {
+    Script script("printf 'Content-Length: 5\\r\\n\\r\\nhello'\n");
+    Response res;
+    std::string body;
+    EXPECT_TRUE(run(script, res, body));
+    ASSERT_EQ(res.getHeaders(http::CONTENT_LENGTH).size(), 1u);
+    EXPECT_EQ(res.getHeaders(http::CONTENT_LENGTH)[0], "5");
+    EXPECT_TRUE(res.getHeaders(http::TRANSFER_ENCODING).empty());
+    EXPECT_EQ(body, "hello");
+}
+
+// ✅ Test: output past Content-Length is dropped
+TEST(CgiStreamTest, RawBodyTruncated) {
+    Script script("printf 'Content-Length: 5\\r\\n\\r\\nhello world'\n");
+    Response res;
+    std::string body;
+    EXPECT_TRUE(run(script, res, body));
+    EXPECT_EQ(body, "hello");
+}
+
+// ✅ Test: HTTP/1.0 clients get the whole output buffered
+TEST(CgiStreamTest, BufferedForHttp10) {
+    Script script("printf 'Status: 201 Created\\r\\n\\r\\n'\nprintf 'made'\n");
+    Response res;
+    std::string body;
+    EXPECT_TRUE(run(script, res, body, "", "HTTP/1.0"));
+    EXPECT_NE(res.getStatus().find("201 Created"), std::string::npos);
+    EXPECT_EQ(body, "made");
+    ASSERT_EQ(res.getHeaders(http::CONTENT_LENGTH).size(), 1u);
+    EXPECT_EQ(res.getHeaders(http::CONTENT_LENGTH)[0], "4");
+}
+
+// ❌ Test: output shorter than Content-Length breaks the body
+TEST(CgiStreamTest, RawBodyShort) {
+    Script script("printf 'Content-Length: 10\\r\\n\\r\\nhello'\n");
+    Response res;
+    std::string body;
+    EXPECT_FALSE(run(script, res, body));
+    EXPECT_EQ(body, "hello");
+}
+
+// ❌ Test: a Content-Length that is not a number answers 502 before any body
+TEST(CgiStreamTest, InvalidContentLength) {
+    for (const char* length : {"5, 5", "-1", "0x10", " ", "99999999999999999999999"}) {
+        Script script(std::string("printf 'Content-Length: ") + length + "\\r\\n\\r\\nhello'\n");
+        Response res;
+        std::string body;
+        run(script, res, body);
+        EXPECT_EQ(res.getStatus().rfind("502", 0), 0u) << length;
+        EXPECT_TRUE(res.getHeaders(http::TRANSFER_ENCODING).empty()) << length;
+    }
+}
+
+// ❌ Test: a script failing after its head went out breaks the chunked body, no last chunk
+TEST(CgiStreamTest, FailsMidStream) {
+    Script script("printf 'Content-Type: text/plain\\r\\n\\r\\npartial'\nexit 3\n");
+    Response res;
+    std::string body;
+    EXPECT_FALSE(run(script, res, body));
+    EXPECT_EQ(res.getStatus(), "200 OK");
+    EXPECT_EQ(body.find("0\r\n\r\n"), std::string::npos);
+}
+
+// ❌ Test: a failing script with buffered output answers 500
+TEST(CgiStreamTest, BufferedFailure) {
+    Script script("printf 'Content-Type: text/plain\\r\\n\\r\\npartial'\nexit 3\n");
+    Response res;
+    std::string body;
+    run(script, res, body, "", "HTTP/1.0");
+    EXPECT_EQ(res.getStatus().rfind("500", 0), 0u);
+}
+
+// ❌ Test: buffered output past MAX_BUFFER_SIZE stops the script and answers 502
+TEST(CgiStreamTest, BufferedTooLarge) {
+    Script script("printf 'Content-Type: text/plain\\r\\n\\r\\n'\nhead -c 11000000 /dev/zero\n");
+    Response res;
+    std::string body;
+    run(script, res, body, "", "HTTP/1.0");
+    EXPECT_EQ(res.getStatus().rfind("502", 0), 0u);
+}
@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+#include <poll.h>
+#include <unistd.h>
+#include <filesystem>
+#include <fstream>
+#include "../src/router/handlers/CgiWorkerPool.hpp"
+#include "../src/router/HttpConstants.hpp"
+#include "../src/parser/Parser.hpp"
+#include "../src/server/Server.hpp"
+
+using router::handlers::CgiRunner;
+using router::handlers::CgiWorkerPool;
+
+// Utility: drive a job the way Cluster does, through its descriptor
+static bool waitForJob(PendingResponse& job) {
+    for (int i = 0; i < 500 && !job.done(); ++i) {
+        if (job.fd() < 0)
+            break ;
+        pollfd pfd = {job.fd(), job.events(), 0};
+        if (poll(&pfd, 1, 20) > 0)
+            job.onEvent(pfd.revents);
+    }
+    return job.done();
+}
+
+static Request makeRequest() {
+    bool kick_me = false;
+    return Parser::parseRequest("GET /cgi-bin/hello.py HTTP/1.1\r\nHost: example.com\r\n\r\n", kick_me, false);
+}
+
+// ✅ Test: a script of the warmed directory runs in a kept worker, twice
+TEST(CgiWorkerPoolTest, RunsScripts) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / ("webserv_cgi_pool_" + std::to_string(getpid()));
+    std::filesystem::create_directories(dir);
+    std::ofstream(dir / "hello.py") << "print('Content-Type: text/plain')\nprint()\nprint('hello', end='')\n";
+
+    const CgiRunner* runner = CgiWorkerPool::findRunner(".py");
+    ASSERT_NE(runner, nullptr);
+    CgiWorkerPool pool(*runner, 1, 0, 4, dir.string());
+    Server server;
+    for (int i = 0; i < 2; ++i) {
+        auto job = pool.submit((dir / "hello.py").string(), {"REQUEST_METHOD=GET"}, "", makeRequest(), server);
+        ASSERT_TRUE(waitForJob(*job));
+        Response res;
+        job->finish(res);
+        EXPECT_EQ(res.getStatus(), http::STATUS_OK_200);
+        EXPECT_EQ(res.getBody(), "hello");
+    }
+    std::filesystem::remove_all(dir);
+}
+
+// ❌ Test: an interpreter that cannot be spawned fails the request at once
+TEST(CgiWorkerPoolTest, SpawnFails) {
+    CgiRunner missing = {"/nonexistent/python3", {"python3"}};
+    CgiWorkerPool pool(missing, 2, 0, 4);
+    Server server;
+    for (int i = 0; i < 8; ++i) {
+        auto job = pool.submit("/tmp/hello.py", {}, "", makeRequest(), server);
+        ASSERT_TRUE(job->done()) << i;
+        Response res;
+        job->finish(res);
+        EXPECT_EQ(res.getStatus().rfind("502", 0), 0u);
+    }
+}
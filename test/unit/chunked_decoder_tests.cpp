@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include "../src/request/ChunkedDecoder.hpp"
+
+// Utility: decode in pieces of the given size, return the decoded body
+static std::string decodeInPieces(ChunkedDecoder& decoder, const std::string& coded, size_t piece, size_t* consumed = nullptr) {
+    std::string body;
+    size_t used = 0;
+    for (size_t pos = 0; pos < coded.size() && !decoder.done() && !decoder.failed(); pos += piece) {
+        used += decoder.decode(coded.data() + pos, std::min(piece, coded.size() - pos),
+            [&body](const char* data, size_t size) { body.append(data, size); });
+    }
+    if (consumed)
+        *consumed = used;
+    return body;
+}
+
+static const std::string CODED =
+    "4\r\nWiki\r\n"
+    "5;name=value\r\npedia\r\n"
+    "E\r\n in\r\n\r\nchunks.\r\n"
+    "0\r\n"
+    "Expires: never\r\n"
+    "\r\n";
+
+// ✅ Test: whole body in one piece, extensions and trailer skipped
+TEST(ChunkedDecoderTest, SingleFeed) {
+    ChunkedDecoder decoder(1000);
+    size_t consumed = 0;
+
+    EXPECT_EQ(decodeInPieces(decoder, CODED, CODED.size(), &consumed), "Wikipedia in\r\n\r\nchunks.");
+    EXPECT_TRUE(decoder.done());
+    EXPECT_EQ(consumed, CODED.size());
+    EXPECT_EQ(decoder.bodySize(), 23u);
+}
+
+// ✅ Test: body fed one byte at a time
+TEST(ChunkedDecoderTest, ByteByByte) {
+    ChunkedDecoder decoder(1000);
+
+    EXPECT_EQ(decodeInPieces(decoder, CODED, 1), "Wikipedia in\r\n\r\nchunks.");
+    EXPECT_TRUE(decoder.done());
+}
+
+// ✅ Test: bytes after the body are left for the next request
+TEST(ChunkedDecoderTest, StopsAtEndOfBody) {
+    ChunkedDecoder decoder(1000);
+    std::string coded = "3\r\nabc\r\n0\r\n\r\nGET / HTTP/1.1\r\n";
+    size_t consumed = 0;
+
+    EXPECT_EQ(decodeInPieces(decoder, coded, coded.size(), &consumed), "abc");
+    EXPECT_TRUE(decoder.done());
+    EXPECT_EQ(coded.substr(consumed), "GET / HTTP/1.1\r\n");
+}
+
+// ❌ Test: body larger than the limit
+TEST(ChunkedDecoderTest, TooLarge) {
+    ChunkedDecoder decoder(8);
+    std::string coded = "5\r\nHello\r\n5\r\nWorld\r\n0\r\n\r\n";
+
+    EXPECT_EQ(decodeInPieces(decoder, coded, 1), "Hello");
+    EXPECT_TRUE(decoder.failed());
+}
+
+// ❌ Test: malformed size lines and chunk ends
+TEST(ChunkedDecoderTest, Malformed) {
+    const std::string cases[] = {
+        "\r\nabc\r\n0\r\n\r\n",                 // empty size
+        "x\r\nabc\r\n0\r\n\r\n",                // not hex
+        "3\nabc\r\n0\r\n\r\n",                  // bare LF
+        "3\r\nabcd\r\n0\r\n\r\n",               // data longer than its size
+        "10000000000000000\r\n",                // size overflows
+        "0\r\n\r\r\n",                          // broken end of body
+    };
+    for (const std::string& coded : cases) {
+        ChunkedDecoder decoder(1000);
+        decodeInPieces(decoder, coded, coded.size());
+        EXPECT_TRUE(decoder.failed()) << coded;
+    }
+}
+
+// ❌ Test: body cut off is neither done nor failed
+TEST(ChunkedDecoderTest, Truncated) {
+    ChunkedDecoder decoder(1000);
+    std::string coded = CODED.substr(0, CODED.size() - 3);
+
+    decodeInPieces(decoder, coded, 7);
+    EXPECT_FALSE(decoder.done());
+    EXPECT_FALSE(decoder.failed());
+}
@@ -35,6 +35,136 @@ TEST(ConfigValidationTest, ValidConfig5) {
 	EXPECT_NO_THROW(config.validate("../test/unit/configs_for_testing/cfg5.conf"));
 }
 
+// Test 6: Valid config, CGI worker pool
+TEST(ConfigValidationTest, ValidConfig6) {
+	Config config;
+	EXPECT_NO_THROW(config.validate("../test/unit/configs_for_testing/cfg6.conf"));
+}
+
+// Test 7: Valid config, CGI response cache
+TEST(ConfigValidationTest, ValidConfig7) {
+	Config config;
+	EXPECT_NO_THROW(config.validate("../test/unit/configs_for_testing/cfg7.conf"));
+}
+
+// Test 8: Valid config, types {} overrides
+TEST(ConfigValidationTest, ValidConfig8) {
+	Config config;
+	EXPECT_NO_THROW(config.validate("../test/unit/configs_for_testing/cfg8.conf"));
+	std::vector<Server> servers = config.parse("../test/unit/configs_for_testing/cfg8.conf");
+	ASSERT_EQ(servers.size(), 1u);
+	const router::utils::MimeTypeMap& types = servers[0].getTypes();
+	EXPECT_EQ(types.size(), 3u);
+	EXPECT_EQ(types.at("log"), "text/plain");
+	EXPECT_EQ(types.at("cust"), "application/x-custom");
+	ASSERT_EQ(servers[0].getLocations().size(), 1u);
+}
+
+// Test 9: Valid config, pipeline depth set and defaulted
+TEST(ConfigValidationTest, ValidConfig9) {
+	Config config;
+	EXPECT_NO_THROW(config.validate("../test/unit/configs_for_testing/cfg9.conf"));
+	std::vector<Server> servers = config.parse("../test/unit/configs_for_testing/cfg9.conf");
+	ASSERT_EQ(servers.size(), 2u);
+	EXPECT_EQ(servers[0].getPipelineDepth(), 4u);
+	EXPECT_EQ(servers[1].getPipelineDepth(), static_cast<size_t>(PIPELINE_DEPTH));
+}
+
+// Test 10: Valid config, proxy_pass location with its timeouts
+TEST(ConfigValidationTest, ValidConfig10) {
+	Config config;
+	EXPECT_NO_THROW(config.validate("../test/unit/configs_for_testing/cfg10.conf"));
+	std::vector<Server> servers = config.parse("../test/unit/configs_for_testing/cfg10.conf");
+	ASSERT_EQ(servers.size(), 1u);
+	const Location* api = nullptr;
+	for (const Location& loc : servers[0].getLocations())
+		if (loc.location == "/api")
+			api = &loc;
+	ASSERT_NE(api, nullptr);
+	EXPECT_EQ(api->proxy_pass, "http://127.0.0.1:9000/");
+	EXPECT_EQ(api->proxy_connect_timeout, 2000u);
+	EXPECT_EQ(api->proxy_send_timeout, static_cast<size_t>(PROXY_SEND_TIMEOUT));
+	EXPECT_EQ(api->proxy_read_timeout, 30000u);
+	EXPECT_EQ(api->proxy_keepalive, 8u);
+}
+
+// Test 11: Valid config, upstream block with its balancing policy, health check and backends
+TEST(ConfigValidationTest, ValidConfig11) {
+	Config config;
+	EXPECT_NO_THROW(config.validate("../test/unit/configs_for_testing/cfg11.conf"));
+	std::vector<Server> servers = config.parse("../test/unit/configs_for_testing/cfg11.conf");
+	ASSERT_EQ(servers.size(), 1u);
+	ASSERT_EQ(servers[0].getUpstreams().count("app"), 1u);
+	const Upstream& app = servers[0].getUpstreams().at("app");
+	EXPECT_EQ(app.balance, "hash");
+	EXPECT_EQ(app.hash_key, "uri");
+	ASSERT_EQ(app.servers.size(), 2u);
+	EXPECT_EQ(app.servers[0].port, 9000);
+	EXPECT_EQ(app.servers[0].weight, 3u);
+	EXPECT_EQ(app.servers[0].max_fails, 2u);
+	EXPECT_EQ(app.servers[0].fail_timeout, 5u);
+	EXPECT_EQ(app.servers[1].weight, 1u);
+	EXPECT_EQ(app.servers[1].max_fails, static_cast<size_t>(UPSTREAM_MAX_FAILS));
+	EXPECT_EQ(app.health_path, "/health");
+	EXPECT_EQ(app.health_status, 204);
+	EXPECT_EQ(app.health_interval, 1000u);
+	EXPECT_EQ(app.health_rise, static_cast<size_t>(HEALTH_CHECK_RISE));
+	EXPECT_EQ(app.health_fall, 2u);
+	EXPECT_EQ(servers[0].getLocations().size(), 2u);
+}
+
+// Test 12: Valid config, disk cache of the server used by a proxy and a CGI location
+TEST(ConfigValidationTest, ValidConfig12) {
+	Config config;
+	EXPECT_NO_THROW(config.validate("../test/unit/configs_for_testing/cfg12.conf"));
+	std::vector<Server> servers = config.parse("../test/unit/configs_for_testing/cfg12.conf");
+	ASSERT_EQ(servers.size(), 1u);
+	EXPECT_EQ(servers[0].getCachePath().path, "/tmp/webserv_cache");
+	EXPECT_EQ(servers[0].getCachePath().max_size, 64u);
+	EXPECT_EQ(servers[0].getCachePath().inactive, 120u);
+	std::map<std::string, size_t> ttl;
+	for (const Location& loc : servers[0].getLocations())
+		ttl[loc.location] = loc.proxy_cache;
+	EXPECT_EQ(ttl["/api"], 30u);
+	EXPECT_EQ(ttl[".py"], 5u);
+	EXPECT_EQ(ttl["/"], 0u);
+}
+
+// Test 13: Valid config, stub_status location needing no index
+TEST(ConfigValidationTest, ValidConfig13) {
+	Config config;
+	EXPECT_NO_THROW(config.validate("../test/unit/configs_for_testing/cfg13.conf"));
+	std::vector<Server> servers = config.parse("../test/unit/configs_for_testing/cfg13.conf");
+	ASSERT_EQ(servers.size(), 1u);
+	std::map<std::string, bool> status;
+	for (const Location& loc : servers[0].getLocations())
+		status[loc.location] = loc.stub_status;
+	EXPECT_TRUE(status["/status"]);
+	EXPECT_FALSE(status["/"]);
+}
+
+// Test 14: Valid config, access_log with a log_format holding braces, the default format and log_level
+TEST(ConfigValidationTest, ValidConfig14) {
+	Config config;
+	EXPECT_NO_THROW(config.validate("../test/unit/configs_for_testing/cfg14.conf"));
+	std::vector<Server> servers = config.parse("../test/unit/configs_for_testing/cfg14.conf");
+	ASSERT_EQ(servers.size(), 2u);
+	const AccessLogConfig& access_log = servers[0].getAccessLog();
+	EXPECT_EQ(access_log.path, "/tmp/webserv_access.log");
+	EXPECT_EQ(access_log.format, "timing");
+	EXPECT_EQ(access_log.buffer, 16u);
+	EXPECT_EQ(access_log.flush, 200u);
+	ASSERT_EQ(servers[0].getLogFormats().size(), 2u);
+	const LogFormat& timing = servers[0].getLogFormats().at("timing");
+	EXPECT_EQ(timing.pattern, "{\"uri\":\"$request_uri\",\"status\":$status,\"time\":$request_time}");
+	EXPECT_TRUE(timing.json);
+	EXPECT_FALSE(servers[0].getLogFormats().at("plain").json);
+	EXPECT_EQ(servers[1].getAccessLog().format, "main");
+	EXPECT_EQ(servers[1].getAccessLog().buffer, static_cast<size_t>(ACCESS_LOG_BUFFER));
+	EXPECT_EQ(servers[0].getLogLevel(), "");
+	EXPECT_EQ(servers[1].getLogLevel(), "debug");
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 // Failing tests
@@ -548,3 +678,210 @@ TEST(ConfigValidationTest, MissingLocation) {
 		FAIL() << "Expected std::exception, got a different exception";
 	}
 }
+
+// Test 35: CGI pool larger than allowed
+TEST(ConfigValidationTest, InvalidCgiPool) {
+	Config config;
+	try {
+		config.validate("../test/unit/configs_for_testing/invalid_cgi_pool.conf");
+		FAIL() << "Expected std::exception to be thrown";
+	} catch (const std::exception& e) {
+		EXPECT_STREQ("Error: Config: Invalid value for directive: cgi_pool", e.what());
+	} catch (...) {
+		FAIL() << "Expected std::exception, got a different exception";
+	}
+}
+
+// Test 36: CGI cache lifetime with a unit
+TEST(ConfigValidationTest, InvalidCgiCache) {
+	Config config;
+	try {
+		config.validate("../test/unit/configs_for_testing/invalid_cgi_cache.conf");
+		FAIL() << "Expected std::exception to be thrown";
+	} catch (const std::exception& e) {
+		std::string error_msg = e.what();
+		EXPECT_TRUE(error_msg.find("Error: Config: Malformed directive") != std::string::npos);
+	} catch (...) {
+		FAIL() << "Expected std::exception, got a different exception";
+	}
+}
+
+// Test 37: types {} block outside a server
+TEST(ConfigValidationTest, TypesInsideLocation) {
+	Config config;
+	try {
+		config.validate("../test/unit/configs_for_testing/invalid_types.conf");
+		FAIL() << "Expected std::exception to be thrown";
+	} catch (const std::exception& e) {
+		std::string error_msg = e.what();
+		EXPECT_TRUE(error_msg.find("Error: Config: 'types' block must be inside a 'server' block") != std::string::npos);
+	} catch (...) {
+		FAIL() << "Expected std::exception, got a different exception";
+	}
+}
+
+// Test 38: Pipeline depth out of range
+TEST(ConfigValidationTest, InvalidPipelineDepth) {
+	Config config;
+	try {
+		config.validate("../test/unit/configs_for_testing/invalid_pipeline_depth.conf");
+		FAIL() << "Expected std::exception to be thrown";
+	} catch (const std::exception& e) {
+		EXPECT_STREQ("Error: Config: Invalid value for directive: pipeline_depth", e.what());
+	} catch (...) {
+		FAIL() << "Expected std::exception, got a different exception";
+	}
+}
+
+// Test 39: proxy_pass to anything but http://
+TEST(ConfigValidationTest, InvalidProxyPass) {
+	Config config;
+	try {
+		config.validate("../test/unit/configs_for_testing/invalid_proxy_pass.conf");
+		FAIL() << "Expected std::exception to be thrown";
+	} catch (const std::exception& e) {
+		EXPECT_STREQ("Error: Config: Invalid value for directive: proxy_pass", e.what());
+	} catch (...) {
+		FAIL() << "Expected std::exception, got a different exception";
+	}
+}
+
+// Test 40: upstream server with a weight out of range
+TEST(ConfigValidationTest, InvalidUpstream) {
+	Config config;
+	try {
+		config.validate("../test/unit/configs_for_testing/invalid_upstream.conf");
+		FAIL() << "Expected std::exception to be thrown";
+	} catch (const std::exception& e) {
+		std::string error_msg = e.what();
+		EXPECT_TRUE(error_msg.find("Error: Config: Malformed directive") != std::string::npos);
+	} catch (...) {
+		FAIL() << "Expected std::exception, got a different exception";
+	}
+}
+
+// Test 41: health check expecting a status that does not exist
+TEST(ConfigValidationTest, InvalidHealthCheck) {
+	Config config;
+	try {
+		config.validate("../test/unit/configs_for_testing/invalid_health_check.conf");
+		FAIL() << "Expected std::exception to be thrown";
+	} catch (const std::exception& e) {
+		std::string error_msg = e.what();
+		EXPECT_TRUE(error_msg.find("Error: Config: Malformed directive") != std::string::npos);
+	} catch (...) {
+		FAIL() << "Expected std::exception, got a different exception";
+	}
+}
+
+// Test 42: proxy_cache in a server without proxy_cache_path
+TEST(ConfigValidationTest, InvalidProxyCache) {
+	Config config;
+	try {
+		config.validate("../test/unit/configs_for_testing/invalid_proxy_cache.conf");
+		FAIL() << "Expected std::exception to be thrown";
+	} catch (const std::exception& e) {
+		std::string error_msg = e.what();
+		EXPECT_TRUE(error_msg.find("Error: Config: proxy_cache without proxy_cache_path") != std::string::npos);
+	} catch (...) {
+		FAIL() << "Expected std::exception, got a different exception";
+	}
+}
+
+// Test 43: stub_status neither on nor off
+TEST(ConfigValidationTest, InvalidStubStatus) {
+	Config config;
+	try {
+		config.validate("../test/unit/configs_for_testing/invalid_stub_status.conf");
+		FAIL() << "Expected std::exception to be thrown";
+	} catch (const std::exception& e) {
+		std::string error_msg = e.what();
+		EXPECT_TRUE(error_msg.find("Error: Config: Invalid value for directive: stub_status") != std::string::npos);
+	} catch (...) {
+		FAIL() << "Expected std::exception, got a different exception";
+	}
+}
+
+// Test 44: log_format naming a variable there is no field for
+TEST(ConfigValidationTest, InvalidLogFormat) {
+	Config config;
+	try {
+		config.validate("../test/unit/configs_for_testing/invalid_log_format.conf");
+		FAIL() << "Expected std::exception to be thrown";
+	} catch (const std::exception& e) {
+		std::string error_msg = e.what();
+		EXPECT_TRUE(error_msg.find("Error: Config: Invalid value for directive: log_format") != std::string::npos);
+	} catch (...) {
+		FAIL() << "Expected std::exception, got a different exception";
+	}
+}
+
+// Test 45: access_log naming a format the server does not have
+TEST(ConfigValidationTest, UnknownLogFormat) {
+	Config config;
+	try {
+		config.validate("../test/unit/configs_for_testing/unknown_log_format.conf");
+		FAIL() << "Expected std::exception to be thrown";
+	} catch (const std::exception& e) {
+		std::string error_msg = e.what();
+		EXPECT_TRUE(error_msg.find("Error: Config: Unknown log_format: combined") != std::string::npos);
+	} catch (...) {
+		FAIL() << "Expected std::exception, got a different exception";
+	}
+}
+
+// Test 46: log_level that is not a level
+TEST(ConfigValidationTest, InvalidLogLevel) {
+	Config config;
+	try {
+		config.validate("../test/unit/configs_for_testing/invalid_log_level.conf");
+		FAIL() << "Expected std::exception to be thrown";
+	} catch (const std::exception& e) {
+		std::string error_msg = e.what();
+		EXPECT_TRUE(error_msg.find("Error: Config: Invalid value for directive: log_level") != std::string::npos);
+	} catch (...) {
+		FAIL() << "Expected std::exception, got a different exception";
+	}
+}
+
+// Test 47: cgi_pool_max_requests too large for any counter
+TEST(ConfigValidationTest, InvalidCgiPoolMaxRequests) {
+	Config config;
+	try {
+		config.validate("../test/unit/configs_for_testing/invalid_cgi_pool_max_requests.conf");
+		FAIL() << "Expected std::exception to be thrown";
+	} catch (const std::exception& e) {
+		std::string error_msg = e.what();
+		EXPECT_TRUE(error_msg.find("Error: Config: Invalid value for directive: cgi_pool_max_requests") != std::string::npos);
+	} catch (...) {
+		FAIL() << "Expected std::exception, got a different exception";
+	}
+}
+
+// Test 48: cgi_cache longer than a year
+TEST(ConfigValidationTest, InvalidCgiCacheTtl) {
+	Config config;
+	try {
+		config.validate("../test/unit/configs_for_testing/invalid_cgi_cache_ttl.conf");
+		FAIL() << "Expected std::exception to be thrown";
+	} catch (const std::exception& e) {
+		std::string error_msg = e.what();
+		EXPECT_TRUE(error_msg.find("Error: Config: Invalid value for directive: cgi_cache") != std::string::npos);
+	} catch (...) {
+		FAIL() << "Expected std::exception, got a different exception";
+	}
+}
+
+// Test 49: access_log buffer too large to allocate
+TEST(ConfigValidationTest, InvalidAccessLogBuffer) {
+	Config config;
+	try {
+		config.validate("../test/unit/configs_for_testing/invalid_access_log_buffer.conf");
+		FAIL() << "Expected std::exception to be thrown";
+	} catch (const std::exception& e) {
+		std::string error_msg = e.what();
+		EXPECT_TRUE(error_msg.find("Error: Config: Invalid value for directive: access_log") != std::string::npos);
+	} catch (...) {
+		FAIL() << "Expected std::exception, got a different exception";
+	}
+}
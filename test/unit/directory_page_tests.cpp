@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <unistd.h>
+#include "../src/router/utils/DirectoryPage.hpp"
+
+using router::utils::AutoindexCache;
+using router::utils::DirectoryPage;
+using router::utils::ListingQuery;
+using router::utils::parseListingQuery;
+
+// Utility: directory holding count empty files f0..f(count-1)
+static std::string makeDir(const std::string& name, int count) {
+    std::string dir = std::filesystem::temp_directory_path().string() + "/" + name + "_" + std::to_string(getpid());
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    for (int i = 0; i < count; ++i) {
+        std::ofstream(dir + "/f" + std::to_string(i));
+    }
+    return dir;
+}
+
+// Utility: whole page, rendered in batches of batch entries
+static std::string renderPage(const std::string& dir, const ListingQuery& query, const std::string& templateHtml, size_t batch) {
+    DirectoryPage page(dir, "/d/", query, AutoindexCache::compile(templateHtml));
+    std::string out;
+    while (!page.finished()) {
+        page.renderNext(out, batch);
+    }
+    return out;
+}
+
+// Utility: names and next link of a JSON page
+static std::vector<std::string> jsonNames(const std::string& json, std::string* next = nullptr) {
+    std::vector<std::string> names;
+    for (size_t pos = json.find("\"name\":\""); pos != std::string::npos; pos = json.find("\"name\":\"", pos)) {
+        pos += 8;
+        names.push_back(json.substr(pos, json.find('"', pos) - pos));
+    }
+    if (next) {
+        size_t pos = json.find("\"next\":\"");
+        *next = pos == std::string::npos ? "" : json.substr(pos + 8, json.find('"', pos + 8) - pos - 8);
+    }
+    return names;
+}
+
+// ✅ Test: listing parameters are read, others are ignored
+TEST(DirectoryPageTest, ParsesQuery) {
+    ListingQuery query;
+    ASSERT_TRUE(parseListingQuery("page=3&limit=50&sort=size&order=desc&format=json&x=1", query));
+    EXPECT_TRUE(query.paged);
+    EXPECT_EQ(query.page, 3u);
+    EXPECT_EQ(query.limit, 50u);
+    EXPECT_EQ(query.sort, ListingQuery::SIZE);
+    EXPECT_TRUE(query.descending);
+    EXPECT_TRUE(query.json);
+
+    ASSERT_TRUE(parseListingQuery("cursor=9223372036854775807", query));
+    EXPECT_TRUE(query.hasCursor);
+    EXPECT_EQ(query.cursor, 9223372036854775807LL);
+
+    ASSERT_TRUE(parseListingQuery("name=value", query));
+    EXPECT_FALSE(query.paged);
+}
+
+// ❌ Test: malformed or conflicting parameters
+TEST(DirectoryPageTest, RejectsBadQuery) {
+    ListingQuery query;
+    EXPECT_FALSE(parseListingQuery("page=0", query));
+    EXPECT_FALSE(parseListingQuery("page=abc", query));
+    EXPECT_FALSE(parseListingQuery("limit=0", query));
+    EXPECT_FALSE(parseListingQuery("limit=" + std::to_string(AUTOINDEX_PAGE_MAX + 1), query));
+    EXPECT_FALSE(parseListingQuery("sort=color", query));
+    EXPECT_FALSE(parseListingQuery("format=xml", query));
+    EXPECT_FALSE(parseListingQuery("cursor=99999999999999999999", query));
+    EXPECT_FALSE(parseListingQuery("cursor=5&sort=name", query));
+    EXPECT_FALSE(parseListingQuery("cursor=5&page=2", query));
+}
+
+// ✅ Test: following the cursor visits every entry once, whatever the batch size
+TEST(DirectoryPageTest, CursorWalksWholeDirectory) {
+    std::string dir = makeDir("dirpage_cursor", 250);
+    std::set<std::string> seen;
+    ListingQuery query;
+    ASSERT_TRUE(parseListingQuery("limit=60&format=json", query));
+    int pages = 0;
+    while (true) {
+        std::string next;
+        for (const auto& name : jsonNames(renderPage(dir, query, "", 7), &next)) {
+            EXPECT_TRUE(seen.insert(name).second) << name;
+        }
+        ++pages;
+        if (next.empty()) {
+            break;
+        }
+        ASSERT_TRUE(parseListingQuery(next.substr(next.find('?') + 1), query));
+        ASSERT_TRUE(query.hasCursor);
+    }
+    EXPECT_EQ(seen.size(), 250u);
+    EXPECT_EQ(pages, 5);
+    std::filesystem::remove_all(dir);
+}
+
+// ✅ Test: sorted pages hold the right slice
+TEST(DirectoryPageTest, SortedByName) {
+    std::string dir = makeDir("dirpage_sorted", 30);
+    ListingQuery query;
+    ASSERT_TRUE(parseListingQuery("sort=name&page=2&limit=4&format=json", query));
+    std::string next;
+    std::vector<std::string> names = jsonNames(renderPage(dir, query, "", 3), &next);
+    EXPECT_EQ(names, (std::vector<std::string>{"f12", "f13", "f14", "f15"}));
+    EXPECT_EQ(next, "/d/?page=3&limit=4&sort=name&format=json");
+
+    ASSERT_TRUE(parseListingQuery("sort=name&order=desc&page=8&limit=4&format=json", query));
+    names = jsonNames(renderPage(dir, query, "", 100), &next);
+    EXPECT_EQ(names, (std::vector<std::string>{"f1", "f0"}));
+    EXPECT_EQ(next, "");
+    std::filesystem::remove_all(dir);
+}
+
+// ✅ Test: HTML page uses the template and links the neighbouring pages
+TEST(DirectoryPageTest, HtmlPager) {
+    std::string dir = makeDir("dirpage_html", 5);
+    ListingQuery query;
+    ASSERT_TRUE(parseListingQuery("sort=name&page=2&limit=2", query));
+    std::string html = renderPage(dir, query, "<h1>{{PATH}}</h1>{{ITEMS}}<end>", 1);
+    EXPECT_EQ(html.rfind("<h1>/d/</h1>", 0), 0u);
+    EXPECT_NE(html.find("<a href=\"/d/f2\" class=\"name\">f2</a>"), std::string::npos);
+    EXPECT_EQ(html.find("class=\"name\">f4<"), std::string::npos);
+    EXPECT_NE(html.find("href=\"/d/?page=1&limit=2&sort=name\" class=\"prev-link\""), std::string::npos);
+    EXPECT_NE(html.find("href=\"/d/?page=3&limit=2&sort=name\" class=\"next-link\""), std::string::npos);
+    EXPECT_EQ(html.substr(html.size() - 5), "<end>");
+    std::filesystem::remove_all(dir);
+}
+
+// ✅ Test: names are escaped in JSON
+TEST(DirectoryPageTest, JsonEscapesNames) {
+    std::string dir = makeDir("dirpage_json", 0);
+    std::ofstream(dir + "/a\"b\\c");
+    ListingQuery query;
+    ASSERT_TRUE(parseListingQuery("format=json", query));
+    std::string json = renderPage(dir, query, "", 10);
+    EXPECT_NE(json.find("\"name\":\"a\\\"b\\\\c\",\"type\":\"file\",\"size\":0"), std::string::npos);
+    EXPECT_NE(json.find("],\"next\":null}"), std::string::npos);
+    std::filesystem::remove_all(dir);
+}
+
+// ❌ Test: missing directory
+TEST(DirectoryPageTest, MissingDirectoryThrows) {
+    ListingQuery query;
+    EXPECT_THROW(DirectoryPage("/nonexistent/dirpage", "/d/", query, {}), std::runtime_error);
+}
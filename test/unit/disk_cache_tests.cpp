@@ -0,0 +1,243 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <poll.h>
+#include <unistd.h>
+#include "../src/router/handlers/DiskCache.hpp"
+#include "../src/router/handlers/FileIoPool.hpp"
+#include "../src/router/HttpConstants.hpp"
+#include "../src/server/Server.hpp"
+
+using router::handlers::DiskCache;
+using router::handlers::FileIoPool;
+
+// Utility: fresh cache directory per test
+class DiskCacheTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        _dir = std::filesystem::temp_directory_path() / ("webserv_disk_cache_" + std::to_string(getpid()));
+        std::filesystem::remove_all(_dir);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(_dir);
+    }
+
+    std::string dir() const { return _dir.string(); }
+    const Server& server() const { return _server; }
+
+private:
+    std::filesystem::path _dir;
+    Server _server;
+};
+
+static Request makeRequest(const std::string& path) {
+    Request req;
+    req.setMethod("GET");
+    req.setPath(path);
+    req.setHeaders("host", "example.com");
+    return req;
+}
+
+static Response makeResponse(const std::string& body) {
+    Response res;
+    res.setStatus(http::STATUS_OK_200);
+    res.setHeaders(http::CONTENT_TYPE, "text/plain");
+    res.setHeaders(http::CONTENT_LENGTH, std::to_string(body.size()));
+    res.setBody(body);
+    return res;
+}
+
+// Utility: wait for a job on its descriptor, the way Cluster does
+static void poll(PendingResponse& job) {
+    if (job.fd() < 0)
+        return ;
+    pollfd pfd = {job.fd(), job.events(), 0};
+    if (::poll(&pfd, 1, 1000) > 0)
+        job.onEvent(pfd.revents);
+}
+
+// Utility: send a hit the way Cluster does, returning its head and body
+static std::string drain(PendingResponse& job, Response& head) {
+    for (int i = 0; i < 100 && !job.done() && !job.streaming(); ++i)
+        poll(job);
+    job.finish(head);
+    std::string body;
+    for (int i = 0; i < 100 && !job.done(); ++i) {
+        poll(job);
+        EXPECT_TRUE(job.takeBody(body));
+    }
+    EXPECT_TRUE(job.done());
+    return body;
+}
+
+// ✅ Test: a stored response is served from its file with its headers
+TEST_F(DiskCacheTest, StoreAndHit) {
+    DiskCache cache(dir(), 1 << 20, 600, server());
+    Request req = makeRequest("/items?page=2");
+    Response res;
+    EXPECT_EQ(cache.lookup(req, res), DiskCache::MISS);
+    ASSERT_TRUE(cache.store(DiskCache::key(req), 30, makeResponse("cached body")));
+
+    Response hit;
+    ASSERT_EQ(cache.lookup(req, hit), DiskCache::HIT);
+    ASSERT_NE(hit.getPending(), nullptr);
+    Response head;
+    EXPECT_EQ(drain(*hit.getPending(), head), "cached body");
+    EXPECT_EQ(head.getStatus(), http::STATUS_OK_200);
+    EXPECT_EQ(head.getHeaders(http::CONTENT_TYPE), std::vector<std::string>{"text/plain"});
+    EXPECT_EQ(head.getHeaders(http::CONTENT_LENGTH), std::vector<std::string>{"11"});
+    EXPECT_EQ(head.getHeaders("X-Cache"), std::vector<std::string>{"HIT"});
+
+    EXPECT_EQ(cache.lookup(makeRequest("/items?page=3"), res), DiskCache::MISS);
+    router::handlers::DiskCacheStats stats = cache.stats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 2u);
+    EXPECT_EQ(stats.stores, 1u);
+    EXPECT_EQ(stats.entries, 1u);
+}
+
+// ❌ Test: requests with credentials or asking for a fresh answer never use the cache
+TEST_F(DiskCacheTest, Bypass) {
+    DiskCache cache(dir(), 1 << 20, 600, server());
+    Request req = makeRequest("/");
+    ASSERT_TRUE(cache.store(DiskCache::key(req), 30, makeResponse("shared")));
+
+    Response res;
+    Request cookie = makeRequest("/");
+    cookie.setHeaders("cookie", "session=1");
+    EXPECT_EQ(cache.lookup(cookie, res), DiskCache::BYPASS);
+    Request noCache = makeRequest("/");
+    noCache.setHeaders("cache-control", "no-cache");
+    EXPECT_EQ(cache.lookup(noCache, res), DiskCache::BYPASS);
+    Request post = makeRequest("/");
+    post.setMethod("POST");
+    EXPECT_EQ(cache.lookup(post, res), DiskCache::BYPASS);
+    EXPECT_EQ(res.getPending(), nullptr);
+    EXPECT_EQ(cache.stats().bypasses, 3u);
+}
+
+// ❌ Test: Cache-Control, Expires, Set-Cookie and the status decide what is stored
+TEST_F(DiskCacheTest, Freshness) {
+    DiskCache cache(dir(), 1 << 20, 600, server());
+
+    Response noStore = makeResponse("x");
+    noStore.setHeaders("Cache-Control", "public, no-store");
+    EXPECT_FALSE(cache.store("a", 30, noStore));
+
+    Response cookie = makeResponse("x");
+    cookie.setHeaders("Set-Cookie", "id=1");
+    EXPECT_FALSE(cache.store("b", 30, cookie));
+
+    Response notFound = makeResponse("x");
+    notFound.setStatus(http::STATUS_NOT_FOUND_404);
+    EXPECT_FALSE(cache.store("c", 30, notFound));
+
+    Response past = makeResponse("x");
+    past.setHeaders("Expires", "Thu, 01 Jan 1970 00:00:00 GMT");
+    EXPECT_FALSE(cache.store("d", 30, past));
+
+    // max-age wins over Expires, and over the location default of 0
+    Response maxAge = makeResponse("x");
+    maxAge.setHeaders("Expires", "Thu, 01 Jan 1970 00:00:00 GMT");
+    maxAge.setHeaders("Cache-Control", "max-age=60");
+    EXPECT_TRUE(cache.store("e", 0, maxAge));
+    EXPECT_FALSE(cache.store("f", 0, makeResponse("x")));
+}
+
+// ✅ Test: a new cache on the same directory finds what the previous one stored
+TEST_F(DiskCacheTest, ReloadsIndex) {
+    Request req = makeRequest("/persisted");
+    {
+        DiskCache cache(dir(), 1 << 20, 600, server());
+        ASSERT_TRUE(cache.store(DiskCache::key(req), 30, makeResponse("from the last run")));
+    }
+    DiskCache cache(dir(), 1 << 20, 600, server());
+    EXPECT_EQ(cache.stats().entries, 1u);
+    Response hit;
+    ASSERT_EQ(cache.lookup(req, hit), DiskCache::HIT);
+    Response head;
+    EXPECT_EQ(drain(*hit.getPending(), head), "from the last run");
+}
+
+// ✅ Test: the sweeper evicts the least recently used entries over the size limit
+TEST_F(DiskCacheTest, SweepEvictsLeastRecentlyUsed) {
+    DiskCache cache(dir(), 2500, 600, server());
+    std::string body(1000, 'x');
+    ASSERT_TRUE(cache.store(DiskCache::key(makeRequest("/1")), 30, makeResponse(body)));
+    ASSERT_TRUE(cache.store(DiskCache::key(makeRequest("/2")), 30, makeResponse(body)));
+    Response res;
+    ASSERT_EQ(cache.lookup(makeRequest("/1"), res), DiskCache::HIT);   // /2 is now the oldest
+    ASSERT_TRUE(cache.store(DiskCache::key(makeRequest("/3")), 30, makeResponse(body)));
+    EXPECT_EQ(cache.stats().entries, 3u);
+
+    cache.sweep(std::chrono::steady_clock::now());
+    EXPECT_EQ(cache.stats().entries, 2u);
+    EXPECT_EQ(cache.stats().evictions, 1u);
+    EXPECT_LE(cache.stats().size, 2500u);
+    Response again;
+    EXPECT_EQ(cache.lookup(makeRequest("/2"), again), DiskCache::MISS);
+    EXPECT_EQ(cache.lookup(makeRequest("/1"), again), DiskCache::HIT);
+    EXPECT_EQ(cache.lookup(makeRequest("/3"), again), DiskCache::HIT);
+}
+
+// ✅ Test: with a pool, files are written, read and removed by its threads
+TEST_F(DiskCacheTest, FileIoPool) {
+    FileIoPool pool(1, 16);
+    DiskCache cache(dir(), 2500, 600, server(), &pool);
+    std::string body(1000, 'x');
+    for (const char* path : {"/1", "/2", "/3"}) {
+        ASSERT_TRUE(cache.store(DiskCache::key(makeRequest(path)), 30, makeResponse(body)));
+        // Indexed once the write is done
+        Response res;
+        EXPECT_EQ(cache.lookup(makeRequest(path), res), DiskCache::MISS);
+        for (auto& job : cache.takeJobs()) {
+            for (int i = 0; i < 100 && !job->done(); ++i)
+                poll(*job);
+            ASSERT_TRUE(job->done());
+        }
+    }
+    EXPECT_EQ(cache.stats().stores, 3u);
+
+    Response hit;
+    ASSERT_EQ(cache.lookup(makeRequest("/1"), hit), DiskCache::HIT);
+    // A file being read is not replaced
+    EXPECT_FALSE(cache.store(DiskCache::key(makeRequest("/1")), 30, makeResponse("other")));
+    Response head;
+    EXPECT_EQ(drain(*hit.getPending(), head), body);
+    EXPECT_EQ(head.getHeaders("X-Cache"), std::vector<std::string>{"HIT"});
+
+    cache.sweep(std::chrono::steady_clock::now());
+    EXPECT_EQ(cache.stats().evictions, 1u);
+    std::vector<std::shared_ptr<PendingResponse>> removals = cache.takeJobs();
+    ASSERT_EQ(removals.size(), 1u);
+    for (int i = 0; i < 100 && !removals[0]->done(); ++i)
+        poll(*removals[0]);
+    ASSERT_TRUE(removals[0]->done());
+    size_t files = 0;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(dir()))
+        files += entry.is_regular_file();
+    EXPECT_EQ(files, 2u);
+    Response again;
+    EXPECT_EQ(cache.lookup(makeRequest("/2"), again), DiskCache::MISS);
+}
+
+// ❌ Test: a file removed behind the cache's back answers 500 and is dropped
+TEST_F(DiskCacheTest, MissingFile) {
+    DiskCache cache(dir(), 1 << 20, 600, server());
+    Request req = makeRequest("/gone");
+    ASSERT_TRUE(cache.store(DiskCache::key(req), 30, makeResponse("soon gone")));
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(dir())) {
+        if (entry.is_regular_file())
+            std::filesystem::remove(entry.path());
+    }
+
+    Response hit;
+    ASSERT_EQ(cache.lookup(req, hit), DiskCache::HIT);
+    ASSERT_TRUE(hit.getPending()->done());
+    EXPECT_FALSE(hit.getPending()->streaming());
+    Response res;
+    hit.getPending()->finish(res);
+    EXPECT_EQ(res.getStatus().rfind("500", 0), 0u);
+    EXPECT_EQ(cache.stats().entries, 0u);
+    EXPECT_EQ(cache.lookup(req, res), DiskCache::MISS);
+}
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+#include "../src/router/utils/ErrorPages.hpp"
+#include "../src/router/utils/HttpResponseBuilder.hpp"
+#include "../src/request/Request.hpp"
+#include "../src/response/Response.hpp"
+#include "../src/server/Server.hpp"
+#include "../src/server/HelperFunctions.hpp"
+
+using router::utils::ErrorPages;
+using router::utils::HttpResponseBuilder;
+
+// Utility: server whose root holds a custom 404 page
+static Server makeServer(const std::string& name, const std::string& page) {
+    std::string root = std::filesystem::temp_directory_path().string() + "/" + name + "_" + std::to_string(getpid());
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root + "/errors");
+    std::ofstream(root + "/errors/404.html") << page;
+    Server server;
+    server.setRoot(root);
+    server.setErrorPage(404, "errors/404.html");
+    server.setErrorPage(403, "errors/missing.html");
+    return server;
+}
+
+static Request makeRequest(const std::string& connection) {
+    Request req;
+    req.setHttpVersion("HTTP/1.1");
+    req.setMethod("GET");
+    req.setPath("/");
+    req.setHeaders("connection", connection);
+    return req;
+}
+
+// ✅ Test: custom page is read once, unreadable ones fall back to the default page
+TEST(ErrorPagesTest, CustomPageReadOnce) {
+    Server server = makeServer("error_pages_custom", "<p>gone</p>");
+    server.setErrorPageCache(std::make_shared<const ErrorPages>(server));
+    std::filesystem::remove_all(server.getRoot());
+
+    EXPECT_EQ(HttpResponseBuilder::getErrorPageHtml(404, server), "<p>gone</p>");
+    EXPECT_EQ(HttpResponseBuilder::getErrorPageHtml(403, server), HttpResponseBuilder::makeDefaultErrorPage(403, "Forbidden"));
+}
+
+// ✅ Test: statuses without a page get the 500 one
+TEST(ErrorPagesTest, UnknownStatusFallsBackTo500) {
+    const ErrorPages& pages = *ErrorPages::defaults();
+    EXPECT_TRUE(pages.contains(413));
+    EXPECT_FALSE(pages.contains(418));
+    EXPECT_FALSE(pages.contains(200));
+    EXPECT_EQ(&pages.find(418), &pages.find(500));
+    EXPECT_EQ(pages.find(999).status, "500 Internal Server Error");
+    EXPECT_EQ(HttpResponseBuilder::parseStatusCodeFromString("413 Payload Too Large"), 413);
+    EXPECT_EQ(HttpResponseBuilder::parseStatusCodeFromString("418 I'm a teapot"), 400);
+}
+
+// ✅ Test: attached headers and body match the fields, for either Connection value
+TEST(ErrorPagesTest, SerializedMatchesFields) {
+    Server server = makeServer("error_pages_serialized", "<p>gone</p>");
+    server.setErrorPageCache(std::make_shared<const ErrorPages>(server));
+    for (const std::string connection : {"keep-alive", "close"}) {
+        Response res;
+        HttpResponseBuilder::setErrorResponse(res, 404, makeRequest(connection), server);
+        ASSERT_TRUE(res.getSerialized());
+        EXPECT_EQ(res.getStatus(), "404 Not Found");
+        EXPECT_EQ(res.getBody(), "<p>gone</p>");
+        EXPECT_EQ(res.getHeaders("Connection")[0], connection);
+
+        const std::string& bytes = *res.getSerialized();
+        EXPECT_EQ(bytes, "Content-Type: text/html\r\nContent-Length: 11\r\nConnection: " + connection
+                         + "\r\n\r\n<p>gone</p>");
+
+        std::string wire = responseToString(res);
+        EXPECT_EQ(wire.rfind("HTTP/1.1 404 Not Found\r\nDate: ", 0), 0u);
+        EXPECT_EQ(wire.substr(wire.size() - bytes.size()), bytes);
+    }
+    std::filesystem::remove_all(server.getRoot());
+}
+
+// ✅ Test: a later change drops the attached response
+TEST(ErrorPagesTest, ChangeDropsSerialized) {
+    Response res;
+    HttpResponseBuilder::setErrorResponse(res, 400, makeRequest("close"));
+    ASSERT_TRUE(res.getSerialized());
+    res.setHeaders("Retry-After", "1");
+    EXPECT_FALSE(res.getSerialized());
+    EXPECT_NE(responseToString(res).find("Retry-After: 1\r\n"), std::string::npos);
+
+    Response prefilled;
+    prefilled.setHeaders("Allow", "GET");
+    HttpResponseBuilder::setErrorResponse(prefilled, 405, makeRequest("close"));
+    EXPECT_FALSE(prefilled.getSerialized());
+}
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include <poll.h>
+#include <thread>
+#include "../src/router/handlers/FileIoPool.hpp"
+#include "../src/router/HttpConstants.hpp"
+#include "../src/server/Server.hpp"
+
+using router::handlers::FileIoPool;
+
+// Utility: wait for a job the way Cluster does, through its descriptor
+static bool waitForJob(PendingResponse& job) {
+    for (int i = 0; i < 100 && !job.done(); ++i) {
+        pollfd pfd = {job.fd(), job.events(), 0};
+        if (poll(&pfd, 1, 50) > 0)
+            job.onEvent(pfd.revents);
+    }
+    return job.done();
+}
+
+// ✅ Test: handler runs on a pool thread, response comes back through finish()
+TEST(FileIoPoolTest, RunsOffTheCallingThread) {
+    FileIoPool pool(2, 8);
+    Server server;
+    Request req;
+    std::thread::id caller = std::this_thread::get_id();
+    std::thread::id worker;
+
+    auto job = pool.submit([&worker](const Request&, Response& res, const Server&) {
+        worker = std::this_thread::get_id();
+        res.setStatus(http::STATUS_OK_200);
+        res.setBody("done");
+    }, req, server);
+
+    ASSERT_GE(job->fd(), 0);
+    ASSERT_TRUE(waitForJob(*job));
+    Response res;
+    job->finish(res);
+    EXPECT_EQ(res.getStatus(), http::STATUS_OK_200);
+    EXPECT_EQ(res.getBody(), "done");
+    EXPECT_NE(worker, caller);
+    EXPECT_EQ(pool.stats().completed, 1u);
+}
+
+// ✅ Test: many jobs on few threads all complete
+TEST(FileIoPoolTest, ManyJobs) {
+    FileIoPool pool(3, 100);
+    Server server;
+    Request req;
+    std::vector<std::shared_ptr<PendingResponse>> jobs;
+    for (int i = 0; i < 50; ++i) {
+        jobs.push_back(pool.submit([i](const Request&, Response& res, const Server&) {
+            res.setBody(std::to_string(i));
+        }, req, server));
+    }
+    for (int i = 0; i < 50; ++i) {
+        ASSERT_TRUE(waitForJob(*jobs[i]));
+        Response res;
+        jobs[i]->finish(res);
+        EXPECT_EQ(res.getBody(), std::to_string(i));
+    }
+    EXPECT_EQ(pool.stats().completed, 50u);
+    EXPECT_EQ(pool.stats().queued, 0u);
+}
+
+// ❌ Test: full queue answers 503 without running the handler
+TEST(FileIoPoolTest, QueueFull) {
+    FileIoPool pool(1, 0);
+    Server server;
+    Request req;
+    bool ran = false;
+
+    auto job = pool.submit([&ran](const Request&, Response&, const Server&) { ran = true; }, req, server);
+
+    EXPECT_TRUE(job->done());
+    Response res;
+    job->finish(res);
+    EXPECT_EQ(res.getStatus(), http::STATUS_SERVICE_UNAVAILABLE_503);
+    EXPECT_FALSE(ran);
+    EXPECT_EQ(pool.stats().rejected, 1u);
+}
+
+// ❌ Test: a timed out job answers 504
+TEST(FileIoPoolTest, TimedOut) {
+    FileIoPool pool(1, 8);
+    Server server;
+    Request req;
+
+    auto job = pool.submit([](const Request&, Response&, const Server&) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }, req, server);
+    job->abort(true);
+
+    EXPECT_TRUE(job->done());
+    Response res;
+    job->finish(res);
+    EXPECT_EQ(res.getStatus(), http::STATUS_GATEWAY_TIMEOUT_504);
+}
+
+// ✅ Test: a handler that attaches its own pending job hands over to it
+TEST(FileIoPoolTest, HandsOverToAttachedJob) {
+    FileIoPool pool(1, 8);
+    Server server;
+    Request req;
+
+    auto job = pool.submit([&pool](const Request& req, Response& res, const Server& server) {
+        res.setPending(pool.submit([](const Request&, Response& res, const Server&) {
+            res.setStatus(http::STATUS_OK_200);
+            res.setBody("second");
+        }, req, server));
+    }, req, server);
+
+    ASSERT_TRUE(waitForJob(*job));
+    Response res;
+    job->finish(res);
+    EXPECT_EQ(res.getBody(), "second");
+}
@@ -0,0 +1,226 @@
+#include <gtest/gtest.h>
+#include "../src/http2/Hpack.hpp"
+#include "../src/http2/Session.hpp"
+#include "../src/response/Response.hpp"
+#include "../src/router/HttpConstants.hpp"
+
+using namespace http2;
+
+// Utility: bytes of a hex string
+static std::string fromHex(const std::string& hex) {
+    std::string out;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2)
+        out.push_back(static_cast<char>(std::stoi(hex.substr(i, 2), nullptr, 16)));
+    return out;
+}
+
+// Utility: decode a header block given in hex
+static bool decodeHex(HpackDecoder& decoder, const std::string& hex, HeaderFields& fields) {
+    std::string block = fromHex(hex);
+    fields.clear();
+    return decoder.decode(reinterpret_cast<const uint8_t*>(block.data()), block.size(), fields);
+}
+
+struct Frame {
+    uint8_t type;
+    uint8_t flags;
+    uint32_t stream;
+    std::string payload;
+};
+
+// Utility: split what a session wrote into frames
+static std::vector<Frame> splitFrames(const std::string& out) {
+    std::vector<Frame> frames;
+    for (size_t pos = 0; pos + 9 <= out.size();) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(out.data() + pos);
+        size_t size = (p[0] << 16) | (p[1] << 8) | p[2];
+        uint32_t stream = ((p[5] & 0x7f) << 24) | (p[6] << 16) | (p[7] << 8) | p[8];
+        frames.push_back({p[3], p[4], stream, out.substr(pos + 9, size)});
+        pos += 9 + size;
+    }
+    return frames;
+}
+
+// Utility: frame header followed by the payload
+static std::string frame(uint8_t type, uint8_t flags, uint32_t stream, const std::string& payload) {
+    std::string out;
+    out.push_back(static_cast<char>(payload.size() >> 16));
+    out.push_back(static_cast<char>(payload.size() >> 8));
+    out.push_back(static_cast<char>(payload.size()));
+    out.push_back(static_cast<char>(type));
+    out.push_back(static_cast<char>(flags));
+    out.push_back(static_cast<char>(stream >> 24));
+    out.push_back(static_cast<char>(stream >> 16));
+    out.push_back(static_cast<char>(stream >> 8));
+    out.push_back(static_cast<char>(stream));
+    return out + payload;
+}
+
+// ✅ Test: RFC 7541 C.3, requests without Huffman sharing the dynamic table
+TEST(Http2Test, HpackDecodeRfcRequests) {
+    HpackDecoder decoder(4096);
+    HeaderFields fields;
+
+    ASSERT_TRUE(decodeHex(decoder, "828684410f7777772e6578616d706c652e636f6d", fields));
+    ASSERT_EQ(fields.size(), 4u);
+    EXPECT_EQ(fields[0].name, ":method");
+    EXPECT_EQ(fields[0].value, "GET");
+    EXPECT_EQ(fields[2].value, "/");
+    EXPECT_EQ(fields[3].name, ":authority");
+    EXPECT_EQ(fields[3].value, "www.example.com");
+
+    ASSERT_TRUE(decodeHex(decoder, "828684be58086e6f2d6361636865", fields));
+    ASSERT_EQ(fields.size(), 5u);
+    EXPECT_EQ(fields[3].value, "www.example.com");
+    EXPECT_EQ(fields[4].name, "cache-control");
+    EXPECT_EQ(fields[4].value, "no-cache");
+}
+
+// ✅ Test: RFC 7541 C.4.1, Huffman-coded literal
+TEST(Http2Test, HpackDecodeRfcHuffman) {
+    HpackDecoder decoder(4096);
+    HeaderFields fields;
+
+    ASSERT_TRUE(decodeHex(decoder, "828684418cf1e3c2e5f23a6ba0ab90f4ff", fields));
+    ASSERT_EQ(fields.size(), 4u);
+    EXPECT_EQ(fields[0].value, "GET");
+    EXPECT_EQ(fields[1].value, "http");
+    EXPECT_EQ(fields[2].value, "/");
+    EXPECT_EQ(fields[3].value, "www.example.com");
+}
+
+// ✅ Test: index past the table and truncated blocks are compression errors
+TEST(Http2Test, HpackDecodeErrors) {
+    HpackDecoder decoder(4096);
+    HeaderFields fields;
+
+    EXPECT_FALSE(decodeHex(decoder, "ff00", fields));
+    EXPECT_FALSE(decodeHex(decoder, "410f7777", fields));
+    EXPECT_FALSE(decodeHex(decoder, "80", fields));
+}
+
+// ✅ Test: Huffman coding round-trips, sizes agree
+TEST(Http2Test, HuffmanRoundTrip) {
+    std::string all;
+    for (int c = 0; c < 256; ++c)
+        all.push_back(static_cast<char>(c));
+
+    for (const std::string& str : {std::string("www.example.com"), std::string("no-cache"), all, std::string()}) {
+        std::string coded;
+        huffmanEncode(coded, str);
+        EXPECT_EQ(coded.size(), huffmanEncodedSize(str));
+        std::string decoded;
+        ASSERT_TRUE(huffmanDecode(reinterpret_cast<const uint8_t*>(coded.data()), coded.size(), decoded));
+        EXPECT_EQ(decoded, str);
+    }
+    EXPECT_EQ(fromHex("f1e3c2e5f23a6ba0ab90f4ff").size(), huffmanEncodedSize("www.example.com"));
+}
+
+// ✅ Test: encoder and decoder stay in step, repeated fields shrink to an index
+TEST(Http2Test, HpackEncoderRoundTrip) {
+    HpackEncoder encoder;
+    HpackDecoder decoder(4096);
+    size_t sizes[2];
+
+    for (int round = 0; round < 2; ++round) {
+        std::string block;
+        encoder.encode(block, ":status", "200");
+        encoder.encode(block, "content-type", "text/html");
+        encoder.encode(block, "server", "webserv/1.0");
+        encoder.encode(block, "content-length", std::to_string(1000 + round));
+        sizes[round] = block.size();
+
+        HeaderFields fields;
+        ASSERT_TRUE(decoder.decode(reinterpret_cast<const uint8_t*>(block.data()), block.size(), fields));
+        ASSERT_EQ(fields.size(), 4u);
+        EXPECT_EQ(fields[1].value, "text/html");
+        EXPECT_EQ(fields[2].value, "webserv/1.0");
+        EXPECT_EQ(fields[3].value, std::to_string(1000 + round));
+    }
+    EXPECT_LT(sizes[1], sizes[0]);
+}
+
+// ✅ Test: preface, SETTINGS and HEADERS give a request, its response leaves as HEADERS and DATA
+TEST(Http2Test, SessionRequestResponse) {
+    Session session(4);
+    std::vector<Frame> greeting = splitFrames(session.output());
+    ASSERT_FALSE(greeting.empty());
+    EXPECT_EQ(greeting[0].type, 0x4);
+    session.output().clear();
+
+    std::string in(PREFACE);
+    in += frame(0x4, 0, 0, "");
+    in += frame(0x1, 0x5, 1, fromHex("828684418cf1e3c2e5f23a6ba0ab90f4ff"));
+    session.feed(in);
+    EXPECT_TRUE(in.empty());
+
+    StreamEvent event;
+    ASSERT_TRUE(session.nextEvent(event));
+    EXPECT_EQ(event.type, StreamEvent::REQUEST);
+    EXPECT_EQ(event.stream, 1u);
+    EXPECT_TRUE(event.end);
+    EXPECT_EQ(event.request.getMethod(), "GET");
+    EXPECT_EQ(event.request.getPath(), "/");
+    ASSERT_FALSE(event.request.getHeaders("host").empty());
+    EXPECT_EQ(event.request.getHeaders("host")[0], "www.example.com");
+    EXPECT_FALSE(session.nextEvent(event));
+
+    Response res;
+    res.setStatus(http::STATUS_OK_200);
+    res.setHeaders("Content-Type", "text/plain");
+    res.setHeaders("Connection", "keep-alive");
+    res.setBody("hello");
+    session.respond(1, res, false);
+
+    std::vector<Frame> frames = splitFrames(session.output());
+    bool ack = false;
+    const Frame* headers = nullptr;
+    const Frame* data = nullptr;
+    for (const Frame& f : frames) {
+        if (f.type == 0x4 && f.flags == 0x1)
+            ack = true;
+        if (f.type == 0x1)
+            headers = &f;
+        if (f.type == 0x0)
+            data = &f;
+    }
+    EXPECT_TRUE(ack);
+    ASSERT_NE(headers, nullptr);
+    ASSERT_NE(data, nullptr);
+    EXPECT_EQ(headers->stream, 1u);
+    EXPECT_EQ(data->payload, "hello");
+    EXPECT_EQ(data->flags & 0x1, 0x1);
+
+    HpackDecoder decoder(4096);
+    HeaderFields fields;
+    ASSERT_TRUE(decoder.decode(reinterpret_cast<const uint8_t*>(headers->payload.data()), headers->payload.size(), fields));
+    ASSERT_FALSE(fields.empty());
+    EXPECT_EQ(fields[0].name, ":status");
+    EXPECT_EQ(fields[0].value, "200");
+    for (const HeaderField& field : fields)
+        EXPECT_NE(field.name, "connection");
+}
+
+// ✅ Test: streams past the limit are refused, a bad preface ends the connection
+TEST(Http2Test, SessionLimits) {
+    Session session(1);
+    session.output().clear();
+
+    std::string in(PREFACE);
+    in += frame(0x4, 0, 0, "");
+    in += frame(0x1, 0x5, 1, fromHex("828684418cf1e3c2e5f23a6ba0ab90f4ff"));
+    in += frame(0x1, 0x5, 3, fromHex("828684be"));
+    session.feed(in);
+
+    bool refused = false;
+    for (const Frame& f : splitFrames(session.output()))
+        if (f.type == 0x3 && f.stream == 3 && f.payload == std::string("\0\0\0\x07", 4))
+            refused = true;
+    EXPECT_TRUE(refused);
+    EXPECT_FALSE(session.closing());
+
+    Session bad(1);
+    std::string garbage = "GET / HTTP/1.1\r\n\r\n";
+    bad.feed(garbage);
+    EXPECT_TRUE(bad.closing());
+}
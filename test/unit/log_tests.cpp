@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include <regex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "../src/server/Log.hpp"
+
+// Utility: counts how often a message was built
+static int built = 0;
+static std::string message(const std::string& text) {
+    ++built;
+    return text;
+}
+
+// Utility: restores the default level after each test
+class LogTest : public ::testing::Test {
+protected:
+    void SetUp() override { built = 0; }
+    void TearDown() override { Log::setLevel(Log::INFO); }
+};
+
+// ✅ Test: level names round-trip, from the most severe to the most verbose
+TEST_F(LogTest, Parse) {
+    Log::Level level = Log::INFO;
+    EXPECT_TRUE(Log::parse("trace", level));
+    EXPECT_EQ(level, Log::TRACE);
+    EXPECT_TRUE(Log::parse("error", level));
+    EXPECT_EQ(level, Log::ERROR);
+    EXPECT_STREQ(Log::name(Log::WARN), "warn");
+    EXPECT_LT(Log::ERROR, Log::DEBUG);
+}
+
+// ❌ Test: unknown names are refused and leave the level alone
+TEST_F(LogTest, ParseUnknown) {
+    Log::Level level = Log::WARN;
+    EXPECT_FALSE(Log::parse("verbose", level));
+    EXPECT_FALSE(Log::parse("INFO", level));
+    EXPECT_EQ(level, Log::WARN);
+}
+
+// ✅ Test: below the level a message is not even built
+TEST_F(LogTest, Filtered) {
+    testing::internal::CaptureStdout();
+    LOG_DEBUG(message("hidden"));
+    LOG_TRACE(message("hidden"));
+    LOG_INFO(message("shown ") << 42);
+    std::string out = testing::internal::GetCapturedStdout();
+    EXPECT_EQ(built, 1);
+    EXPECT_EQ(out.find("hidden"), std::string::npos);
+    EXPECT_NE(out.find("shown 42"), std::string::npos);
+}
+
+// ✅ Test: the level set at runtime lets debug sites through, in builds that keep them
+TEST_F(LogTest, RuntimeLevel) {
+    Log::setLevel(Log::DEBUG);
+    EXPECT_TRUE(Log::enabled(Log::DEBUG));
+    EXPECT_FALSE(Log::enabled(Log::TRACE));
+    testing::internal::CaptureStdout();
+    LOG_DEBUG(message("client ") << 7);
+    LOG_TRACE(message("hidden"));
+    std::string out = testing::internal::GetCapturedStdout();
+    EXPECT_EQ(built, LOG_MAX_LEVEL >= LOG_LEVEL_DEBUG ? 1 : 0);
+    if (LOG_MAX_LEVEL >= LOG_LEVEL_DEBUG)
+        EXPECT_NE(out.find("client 7\n"), std::string::npos);
+    EXPECT_EQ(out.find("hidden"), std::string::npos);
+}
+
+// ✅ Test: errors are always logged
+TEST_F(LogTest, Errors) {
+    Log::setLevel(Log::ERROR);
+    testing::internal::CaptureStdout();
+    LOG_WARN(message("hidden"));
+    LOG_ERROR(message("failed"));
+    std::string out = testing::internal::GetCapturedStdout();
+    EXPECT_EQ(built, 1);
+    EXPECT_NE(out.find("failed"), std::string::npos);
+}
+
+// ✅ Test: lines from several threads each carry a whole timestamp and stay whole
+TEST_F(LogTest, Threads) {
+    Log::setLevel(Log::DEBUG);
+    testing::internal::CaptureStdout();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([t]() {
+            for (int i = 0; i < 50; ++i)
+                Log::write(Log::DEBUG, "thread " + std::to_string(t) + " line " + std::to_string(i));
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    std::string out = testing::internal::GetCapturedStdout();
+
+    std::istringstream lines(out);
+    std::string line;
+    int count = 0;
+    const std::regex format(R"(\[\d{4}-\d{2}-\d{2} \d{2}:\d{2}:\d{2}\]\tthread \d line \d+)");
+    while (std::getline(lines, line)) {
+        EXPECT_TRUE(std::regex_match(line, format)) << line;
+        ++count;
+    }
+    EXPECT_EQ(count, 200);
+}
@@ -0,0 +1,230 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include "../src/server/Metrics.hpp"
+#include "../src/server/Histogram.hpp"
+#include "../src/router/handlers/Status.hpp"
+
+using router::handlers::StatusReport;
+
+// Utility: trace of a request whose handler started ms milliseconds ago
+static RequestTrace makeTrace(int server, const std::string* route, int ms) {
+    RequestTrace trace;
+    trace.server = server;
+    trace.route = route;
+    trace.handler = "static";
+    trace.receive = 300;
+    trace.start = std::chrono::steady_clock::now() - std::chrono::milliseconds(ms);
+    return trace;
+}
+
+// ✅ Test: percentiles are exact below 16 µs and within a bucket (1/16) above
+TEST(HistogramTest, Percentiles) {
+    Histogram histogram;
+    EXPECT_EQ(histogram.percentile(0.5), 0u);
+    for (uint64_t value = 1; value <= 10; ++value)
+        histogram.record(value);
+    EXPECT_EQ(histogram.percentile(0.5), 5u);
+    EXPECT_EQ(histogram.percentile(0.9), 9u);
+    EXPECT_EQ(histogram.percentile(1), 10u);
+
+    Histogram wide;
+    for (uint64_t value = 1; value <= 100000; ++value)
+        wide.record(value);
+    EXPECT_EQ(wide.count(), 100000u);
+    EXPECT_EQ(wide.max(), 100000u);
+    EXPECT_GE(wide.percentile(0.5), 50000u);
+    EXPECT_LE(wide.percentile(0.5), 50000u + 50000u / 16);
+    EXPECT_GE(wide.percentile(0.99), 99000u);
+    EXPECT_LE(wide.percentile(0.999), 100000u);
+}
+
+// ✅ Test: one slow request shows in p999 and max, not in p50
+TEST(HistogramTest, Tail) {
+    Histogram histogram;
+    for (int i = 0; i < 999; ++i)
+        histogram.record(100);
+    histogram.record(2000000);
+    EXPECT_LE(histogram.percentile(0.5), 103u);
+    EXPECT_LE(histogram.percentile(0.99), 103u);
+    EXPECT_LE(histogram.percentile(0.999), 103u);
+    histogram.record(2000000);
+    EXPECT_GE(histogram.percentile(0.999), 2000000u - 2000000u / 16);
+    EXPECT_EQ(histogram.max(), 2000000u);
+}
+
+// ✅ Test: connections, bytes, statuses and locations are counted
+TEST(MetricsTest, Counters) {
+    Metrics metrics;
+    const std::string api = "/api";
+    metrics.nameServer(0, "test:8080");
+    metrics.accepted();
+    metrics.accepted();
+    metrics.handled();
+    metrics.received(100);
+    metrics.sent(250);
+    metrics.response("200 OK", makeTrace(0, &api, 5));
+    metrics.response("200 OK", makeTrace(0, &api, 1));
+    metrics.response("404 Not Found", makeTrace(0, nullptr, 1));
+    metrics.response("408 Request Timeout", RequestTrace());
+
+    MetricsSnapshot snapshot = metrics.snapshot();
+    EXPECT_EQ(snapshot.accepted, 2u);
+    EXPECT_EQ(snapshot.handled, 1u);
+    EXPECT_EQ(snapshot.requests, 4u);
+    EXPECT_EQ(snapshot.bytes_in, 100u);
+    EXPECT_EQ(snapshot.bytes_out, 250u);
+    EXPECT_EQ(snapshot.statuses, (std::map<int, uint64_t>{{200, 2}, {404, 1}, {408, 1}}));
+
+    // Only requests a location handled have latencies
+    ASSERT_EQ(snapshot.locations.size(), 1u);
+    EXPECT_EQ(snapshot.locations[0].server, "test:8080");
+    EXPECT_EQ(snapshot.locations[0].location, "/api");
+    EXPECT_EQ(snapshot.locations[0].handler, "static");
+    EXPECT_EQ(snapshot.locations[0].requests, 2u);
+    EXPECT_GE(snapshot.locations[0].handle.max, 5000u);
+    EXPECT_GE(snapshot.locations[0].handle.sum, 6000u);
+    EXPECT_EQ(snapshot.locations[0].receive.count, 2u);
+    EXPECT_EQ(snapshot.locations[0].receive.p50, 300u);
+}
+
+// ✅ Test: the send phase runs from the response head to the last byte out
+TEST(MetricsTest, SendPhase) {
+    Metrics metrics;
+    const std::string root = "/";
+    RequestTrace trace = makeTrace(0, &root, 5);
+    trace.head = std::chrono::steady_clock::now() - std::chrono::milliseconds(3);
+    metrics.response("200 OK", trace);
+    metrics.delivered(trace);
+
+    MetricsSnapshot snapshot = metrics.snapshot();
+    ASSERT_EQ(snapshot.locations.size(), 1u);
+    EXPECT_EQ(snapshot.locations[0].send.count, 1u);
+    EXPECT_GE(snapshot.locations[0].send.p50, 3000u);
+    EXPECT_LE(snapshot.locations[0].handle.max, snapshot.locations[0].send.max);
+}
+
+// ✅ Test: connection states come from the counter the event loop sets
+TEST(MetricsTest, ConnectionCounter) {
+    Metrics metrics;
+    EXPECT_EQ(metrics.snapshot().connections.active, 0u);
+    metrics.setConnectionCounter([]() {
+        ConnectionCounts counts;
+        counts.active = 3;
+        counts.reading = 1;
+        counts.writing = 1;
+        counts.idle = 1;
+        return counts;
+    });
+    ConnectionCounts counts = metrics.snapshot().connections;
+    EXPECT_EQ(counts.active, 3u);
+    EXPECT_EQ(counts.reading + counts.writing + counts.idle, 3u);
+}
+
+// ✅ Test: requests per second only counts whole seconds of the window
+TEST(MetricsTest, RequestsPerSecond) {
+    Metrics metrics;
+    for (int i = 0; i < 20; ++i)
+        metrics.response("200 OK", RequestTrace());
+    EXPECT_LE(metrics.snapshot().requests_per_second, 20.0 / METRICS_RATE_WINDOW);
+
+    // Once the second is over it is part of the window
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    EXPECT_DOUBLE_EQ(metrics.snapshot().requests_per_second, 20.0 / METRICS_RATE_WINDOW);
+}
+
+// ✅ Test: the text report starts like nginx's stub_status
+TEST(MetricsTest, RenderText) {
+    StatusReport report;
+    report.metrics.connections.active = 2;
+    report.metrics.connections.writing = 1;
+    report.metrics.connections.idle = 1;
+    report.metrics.accepted = 7;
+    report.metrics.handled = 7;
+    report.metrics.requests = 12;
+    report.metrics.statuses[200] = 12;
+
+    std::string text = router::handlers::renderStatusText(report);
+    EXPECT_EQ(text.find("Active connections: 2\n"
+                        "server accepts handled requests\n"
+                        " 7 7 12\n"
+                        "Reading: 0 Writing: 1 Waiting: 1\n"), 0u);
+    EXPECT_NE(text.find("Status 200: 12\n"), std::string::npos);
+}
+
+// ✅ Test: the Prometheus report has typed families and escaped labels
+TEST(MetricsTest, RenderPrometheus) {
+    StatusReport report;
+    report.metrics.requests = 3;
+    report.metrics.statuses[503] = 3;
+    LocationMetrics location;
+    location.server = "test:8080";
+    location.location = "/a\"b";
+    location.handler = "cgi";
+    location.requests = 3;
+    location.handle.count = 3;
+    location.handle.sum = 1500000;
+    location.handle.p99 = 900000;
+    report.metrics.locations.push_back(location);
+    report.cache.hits = 4;
+
+    std::string text = router::handlers::renderStatusPrometheus(report);
+    EXPECT_NE(text.find("# TYPE webserv_requests_total counter\nwebserv_requests_total 3\n"), std::string::npos);
+    EXPECT_NE(text.find("webserv_responses_total{status=\"503\"} 3\n"), std::string::npos);
+    EXPECT_NE(text.find("webserv_location_requests_total{server=\"test:8080\",location=\"/a\\\"b\",handler=\"cgi\"} 3\n"),
+              std::string::npos);
+    const std::string labels = "{server=\"test:8080\",location=\"/a\\\"b\",handler=\"cgi\",phase=\"handle\"";
+    EXPECT_NE(text.find("webserv_request_duration_seconds" + labels + ",quantile=\"0.99\"} 0.900000\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("webserv_request_duration_seconds_sum" + labels + "} 1.500000\n"), std::string::npos);
+    EXPECT_NE(text.find("webserv_request_duration_seconds_count" + labels + "} 3\n"), std::string::npos);
+    EXPECT_NE(text.find("webserv_disk_cache_lookups_total{result=\"hit\"} 4\n"), std::string::npos);
+}
+
+// ✅ Test: file I/O queue and run times in both reports
+TEST(MetricsTest, RenderFileIoTimes) {
+    StatusReport report;
+    report.fileIo.waitTotal = 1500;
+    report.fileIo.waitMax = 900;
+    report.fileIo.runTotal = 2500000;
+    report.fileIo.runMax = 2000000;
+
+    std::string text = router::handlers::renderStatusText(report);
+    EXPECT_NE(text.find("  wait total 1500us max 900us run total 2500000us max 2000000us\n"), std::string::npos);
+
+    std::string metrics = router::handlers::renderStatusPrometheus(report);
+    EXPECT_NE(metrics.find("webserv_file_io_wait_seconds_sum 0.001500\n"), std::string::npos);
+    EXPECT_NE(metrics.find("webserv_file_io_run_seconds_max 2.000000\n"), std::string::npos);
+}
+
+// ✅ Test: upstream backends in both reports, probe figures only for checked groups
+TEST(MetricsTest, RenderUpstreams) {
+    StatusReport report;
+    router::handlers::BackendStatus checked;
+    checked.upstream = "0/app";
+    checked.backend = "127.0.0.1:9001";
+    checked.checked = true;
+    checked.latency = 1200;
+    checked.probes = 5;
+    checked.probeFailures = 2;
+    report.upstreams.push_back(checked);
+    router::handlers::BackendStatus down;
+    down.upstream = "127.0.0.1:9002";
+    down.backend = "127.0.0.1:9002";
+    down.up = false;
+    down.fails = 3;
+    report.upstreams.push_back(down);
+
+    std::string text = router::handlers::renderStatusText(report);
+    EXPECT_NE(text.find("Upstream 0/app 127.0.0.1:9001: up active 0 fails 0 probes 5 failed 2 latency 1200us\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("Upstream 127.0.0.1:9002 127.0.0.1:9002: down active 0 fails 3\n"), std::string::npos);
+
+    std::string metrics = router::handlers::renderStatusPrometheus(report);
+    const std::string labels = "{upstream=\"0/app\",backend=\"127.0.0.1:9001\"";
+    EXPECT_NE(metrics.find("webserv_upstream_backend_up" + labels + "} 1\n"), std::string::npos);
+    EXPECT_NE(metrics.find("webserv_upstream_probes_total" + labels + ",result=\"failed\"} 2\n"), std::string::npos);
+    EXPECT_NE(metrics.find("webserv_upstream_probe_latency_seconds" + labels + "} 0.001200\n"), std::string::npos);
+    EXPECT_NE(metrics.find("webserv_upstream_backend_up{upstream=\"127.0.0.1:9002\",backend=\"127.0.0.1:9002\"} 0\n"),
+              std::string::npos);
+    EXPECT_EQ(metrics.find("webserv_upstream_probe_latency_seconds{upstream=\"127.0.0.1:9002\""), std::string::npos);
+}
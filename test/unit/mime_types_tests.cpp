@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+#include "../src/router/utils/MimeTypes.hpp"
+#include "../src/router/utils/FileUtils.hpp"
+#include "../src/server/Server.hpp"
+
+using router::utils::MimeTypeMap;
+using router::utils::builtinMimeType;
+using router::utils::fileExtension;
+using router::utils::mimeTypeFor;
+
+// ✅ Test: built-in types, any case
+TEST(MimeTypesTest, BuiltinTypes) {
+    EXPECT_EQ(builtinMimeType("html"), "text/html");
+    EXPECT_EQ(builtinMimeType("JS"), "application/javascript");
+    EXPECT_EQ(builtinMimeType("woff2"), "font/woff2");
+    EXPECT_EQ(builtinMimeType("WebP"), "image/webp");
+    EXPECT_EQ(builtinMimeType("avif"), "image/avif");
+    EXPECT_EQ(builtinMimeType("wasm"), "application/wasm");
+    EXPECT_EQ(builtinMimeType("webm"), "video/webm");
+    EXPECT_EQ(builtinMimeType("webmanifest"), "application/manifest+json");
+    EXPECT_EQ(builtinMimeType("htmx"), "");
+    EXPECT_EQ(builtinMimeType(std::string_view("htm\0", 4)), "");
+    EXPECT_EQ(builtinMimeType(""), "");
+}
+
+// ✅ Test: extension of the last path segment only
+TEST(MimeTypesTest, FileExtension) {
+    EXPECT_EQ(fileExtension("/www/index.html"), "html");
+    EXPECT_EQ(fileExtension("archive.tar.gz"), "gz");
+    EXPECT_EQ(fileExtension("/dir.d/README"), "");
+    EXPECT_EQ(fileExtension("/home/.bashrc"), "");
+    EXPECT_EQ(fileExtension("/a/b."), "");
+}
+
+// ✅ Test: overrides win, unknown extensions are binary
+TEST(MimeTypesTest, Overrides) {
+    MimeTypeMap overrides = {{"log", "text/x-log"}, {"html", "text/html; charset=utf-8"}};
+    EXPECT_EQ(mimeTypeFor("/var/app.LOG", &overrides), "text/x-log");
+    EXPECT_EQ(mimeTypeFor("/index.HTML", &overrides), "text/html; charset=utf-8");
+    EXPECT_EQ(mimeTypeFor("/style.css", &overrides), "text/css");
+    EXPECT_EQ(mimeTypeFor("/blob.unknown", &overrides), "application/octet-stream");
+    EXPECT_EQ(mimeTypeFor("/noext"), "application/octet-stream");
+
+    Server server;
+    server.setType("cust", "text/x-custom");
+    EXPECT_EQ(router::utils::FileUtils::getContentType("/x/y.cust", server), "text/x-custom");
+    EXPECT_EQ(router::utils::FileUtils::getContentType("/x/y.cust"), "application/octet-stream");
+}
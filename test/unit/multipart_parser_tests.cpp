@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include "../src/router/handlers/MultipartParser.hpp"
+
+using router::handlers::MultipartParser;
+
+// Utility: records what the parser reports, one entry per part
+struct Recorder {
+    std::vector<MultipartParser::Part> parts;
+    std::vector<std::string> data;
+    int ended = 0;
+
+    MultipartParser parser(const std::string& boundary) {
+        return MultipartParser(boundary,
+            [this](const MultipartParser::Part& part) { parts.push_back(part); data.emplace_back(); return true; },
+            [this](const char* bytes, size_t size) { data.back().append(bytes, size); return true; },
+            [this]() { ++ended; return true; });
+    }
+};
+
+static const std::string BODY =
+    "--XyZ\r\n"
+    "Content-Disposition: form-data; name=\"title\"\r\n"
+    "\r\n"
+    "hello\r\n"
+    "--XyZ\r\n"
+    "Content-Disposition: form-data; name=\"file\"; filename=\"a.txt\"\r\n"
+    "Content-Type: text/plain\r\n"
+    "\r\n"
+    "line one\r\n--XyQ not a delimiter\r\n"
+    "--XyZ--\r\n";
+
+// ✅ Test: whole body in one piece
+TEST(MultipartParserTest, SingleFeed) {
+    Recorder rec;
+    MultipartParser parser = rec.parser("--XyZ");
+
+    EXPECT_TRUE(parser.feed(BODY.data(), BODY.size()));
+    EXPECT_TRUE(parser.complete());
+    ASSERT_EQ(rec.parts.size(), 2u);
+    EXPECT_EQ(rec.ended, 2);
+    EXPECT_EQ(rec.parts[0].name, "title");
+    EXPECT_EQ(rec.parts[0].filename, "");
+    EXPECT_EQ(rec.data[0], "hello");
+    EXPECT_EQ(rec.parts[1].name, "file");
+    EXPECT_EQ(rec.parts[1].filename, "a.txt");
+    EXPECT_EQ(rec.parts[1].contentType, "text/plain");
+    EXPECT_EQ(rec.data[1], "line one\r\n--XyQ not a delimiter");
+}
+
+// ✅ Test: body fed one byte at a time, delimiters split across calls
+TEST(MultipartParserTest, ByteByByte) {
+    Recorder rec;
+    MultipartParser parser = rec.parser("--XyZ");
+
+    for (char c : BODY) {
+        ASSERT_TRUE(parser.feed(&c, 1));
+    }
+    EXPECT_TRUE(parser.complete());
+    ASSERT_EQ(rec.parts.size(), 2u);
+    EXPECT_EQ(rec.data[0], "hello");
+    EXPECT_EQ(rec.data[1], "line one\r\n--XyQ not a delimiter");
+}
+
+// ✅ Test: preamble before the first delimiter and an empty part
+TEST(MultipartParserTest, PreambleAndEmptyPart) {
+    Recorder rec;
+    MultipartParser parser = rec.parser("--b");
+    std::string body =
+        "ignored preamble\r\n"
+        "--b\r\n"
+        "Content-Disposition: form-data; name=\"empty\"\r\n"
+        "\r\n"
+        "\r\n"
+        "--b--";
+
+    EXPECT_TRUE(parser.feed(body.data(), body.size()));
+    EXPECT_TRUE(parser.complete());
+    ASSERT_EQ(rec.parts.size(), 1u);
+    EXPECT_EQ(rec.parts[0].name, "empty");
+    EXPECT_EQ(rec.data[0], "");
+}
+
+// ✅ Test: batch of file parts, each reported separately
+TEST(MultipartParserTest, ManyFiles) {
+    Recorder rec;
+    MultipartParser parser = rec.parser("--batch");
+    std::string body;
+    for (int i = 0; i < 50; ++i) {
+        body += "--batch\r\n"
+                "Content-Disposition: form-data; name=\"files\"; filename=\"f" + std::to_string(i) + ".bin\"\r\n"
+                "\r\n" + std::string(i * 100, 'a' + i % 26) + "\r\n";
+    }
+    body += "--batch--\r\n";
+
+    for (size_t pos = 0; pos < body.size(); pos += 777) {
+        ASSERT_TRUE(parser.feed(body.data() + pos, std::min<size_t>(777, body.size() - pos)));
+    }
+    EXPECT_TRUE(parser.complete());
+    ASSERT_EQ(rec.parts.size(), 50u);
+    EXPECT_EQ(rec.ended, 50);
+    for (int i = 0; i < 50; ++i) {
+        EXPECT_EQ(rec.parts[i].filename, "f" + std::to_string(i) + ".bin");
+        EXPECT_EQ(rec.data[i], std::string(i * 100, 'a' + i % 26));
+    }
+}
+
+// ❌ Test: body cut off before the closing delimiter
+TEST(MultipartParserTest, Truncated) {
+    Recorder rec;
+    MultipartParser parser = rec.parser("--XyZ");
+    std::string body = BODY.substr(0, BODY.size() - 10);
+
+    EXPECT_TRUE(parser.feed(body.data(), body.size()));
+    EXPECT_FALSE(parser.complete());
+    EXPECT_FALSE(parser.failed());
+}
+
+// ❌ Test: garbage after a delimiter
+TEST(MultipartParserTest, GarbageAfterDelimiter) {
+    Recorder rec;
+    MultipartParser parser = rec.parser("--XyZ");
+    std::string body = "--XyZgarbage\r\n\r\n";
+
+    EXPECT_FALSE(parser.feed(body.data(), body.size()));
+    EXPECT_TRUE(parser.failed());
+}
+
+// ❌ Test: a callback stops the parser
+TEST(MultipartParserTest, CallbackRefuses) {
+    MultipartParser parser("--XyZ",
+        [](const MultipartParser::Part&) { return false; },
+        [](const char*, size_t) { return true; },
+        []() { return true; });
+
+    EXPECT_FALSE(parser.feed(BODY.data(), BODY.size()));
+    EXPECT_TRUE(parser.failed());
+    EXPECT_FALSE(parser.complete());
+}
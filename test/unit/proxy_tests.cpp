@@ -0,0 +1,332 @@
+#include <gtest/gtest.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "../src/router/handlers/Proxy.hpp"
+#include "../src/router/handlers/HealthCheck.hpp"
+#include "../src/router/HttpConstants.hpp"
+#include "../src/parser/Parser.hpp"
+#include "../src/server/Server.hpp"
+
+using router::handlers::ProxyJob;
+using router::handlers::ProxyTarget;
+using router::handlers::UpstreamGroup;
+using router::handlers::UpstreamPool;
+
+// Stub upstream: answers each request read on a connection with the next scripted response
+class StubUpstream {
+public:
+    explicit StubUpstream(std::vector<std::string> responses) : _responses(std::move(responses)) {
+        _listen = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(_listen, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        _address.sin_family = AF_INET;
+        _address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        _address.sin_port = 0;
+        bind(_listen, reinterpret_cast<sockaddr*>(&_address), sizeof(_address));
+        socklen_t size = sizeof(_address);
+        getsockname(_listen, reinterpret_cast<sockaddr*>(&_address), &size);
+        listen(_listen, 8);
+        _thread = std::thread([this]() { serve(); });
+    }
+
+    ~StubUpstream() {
+        _stop = true;
+        shutdown(_listen, SHUT_RDWR);
+        close(_listen);
+        _thread.join();
+    }
+
+    const sockaddr_in& address() const { return _address; }
+    int accepted() const { return _accepted; }
+    std::string received() const { return _received; }
+
+private:
+    void serve() {
+        size_t next = 0;
+        while (!_stop && next < _responses.size()) {
+            int conn = accept(_listen, nullptr, nullptr);
+            if (conn < 0)
+                return;
+            ++_accepted;
+            std::string request;
+            char buffer[4096];
+            while (next < _responses.size()) {
+                ssize_t n = recv(conn, buffer, sizeof(buffer), 0);
+                if (n <= 0)
+                    break;
+                request.append(buffer, n);
+                if (request.find("\r\n\r\n") == std::string::npos)
+                    continue;
+                _received = request;
+                request.clear();
+                const std::string& response = _responses[next++];
+                if (response.empty())
+                    continue;   // never answers, for timeouts
+                send(conn, response.data(), response.size(), MSG_NOSIGNAL);
+            }
+            while (!_stop && next >= _responses.size() && recv(conn, buffer, sizeof(buffer), 0) > 0)
+                ;
+            close(conn);
+        }
+    }
+
+    std::vector<std::string> _responses;
+    int _listen;
+    sockaddr_in _address{};
+    std::thread _thread;
+    std::atomic<bool> _stop{false};
+    std::atomic<int> _accepted{0};
+    std::string _received;
+};
+
+// Utility: drive a job the way Cluster does, through its descriptor
+static bool waitForJob(PendingResponse& job, int rounds = 100) {
+    for (int i = 0; i < rounds && !job.done(); ++i) {
+        pollfd pfd = {job.fd(), job.events(), 0};
+        if (poll(&pfd, 1, 20) > 0)
+            job.onEvent(pfd.revents);
+    }
+    return job.done();
+}
+
+static Request makeRequest(const std::string& raw) {
+    bool kick_me = false;
+    return Parser::parseRequest(raw, kick_me, false);
+}
+
+static ProxyTarget makeTarget(UpstreamGroup& group) {
+    ProxyTarget target;
+    target.group = &group;
+    target.host = "upstream";
+    target.location = "/app";
+    target.uri = "/";
+    target.connectTimeout = 1000;
+    target.sendTimeout = 1000;
+    target.readTimeout = 1000;
+    return target;
+}
+
+// ✅ Test: proxy_pass URLs split into host, port and path
+TEST(ProxyTest, ParseUrl) {
+    std::string host;
+    std::string uri;
+    int port = 0;
+    EXPECT_TRUE(router::handlers::parseProxyUrl("http://127.0.0.1:8000/api/", host, port, uri));
+    EXPECT_EQ(host, "127.0.0.1");
+    EXPECT_EQ(port, 8000);
+    EXPECT_EQ(uri, "/api/");
+    EXPECT_TRUE(router::handlers::parseProxyUrl("http://backend", host, port, uri));
+    EXPECT_EQ(port, 80);
+    EXPECT_EQ(uri, "");
+    EXPECT_FALSE(router::handlers::parseProxyUrl("https://backend", host, port, uri));
+    EXPECT_FALSE(router::handlers::parseProxyUrl("http://backend:99999", host, port, uri));
+}
+
+// ✅ Test: location prefix rewritten, hop-by-hop headers dropped, buffered response passed back
+TEST(ProxyTest, ForwardsRequest) {
+    StubUpstream upstream({"HTTP/1.1 200 OK\r\nContent-Length: 5\r\nX-App: yes\r\n\r\nhello"});
+    UpstreamPool pool(upstream.address(), 4);
+    UpstreamGroup group(UpstreamGroup::ROUND_ROBIN);
+    group.addBackend("upstream", &pool, 1, 0, 0);
+    ProxyTarget target = makeTarget(group);
+    Server server;
+    Request req = makeRequest("GET /app/items HTTP/1.1\r\nHost: example.com\r\nConnection: keep-alive\r\n\r\n");
+
+    ProxyJob job(target, req, server, false, false);
+    ASSERT_TRUE(waitForJob(job));
+    Response res;
+    job.finish(res);
+    EXPECT_EQ(res.getStatus(), "200 OK");
+    EXPECT_EQ(res.getBody(), "hello");
+    ASSERT_EQ(res.getHeaders("X-App").size(), 1u);
+    EXPECT_EQ(res.getHeaders("X-App")[0], "yes");
+    EXPECT_EQ(upstream.received().rfind("GET /items HTTP/1.1\r\n", 0), 0u);
+    EXPECT_NE(upstream.received().find("host: example.com\r\n"), std::string::npos);
+    EXPECT_EQ(upstream.received().find("connection:"), std::string::npos);
+}
+
+// ✅ Test: a second request reuses the pooled connection
+TEST(ProxyTest, ReusesKeepAliveConnection) {
+    StubUpstream upstream({
+        "HTTP/1.1 200 OK\r\nContent-Length: 1\r\n\r\na",
+        "HTTP/1.1 200 OK\r\nContent-Length: 1\r\n\r\nb",
+    });
+    UpstreamPool pool(upstream.address(), 4);
+    UpstreamGroup group(UpstreamGroup::ROUND_ROBIN);
+    group.addBackend("upstream", &pool, 1, 0, 0);
+    ProxyTarget target = makeTarget(group);
+    Server server;
+    Request req = makeRequest("GET /app/ HTTP/1.1\r\nHost: example.com\r\n\r\n");
+
+    for (const char* expected : {"a", "b"}) {
+        ProxyJob job(target, req, server, false, false);
+        ASSERT_TRUE(waitForJob(job));
+        Response res;
+        job.finish(res);
+        EXPECT_EQ(res.getBody(), expected);
+    }
+    EXPECT_EQ(upstream.accepted(), 1);
+}
+
+// ✅ Test: a chunked upstream response streams to the client re-chunked
+TEST(ProxyTest, StreamsChunkedResponse) {
+    StubUpstream upstream({"HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n2\r\nde\r\n0\r\n\r\n"});
+    UpstreamPool pool(upstream.address(), 4);
+    UpstreamGroup group(UpstreamGroup::ROUND_ROBIN);
+    group.addBackend("upstream", &pool, 1, 0, 0);
+    ProxyTarget target = makeTarget(group);
+    Server server;
+    Request req = makeRequest("GET /app/ HTTP/1.1\r\nHost: example.com\r\n\r\n");
+
+    ProxyJob job(target, req, server);
+    ASSERT_TRUE(waitForJob(job));
+    ASSERT_TRUE(job.streaming());
+    Response res;
+    job.finish(res);
+    ASSERT_EQ(res.getHeaders(http::TRANSFER_ENCODING).size(), 1u);
+    EXPECT_EQ(res.getHeaders(http::TRANSFER_ENCODING)[0], http::TRANSFER_ENCODING_CHUNKED);
+    std::string body;
+    EXPECT_TRUE(job.takeBody(body));
+    EXPECT_EQ(body, "3\r\nabc\r\n2\r\nde\r\n0\r\n\r\n");
+}
+
+// ❌ Test: nothing listening answers 502
+TEST(ProxyTest, ConnectRefused) {
+    sockaddr_in address{};
+    {
+        StubUpstream closed({});
+        address = closed.address();
+    }
+    UpstreamPool pool(address, 4);
+    UpstreamGroup group(UpstreamGroup::ROUND_ROBIN);
+    group.addBackend("upstream", &pool, 1, 0, 0);
+    ProxyTarget target = makeTarget(group);
+    Server server;
+    Request req = makeRequest("GET /app/ HTTP/1.1\r\nHost: example.com\r\n\r\n");
+
+    ProxyJob job(target, req, server);
+    ASSERT_TRUE(waitForJob(job));
+    Response res;
+    job.finish(res);
+    EXPECT_EQ(res.getStatus(), http::STATUS_BAD_GATEWAY_502);
+}
+
+// ❌ Test: an upstream that never answers expires after proxy_read_timeout
+TEST(ProxyTest, ReadTimeout) {
+    StubUpstream upstream({""});
+    UpstreamPool pool(upstream.address(), 4);
+    UpstreamGroup group(UpstreamGroup::ROUND_ROBIN);
+    group.addBackend("upstream", &pool, 1, 0, 0);
+    ProxyTarget target = makeTarget(group);
+    target.readTimeout = 50;
+    Server server;
+    Request req = makeRequest("GET /app/ HTTP/1.1\r\nHost: example.com\r\n\r\n");
+
+    ProxyJob job(target, req, server);
+    EXPECT_FALSE(waitForJob(job, 10));
+    usleep(60000);
+    EXPECT_TRUE(job.expired(0));
+    job.abort(true);
+    Response res;
+    job.finish(res);
+    EXPECT_EQ(res.getStatus(), http::STATUS_GATEWAY_TIMEOUT_504);
+}
+
+// ✅ Test: a client going away mid-request is no failure of the backend
+TEST(ProxyTest, ClientAbortKeepsBackend) {
+    StubUpstream slow({""});
+    StubUpstream other({});
+    UpstreamPool slowPool(slow.address(), 4);
+    UpstreamPool otherPool(other.address(), 4);
+    UpstreamGroup group(UpstreamGroup::ROUND_ROBIN);
+    group.addBackend("slow", &slowPool, 1, 1, 10);
+    group.addBackend("other", &otherPool, 1, 1, 10);
+    UpstreamGroup::Backend* backend = &group.backends()[0];
+    ProxyTarget target = makeTarget(group);
+    Server server;
+    Request req = makeRequest("GET /app/ HTTP/1.1\r\nHost: example.com\r\n\r\n");
+
+    {
+        ProxyJob job(target, req, server);
+        EXPECT_FALSE(waitForJob(job, 5));
+        EXPECT_EQ(job.events(), POLLIN);   // request sent, waiting for the answer
+        job.abort(false);
+        EXPECT_TRUE(job.done());
+    }
+    EXPECT_EQ(backend->fails, 0u);
+    EXPECT_EQ(backend->active, 0u);
+    std::vector<UpstreamGroup::Backend*> picked;
+    for (int i = 0; i < 2; ++i) {
+        picked.push_back(group.pick(req));
+        group.release(picked.back());
+    }
+    EXPECT_NE(std::find(picked.begin(), picked.end(), backend), picked.end());
+}
+
+// ✅ Test: an unreachable backend is skipped and the request goes to the next one
+TEST(ProxyTest, FailsOverToNextBackend) {
+    sockaddr_in dead{};
+    {
+        StubUpstream closed({});
+        dead = closed.address();
+    }
+    StubUpstream upstream({"HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok"});
+    UpstreamPool deadPool(dead, 4);
+    UpstreamPool livePool(upstream.address(), 4);
+    UpstreamGroup group(UpstreamGroup::ROUND_ROBIN);
+    group.addBackend("dead", &deadPool, 1, 1, 10);
+    group.addBackend("live", &livePool, 1, 1, 10);
+    ProxyTarget target = makeTarget(group);
+    Server server;
+    Request req = makeRequest("GET /app/ HTTP/1.1\r\nHost: example.com\r\n\r\n");
+
+    ProxyJob job(target, req, server, false, false);
+    ASSERT_TRUE(waitForJob(job));
+    Response res;
+    job.finish(res);
+    EXPECT_EQ(res.getBody(), "ok");
+    EXPECT_EQ(upstream.accepted(), 1);
+}
+
+// ✅ Test: health probes GET the check path and report the status to the group
+TEST(ProxyTest, HealthProbe) {
+    StubUpstream upstream({
+        "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n",
+        "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n",
+    });
+    UpstreamPool pool(upstream.address(), 4);
+    UpstreamGroup group(UpstreamGroup::ROUND_ROBIN);
+    group.addBackend("upstream", &pool, 1, 1, 10);
+    UpstreamGroup::HealthCheck check;
+    check.path = "/health";
+    check.timeout = std::chrono::milliseconds(1000);
+    group.setHealthCheck(check);
+    UpstreamGroup::Backend& backend = group.backends()[0];
+
+    std::vector<std::shared_ptr<PendingResponse>> probes;
+    router::handlers::startDueProbes(group, std::chrono::steady_clock::now(), probes);
+    ASSERT_EQ(probes.size(), 1u);
+    EXPECT_TRUE(backend.probing);
+    ASSERT_TRUE(waitForJob(*probes[0]));
+    EXPECT_EQ(upstream.received().rfind("GET /health HTTP/1.1\r\n", 0), 0u);
+    EXPECT_TRUE(backend.healthy);
+    EXPECT_EQ(backend.probes, 1u);
+
+    // Not due again before the interval
+    probes.clear();
+    router::handlers::startDueProbes(group, std::chrono::steady_clock::now() - std::chrono::seconds(1), probes);
+    EXPECT_TRUE(probes.empty());
+
+    router::handlers::startDueProbes(group, backend.nextProbe, probes);
+    ASSERT_EQ(probes.size(), 1u);
+    ASSERT_TRUE(waitForJob(*probes[0]));
+    EXPECT_FALSE(backend.healthy);
+    EXPECT_EQ(backend.probeFailures, 1u);
+}
@@ -151,7 +151,7 @@ TEST(DecodeChunkedBodyTest, DecodeChunkedBinaryData) {
 	EXPECT_TRUE(client_state.data_validity);
 }
 
-// Test 7: Malformed chunk (incomplete)
+// Test 7: Incomplete chunk waits for the rest of the body
 TEST(DecodeChunkedBodyTest, HandleIncompleteChunk) {
 	ClientRequestState client_state;
 	client_state.max_body_size = 1000;
@@ -161,12 +161,29 @@ TEST(DecodeChunkedBodyTest, HandleIncompleteChunk) {
 	std::string expected =
 		"POST / HTTP/1.1\r\n"
 		"Content-Type: text/plain\r\n"
-		"\r\n";
+		"\r\n"
+		"Hello";
 
 	client_state.data_validity = true;
 	EXPECT_FALSE(decodeChunkedBody(client_state));
+	EXPECT_TRUE(client_state.data_validity);
 
-	// EXPECT_EQ(client_state.clean_buffer, expected);
+	client_state.buffer += "\r\n0\r\n\r\nGET";
+	EXPECT_TRUE(decodeChunkedBody(client_state));
+	EXPECT_EQ(client_state.clean_buffer, expected);
+	EXPECT_EQ(client_state.buffer, "GET");
+	EXPECT_TRUE(client_state.data_validity);
+}
+
+// Test 7b: Malformed chunk (data longer than its size)
+TEST(DecodeChunkedBodyTest, HandleMalformedChunk) {
+	ClientRequestState client_state;
+	client_state.max_body_size = 1000;
+	client_state.buffer =
+		"POST / HTTP/1.1\r\nContent-Type: text/plain\r\n\r\n3\r\nHello\r\n0\r\n\r\n";
+
+	client_state.data_validity = true;
+	EXPECT_FALSE(decodeChunkedBody(client_state));
 	EXPECT_FALSE(client_state.data_validity); // invalid chunk
 }
 
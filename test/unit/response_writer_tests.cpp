@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "../src/response/Response.hpp"
+#include "../src/server/HelperFunctions.hpp"
+
+// Every allocation of this test binary goes through here, so a test can count its own
+static std::atomic<size_t> g_allocations{0};
+
+void* operator new(std::size_t size) {
+    ++g_allocations;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    ++g_allocations;
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+// Utility: response as a static file handler leaves it
+static Response makeResponse() {
+    Response res;
+    res.setStatus("200 OK");
+    res.setHeaders("Content-Type", "text/html");
+    res.setHeaders("Content-Length", "11");
+    res.setHeaders("Last-Modified", "Sat, 17 Oct 2026 09:00:00 GMT");
+    res.setHeaders("Cache-Control", "public, max-age=3600");
+    res.setHeaders("Connection", "keep-alive");
+    res.setBody("hello world");
+    return res;
+}
+
+// ✅ Test: headers go out in the order they were set, after Date and Server
+TEST(ResponseWriterTest, InsertionOrder) {
+    std::string out = responseToString(makeResponse());
+    std::string expected = "HTTP/1.1 200 OK\r\n" + dateHeaderLine() + "Server: webserv/1.0\r\n"
+        "Content-Type: text/html\r\n"
+        "Content-Length: 11\r\n"
+        "Last-Modified: Sat, 17 Oct 2026 09:00:00 GMT\r\n"
+        "Cache-Control: public, max-age=3600\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n"
+        "hello world";
+    EXPECT_EQ(out, expected);
+}
+
+// ✅ Test: Date line is an IMF-fixdate
+TEST(ResponseWriterTest, DateLine) {
+    const std::string& line = dateHeaderLine();
+    ASSERT_EQ(line.size(), 37u);
+    EXPECT_EQ(line.rfind("Date: ", 0), 0u);
+    EXPECT_EQ(line.substr(line.size() - 6), " GMT\r\n");
+    EXPECT_EQ(line[9], ',');
+}
+
+// ✅ Test: Date and Server set by the handler are not doubled
+TEST(ResponseWriterTest, KeepsHandlerDateAndServer) {
+    Response res;
+    res.setStatus("200 OK");
+    res.setHeaders("server", "cgi");
+    res.setHeaders("Date", "Thu, 01 Jan 1970 00:00:00 GMT");
+    std::string out = responseToString(res);
+    EXPECT_EQ(out, "HTTP/1.1 200 OK\r\nserver: cgi\r\nDate: Thu, 01 Jan 1970 00:00:00 GMT\r\n\r\n");
+}
+
+// ✅ Test: values of a repeated header come back in order
+TEST(ResponseWriterTest, RepeatedHeader) {
+    Response res;
+    res.setHeaders("Set-Cookie", "a=1");
+    res.setHeaders("Content-Type", "text/plain");
+    res.setHeaders("Set-Cookie", "b=2");
+    EXPECT_EQ(res.getHeaders("Set-Cookie"), (std::vector<std::string>{"a=1", "b=2"}));
+    EXPECT_TRUE(res.getHeaders("Missing").empty());
+}
+
+// ✅ Test: serializing into a reused buffer allocates nothing
+TEST(ResponseWriterTest, ZeroAllocation) {
+    const Response res = makeResponse();
+    std::string buffer;
+    appendResponse(buffer, res);    // buffer capacity and the Date line
+
+    size_t before = g_allocations.load();
+    for (int i = 0; i < 100; ++i) {
+        buffer.clear();
+        appendResponse(buffer, res);
+    }
+    // The Date line is formatted again when the second changes, which reuses its storage
+    EXPECT_EQ(g_allocations.load() - before, 0u);
+}
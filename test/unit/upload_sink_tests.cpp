@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <poll.h>
+#include <unistd.h>
+#include "../src/router/handlers/FileIoPool.hpp"
+#include "../src/router/handlers/UploadSink.hpp"
+#include "../src/router/HttpConstants.hpp"
+#include "../src/server/Server.hpp"
+
+using router::handlers::FileIoPool;
+using router::handlers::UploadSink;
+
+// Utility: fresh upload directory per test
+class UploadSinkTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        _dir = std::filesystem::temp_directory_path() / ("webserv_upload_sink_" + std::to_string(getpid()));
+        std::filesystem::remove_all(_dir);
+        std::filesystem::create_directories(_dir);
+        _location.location = "/uploads";
+        _location.upload_path = _dir.string();
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(_dir);
+    }
+
+    // Body of file parts named by names, holding contents
+    static std::string body(const std::vector<std::pair<std::string, std::string>>& files) {
+        std::string text;
+        for (const auto& [name, content] : files) {
+            text += "--XyZ\r\n"
+                    "Content-Disposition: form-data; name=\"file\"; filename=\"" + name + "\"\r\n"
+                    "\r\n" + content + "\r\n";
+        }
+        return text + "--XyZ--\r\n";
+    }
+
+    // Feed body to a sink in small pieces, the way socket reads do
+    Response upload(const std::string& text) {
+        Request req;
+        req.setMethod("POST");
+        req.setPath("/uploads");
+        req.setHttpVersion("HTTP/1.1");
+        UploadSink sink(req, _server, &_location, "--XyZ");
+        for (size_t i = 0; i < text.size(); i += 7)
+            sink.write(text.data() + i, std::min<size_t>(7, text.size() - i));
+        Response res;
+        sink.finish(res);
+        return res;
+    }
+
+    // Feed body through the file I/O threads, waiting whenever the sink is full, the way Cluster does
+    Response uploadThroughPool(const std::string& text, size_t piece) {
+        FileIoPool pool(2, 16);
+        Request req;
+        req.setMethod("POST");
+        req.setPath("/uploads");
+        req.setHttpVersion("HTTP/1.1");
+        UploadSink sink(req, _server, &_location, "--XyZ", &pool);
+        for (size_t i = 0; i < text.size(); i += piece) {
+            sink.write(text.data() + i, std::min(piece, text.size() - i));
+            while (sink.full()) {
+                wait(sink.fd());
+                sink.onEvent();
+            }
+        }
+        Response res;
+        sink.finish(res);
+        std::shared_ptr<PendingResponse> job = res.getPending();
+        if (!job)
+            return res;
+        while (!job->done()) {
+            wait(job->fd());
+            job->onEvent(POLLIN);
+        }
+        Response done;
+        job->finish(done);
+        return done;
+    }
+
+    static void wait(int fd) {
+        pollfd entry = {fd, POLLIN, 0};
+        ASSERT_EQ(poll(&entry, 1, 5000), 1);
+    }
+
+    std::string read(const std::string& name) const {
+        std::ifstream in(_dir / name);
+        std::stringstream content;
+        content << in.rdbuf();
+        return content.str();
+    }
+
+    // Names in the upload directory, temporary files included
+    std::vector<std::string> files() const {
+        std::vector<std::string> names;
+        for (const auto& entry : std::filesystem::directory_iterator(_dir))
+            names.push_back(entry.path().filename().string());
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+    void put(const std::string& name, const std::string& content) const {
+        std::ofstream(_dir / name) << content;
+    }
+
+private:
+    std::filesystem::path _dir;
+    Location _location;
+    Server _server;
+};
+
+// ✅ Test: every file part is stored under its name and listed
+TEST_F(UploadSinkTest, StoresFiles) {
+    Response res = upload(body({{"a.txt", "first"}, {"b.txt", "second"}}));
+    EXPECT_EQ(res.getStatus(), http::STATUS_CREATED_201);
+    EXPECT_EQ(files(), (std::vector<std::string>{"a.txt", "b.txt"}));
+    EXPECT_EQ(read("a.txt"), "first");
+    EXPECT_EQ(read("b.txt"), "second");
+    EXPECT_NE(res.getBody().find("a.txt 5\n"), std::string::npos);
+}
+
+// ✅ Test: an existing file is kept, the upload gets the next free number
+TEST_F(UploadSinkTest, KeepsExistingFiles) {
+    put("report.pdf", "old");
+    put("report-1.pdf", "older");
+    Response res = upload(body({{"report.pdf", "new"}}));
+    EXPECT_EQ(res.getStatus(), http::STATUS_CREATED_201);
+    EXPECT_EQ(read("report.pdf"), "old");
+    EXPECT_EQ(read("report-1.pdf"), "older");
+    EXPECT_EQ(read("report-2.pdf"), "new");
+    EXPECT_NE(res.getBody().find("report-2.pdf 3\n"), std::string::npos);
+}
+
+// ✅ Test: the same name twice in one request stores both
+TEST_F(UploadSinkTest, DuplicateNames) {
+    Response res = upload(body({{"README", "one"}, {"README", "two"}}));
+    EXPECT_EQ(res.getStatus(), http::STATUS_CREATED_201);
+    EXPECT_EQ(files(), (std::vector<std::string>{"README", "README-1"}));
+    EXPECT_EQ(read("README"), "one");
+    EXPECT_EQ(read("README-1"), "two");
+}
+
+// ❌ Test: a file that cannot be stored takes the ones stored before it back
+TEST_F(UploadSinkTest, RollsBackOnFailure) {
+    put("keep.txt", "kept");
+    Response res = upload(body({{"a.txt", "first"}, {std::string(300, 'x'), "too long a name"}}));
+    EXPECT_EQ(res.getStatus().rfind("500", 0), 0u);
+    EXPECT_EQ(files(), std::vector<std::string>{"keep.txt"});
+    EXPECT_EQ(read("keep.txt"), "kept");
+}
+
+// ❌ Test: a cut off body stores nothing
+TEST_F(UploadSinkTest, IncompleteBody) {
+    std::string text = body({{"a.txt", "first"}});
+    Response res = upload(text.substr(0, text.size() - 9));
+    EXPECT_EQ(res.getStatus().rfind("400", 0), 0u);
+    EXPECT_TRUE(files().empty());
+}
+
+// ✅ Test: parts written on the file I/O threads, in batches, answered once stored
+TEST_F(UploadSinkTest, ThroughPool) {
+    std::string big(1 << 20, 'b');
+    Response res = uploadThroughPool(body({{"a.txt", "first"}, {"big.bin", big}}), 4096);
+    EXPECT_EQ(res.getStatus(), http::STATUS_CREATED_201);
+    EXPECT_EQ(files(), (std::vector<std::string>{"a.txt", "big.bin"}));
+    EXPECT_EQ(read("a.txt"), "first");
+    EXPECT_EQ(read("big.bin"), big);
+}
+
+// ❌ Test: a cut off body sent through the pool stores nothing
+TEST_F(UploadSinkTest, ThroughPoolIncomplete) {
+    std::string text = body({{"a.txt", "first"}});
+    Response res = uploadThroughPool(text.substr(0, text.size() - 9), 7);
+    EXPECT_EQ(res.getStatus().rfind("400", 0), 0u);
+    EXPECT_TRUE(files().empty());
+}
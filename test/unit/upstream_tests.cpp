@@ -0,0 +1,182 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <map>
+#include <set>
+#include "../src/router/handlers/Upstream.hpp"
+
+using router::handlers::UpstreamGroup;
+
+// Utility: request with a path and a client address
+static Request makeRequest(const std::string& path, const std::string& addr = "10.0.0.1") {
+    Request req;
+    req.setMethod("GET");
+    req.setPath(path);
+    req.setRemoteAddr(addr);
+    return req;
+}
+
+// Utility: pick and release at once, returning the backend name
+static std::string pickName(UpstreamGroup& group, const Request& req) {
+    UpstreamGroup::Backend* backend = group.pick(req);
+    if (!backend)
+        return "";
+    group.release(backend);
+    return backend->name;
+}
+
+// ✅ Test: weighted round robin interleaves backends by weight
+TEST(UpstreamGroupTest, SmoothWeightedRoundRobin) {
+    UpstreamGroup group(UpstreamGroup::ROUND_ROBIN);
+    group.addBackend("a", nullptr, 5, 1, 10);
+    group.addBackend("b", nullptr, 1, 1, 10);
+    group.addBackend("c", nullptr, 1, 1, 10);
+    Request req = makeRequest("/");
+
+    std::string order;
+    for (int i = 0; i < 7; ++i)
+        order += pickName(group, req);
+    EXPECT_EQ(order, "aabacaa");
+}
+
+// ✅ Test: least_conn sends new requests to the backend with fewest active ones
+TEST(UpstreamGroupTest, LeastConnections) {
+    UpstreamGroup group(UpstreamGroup::LEAST_CONN);
+    group.addBackend("a", nullptr, 1, 1, 10);
+    group.addBackend("b", nullptr, 1, 1, 10);
+    Request req = makeRequest("/");
+
+    UpstreamGroup::Backend* first = group.pick(req);
+    UpstreamGroup::Backend* second = group.pick(req);
+    EXPECT_NE(first, second);
+    group.release(first);
+    // first is idle again, second still busy
+    for (int i = 0; i < 3; ++i) {
+        UpstreamGroup::Backend* next = group.pick(req);
+        EXPECT_EQ(next, first);
+        group.release(next);
+    }
+}
+
+// ✅ Test: the same key lands on the same backend, and only keys of a removed backend move
+TEST(UpstreamGroupTest, ConsistentHash) {
+    UpstreamGroup group(UpstreamGroup::HASH_URI);
+    group.addBackend("a", nullptr, 1, 1, 10);
+    group.addBackend("b", nullptr, 1, 1, 10);
+    group.addBackend("c", nullptr, 1, 1, 10);
+
+    std::map<std::string, std::string> owner;
+    std::set<std::string> used;
+    for (int i = 0; i < 300; ++i) {
+        std::string path = "/item/" + std::to_string(i);
+        owner[path] = pickName(group, makeRequest(path));
+        used.insert(owner[path]);
+        EXPECT_EQ(pickName(group, makeRequest(path)), owner[path]);
+    }
+    EXPECT_EQ(used.size(), 3u);
+
+    // Take b out: its keys move, the others stay
+    auto owned = std::find_if(owner.begin(), owner.end(), [](const auto& entry) { return entry.second == "b"; });
+    UpstreamGroup::Backend* b = group.pick(makeRequest(owned->first));
+    ASSERT_EQ(b->name, "b");
+    group.report(b, false);
+    group.release(b);
+    for (const auto& [path, name] : owner) {
+        std::string now = pickName(group, makeRequest(path));
+        if (name == "b")
+            EXPECT_NE(now, "b");
+        else
+            EXPECT_EQ(now, name);
+    }
+}
+
+// ✅ Test: hash ip keeps a client on one backend
+TEST(UpstreamGroupTest, HashByClientAddress) {
+    UpstreamGroup group(UpstreamGroup::HASH_IP);
+    group.addBackend("a", nullptr, 1, 1, 10);
+    group.addBackend("b", nullptr, 1, 1, 10);
+
+    std::string first = pickName(group, makeRequest("/x", "192.168.1.7"));
+    EXPECT_EQ(pickName(group, makeRequest("/y", "192.168.1.7")), first);
+    EXPECT_EQ(pickName(group, makeRequest("/z", "192.168.1.7")), first);
+}
+
+// ❌ Test: max_fails failures take a backend out; one failing again on return stays out longer
+TEST(UpstreamGroupTest, PassiveFailuresWithBackoff) {
+    UpstreamGroup group(UpstreamGroup::ROUND_ROBIN);
+    group.addBackend("a", nullptr, 1, 2, 1);
+    group.addBackend("b", nullptr, 1, 2, 1);
+    Request req = makeRequest("/");
+    UpstreamGroup::Backend* a = group.pick(req);
+    group.release(a);
+    ASSERT_EQ(a->name, "a");
+
+    group.report(a, false);
+    EXPECT_EQ(a->downUntil, std::chrono::steady_clock::time_point{});
+    group.report(a, false);
+    for (int i = 0; i < 4; ++i)
+        EXPECT_EQ(pickName(group, req), "b");
+
+    // Back after fail_timeout, on probation: one failure doubles the time out
+    a->downUntil = std::chrono::steady_clock::now();
+    group.report(a, false);
+    auto out = a->downUntil - std::chrono::steady_clock::now();
+    EXPECT_GT(out, std::chrono::milliseconds(1500));
+    EXPECT_EQ(a->backoff, 2u);
+
+    // A success once it is back ends the backoff
+    a->downUntil = std::chrono::steady_clock::now();
+    group.report(a, true);
+    EXPECT_EQ(a->backoff, 0u);
+}
+
+// ❌ Test: nothing to pick when every backend is out; a lone backend never is
+TEST(UpstreamGroupTest, NoLiveBackend) {
+    UpstreamGroup lone(UpstreamGroup::ROUND_ROBIN);
+    lone.addBackend("a", nullptr, 1, 1, 10);
+    UpstreamGroup::Backend* a = lone.pick(makeRequest("/"));
+    lone.report(a, false);
+    lone.release(a);
+    EXPECT_EQ(pickName(lone, makeRequest("/")), "a");
+
+    UpstreamGroup group(UpstreamGroup::ROUND_ROBIN);
+    group.addBackend("a", nullptr, 1, 1, 10);
+    group.addBackend("b", nullptr, 1, 1, 10);
+    for (int i = 0; i < 2; ++i) {
+        UpstreamGroup::Backend* backend = group.pick(makeRequest("/"));
+        group.report(backend, false);
+        group.release(backend);
+    }
+    EXPECT_EQ(group.pick(makeRequest("/")), nullptr);
+}
+
+// ❌ Test: fall failed probes take a backend out, rise passed ones bring it back
+TEST(UpstreamGroupTest, HealthCheckRiseAndFall) {
+    UpstreamGroup group(UpstreamGroup::ROUND_ROBIN);
+    group.addBackend("a", nullptr, 1, 1, 10);
+    group.addBackend("b", nullptr, 1, 1, 10);
+    UpstreamGroup::HealthCheck check;
+    check.path = "/health";
+    check.rise = 2;
+    check.fall = 2;
+    group.setHealthCheck(check);
+    UpstreamGroup::Backend* a = &group.backends()[0];
+    Request req = makeRequest("/");
+
+    group.probed(a, false, std::chrono::microseconds(100));
+    EXPECT_TRUE(a->healthy);
+    group.probed(a, true, std::chrono::microseconds(100));
+    group.probed(a, false, std::chrono::microseconds(100));
+    EXPECT_TRUE(a->healthy);   // not in a row
+    group.probed(a, false, std::chrono::microseconds(100));
+    EXPECT_FALSE(a->healthy);
+    for (int i = 0; i < 3; ++i)
+        EXPECT_EQ(pickName(group, req), "b");
+
+    group.probed(a, true, std::chrono::microseconds(250));
+    EXPECT_FALSE(a->healthy);
+    group.probed(a, true, std::chrono::microseconds(250));
+    EXPECT_TRUE(a->healthy);
+    EXPECT_EQ(a->latency, std::chrono::microseconds(250));
+    EXPECT_EQ(a->probes, 6u);
+    EXPECT_EQ(a->probeFailures, 3u);
+}